@@ -1,15 +1,21 @@
 #include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnFusionPass.h"
 #include "FHN/FhnMovementPlan.h"
+#include "FHN/FhnPartitioner.h"
+#include "FHN/FhnSchedulePass.h"
+#include "FHN/FhnTrace.h"
 #include "corpus_backend.h"
 #include "corpus_oracle.h"
 #include "corpus_shapes.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cinttypes>
 #include <cstdio>
 #include <cstring>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 using namespace fhenomenon;
@@ -36,10 +42,102 @@ uint32_t maxWorkingSet(const FhnProgram &program) {
   return max_ws;
 }
 
+// Timed repetitions per side of the fused-vs-unfused comparison.
+constexpr uint32_t kFusionReps = 5;
+
+// FhnPlanOptions::prefetch_lookahead of the lookahead report and variant.
+constexpr uint32_t kPrefetchLookahead = 4;
+
+// Device counts of the partition report.
+constexpr uint32_t kPartitionDevices[2] = {2, 4};
+
+// Encrypts slot 0 of every shape input, executes `program` under `plan` and
+// checks each shape output against the oracle's `expected` values. A plan
+// with slot assignment runs its own rewritten program on its slot table.
+// Returns the execute() wall time in ms, or nullopt on any failure.
+std::optional<double> executeVerified(const CorpusBackend &backend, FhnDefaultExecutor &executor,
+                                      const Shape &shape, const FhnProgram &program, const FhnMovementPlan &plan,
+                                      const std::map<uint32_t, Slots> &expected) {
+  const FhnProgram &run = plan.program() ? *plan.program() : program;
+  std::vector<FhnBuffer *> buffers(plan.tableSize(), nullptr);
+  bool ok = true;
+  for (const auto &[id, slots] : shape.inputs) {
+    FhnBuffer *&buf = buffers[plan.slotOf(id)];
+    buf = backend.bufferAlloc()(backend.ctx());
+    if (!buf || backend.encryptI64()(backend.ctx(), buf, slots[0]) != 0) {
+      ok = false;
+      break;
+    }
+  }
+
+  FhnMovementHooks hooks{backend.ctx(), backend.bufferAlloc(), backend.bufferFree(), backend.prefetch(),
+                         backend.evict()};
+  const auto t0 = std::chrono::steady_clock::now();
+  if (ok && executor.execute(hooks, &run, buffers.data(), plan) != 0)
+    ok = false;
+  const auto t1 = std::chrono::steady_clock::now();
+
+  for (uint32_t out : shape.output_ids) {
+    if (!ok)
+      break;
+    int64_t got = 0;
+    if (backend.decryptI64()(backend.ctx(), buffers[plan.slotOf(out)], &got) != 0 || got != expected.at(out)[0]) {
+      std::fprintf(stderr, "FAIL %s: output id %u got %" PRId64 " want %" PRId64 "\n", shape.name.c_str(), out, got,
+                   expected.at(out)[0]);
+      ok = false;
+    }
+  }
+
+  for (FhnBuffer *buf : buffers)
+    if (buf)
+      backend.bufferFree()(backend.ctx(), buf);
+  if (!ok)
+    return std::nullopt;
+  return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+// --timeline: appends one plan's residency timeline to `out`, as CSV rows
+// prefixed with shape, policy and budget, or as one entry of a JSON array.
+void appendTimeline(std::string &out, bool csv, const std::string &shape, const char *policy, uint64_t budget,
+                    const FhnMovementPlan &plan) {
+  const std::string prefix = shape + ',' + policy + ',' + std::to_string(budget) + ',';
+  if (csv) {
+    const std::string rows = plan.timelineCsv();
+    for (size_t line = rows.find('\n') + 1; line < rows.size();) {
+      const size_t end = rows.find('\n', line) + 1;
+      out += prefix;
+      out.append(rows, line, end - line);
+      line = end;
+    }
+    return;
+  }
+  if (!out.empty())
+    out += ',';
+  out += "\n{\"shape\":\"" + shape + "\",\"policy\":\"" + policy + "\",\"budget\":" + std::to_string(budget) +
+         ",\"timeline\":" + plan.timelineJson() + '}';
+}
+
+// Bottleneck summary of one timeline: "<peak> at <count> insts (first i<k>)".
+std::string bottlenecks(const FhnMovementPlan &plan) {
+  size_t count = 0;
+  size_t first = 0;
+  size_t peak = 0;
+  for (size_t i = 0; i < plan.timeline().size(); ++i) {
+    const FhnTimelinePoint &point = plan.timeline()[i];
+    if (!point.bottleneck)
+      continue;
+    if (count++ == 0)
+      first = i;
+    peak = point.resident.size();
+  }
+  return std::to_string(peak) + " at " + std::to_string(count) + " insts (first i" + std::to_string(first) + ")";
+}
+
 void usage(const char *argv0) {
   std::fprintf(stderr,
                "usage: %s [--backend <lib.so>] [--prefix <sym, default toyfhe_>] "
-               "[--shape <name>] [--max-depth <N>] [--list] [--budget-bytes <N|min>]\n",
+               "[--shape <name>] [--max-depth <N>] [--list] [--budget-bytes <N|min>] [--trace <out.json>] "
+               "[--timeline <out.json|out.csv>]\n",
                argv0);
 }
 
@@ -73,6 +171,8 @@ int main(int argc, char **argv) {
   bool budget_bytes_given = false;
   bool budget_bytes_min = false;
   uint64_t budget_bytes = 0;
+  std::string trace_path;
+  std::string timeline_path;
 
   for (int i = 1; i < argc; ++i) {
     if (std::strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
@@ -83,6 +183,10 @@ int main(int argc, char **argv) {
       only_shape = argv[++i];
     } else if (std::strcmp(argv[i], "--max-depth") == 0 && i + 1 < argc) {
       max_depth = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      trace_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--timeline") == 0 && i + 1 < argc) {
+      timeline_path = argv[++i];
     } else if (std::strcmp(argv[i], "--list") == 0) {
       list_only = true;
     } else if (std::strcmp(argv[i], "--budget-bytes") == 0 && i + 1 < argc) {
@@ -151,9 +255,44 @@ int main(int argc, char **argv) {
   bool failed = false;
   uint64_t total_belady = 0;
   uint64_t total_lru = 0;
+  uint64_t total_remat = 0;
+  uint64_t total_prefetches = 0;
+  uint64_t total_hoisted = 0;
+  uint64_t total_hoist_distance = 0;
+  uint64_t total_hw_lowered = 0;
+  uint64_t total_hw_scheduled = 0;
+  uint64_t total_mid_lowered = 0;
+  uint64_t total_mid_scheduled = 0;
+  double total_serial = 0.0;
+  double total_makespan[2] = {0.0, 0.0}; // by kPartitionDevices entry
+  uint64_t total_cut[2] = {0, 0};
   std::vector<double> shape_savings;
-  std::printf("%-14s %6s %-11s | %8s %14s %14s %8s\n", "shape", "budget", "point", "hw", "belady p/e", "lru p/e",
-              "saved");
+  double total_unfused_ms = 0.0;
+  double total_fused_ms = 0.0;
+  // --trace: the verification run of every executed shape (and of its
+  // fused form) is traced on its own track; timed repetitions are not.
+  FhnTrace trace;
+  FhnTrace *const trace_sink = trace_path.empty() ? nullptr : &trace;
+  std::printf("%-14s %6s %-11s | %8s %14s %14s %8s %16s\n", "shape", "budget", "point", "hw", "belady p/e", "lru p/e",
+              "saved", "remat p/e/r");
+  // Belady with rematerialization (built-in cheap-op set): transfers it
+  // replaces with recomputation of the discarded values.
+  FhnPlanOptions remat_options;
+  remat_options.rematerialize = true;
+  // Belady with prefetch lookahead: prefetches that start early enough
+  // to overlap the compute before their use.
+  FhnPlanOptions lookahead_options;
+  lookahead_options.prefetch_lookahead = kPrefetchLookahead;
+  // --timeline: per-instruction residency of every shape at B_mid under
+  // both policies, in one CSV (by the path's extension) or JSON document.
+  const bool timeline_csv =
+    timeline_path.size() >= 4 && timeline_path.compare(timeline_path.size() - 4, 4, ".csv") == 0;
+  std::string timeline_out =
+    timeline_csv ? "shape,policy,budget,index,resident_count,resident_bytes,transfers,transfer_bytes,bottleneck,"
+                   "resident\n"
+                 : "";
+  FhnPlanOptions timeline_options;
+  timeline_options.record_timeline = true;
 
   for (const auto &shape : shapes) {
     if (!only_shape.empty() && shape.name != only_shape)
@@ -176,7 +315,11 @@ int main(int argc, char **argv) {
     for (uint32_t budget : points) {
       auto belady = FhnMovementPlan::analyze(*shape.program, shape.output_ids, budget, FhnEvictionPolicy::Belady);
       auto lru = FhnMovementPlan::analyze(*shape.program, shape.output_ids, budget, FhnEvictionPolicy::Lru);
-      if (!belady || !lru) {
+      auto remat = FhnMovementPlan::analyze(*shape.program, shape.output_ids, budget, FhnEvictionPolicy::Belady,
+                                            nullptr, remat_options);
+      auto ahead = FhnMovementPlan::analyze(*shape.program, shape.output_ids, budget, FhnEvictionPolicy::Belady,
+                                            nullptr, lookahead_options);
+      if (!belady || !lru || !remat || !ahead) {
         std::fprintf(stderr, "FAIL %s: budget %u infeasible\n", shape.name.c_str(), budget);
         failed = true;
         continue;
@@ -202,17 +345,38 @@ int main(int argc, char **argv) {
           tag += "=";
         tag += "hw";
       }
-      std::printf("%-14s %6u %-11s | %8u %7u/%-6u %7u/%-6u %7.1f%%\n", shape.name.c_str(), budget, tag.c_str(), hw,
-                  belady->stats().prefetch_count, belady->stats().evict_count, lru->stats().prefetch_count,
-                  lru->stats().evict_count, saved);
+      std::printf("%-14s %6u %-11s | %8u %7u/%-6u %7u/%-6u %7.1f%% %7u/%u/%u\n", shape.name.c_str(), budget, tag.c_str(),
+                  hw, belady->stats().prefetch_count, belady->stats().evict_count, lru->stats().prefetch_count,
+                  lru->stats().evict_count, saved, remat->stats().prefetch_count, remat->stats().evict_count,
+                  remat->stats().recompute_count);
       if (budget == b_mid && !counted) {
         total_belady += tb;
         total_lru += tl;
+        total_remat += transfers(remat->stats());
+        total_prefetches += ahead->stats().prefetch_count;
+        total_hoisted += ahead->stats().hoisted_prefetch_count;
+        total_hoist_distance += ahead->stats().hoist_distance;
         shape_savings.push_back(saved);
         counted = true;
       }
     }
 
+    if (!timeline_path.empty()) {
+      auto belady = FhnMovementPlan::analyze(*shape.program, shape.output_ids, b_mid, FhnEvictionPolicy::Belady,
+                                             nullptr, timeline_options);
+      auto lru = FhnMovementPlan::analyze(*shape.program, shape.output_ids, b_mid, FhnEvictionPolicy::Lru, nullptr,
+                                          timeline_options);
+      if (!belady || !lru) {
+        std::fprintf(stderr, "FAIL %s: timeline plans infeasible at B_mid\n", shape.name.c_str());
+        failed = true;
+      } else {
+        appendTimeline(timeline_out, timeline_csv, shape.name, "belady", b_mid, *belady);
+        appendTimeline(timeline_out, timeline_csv, shape.name, "lru", b_mid, *lru);
+        std::printf("timeline[%s] @B_mid=%u: belady peak %s, lru peak %s\n", shape.name.c_str(), b_mid,
+                    bottlenecks(*belady).c_str(), bottlenecks(*lru).c_str());
+      }
+    }
+
     // Byte-mode report: hw_bytes from an unlimited byte-mode analysis, then
     // both policies at budget_bytes. Pinned set matches the slot sweep
     // above (outputs only) — not the execution pass's inputs∪outputs.
@@ -227,11 +391,70 @@ int main(int argc, char **argv) {
         std::fprintf(stderr, "FAIL %s: byte-budget infeasible/model invalid\n", shape.name.c_str());
         failed = true;
       } else {
+        const FhnMovementPlan::Stats &pool = hw_bytes_plan->stats();
         std::printf("movement-bytes[%s]: hw_bytes=%" PRIu64 " belady p/e=%u/%u lru p/e=%u/%u (budget-bytes %" PRIu64
-                    ")\n",
-                    shape.name.c_str(), hw_bytes_plan->stats().high_water_bytes, belady_bytes->stats().prefetch_count,
+                    ") pool hits cold/warm=%u/%u of %u\n",
+                    shape.name.c_str(), pool.high_water_bytes, belady_bytes->stats().prefetch_count,
                     belady_bytes->stats().evict_count, lru_bytes->stats().prefetch_count,
-                    lru_bytes->stats().evict_count, budget_bytes);
+                    lru_bytes->stats().evict_count, budget_bytes, pool.pool_hits, pool.pool_warm_hits,
+                    pool.alloc_count);
+      }
+    }
+
+    // Slot assignment: buffer table size, allocations and high water of
+    // the unlimited plan once ids are colored onto reusable slots.
+    FhnPlanOptions slot_options;
+    slot_options.assign_slots = true;
+    auto slotted = FhnMovementPlan::analyze(*shape.program, shape.output_ids, 0, FhnEvictionPolicy::Belady, nullptr,
+                                            slot_options);
+    if (!slotted) {
+      std::fprintf(stderr, "FAIL %s: slot assignment rejected the program\n", shape.name.c_str());
+      failed = true;
+    } else {
+      std::printf("slots[%s]: ids %u -> slots %u, allocs %u -> %u, hw %u -> %u\n", shape.name.c_str(),
+                  unlimited->tableSize() - 1, slotted->tableSize() - 1, unlimited->stats().alloc_count,
+                  slotted->stats().alloc_count, hw, slotted->stats().high_water);
+    }
+
+    // Reordering: peak live set unbudgeted and transfers at B_mid, for the
+    // lowered order and after FhnSchedulePass (which keeps the lowered
+    // order unless its own scores better).
+    FhnSchedulePass::Stats hw_schedule;
+    FhnSchedulePass::Stats mid_schedule;
+    FhnProgramPtr scheduled(FhnSchedulePass::run(*shape.program, shape.output_ids, 0, nullptr, &hw_schedule),
+                            &fhn_program_free);
+    FhnProgramPtr scheduled_mid(FhnSchedulePass::run(*shape.program, shape.output_ids, b_mid, nullptr, &mid_schedule),
+                                &fhn_program_free);
+    if (!scheduled || !scheduled_mid) {
+      std::fprintf(stderr, "FAIL %s: scheduling pass rejected the program\n", shape.name.c_str());
+      failed = true;
+    } else {
+      std::printf("schedule[%s]: hw %u -> %u (%u moved), @B_mid transfers %" PRIu64 " -> %" PRIu64 " (%u moved)\n",
+                  shape.name.c_str(),
+                  hw_schedule.before.high_water, hw_schedule.after.high_water, hw_schedule.moved,
+                  transfers(mid_schedule.before), transfers(mid_schedule.after), mid_schedule.moved);
+      total_hw_lowered += hw_schedule.before.high_water;
+      total_hw_scheduled += hw_schedule.after.high_water;
+      total_mid_lowered += transfers(mid_schedule.before);
+      total_mid_scheduled += transfers(mid_schedule.after);
+    }
+
+    // Multi-device split (estimate only: unit instruction and copy costs).
+    std::optional<FhnPartitioner::Partition> splits[2];
+    for (size_t k = 0; k < 2; ++k)
+      splits[k] = FhnPartitioner::partition(*shape.program, shape.output_ids, kPartitionDevices[k]);
+    if (!splits[0] || !splits[1]) {
+      std::fprintf(stderr, "FAIL %s: partitioner rejected the program\n", shape.name.c_str());
+      failed = true;
+    } else {
+      std::printf("partition[%s]: serial %.0f, N=%u makespan %.0f (%u copies), N=%u makespan %.0f (%u copies)\n",
+                  shape.name.c_str(), splits[0]->stats.serial, kPartitionDevices[0], splits[0]->stats.makespan,
+                  splits[0]->stats.transfers, kPartitionDevices[1], splits[1]->stats.makespan,
+                  splits[1]->stats.transfers);
+      total_serial += splits[0]->stats.serial;
+      for (size_t k = 0; k < 2; ++k) {
+        total_makespan[k] += splits[k]->stats.makespan;
+        total_cut[k] += splits[k]->stats.transfers;
       }
     }
 
@@ -252,51 +475,91 @@ int main(int argc, char **argv) {
           continue;
         }
 
-        uint32_t max_id = 0;
-        for (uint32_t i = 0; i < shape.program->num_instructions; ++i)
-          max_id = std::max(max_id, shape.program->instructions[i].result_id);
-        for (uint32_t i = 0; i < shape.program->num_inputs; ++i)
-          max_id = std::max(max_id, shape.program->input_ids[i]);
-
-        std::vector<FhnBuffer *> buffers(max_id + 1, nullptr);
-        bool exec_ok = true;
-        for (const auto &[id, slots] : shape.inputs) {
-          buffers[id] = backend->bufferAlloc()(backend->ctx());
-          if (!buffers[id] || backend->encryptI64()(backend->ctx(), buffers[id], slots[0]) != 0) {
-            exec_ok = false;
-            break;
-          }
+        auto expected = evaluate(*shape.program, shape.inputs);
+        if (trace_sink)
+          trace.beginTrack(shape.name);
+        executor.setTraceSink(trace_sink);
+        const std::optional<double> unfused_ms =
+          expected ? executeVerified(*backend, executor, shape, *shape.program, *plan, *expected) : std::nullopt;
+        executor.setTraceSink(nullptr);
+        if (!unfused_ms) {
+          std::fprintf(stderr, "FAIL %s: execution/verification failed\n", shape.name.c_str());
+          failed = true;
+          continue;
         }
+        // The same program on colored slots, unbudgeted and at B_mid,
+        // rematerializing at B_mid with and without slots, and with
+        // prefetch lookahead at B_mid (synchronous copies on a backend
+        // without the async pair).
+        bool variants_ok = true;
+        FhnPlanOptions slot_remat = remat_options;
+        slot_remat.assign_slots = true;
+        FhnPlanOptions slot_lookahead = lookahead_options;
+        slot_lookahead.assign_slots = true;
+        const std::pair<uint64_t, const FhnPlanOptions *> variants[] = {
+          {0, &slot_options},   {b_mid, &slot_options},      {b_mid, &remat_options},
+          {b_mid, &slot_remat}, {b_mid, &lookahead_options}, {b_mid, &slot_lookahead}};
+        for (const auto &[budget, options] : variants) {
+          auto variant =
+            FhnMovementPlan::analyze(*shape.program, pinned, budget, FhnEvictionPolicy::Belady, nullptr, *options);
+          variants_ok = variants_ok && variant &&
+                        executeVerified(*backend, executor, shape, *shape.program, *variant, *expected).has_value();
+        }
+        if (!variants_ok) {
+          std::fprintf(stderr, "FAIL %s: slot-assigned/rematerialized/lookahead execution/verification failed\n",
+                       shape.name.c_str());
+          failed = true;
+          continue;
+        }
+        // The reordered program at B_mid, planned with the execution pins.
+        FhnProgramPtr reordered(FhnSchedulePass::run(*shape.program, pinned, b_mid), &fhn_program_free);
+        auto reordered_plan = reordered ? FhnMovementPlan::analyze(*reordered, pinned, b_mid) : std::nullopt;
+        if (!reordered_plan ||
+            !executeVerified(*backend, executor, shape, *reordered, *reordered_plan, *expected).has_value()) {
+          std::fprintf(stderr, "FAIL %s: reordered execution/verification failed\n", shape.name.c_str());
+          failed = true;
+          continue;
+        }
+        std::printf("%-14s executed and verified on backend\n", shape.name.c_str());
 
-        FhnMovementHooks hooks{backend->ctx(), backend->bufferAlloc(), backend->bufferFree(), backend->prefetch(),
-                               backend->evict()};
-        if (exec_ok && executor.execute(hooks, shape.program.get(), buffers.data(), *plan) != 0)
-          exec_ok = false;
-
-        auto expected = evaluate(*shape.program, shape.inputs);
-        if (exec_ok && expected) {
-          for (uint32_t out : shape.output_ids) {
-            int64_t got = 0;
-            if (backend->decryptI64()(backend->ctx(), buffers[out], &got) != 0 || got != expected->at(out)[0]) {
-              std::fprintf(stderr, "FAIL %s: output id %u got %" PRId64 " want %" PRId64 "\n", shape.name.c_str(), out,
-                           got, expected->at(out)[0]);
-              exec_ok = false;
-            }
+        // Fused vs unfused: the same shape after FhnFusionPass, verified
+        // against the same oracle values, best of kFusionReps each.
+        FhnFusionPass::Stats fusion;
+        FhnProgramPtr fused(FhnFusionPass::run(executor, *shape.program, pinned, &fusion), &fhn_program_free);
+        if (!fused || fusion.fused() == 0)
+          continue;
+        // Fusion can stretch a producer operand's live range to the
+        // consumer, so the fused program may need one more resident slot.
+        auto fused_plan = FhnMovementPlan::analyze(*fused, pinned, std::max(b_mid, maxWorkingSet(*fused)),
+                                                   FhnEvictionPolicy::Belady);
+        double best_unfused = *unfused_ms;
+        double best_fused = -1.0;
+        for (uint32_t rep = 0; fused_plan && rep < kFusionReps; ++rep) {
+          const auto u = rep == 0 ? unfused_ms
+                                  : executeVerified(*backend, executor, shape, *shape.program, *plan, *expected);
+          if (rep == 0 && trace_sink)
+            trace.beginTrack(shape.name + " (fused)");
+          executor.setTraceSink(rep == 0 ? trace_sink : nullptr);
+          const auto f = executeVerified(*backend, executor, shape, *fused, *fused_plan, *expected);
+          executor.setTraceSink(nullptr);
+          if (!u || !f) {
+            fused_plan.reset();
+            break;
           }
-        } else if (exec_ok) {
-          exec_ok = false;
+          best_unfused = std::min(best_unfused, *u);
+          best_fused = best_fused < 0.0 ? *f : std::min(best_fused, *f);
         }
-
-        for (uint32_t id = 1; id <= max_id; ++id)
-          if (buffers[id])
-            backend->bufferFree()(backend->ctx(), buffers[id]);
-
-        if (!exec_ok) {
-          std::fprintf(stderr, "FAIL %s: execution/verification failed\n", shape.name.c_str());
+        if (!fused_plan) {
+          std::fprintf(stderr, "FAIL %s: fused program failed planning/execution/verification\n", shape.name.c_str());
           failed = true;
-        } else {
-          std::printf("%-14s executed and verified on backend\n", shape.name.c_str());
+          continue;
         }
+        total_unfused_ms += best_unfused;
+        total_fused_ms += best_fused;
+        std::printf("fusion[%s]: insts %u -> %u (hrot_add=%u mad=%u hmult=%u) unfused %.3f ms fused %.3f ms -> %.2fx\n",
+                    shape.name.c_str(), shape.program->num_instructions, fused->num_instructions, fusion.hrot_add,
+                    fusion.mad, fusion.hmult, best_unfused, best_fused,
+                    best_fused > 0.0 ? best_unfused / best_fused : 0.0);
       }
     }
   }
@@ -306,6 +569,22 @@ int main(int argc, char **argv) {
                 total_lru,
                 100.0 * (static_cast<double>(total_lru) - static_cast<double>(total_belady)) /
                   static_cast<double>(total_lru));
+    std::printf("aggregate @B_mid: belady=%" PRIu64 " belady+remat=%" PRIu64 " transfers -> remat saves %.1f%%\n",
+                total_belady, total_remat,
+                total_belady == 0 ? 0.0
+                                  : 100.0 * (static_cast<double>(total_belady) - static_cast<double>(total_remat)) /
+                                      static_cast<double>(total_belady));
+    std::printf("aggregate @B_mid: lookahead k=%u issues %" PRIu64 " of %" PRIu64
+                " prefetches async, %.1f instructions ahead on average\n",
+                kPrefetchLookahead, total_hoisted, total_prefetches,
+                total_hoisted == 0 ? 0.0
+                                   : static_cast<double>(total_hoist_distance) / static_cast<double>(total_hoisted));
+    std::printf("aggregate schedule: Σhw %" PRIu64 " -> %" PRIu64 ", @B_mid transfers %" PRIu64 " -> %" PRIu64 "\n",
+                total_hw_lowered, total_hw_scheduled, total_mid_lowered, total_mid_scheduled);
+    std::printf("aggregate partition: Σ est. makespan %.0f serial, %.0f on %u devices (%" PRIu64 " copies), %.0f on %u "
+                "(%" PRIu64 " copies)\n",
+                total_serial, total_makespan[0], kPartitionDevices[0], total_cut[0], total_makespan[1],
+                kPartitionDevices[1], total_cut[1]);
     std::vector<double> sorted_savings = shape_savings;
     std::sort(sorted_savings.begin(), sorted_savings.end());
     const size_t n = sorted_savings.size();
@@ -313,5 +592,30 @@ int main(int argc, char **argv) {
       (n % 2 == 1) ? sorted_savings[n / 2] : (sorted_savings[n / 2 - 1] + sorted_savings[n / 2]) / 2.0;
     std::printf("median per-shape savings @B_mid: %.1f%%\n", median);
   }
+  if (total_fused_ms > 0.0) {
+    std::printf("aggregate fusion: unfused %.3f ms fused %.3f ms -> %.2fx\n", total_unfused_ms, total_fused_ms,
+                total_unfused_ms / total_fused_ms);
+  }
+  if (trace_sink) {
+    std::printf("\nper-opcode latency (%zu traced instructions):\n%s", trace.events().size(),
+                trace.histogramText().c_str());
+    if (trace.writeChromeJson(trace_path) != 0) {
+      std::fprintf(stderr, "error: cannot write trace to %s\n", trace_path.c_str());
+      return 1;
+    }
+    std::printf("chrome trace written to %s\n", trace_path.c_str());
+  }
+  if (!timeline_path.empty()) {
+    if (!timeline_csv)
+      timeline_out = "[" + timeline_out + "\n]\n";
+    std::FILE *f = std::fopen(timeline_path.c_str(), "w");
+    const bool written =
+      f != nullptr && std::fwrite(timeline_out.data(), 1, timeline_out.size(), f) == timeline_out.size();
+    if (f == nullptr || std::fclose(f) != 0 || !written) {
+      std::fprintf(stderr, "error: cannot write timeline to %s\n", timeline_path.c_str());
+      return 1;
+    }
+    std::printf("residency timeline written to %s\n", timeline_path.c_str());
+  }
   return failed ? 1 : 0;
 }
@@ -0,0 +1,240 @@
+// fhn-bench-async — host/backend overlap through the async control plane.
+//
+// A stream of batches runs ONE program (an encrypted dot product of a fresh
+// n-slot vector x_b with a fixed weight vector w):
+//   p = HMULT(x_b, w)
+//   t = HROT_ADD(t, t)  d = n/2, n/4, ..., 1
+// Each batch needs host work on both sides of the kernels: x_b is encrypted
+// before submission and the result decrypted afterwards. Two paths:
+//   serial:    encrypt -> execute -> decrypt, one batch at a time;
+//   pipelined: FhnDefaultExecutor::executePipelined over ToyFHE's
+//              fhn_submit/fhn_wait worker, so batch b + 1 is encrypted while
+//              batch b runs on the backend.
+// With a single core the two paths only interleave; the overlap shows up as
+// a speedup once host and worker threads can run on separate cores.
+//
+// Noise headroom matches fhn-bench-matvec: entries in [0, 9], n <= 512.
+
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/ToyFheKernels.h"
+#include "FHN/fhn_program.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct TimingStats {
+  double median_ms = 0.0;
+  double min_ms = 0.0;
+};
+
+TimingStats time_path(const char *label, uint32_t reps, const std::function<int()> &run) {
+  if (run() != 0) {
+    std::fprintf(stderr, "FATAL: warmup execution failed on the %s path\n", label);
+    std::exit(1);
+  }
+  std::vector<double> samples;
+  samples.reserve(reps);
+  for (uint32_t r = 0; r < reps; ++r) {
+    const auto t0 = std::chrono::steady_clock::now();
+    const int rc = run();
+    const auto t1 = std::chrono::steady_clock::now();
+    if (rc != 0) {
+      std::fprintf(stderr, "FATAL: timed execution failed on the %s path (rep %u)\n", label, r);
+      std::exit(1);
+    }
+    samples.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  TimingStats stats;
+  stats.min_ms = samples.front();
+  const std::size_t mid = samples.size() / 2;
+  stats.median_ms = (samples.size() % 2 != 0) ? samples[mid] : 0.5 * (samples[mid - 1] + samples[mid]);
+  return stats;
+}
+
+void usage(const char *argv0) {
+  std::fprintf(stderr,
+               "usage: %s [--n <slots, power of two, default 256>] [--batches <default 16>] [--reps <default 3>]\n",
+               argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t n = 256;
+  uint32_t batches = 16;
+  uint32_t reps = 3;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
+      n = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--batches") == 0 && i + 1 < argc) {
+      batches = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+      reps = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (n == 0 || (n & (n - 1)) != 0) {
+    std::fprintf(stderr, "error: --n must be a power of two (got %u)\n", n);
+    return 1;
+  }
+  if (batches == 0 || reps == 0) {
+    std::fprintf(stderr, "error: --batches and --reps must be >= 1\n");
+    return 1;
+  }
+
+  // --- Deterministic data: one x per batch, one shared w.
+  std::mt19937 rng(20260711u);
+  std::uniform_int_distribution<int64_t> dist(0, 9);
+  std::vector<int64_t> w(n, 0);
+  for (auto &e : w) {
+    e = dist(rng);
+  }
+  std::vector<std::vector<int64_t>> xs(batches, std::vector<int64_t>(n, 0));
+  std::vector<int64_t> expected(batches, 0);
+  for (uint32_t b = 0; b < batches; ++b) {
+    for (uint32_t j = 0; j < n; ++j) {
+      xs[b][j] = dist(rng);
+      expected[b] += xs[b][j] * w[j];
+    }
+  }
+
+  // --- Backend.
+  FhnBackendInfo *info = toyfhe_fhn_get_info();
+  FhnBackendCtx *ctx = toyfhe_fhn_create(nullptr);
+  FhnKernelTable *table = toyfhe_fhn_get_kernels(ctx);
+  fhenomenon::FhnDefaultExecutor executor(table);
+  const fhenomenon::FhnAsyncHooks hooks{ctx,
+                                        toyfhe_fhn_submit,
+                                        toyfhe_fhn_poll,
+                                        toyfhe_fhn_wait,
+                                        toyfhe_fhn_get_outputs,
+                                        toyfhe_fhn_exec_free,
+                                        toyfhe_fhn_buffer_free};
+
+  // --- Program: inputs x (id 1) and w (id 2).
+  uint32_t log2n = 0;
+  while ((1u << log2n) < n) {
+    ++log2n;
+  }
+  FhnProgram *prog = fhn_program_alloc(1 + log2n, 2, 1);
+  if (prog == nullptr) {
+    std::fprintf(stderr, "FATAL: program allocation failed\n");
+    return 1;
+  }
+  prog->input_ids[0] = 1;
+  prog->input_ids[1] = 2;
+  uint32_t t_id = 3;
+  prog->instructions[0].opcode = FHN_HMULT;
+  prog->instructions[0].result_id = t_id;
+  prog->instructions[0].operands[0] = 1;
+  prog->instructions[0].operands[1] = 2;
+  uint32_t inst_idx = 1;
+  for (uint32_t d = n / 2; d >= 1; d /= 2) {
+    FhnInstruction &red = prog->instructions[inst_idx++];
+    red.opcode = FHN_HROT_ADD;
+    red.result_id = t_id + 1;
+    red.operands[0] = t_id;
+    red.operands[1] = t_id;
+    red.params[0] = static_cast<int64_t>(d);
+    ++t_id;
+  }
+  prog->output_ids[0] = t_id;
+
+  FhnBuffer *w_buf = toyfhe_fhn_buffer_alloc(ctx);
+  if (toyfhe_fhn_encrypt_vec_i64(ctx, w_buf, w.data(), n) != 0) {
+    std::fprintf(stderr, "FATAL: failed to encrypt w\n");
+    return 1;
+  }
+
+  // Every path records batch b's dot product here; checked after each run.
+  std::vector<int64_t> got(batches, -1);
+  std::vector<int64_t> slots(n, 0);
+  auto decrypt_into = [&](uint32_t b, const FhnBuffer *out) {
+    if (toyfhe_fhn_decrypt_vec_i64(ctx, out, slots.data(), n) == 0) {
+      got[b] = slots[0];
+    }
+  };
+  auto check = [&](const char *label) {
+    for (uint32_t b = 0; b < batches; ++b) {
+      if (got[b] != expected[b]) {
+        std::fprintf(stderr, "FATAL [%s]: batch %u decrypted to %lld, expected %lld\n", label, b,
+                     static_cast<long long>(got[b]), static_cast<long long>(expected[b]));
+        std::exit(1);
+      }
+    }
+    std::fill(got.begin(), got.end(), -1);
+    return 0;
+  };
+
+  // --- Serial: one buffer table reused for every batch.
+  std::vector<FhnBuffer *> bufs(t_id + 1, nullptr);
+  for (uint32_t id = 1; id <= t_id; ++id) {
+    bufs[id] = id == 2 ? w_buf : toyfhe_fhn_buffer_alloc(ctx);
+  }
+  auto run_serial = [&] {
+    for (uint32_t b = 0; b < batches; ++b) {
+      if (toyfhe_fhn_encrypt_vec_i64(ctx, bufs[1], xs[b].data(), n) != 0 ||
+          executor.execute(ctx, prog, bufs.data()) != 0) {
+        return -1;
+      }
+      decrypt_into(b, bufs[t_id]);
+    }
+    return check("serial");
+  };
+
+  // --- Pipelined: x_b is allocated per batch; w is shared and never freed
+  // by consume.
+  auto prepare = [&](uint32_t b, FhnBuffer **inputs) {
+    inputs[0] = toyfhe_fhn_buffer_alloc(ctx);
+    inputs[1] = w_buf;
+    return toyfhe_fhn_encrypt_vec_i64(ctx, inputs[0], xs[b].data(), n);
+  };
+  auto consume = [&](uint32_t b, FhnBuffer **inputs, FhnBuffer **outputs) {
+    if (outputs) {
+      decrypt_into(b, outputs[0]);
+      toyfhe_fhn_buffer_free(ctx, outputs[0]);
+    }
+    toyfhe_fhn_buffer_free(ctx, inputs[0]);
+  };
+  auto run_pipelined = [&] {
+    if (fhenomenon::FhnDefaultExecutor::executePipelined(hooks, prog, batches, prepare, consume) != 0) {
+      return -1;
+    }
+    return check("pipelined");
+  };
+
+  // time_path's warmup run doubles as the correctness check of each path.
+  const TimingStats serial = time_path("serial", reps, run_serial);
+  const TimingStats pipelined = time_path("pipelined", reps, run_pipelined);
+
+  // --- Report.
+  std::printf("# FHN async overlap benchmark (serial vs pipelined)\n\n");
+  std::printf("backend: %s %s | n = %u | batches = %u | reps = %u\n\n", info->name, info->version, n, batches, reps);
+  std::printf("| path | median ms | min ms | ms / batch | speedup |\n");
+  std::printf("|------|----------:|-------:|-----------:|--------:|\n");
+  std::printf("| serial | %.3f | %.3f | %.3f | 1.00x |\n", serial.median_ms, serial.min_ms,
+              serial.median_ms / batches);
+  std::printf("| pipelined | %.3f | %.3f | %.3f | %.2fx |\n", pipelined.median_ms, pipelined.min_ms,
+              pipelined.median_ms / batches, serial.median_ms / pipelined.median_ms);
+
+  // --- Cleanup.
+  for (uint32_t id = 1; id <= t_id; ++id) {
+    toyfhe_fhn_buffer_free(ctx, bufs[id]);
+  }
+  fhn_program_free(prog);
+  toyfhe_fhn_destroy(ctx);
+  return 0;
+}
@@ -0,0 +1,326 @@
+// fhn-calibrate — measure per-opcode kernel costs of a loaded FHN backend.
+//
+// Every registered kernel is timed in isolation on freshly encrypted
+// scalar ciphertexts (the result buffer is separate, so operands stay
+// fresh across calls) and reported as the FhnKernelCost estimates a
+// backend's fhn_get_kernel_costs export returns:
+//   base_ns       cost at level 0
+//   per_level_ns  added cost per level above 0
+// The per-level slope needs a level model and a LEVEL_DOWN kernel to
+// produce low-level operands; without them it is 0 and base_ns is the
+// fresh-level cost.
+//
+// Plaintext-operand opcodes (*_CP) are skipped: the ABI has no plaintext
+// encoder. Kernels that reject scalar operands are skipped with a note.
+// Finally the tool prints the fused-vs-decomposed choice FhnDefaultExecutor
+// makes under the measured costs.
+
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnMovementPlan.h"
+#include "FHN/FhnTrace.h"
+#include "corpus_backend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace fhenomenon;
+using namespace fhenomenon::corpus;
+
+namespace {
+
+enum class Arity { kSkip, kUnary, kBinary, kScalar };
+
+Arity arityOf(FhnOpCode op) {
+  switch (op) {
+  case FHN_NEGATE:
+  case FHN_RELINEARIZE:
+  case FHN_RESCALE:
+  case FHN_ROTATE:
+  case FHN_CONJUGATE:
+  case FHN_MULT_KEY:
+  case FHN_MOD_DOWN:
+  case FHN_LEVEL_DOWN:
+  case FHN_HROT:
+    return Arity::kUnary;
+  case FHN_ADD_CC:
+  case FHN_SUB_CC:
+  case FHN_MULT_CC:
+  case FHN_HMULT:
+  case FHN_HROT_ADD:
+  case FHN_HCONJ_ADD:
+  case FHN_MAD:
+  case FHN_AND:
+  case FHN_OR:
+  case FHN_XOR:
+  case FHN_EQ:
+  case FHN_LT:
+  case FHN_LE:
+    return Arity::kBinary;
+  case FHN_ADD_CS:
+  case FHN_SUB_SC:
+  case FHN_MULT_CS:
+    return Arity::kScalar;
+  default:
+    return Arity::kSkip;
+  }
+}
+
+// Owns the buffers one kernel is timed on.
+struct Operands {
+  const CorpusBackend &backend;
+  std::vector<FhnBuffer *> buffers;
+
+  explicit Operands(const CorpusBackend &b) : backend(b) {}
+  Operands(const Operands &) = delete;
+  Operands &operator=(const Operands &) = delete;
+  ~Operands() {
+    for (FhnBuffer *buf : buffers)
+      backend.bufferFree()(backend.ctx(), buf);
+  }
+
+  FhnBuffer *alloc() {
+    FhnBuffer *buf = backend.bufferAlloc()(backend.ctx());
+    if (buf)
+      buffers.push_back(buf);
+    return buf;
+  }
+};
+
+// A fresh encryption of value, lowered to level when level_down is given.
+FhnBuffer *encryptAt(Operands &ops, int64_t value, FhnKernelFn level_down, int64_t level) {
+  FhnBuffer *fresh = ops.alloc();
+  if (!fresh || ops.backend.encryptI64()(ops.backend.ctx(), fresh, value) != 0)
+    return nullptr;
+  if (!level_down)
+    return fresh;
+  FhnBuffer *lowered = ops.alloc();
+  const FhnBuffer *in[1] = {fresh};
+  const int64_t params[4] = {level, 0, 0, 0};
+  const double fparams[2] = {0.0, 0.0};
+  if (!lowered || level_down(ops.backend.ctx(), lowered, in, params, fparams) != 0)
+    return nullptr;
+  return lowered;
+}
+
+// Median ns per call of fn on operands at level, or nullopt if the kernel
+// fails. Calls are batched until one batch spans at least 20 us so the
+// clock's resolution does not dominate cheap kernels.
+std::optional<double> measure(const CorpusBackend &backend, FhnOpCode op, FhnKernelFn fn, uint32_t reps,
+                              FhnKernelFn level_down, int64_t level) {
+  Operands ops(backend);
+  const Arity arity = arityOf(op);
+  FhnBuffer *a = encryptAt(ops, 3, level_down, level);
+  FhnBuffer *b = arity == Arity::kBinary ? encryptAt(ops, 5, level_down, level) : nullptr;
+  FhnBuffer *result = ops.alloc();
+  if (!a || !result || (arity == Arity::kBinary && !b))
+    return std::nullopt;
+
+  const FhnBuffer *in[4] = {a, b, nullptr, nullptr};
+  // ROTATE-family distance 1; LEVEL_DOWN to the operand's own level.
+  const int64_t params[4] = {op == FHN_LEVEL_DOWN ? level : 1, 0, 0, 0};
+  const double fparams[2] = {2.0, 0.0};
+  auto call = [&]() { return fn(backend.ctx(), result, in, params, fparams); };
+  if (call() != 0)
+    return std::nullopt;
+
+  using clock = std::chrono::steady_clock;
+  auto batch_ns = [&](uint32_t calls) -> std::optional<double> {
+    const auto t0 = clock::now();
+    for (uint32_t c = 0; c < calls; ++c) {
+      if (call() != 0)
+        return std::nullopt;
+    }
+    return std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+  };
+
+  uint32_t calls = 1;
+  for (;;) {
+    const auto ns = batch_ns(calls);
+    if (!ns)
+      return std::nullopt;
+    if (*ns >= 20000.0 || calls >= (1u << 20))
+      break;
+    calls *= 2;
+  }
+  std::vector<double> samples;
+  samples.reserve(reps);
+  for (uint32_t r = 0; r < reps; ++r) {
+    const auto ns = batch_ns(calls);
+    if (!ns)
+      return std::nullopt;
+    samples.push_back(*ns / calls);
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+// Level model from the backend's optional trio; fresh_level 0 without it.
+FhnLevelModel queryLevelModel(const CorpusBackend &backend) {
+  FhnLevelModel model;
+  if (!backend.freshLevel() || !backend.levelBytes() || !backend.opcodeLevelEffect())
+    return model;
+  model.fresh_level = backend.freshLevel()(backend.ctx());
+  if (model.fresh_level < 0 || model.fresh_level > 4096) {
+    model.fresh_level = 0;
+    return model;
+  }
+  for (int64_t l = 0; l <= model.fresh_level; ++l)
+    model.bytes_by_level.push_back(backend.levelBytes()(backend.ctx(), l));
+  for (int op = FHN_NOP; op < FHN_OPCODE_COUNT; ++op)
+    model.effects[op] = backend.opcodeLevelEffect()(backend.ctx(), static_cast<FhnOpCode>(op));
+  return model;
+}
+
+void appendEscaped(std::string &out, const std::string &s) {
+  for (const char c : s) {
+    if (c == '"' || c == '\\')
+      out += '\\';
+    if (static_cast<unsigned char>(c) >= 0x20)
+      out += c;
+  }
+}
+
+void usage(const char *argv0) {
+  std::fprintf(stderr,
+               "usage: %s --backend <lib.so> [--prefix <sym, default toyfhe_>] [--reps <default 5>] "
+               "[--out <costs.json>]\n",
+               argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string backend_path;
+  std::string prefix = "toyfhe_";
+  std::string out_path;
+  uint32_t reps = 5;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+      backend_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--prefix") == 0 && i + 1 < argc) {
+      prefix = argv[++i];
+    } else if (std::strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+      reps = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      out_path = argv[++i];
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (backend_path.empty() || reps == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::string error;
+  auto backend = CorpusBackend::load(backend_path, prefix, &error);
+  if (!backend) {
+    std::fprintf(stderr, "error: cannot load backend: %s\n", error.c_str());
+    return 1;
+  }
+
+  const FhnLevelModel model = queryLevelModel(*backend);
+  FhnDefaultExecutor executor(backend->kernels());
+  FhnKernelFn level_down = executor.kernel(FHN_LEVEL_DOWN);
+  const bool per_level = model.fresh_level > 0 && level_down != nullptr;
+
+  std::printf("fhn-calibrate: %s  fresh_level=%lld  reps=%u%s\n", backend_path.c_str(),
+              static_cast<long long>(model.fresh_level), reps, per_level ? "" : "  (level-independent)");
+  std::printf("%-11s %-14s %12s %14s\n", "opcode", "kernel", "base_ns", "per_level_ns");
+
+  std::vector<FhnKernelCost> costs;
+  for (int op_index = FHN_NOP + 1; op_index < FHN_OPCODE_COUNT; ++op_index) {
+    const auto op = static_cast<FhnOpCode>(op_index);
+    FhnKernelFn fn = executor.kernel(op);
+    if (!fn)
+      continue;
+    const char *name = executor.kernelName(op) ? executor.kernelName(op) : "?";
+    if (arityOf(op) == Arity::kSkip) {
+      std::printf("%-11s %-14s skipped: plaintext operands\n", FhnTrace::opcodeName(op), name);
+      continue;
+    }
+
+    FhnKernelCost cost{op, 0.0, 0.0};
+    if (per_level) {
+      // Two-point fit between the fresh level and the lowest level the
+      // opcode can run at (CONSUME needs one level to spend).
+      const auto effect = model.effects.find(op_index);
+      const int64_t low = (effect != model.effects.end() && effect->second == FHN_LEVEL_CONSUME) ? 1 : 0;
+      const auto at_fresh = measure(*backend, op, fn, reps, level_down, model.fresh_level);
+      const auto at_low = low < model.fresh_level ? measure(*backend, op, fn, reps, level_down, low) : std::nullopt;
+      if (!at_fresh) {
+        std::printf("%-11s %-14s skipped: kernel rejects scalar operands\n", FhnTrace::opcodeName(op), name);
+        continue;
+      }
+      if (at_low) {
+        cost.per_level_ns = std::max(0.0, (*at_fresh - *at_low) / static_cast<double>(model.fresh_level - low));
+        cost.base_ns = std::max(0.0, *at_low - cost.per_level_ns * static_cast<double>(low));
+      } else {
+        cost.base_ns = *at_fresh;
+      }
+    } else {
+      const auto ns = measure(*backend, op, fn, reps, nullptr, 0);
+      if (!ns) {
+        std::printf("%-11s %-14s skipped: kernel rejects scalar operands\n", FhnTrace::opcodeName(op), name);
+        continue;
+      }
+      cost.base_ns = *ns;
+    }
+    std::printf("%-11s %-14s %12.1f %14.1f\n", FhnTrace::opcodeName(op), name, cost.base_ns, cost.per_level_ns);
+    costs.push_back(cost);
+  }
+
+  // The choice FhnDefaultExecutor makes for each registered fused kernel.
+  FhnKernelCostTable table{static_cast<uint32_t>(costs.size()), costs.data()};
+  executor.setKernelCosts(&table, per_level ? &model : nullptr);
+  std::printf("\nselection under these costs:\n");
+  for (FhnOpCode op : {FHN_HMULT, FHN_HROT, FHN_HROT_ADD, FHN_HCONJ_ADD, FHN_MAD}) {
+    if (!executor.kernel(op))
+      continue;
+    std::printf("  %-10s", FhnTrace::opcodeName(op));
+    for (int64_t l = per_level ? 0 : model.fresh_level; l <= model.fresh_level; ++l) {
+      if (per_level)
+        std::printf(" L%lld:", static_cast<long long>(l));
+      std::printf(" %s", executor.prefersDecomposition(op, l) ? "decomposed" : "fused");
+    }
+    std::printf("\n");
+  }
+
+  std::string json = "{\n  \"backend\": \"";
+  appendEscaped(json, backend_path);
+  json += "\",\n  \"unit\": \"ns\",\n  \"reps\": " + std::to_string(reps) + ",\n  \"costs\": [";
+  for (std::size_t i = 0; i < costs.size(); ++i) {
+    const FhnKernelCost &c = costs[i];
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "%s\n    {\"opcode\": \"%s\", \"id\": %d, \"kernel\": \"", i == 0 ? "" : ",",
+                  FhnTrace::opcodeName(c.opcode), static_cast<int>(c.opcode));
+    json += line;
+    appendEscaped(json, executor.kernelName(c.opcode) ? executor.kernelName(c.opcode) : "");
+    std::snprintf(line, sizeof(line), "\", \"base_ns\": %.1f, \"per_level_ns\": %.1f}", c.base_ns, c.per_level_ns);
+    json += line;
+  }
+  json += "\n  ]\n}\n";
+
+  if (out_path.empty()) {
+    std::printf("\n%s", json.c_str());
+    return 0;
+  }
+  std::FILE *f = std::fopen(out_path.c_str(), "w");
+  bool ok = f != nullptr && std::fwrite(json.data(), 1, json.size(), f) == json.size();
+  ok = (f == nullptr || std::fclose(f) == 0) && ok;
+  if (!ok) {
+    std::fprintf(stderr, "error: cannot write %s\n", out_path.c_str());
+    return 1;
+  }
+  std::printf("\nwrote %zu kernel costs to %s\n", costs.size(), out_path.c_str());
+  return costs.empty() ? 1 : 0;
+}
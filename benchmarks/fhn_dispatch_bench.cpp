@@ -0,0 +1,223 @@
+// fhn-bench-dispatch — executor dispatch overhead in isolation.
+//
+// Kernels here are single integer operations on a one-word buffer, so the
+// measured time is almost entirely executor bookkeeping: opcode lookup,
+// operand-array construction and decomposition. The same program runs three
+// ways:
+//   interpreted: FhnDefaultExecutor::execute, per-instruction lookup and
+//                run-time decomposition;
+//   compiled:    FhnCompiledProgram bound once, then run() repeatedly;
+//   rebind:      FhnCompiledProgram::execute, i.e. bind() + run() every
+//                time (callers whose buffer table changes per run).
+//
+// The program mixes direct kernels (ADD_CC, MULT_CS, NEGATE) with fused
+// opcodes the table lacks (HROT_ADD -> ROTATE + ADD_CC, MAD -> MULT_CS +
+// ADD_CC), so the compiled path's pre-expansion is exercised too.
+
+#include "FHN/FhnCompiledProgram.h"
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/fhn_program.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace {
+
+// Unsigned so long chains wrap instead of overflowing.
+struct WordBuffer {
+  uint64_t value;
+};
+
+const WordBuffer *word(const FhnBuffer *b) { return reinterpret_cast<const WordBuffer *>(b); }
+WordBuffer *word(FhnBuffer *b) { return reinterpret_cast<WordBuffer *>(b); }
+
+int word_add_cc(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+                const double *) {
+  word(result)->value = word(operands[0])->value + word(operands[1])->value;
+  return 0;
+}
+
+int word_mult_cs(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+                 const double *fparams) {
+  word(result)->value = word(operands[0])->value * static_cast<uint64_t>(fparams[0]);
+  return 0;
+}
+
+int word_negate(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+                const double *) {
+  word(result)->value = ~word(operands[0])->value;
+  return 0;
+}
+
+int word_rotate(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *params,
+                const double *) {
+  const uint64_t v = word(operands[0])->value;
+  const auto d = static_cast<unsigned>(params[0] & 63);
+  word(result)->value = d == 0 ? v : (v << d) | (v >> (64 - d));
+  return 0;
+}
+
+struct TimingStats {
+  double median_ms = 0.0;
+  double min_ms = 0.0;
+};
+
+TimingStats time_path(const char *label, uint32_t reps, const std::function<int()> &run) {
+  if (run() != 0) {
+    std::fprintf(stderr, "FATAL: warmup execution failed on the %s path\n", label);
+    std::exit(1);
+  }
+  std::vector<double> samples;
+  samples.reserve(reps);
+  for (uint32_t r = 0; r < reps; ++r) {
+    const auto t0 = std::chrono::steady_clock::now();
+    const int rc = run();
+    const auto t1 = std::chrono::steady_clock::now();
+    if (rc != 0) {
+      std::fprintf(stderr, "FATAL: timed execution failed on the %s path (rep %u)\n", label, r);
+      std::exit(1);
+    }
+    samples.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  TimingStats stats;
+  stats.min_ms = samples.front();
+  const std::size_t mid = samples.size() / 2;
+  stats.median_ms = (samples.size() % 2 != 0) ? samples[mid] : 0.5 * (samples[mid - 1] + samples[mid]);
+  return stats;
+}
+
+void usage(const char *argv0) {
+  std::fprintf(stderr, "usage: %s [--n <instructions, default 100000>] [--reps <default 20>]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t n = 100000;
+  uint32_t reps = 20;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
+      n = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+      reps = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (n == 0 || reps == 0) {
+    std::fprintf(stderr, "error: --n and --reps must be >= 1\n");
+    return 1;
+  }
+
+  FhnKernelEntry entries[] = {
+    {FHN_ADD_CC, word_add_cc, "add_cc"},
+    {FHN_MULT_CS, word_mult_cs, "mult_cs"},
+    {FHN_NEGATE, word_negate, "negate"},
+    {FHN_ROTATE, word_rotate, "rotate"},
+  };
+  FhnKernelTable table = {4, entries};
+  fhenomenon::FhnDefaultExecutor executor(&table);
+
+  // --- Program: inputs 1 and 2; instruction i defines id i + 3 from the two
+  // most recent ids, cycling through five opcodes.
+  FhnProgram *prog = fhn_program_alloc(n, 2, 1);
+  if (prog == nullptr) {
+    std::fprintf(stderr, "FATAL: program allocation failed\n");
+    return 1;
+  }
+  prog->input_ids[0] = 1;
+  prog->input_ids[1] = 2;
+  for (uint32_t i = 0; i < n; ++i) {
+    FhnInstruction &inst = prog->instructions[i];
+    inst.result_id = i + 3;
+    inst.operands[0] = i + 2;
+    switch (i % 5) {
+    case 0:
+      inst.opcode = FHN_ADD_CC;
+      inst.operands[1] = i + 1;
+      break;
+    case 1:
+      inst.opcode = FHN_MULT_CS;
+      inst.fparams[0] = 3.0;
+      break;
+    case 2:
+      inst.opcode = FHN_NEGATE;
+      break;
+    case 3:
+      inst.opcode = FHN_HROT_ADD;
+      inst.operands[1] = i + 1;
+      inst.params[0] = static_cast<int64_t>(i % 61 + 1);
+      break;
+    default:
+      inst.opcode = FHN_MAD;
+      inst.operands[1] = i + 1;
+      inst.fparams[0] = 5.0;
+      break;
+    }
+  }
+  prog->output_ids[0] = n + 2;
+
+  auto compiled = fhenomenon::FhnCompiledProgram::compile(executor, *prog);
+  if (!compiled) {
+    std::fprintf(stderr, "FATAL: program failed to compile against the kernel table\n");
+    return 1;
+  }
+
+  // --- Two buffer tables with identical inputs: one per dispatch style.
+  const uint32_t num_buffers = n + 3;
+  std::vector<WordBuffer> interp_words(num_buffers, WordBuffer{0});
+  std::vector<WordBuffer> compiled_words(num_buffers, WordBuffer{0});
+  std::vector<FhnBuffer *> interp_bufs(num_buffers), compiled_bufs(num_buffers);
+  for (uint32_t i = 0; i < num_buffers; ++i) {
+    interp_bufs[i] = reinterpret_cast<FhnBuffer *>(&interp_words[i]);
+    compiled_bufs[i] = reinterpret_cast<FhnBuffer *>(&compiled_words[i]);
+  }
+  interp_words[1].value = compiled_words[1].value = 0x9e3779b97f4a7c15ull;
+  interp_words[2].value = compiled_words[2].value = 0x2545f4914f6cdd1dull;
+
+  // --- Correctness before timing: every id must agree across paths.
+  if (executor.execute(nullptr, prog, interp_bufs.data()) != 0 ||
+      compiled->execute(nullptr, compiled_bufs.data()) != 0) {
+    std::fprintf(stderr, "FATAL: execution failed\n");
+    return 1;
+  }
+  for (uint32_t i = 0; i < num_buffers; ++i) {
+    if (interp_words[i].value != compiled_words[i].value) {
+      std::fprintf(stderr, "FATAL: id %u differs between interpreted and compiled execution\n", i);
+      return 1;
+    }
+  }
+
+  // --- Timing.
+  const TimingStats interpreted =
+    time_path("interpreted", reps, [&] { return executor.execute(nullptr, prog, interp_bufs.data()); });
+  compiled->bind(compiled_bufs.data());
+  const TimingStats bound = time_path("compiled", reps, [&] { return compiled->run(nullptr); });
+  const TimingStats rebind =
+    time_path("rebind", reps, [&] { return compiled->execute(nullptr, compiled_bufs.data()); });
+
+  // --- Report.
+  const double per_inst = 1e6 / static_cast<double>(n); // ms -> ns per instruction
+  std::printf("# FHN dispatch overhead benchmark (interpreted vs compiled)\n\n");
+  std::printf("instructions = %u | kernel calls per run = %u | reps = %u\n\n", n, compiled->stepCount(), reps);
+  std::printf("| path | median ms | min ms | ns / instruction | speedup |\n");
+  std::printf("|------|----------:|-------:|-----------------:|--------:|\n");
+  std::printf("| interpreted | %.3f | %.3f | %.2f | 1.00x |\n", interpreted.median_ms, interpreted.min_ms,
+              interpreted.median_ms * per_inst);
+  std::printf("| compiled | %.3f | %.3f | %.2f | %.2fx |\n", bound.median_ms, bound.min_ms,
+              bound.median_ms * per_inst, interpreted.median_ms / bound.median_ms);
+  std::printf("| compiled + bind | %.3f | %.3f | %.2f | %.2fx |\n", rebind.median_ms, rebind.min_ms,
+              rebind.median_ms * per_inst, interpreted.median_ms / rebind.median_ms);
+
+  fhn_program_free(prog);
+  return 0;
+}
@@ -0,0 +1,227 @@
+// fhn-bench-encrypt — client-side ingest: encrypting a large batch of
+// integers through ToyFHE's data plane.
+//
+// The first table encrypts n values into n scalar ciphertext buffers three
+// ways: one toyfhe_fhn_encrypt_i64 call per value (an mt19937_64 draw for
+// `a` and one for the noise, each under the Engine's RNG mutex), and one
+// toyfhe_fhn_encrypt_batch_i64 call (Philox blocks generated a lane group
+// at a time) on a context without a slot pool and on one whose pool has
+// --threads threads. Every path's buffers are decrypted and checked before
+// timing.
+//
+// Writing a million scattered buffers costs about as much as encrypting
+// into them, so the second table repeats the comparison one level down, on
+// toyfhe::Engine into flat c0/c1 arrays: encryptInt per value against
+// encryptIntBulk, on the calling thread and through a slot runner over a
+// --threads pool like the context's. The third times the Philox generator
+// alone on each instruction set this CPU supports, in 128-bit blocks per
+// second.
+
+#include "Crypto/ToyFHE.h"
+#include "Crypto/ToyFhePhilox.h"
+#include "FHN/FhnThreadPool.h"
+#include "FHN/ToyFheKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace toy = fhenomenon::toyfhe;
+
+// Median ms over reps runs of body.
+double time_ms(uint32_t reps, const std::function<void()> &body) {
+  std::vector<double> samples;
+  samples.reserve(reps);
+  for (uint32_t r = 0; r < reps; ++r) {
+    const auto t0 = std::chrono::steady_clock::now();
+    body();
+    const auto t1 = std::chrono::steady_clock::now();
+    samples.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  const std::size_t mid = samples.size() / 2;
+  return (samples.size() % 2 != 0) ? samples[mid] : 0.5 * (samples[mid - 1] + samples[mid]);
+}
+
+// encryptIntBulk's range in one chunk per pool thread.
+class PoolRunner final : public toy::SlotRunner {
+  public:
+  explicit PoolRunner(unsigned threads) : pool_(threads) {}
+
+  void run(std::size_t n, std::size_t, Chunk chunk, void *arg) override {
+    const std::size_t size = (n + pool_.threadCount() - 1) / pool_.threadCount();
+    pool_.parallelFor(static_cast<uint32_t>((n + size - 1) / size), [&](uint32_t i) {
+      const std::size_t begin = std::size_t{i} * size;
+      chunk(arg, begin, std::min(n, begin + size));
+    });
+  }
+
+  private:
+  fhenomenon::FhnThreadPool pool_;
+};
+
+void check(const char *label, FhnBackendCtx *ctx, const std::vector<FhnBuffer *> &bufs,
+           const std::vector<int64_t> &values) {
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    int64_t decrypted = 0;
+    if (toyfhe_fhn_decrypt_i64(ctx, bufs[i], &decrypted) != 0 || decrypted != values[i]) {
+      std::fprintf(stderr, "FATAL [%s]: value %zu decrypted to %lld, expected %lld\n", label, i,
+                   static_cast<long long>(decrypted), static_cast<long long>(values[i]));
+      std::exit(1);
+    }
+  }
+}
+
+void usage(const char *argv0) {
+  std::fprintf(stderr,
+               "usage: %s [--n <values, default 1048576>] [--reps <default 5>] "
+               "[--threads <encrypt threads, default hardware concurrency>]\n",
+               argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::size_t n = std::size_t{1} << 20;
+  uint32_t reps = 5;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
+      n = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+      reps = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (n == 0 || n > UINT32_MAX || reps == 0 || threads == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::vector<int64_t> values(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    values[i] = static_cast<int64_t>((i * 2654435761u) % 2000001) - 1000000;
+  }
+  const uint32_t count = static_cast<uint32_t>(n);
+
+  FhnBackendCtx *single = toyfhe_fhn_create(nullptr);
+  const std::string config = "{\"encrypt_threads\": " + std::to_string(threads) + "}";
+  FhnBackendCtx *threaded = toyfhe_fhn_create(config.c_str());
+  std::vector<FhnBuffer *> bufs(n);
+  for (FhnBuffer *&buf : bufs) {
+    buf = toyfhe_fhn_buffer_alloc(single);
+  }
+
+  auto per_value = [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      toyfhe_fhn_encrypt_i64(single, bufs[i], values[i]);
+    }
+  };
+  auto batch_single = [&] { toyfhe_fhn_encrypt_batch_i64(single, bufs.data(), values.data(), count); };
+  auto batch_threaded = [&] { toyfhe_fhn_encrypt_batch_i64(threaded, bufs.data(), values.data(), count); };
+
+  std::printf("# ToyFHE bulk encryption benchmark\n\n");
+  std::printf("n = %zu | reps = %u | threads = %u | isa = %s\n\n", n, reps, threads,
+              toy::simd::name(toy::simd::best()));
+  std::printf("| path | median ms | Mvalues/s | speedup |\n");
+  std::printf("|------|----------:|----------:|--------:|\n");
+  per_value();
+  check("per value", single, bufs, values);
+  const double base_ms = time_ms(reps, per_value);
+  std::printf("| encrypt_i64 per value | %.2f | %.1f | 1.00x |\n", base_ms, static_cast<double>(n) / (base_ms * 1e3));
+  batch_single();
+  check("batch", single, bufs, values);
+  const double single_ms = time_ms(reps, batch_single);
+  std::printf("| encrypt_batch_i64, 1 thread | %.2f | %.1f | %.2fx |\n", single_ms,
+              static_cast<double>(n) / (single_ms * 1e3), base_ms / single_ms);
+  if (threads > 1) {
+    batch_threaded();
+    check("batch threaded", threaded, bufs, values);
+    const double threaded_ms = time_ms(reps, batch_threaded);
+    std::printf("| encrypt_batch_i64, %u threads | %.2f | %.1f | %.2fx |\n", threads, threaded_ms,
+                static_cast<double>(n) / (threaded_ms * 1e3), base_ms / threaded_ms);
+  }
+
+  toy::Engine engine;
+  engine.initialize(toy::Parameters{});
+  engine.generateKeys();
+  std::vector<int64_t> c0(n);
+  std::vector<int64_t> c1(n);
+  auto engine_check = [&](const char *label) {
+    for (std::size_t i = 0; i < n; ++i) {
+      const int64_t decrypted = engine.decryptInt(toy::Ciphertext{c0[i], c1[i], 0, toy::Encoding::Integer});
+      if (decrypted != values[i]) {
+        std::fprintf(stderr, "FATAL [%s]: value %zu decrypted to %lld, expected %lld\n", label, i,
+                     static_cast<long long>(decrypted), static_cast<long long>(values[i]));
+        std::exit(1);
+      }
+    }
+  };
+  auto engine_per_value = [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      const toy::Ciphertext ct = engine.encryptInt(values[i]);
+      c0[i] = ct.c0;
+      c1[i] = ct.c1;
+    }
+  };
+  PoolRunner pool(threads);
+  auto engine_bulk = [&](unsigned workers) {
+    return [&, workers] {
+      engine.setSlotRunner(workers > 1 ? &pool : nullptr);
+      engine.encryptIntBulk(values.data(), n, c0.data(), c1.data());
+    };
+  };
+
+  std::printf("\n| engine path | median ms | Mvalues/s | speedup |\n");
+  std::printf("|-------------|----------:|----------:|--------:|\n");
+  engine_per_value();
+  engine_check("engine per value");
+  const double engine_ms = time_ms(reps, engine_per_value);
+  std::printf("| encryptInt per value | %.2f | %.1f | 1.00x |\n", engine_ms,
+              static_cast<double>(n) / (engine_ms * 1e3));
+  std::vector<unsigned> worker_counts = {1};
+  if (threads > 1) {
+    worker_counts.push_back(threads);
+  }
+  for (unsigned workers : worker_counts) {
+    engine_bulk(workers)();
+    engine_check("engine bulk");
+    const double ms = time_ms(reps, engine_bulk(workers));
+    std::printf("| encryptIntBulk, %u thread%s | %.2f | %.1f | %.2fx |\n", workers, workers == 1 ? "" : "s", ms,
+                static_cast<double>(n) / (ms * 1e3), engine_ms / ms);
+  }
+
+  const toy::Philox4x32 philox(1);
+  std::vector<uint64_t> lo(n);
+  std::vector<uint64_t> hi(n);
+  std::printf("\n| philox isa | median ms | Mblocks/s |\n");
+  std::printf("|------------|----------:|----------:|\n");
+  for (toy::simd::Isa isa : {toy::simd::Isa::Scalar, toy::simd::Isa::Avx2, toy::simd::Isa::Avx512}) {
+    if (!toy::simd::supported(isa)) {
+      continue;
+    }
+    const double ms = time_ms(reps, [&] { philox.fill(0, n, 0, lo.data(), hi.data(), isa); });
+    std::printf("| %s | %.2f | %.1f |\n", toy::simd::name(isa), ms, static_cast<double>(n) / (ms * 1e3));
+  }
+
+  for (FhnBuffer *buf : bufs) {
+    toyfhe_fhn_buffer_free(single, buf);
+  }
+  toyfhe_fhn_destroy(threaded);
+  toyfhe_fhn_destroy(single);
+  return 0;
+}
@@ -21,9 +21,51 @@
 // |m1|*e2 + |m2|*e1 <= 2 * 81 * 8 = 1296 and the reduction sums n of them,
 // so total noise stays near n * 1300 — for n <= 512 that is < 7e5, far below
 // 2^25 ~ 3.4e7.
+//
+// With --threads T the fused program also runs on the wavefront-parallel
+// executor: the n rows are independent, so the n HMULTs and then each
+// reduction level's n HROT_ADDs run concurrently (every ToyFHE kernel is
+// thread-safe; the engine serializes its RNG internally).
+//
+// With --batch R the fused program also runs for R independent requests
+// (R buffer tables holding the same encrypted inputs), once as a loop of
+// per-request execute() calls and twice through executeBatch(): without
+// batched kernels (the executor's per-request fallback loop) and over
+// ToyFHE's batched kernel table, one kernel call per instruction whose
+// vector bodies run one slot loop across all requests.
+//
+// With --packed N the backend runs in packed mode: each row and v is one
+// RLWE ciphertext of ring dimension N (N >= 2n), HMULT is an NTT-domain
+// tensor product plus relinearization and every rotation is a Galois key
+// switch, so the timings scale the way a real lattice backend's do. The
+// default plaintext modulus 786433 holds dot products up to 81 * n for
+// n <= 512 with the noise budget to spare.
+//
+// Unless packed, a rotation table times programs dominated by FHN_ROTATE
+// on a context that records each rotation as an O(1) slot offset (the
+// default) against one that copies the slots into rotated order (config
+// lazy_rotate false): this matvec on the decomposed path, where every
+// HROT_ADD becomes ROTATE + ADD_CC, and n-slot versions of the corpus's
+// reduce-tree and conv1d shapes.
+//
+// With --slot-threads T (and optionally --slot-grain G, in ToyFHE's work
+// units: see ToyFheKernels.h), unless packed,
+// single kernel calls over one n*n-slot vector (M flattened, v repeated)
+// are timed on the default context and on one with config
+// {"slot_threads": T, "slot_grain": G}, whose vector kernels split their
+// slots across a ctx-owned pool.
+//
+// A last table times ToyFHE's slot-wise kernels (add, sub, negate, integral
+// scalar multiply) at the program's scale, n vectors of n slots, in the
+// array-of-structs layout the vector kernels used to run on (one
+// toyfhe::Ciphertext per slot, each through the single-slot Engine call)
+// against the structure-of-arrays CiphertextVec on its scalar and its SIMD
+// path.
 
+#include "Crypto/ToyFHE.h"
 #include "FHN/FhnDefaultExecutor.h"
 #include "FHN/FhnMovementPlan.h"
+#include "FHN/FhnThreadPool.h"
 #include "FHN/ToyFheKernels.h"
 #include "FHN/fhn_program.h"
 
@@ -33,7 +75,10 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
+#include <memory>
 #include <random>
+#include <string>
 #include <vector>
 
 namespace {
@@ -43,11 +88,10 @@ struct TimingStats {
   double min_ms = 0.0;
 };
 
-// Warmup once, then time `reps` executions of executor.execute only (inputs
-// are already encrypted; result buffers are simply overwritten every run).
-TimingStats time_path(const char *label, fhenomenon::FhnDefaultExecutor &executor, FhnBackendCtx *ctx,
-                      const FhnProgram *prog, FhnBuffer **bufs, uint32_t reps) {
-  if (executor.execute(ctx, prog, bufs) != 0) {
+// Warmup once, then time `reps` calls of run only (inputs are already
+// encrypted; result buffers are simply overwritten every run).
+TimingStats time_path(const char *label, uint32_t reps, const std::function<int()> &run) {
+  if (run() != 0) {
     std::fprintf(stderr, "FATAL: warmup execution failed on the %s path\n", label);
     std::exit(1);
   }
@@ -55,7 +99,7 @@ TimingStats time_path(const char *label, fhenomenon::FhnDefaultExecutor &executo
   samples.reserve(reps);
   for (uint32_t r = 0; r < reps; ++r) {
     const auto t0 = std::chrono::steady_clock::now();
-    const int rc = executor.execute(ctx, prog, bufs);
+    const int rc = run();
     const auto t1 = std::chrono::steady_clock::now();
     if (rc != 0) {
       std::fprintf(stderr, "FATAL: timed execution failed on the %s path (rep %u)\n", label, r);
@@ -92,7 +136,12 @@ bool check_outputs(const char *label, FhnBackendCtx *ctx, const FhnProgram *prog
 void usage(const char *argv0) {
   std::fprintf(stderr,
                "usage: %s [--n <size, power of two, default 64>] [--reps <default 5>] "
-               "[--budget <max resident buffers, default 0 = unlimited>]\n",
+               "[--budget <max resident buffers, default 0 = unlimited>] "
+               "[--threads <parallel executor threads, default 0 = skip>] "
+               "[--batch <requests per batched run, default 0 = skip>] "
+               "[--packed <RLWE ring dimension, default 0 = per-slot ciphertexts>] "
+               "[--slot-threads <threads per vector kernel, default 0 = skip>] "
+               "[--slot-grain <min work per chunk, default 0 = backend default>]\n",
                argv0);
 }
 
@@ -113,12 +162,356 @@ void report_movement_plan(const char *label, const FhnProgram *prog, uint32_t bu
               plan->stats().evict_count, budget);
 }
 
+// SSA program assembly for the rotation table: ids 1..num_inputs are the
+// inputs, every instruction defines the next id.
+struct ProgramBuilder {
+  uint32_t num_inputs;
+  uint32_t next_id;
+  std::vector<FhnInstruction> instructions;
+
+  explicit ProgramBuilder(uint32_t inputs) : num_inputs(inputs), next_id(inputs + 1) {}
+
+  uint32_t emit(FhnOpCode opcode, uint32_t a, uint32_t b = 0, int64_t param = 0, double fparam = 0.0) {
+    FhnInstruction inst{};
+    inst.opcode = opcode;
+    inst.result_id = next_id++;
+    inst.operands[0] = a;
+    inst.operands[1] = b;
+    inst.params[0] = param;
+    inst.fparams[0] = fparam;
+    instructions.push_back(inst);
+    return inst.result_id;
+  }
+
+  FhnProgram *finish(const std::vector<uint32_t> &outputs) const {
+    FhnProgram *prog = fhn_program_alloc(static_cast<uint32_t>(instructions.size()), num_inputs,
+                                         static_cast<uint32_t>(outputs.size()));
+    if (prog == nullptr) {
+      std::fprintf(stderr, "FATAL: program allocation failed\n");
+      std::exit(1);
+    }
+    std::copy(instructions.begin(), instructions.end(), prog->instructions);
+    for (uint32_t i = 0; i < num_inputs; ++i) {
+      prog->input_ids[i] = i + 1;
+    }
+    std::copy(outputs.begin(), outputs.end(), prog->output_ids);
+    return prog;
+  }
+};
+
+struct RotationCase {
+  const char *name;
+  FhnProgram *prog;
+  std::vector<std::vector<int64_t>> inputs;   // per input id, n slots each
+  std::vector<std::vector<int64_t>> expected; // per output, every slot
+};
+
+// n-slot reduce-tree: four inputs, each summed into every slot by
+// log2(n) ROTATE + ADD_CC steps, the sums added together.
+RotationCase reduce_tree_case(uint32_t n) {
+  ProgramBuilder b(4);
+  RotationCase c{"reduce-tree", nullptr, {}, {}};
+  int64_t total = 0;
+  uint32_t combined = 0;
+  for (uint32_t j = 0; j < 4; ++j) {
+    std::vector<int64_t> x(n);
+    for (uint32_t i = 0; i < n; ++i) {
+      x[i] = static_cast<int64_t>((i * 7 + j * 3) % 10);
+      total += x[i];
+    }
+    c.inputs.push_back(x);
+    uint32_t s = j + 1;
+    for (uint32_t k = n / 2; k >= 1; k /= 2) {
+      s = b.emit(FHN_ADD_CC, s, b.emit(FHN_ROTATE, s, 0, static_cast<int64_t>(k)));
+    }
+    combined = j == 0 ? s : b.emit(FHN_ADD_CC, combined, s);
+  }
+  c.expected.assign(1, std::vector<int64_t>(n, total));
+  c.prog = b.finish({combined});
+  return c;
+}
+
+// n-slot conv1d: three layers of a five-tap stencil, each tap a ROTATE and
+// an integral MULT_CS, accumulated with ADD_CC.
+RotationCase conv1d_case(uint32_t n) {
+  ProgramBuilder b(1);
+  RotationCase c{"conv1d", nullptr, {}, {}};
+  std::vector<int64_t> p(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    p[i] = static_cast<int64_t>((i * 5 + 1) % 10);
+  }
+  c.inputs.push_back(p);
+  const int64_t taps[4] = {-2, -1, 1, 2};
+  uint32_t id = 1;
+  for (uint32_t layer = 0; layer < 3; ++layer) {
+    std::vector<int64_t> next(n);
+    for (uint32_t i = 0; i < n; ++i) {
+      next[i] = 2 * p[i];
+    }
+    uint32_t acc = b.emit(FHN_MULT_CS, id, 0, 0, 2.0);
+    for (int64_t t : taps) {
+      const int64_t weight = (t % 3) + 1;
+      const uint32_t m = b.emit(FHN_MULT_CS, b.emit(FHN_ROTATE, id, 0, t), 0, 0, static_cast<double>(weight));
+      acc = b.emit(FHN_ADD_CC, acc, m);
+      for (uint32_t i = 0; i < n; ++i) {
+        const int64_t at = (static_cast<int64_t>(i) + t + static_cast<int64_t>(n)) % static_cast<int64_t>(n);
+        next[i] += weight * p[static_cast<std::size_t>(at)];
+      }
+    }
+    p = next;
+    id = acc;
+  }
+  c.expected.push_back(p);
+  c.prog = b.finish({id});
+  return c;
+}
+
+// Encrypts the case's inputs under ctx, runs it once and checks every slot
+// of every output, then times reps runs.
+TimingStats time_rotation_case(const RotationCase &c, FhnBackendCtx *ctx, fhenomenon::FhnDefaultExecutor &executor,
+                               uint32_t n, uint32_t reps, const char *mode) {
+  uint32_t num_buffers = 0;
+  for (uint32_t i = 0; i < c.prog->num_instructions; ++i) {
+    num_buffers = std::max(num_buffers, c.prog->instructions[i].result_id + 1);
+  }
+  std::vector<FhnBuffer *> bufs(num_buffers, nullptr);
+  for (FhnBuffer *&buf : bufs) {
+    buf = toyfhe_fhn_buffer_alloc(ctx);
+  }
+  for (std::size_t i = 0; i < c.inputs.size(); ++i) {
+    if (toyfhe_fhn_encrypt_vec_i64(ctx, bufs[i + 1], c.inputs[i].data(), n) != 0) {
+      std::fprintf(stderr, "FATAL [%s, %s]: failed to encrypt input %zu\n", c.name, mode, i);
+      std::exit(1);
+    }
+  }
+  if (executor.execute(ctx, c.prog, bufs.data()) != 0) {
+    std::fprintf(stderr, "FATAL [%s, %s]: execution failed\n", c.name, mode);
+    std::exit(1);
+  }
+  std::vector<int64_t> slots(n);
+  for (uint32_t o = 0; o < c.prog->num_outputs; ++o) {
+    if (toyfhe_fhn_decrypt_vec_i64(ctx, bufs[c.prog->output_ids[o]], slots.data(), n) != 0 ||
+        slots != c.expected[o]) {
+      std::fprintf(stderr, "FATAL [%s, %s]: output %u does not match the plaintext result\n", c.name, mode, o);
+      std::exit(1);
+    }
+  }
+  const TimingStats stats = time_path(c.name, reps, [&] { return executor.execute(ctx, c.prog, bufs.data()); });
+  for (FhnBuffer *buf : bufs) {
+    toyfhe_fhn_buffer_free(ctx, buf);
+  }
+  return stats;
+}
+
+uint32_t count_rotations(const FhnProgram *prog, bool decomposed) {
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < prog->num_instructions; ++i) {
+    const FhnOpCode op = prog->instructions[i].opcode;
+    count += (op == FHN_ROTATE || (decomposed && op == FHN_HROT_ADD)) ? 1 : 0;
+  }
+  return count;
+}
+
+// HMULT, fractional MULT_CS, HROT_ADD and ADD_CC, one call each over an
+// n*n-slot vector, on the default context against one whose kernels split
+// their slots across slot_threads threads. Both contexts' results are
+// decrypted and compared (and HMULT's against the plaintext) before
+// timing; exits on a mismatch.
+void report_slot_threads(uint32_t n, uint32_t reps, const std::vector<std::vector<int64_t>> &M,
+                         const std::vector<int64_t> &v, uint32_t slot_threads, uint32_t slot_grain) {
+  const uint32_t width = n * n;
+  std::vector<int64_t> flat(width);
+  std::vector<int64_t> repeated(width);
+  for (uint32_t i = 0; i < width; ++i) {
+    flat[i] = M[i / n][i % n];
+    repeated[i] = v[i % n];
+  }
+  std::string config = "{\"slot_threads\": " + std::to_string(slot_threads);
+  if (slot_grain != 0) {
+    config += ", \"slot_grain\": " + std::to_string(slot_grain);
+  }
+  config += "}";
+  FhnBackendCtx *ctxs[2] = {toyfhe_fhn_create(nullptr), toyfhe_fhn_create(config.c_str())};
+  const FhnKernelTable *table = toyfhe_fhn_get_kernels(ctxs[0]);
+
+  struct SlotKernel {
+    const char *name;
+    FhnOpCode opcode;
+    int64_t param;
+    double fparam;
+  };
+  const SlotKernel kernels[] = {
+    {"HMULT", FHN_HMULT, 0, 0.0},
+    {"MULT_CS 0.5", FHN_MULT_CS, 0, 0.5},
+    {"HROT_ADD", FHN_HROT_ADD, 1, 0.0},
+    {"ADD_CC", FHN_ADD_CC, 0, 0.0},
+  };
+  std::printf("\n| kernel, %u slots | 1 thread ms | %u slot threads ms | speedup |\n", width, slot_threads);
+  std::printf("|------|------------:|-------------------:|--------:|\n");
+  for (const SlotKernel &kernel : kernels) {
+    FhnKernelFn fn = nullptr;
+    for (uint32_t i = 0; i < table->num_kernels; ++i) {
+      if (table->kernels[i].opcode == kernel.opcode) {
+        fn = table->kernels[i].fn;
+      }
+    }
+    double ms[2] = {0.0, 0.0};
+    std::vector<int64_t> decrypted[2];
+    for (int c = 0; c < 2; ++c) {
+      FhnBuffer *a = toyfhe_fhn_buffer_alloc(ctxs[c]);
+      FhnBuffer *b = toyfhe_fhn_buffer_alloc(ctxs[c]);
+      FhnBuffer *out = toyfhe_fhn_buffer_alloc(ctxs[c]);
+      const FhnBuffer *operands[4] = {a, b, nullptr, nullptr};
+      const int64_t params[4] = {kernel.param, 0, 0, 0};
+      const double fparams[2] = {kernel.fparam, 0.0};
+      auto call = [&] { return fn(ctxs[c], out, operands, params, fparams); };
+      decrypted[c].resize(width);
+      if (fn == nullptr || toyfhe_fhn_encrypt_vec_i64(ctxs[c], a, flat.data(), width) != 0 ||
+          toyfhe_fhn_encrypt_vec_i64(ctxs[c], b, repeated.data(), width) != 0 || call() != 0 ||
+          toyfhe_fhn_decrypt_vec_i64(ctxs[c], out, decrypted[c].data(), width) != 0) {
+        std::fprintf(stderr, "FATAL [%s]: kernel call failed\n", kernel.name);
+        std::exit(1);
+      }
+      ms[c] = time_path(kernel.name, reps, call).median_ms;
+      toyfhe_fhn_buffer_free(ctxs[c], out);
+      toyfhe_fhn_buffer_free(ctxs[c], b);
+      toyfhe_fhn_buffer_free(ctxs[c], a);
+    }
+    if (decrypted[0] != decrypted[1]) {
+      std::fprintf(stderr, "FATAL [%s]: slot threads change the result\n", kernel.name);
+      std::exit(1);
+    }
+    for (uint32_t i = 0; kernel.opcode == FHN_HMULT && i < width; ++i) {
+      if (decrypted[0][i] != flat[i] * repeated[i]) {
+        std::fprintf(stderr, "FATAL [%s]: slot %u does not match the plaintext product\n", kernel.name, i);
+        std::exit(1);
+      }
+    }
+    std::printf("| %s | %.3f | %.3f | %.2fx |\n", kernel.name, ms[0], ms[1], ms[0] / ms[1]);
+  }
+  toyfhe_fhn_destroy(ctxs[1]);
+  toyfhe_fhn_destroy(ctxs[0]);
+}
+
+// Slot-wise kernels over n vectors of n slots (row r with row r + 1): the
+// AoS reference against CiphertextVec on the scalar path and on the CPU's
+// widest SIMD path. Every layout's results are decrypted and compared slot
+// by slot before anything is timed; exits on a mismatch.
+void report_slot_kernels(uint32_t n, uint32_t reps, const std::vector<std::vector<int64_t>> &M) {
+  namespace toy = fhenomenon::toyfhe;
+  using AosVec = std::vector<toy::Ciphertext>;
+  toy::Engine engine;
+  engine.initialize(toy::Parameters{});
+  engine.generateKeys();
+
+  std::vector<AosVec> aos(n, AosVec(n));
+  std::vector<toy::CiphertextVec> soa(n);
+  for (uint32_t r = 0; r < n; ++r) {
+    soa[r].resize(n);
+    for (uint32_t i = 0; i < n; ++i) {
+      aos[r][i] = engine.encryptInt(M[r][i]);
+      soa[r].c0[i] = aos[r][i].c0;
+      soa[r].c1[i] = aos[r][i].c1;
+    }
+  }
+  std::vector<AosVec> aos_out(n, AosVec(n));
+  std::vector<toy::CiphertextVec> soa_out(n);
+
+  struct Kernel {
+    const char *name;
+    std::function<void(const AosVec &, const AosVec &, AosVec &)> aos;
+    std::function<void(const toy::CiphertextVec &, const toy::CiphertextVec &, toy::CiphertextVec &)> soa;
+  };
+  const Kernel kernels[] = {
+    {"add",
+     [&](const AosVec &a, const AosVec &b, AosVec &out) {
+       for (uint32_t i = 0; i < n; ++i)
+         out[i] = engine.add(a[i], b[i]);
+     },
+     [&](const toy::CiphertextVec &a, const toy::CiphertextVec &b, toy::CiphertextVec &out) {
+       engine.addVec(a, b, out);
+     }},
+    {"sub",
+     [&](const AosVec &a, const AosVec &b, AosVec &out) {
+       for (uint32_t i = 0; i < n; ++i) {
+         toy::Ciphertext neg_b = b[i];
+         neg_b.c0 = -neg_b.c0;
+         neg_b.c1 = -neg_b.c1;
+         out[i] = engine.add(a[i], neg_b);
+       }
+     },
+     [&](const toy::CiphertextVec &a, const toy::CiphertextVec &b, toy::CiphertextVec &out) {
+       engine.subVec(a, b, out);
+     }},
+    {"negate",
+     [&](const AosVec &a, const AosVec &, AosVec &out) {
+       for (uint32_t i = 0; i < n; ++i) {
+         out[i] = a[i];
+         out[i].c0 = -out[i].c0;
+         out[i].c1 = -out[i].c1;
+       }
+     },
+     [&](const toy::CiphertextVec &a, const toy::CiphertextVec &, toy::CiphertextVec &out) {
+       engine.negateVec(a, out);
+     }},
+    {"mult by 3",
+     [&](const AosVec &a, const AosVec &, AosVec &out) {
+       for (uint32_t i = 0; i < n; ++i)
+         out[i] = engine.multiplyPlain(a[i], 3.0);
+     },
+     [&](const toy::CiphertextVec &a, const toy::CiphertextVec &, toy::CiphertextVec &out) {
+       engine.multiplyPlainVec(a, 3.0, out);
+     }},
+  };
+
+  const toy::simd::Isa widest = toy::simd::best();
+  std::printf("\n| slot kernel, %u x %u slots | AoS Mslots/s | SoA scalar Mslots/s | SoA %s Mslots/s | speedup |\n",
+              n, n, toy::simd::name(widest));
+  std::printf("|------|-------------:|--------------------:|-----------------:|--------:|\n");
+  const double slots = static_cast<double>(n) * static_cast<double>(n);
+  for (const Kernel &kernel : kernels) {
+    auto run_aos = [&] {
+      for (uint32_t r = 0; r < n; ++r)
+        kernel.aos(aos[r], aos[(r + 1) % n], aos_out[r]);
+      return 0;
+    };
+    auto run_soa = [&] {
+      for (uint32_t r = 0; r < n; ++r)
+        kernel.soa(soa[r], soa[(r + 1) % n], soa_out[r]);
+      return 0;
+    };
+    double mslots[3] = {0.0, 0.0, 0.0};
+    const toy::simd::Isa isas[2] = {toy::simd::Isa::Scalar, widest};
+    mslots[0] = slots / (time_path(kernel.name, reps, run_aos).median_ms * 1e3);
+    for (int k = 0; k < 2; ++k) {
+      engine.setSimdIsa(isas[k]);
+      mslots[k + 1] = slots / (time_path(kernel.name, reps, run_soa).median_ms * 1e3);
+      for (uint32_t r = 0; r < n; ++r) {
+        for (uint32_t i = 0; i < n; ++i) {
+          if (engine.decryptInt(aos_out[r][i]) != engine.decryptInt(soa_out[r].slot(i))) {
+            std::fprintf(stderr, "FATAL: SoA %s (%s) disagrees with AoS at row %u slot %u\n", kernel.name,
+                         toy::simd::name(isas[k]), r, i);
+            std::exit(1);
+          }
+        }
+      }
+    }
+    std::printf("| %s | %.1f | %.1f | %.1f | %.2fx |\n", kernel.name, mslots[0], mslots[1], mslots[2],
+                mslots[2] / mslots[0]);
+  }
+}
+
 } // namespace
 
 int main(int argc, char **argv) {
   uint32_t n = 64;
   uint32_t reps = 5;
   uint32_t budget = 0;
+  uint32_t threads = 0;
+  uint32_t batch = 0;
+  uint32_t packed = 0;
+  uint32_t slot_threads = 0;
+  uint32_t slot_grain = 0;
 
   for (int i = 1; i < argc; ++i) {
     if (std::strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
@@ -127,6 +520,16 @@ int main(int argc, char **argv) {
       reps = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
     } else if (std::strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
       budget = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+      batch = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--packed") == 0 && i + 1 < argc) {
+      packed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--slot-threads") == 0 && i + 1 < argc) {
+      slot_threads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--slot-grain") == 0 && i + 1 < argc) {
+      slot_grain = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
     } else {
       usage(argv[0]);
       return 1;
@@ -140,6 +543,10 @@ int main(int argc, char **argv) {
     std::fprintf(stderr, "error: --reps must be >= 1\n");
     return 1;
   }
+  if (packed != 0 && packed < 2 * n) {
+    std::fprintf(stderr, "error: --packed ring dimension must be at least 2n (got %u for n = %u)\n", packed, n);
+    return 1;
+  }
 
   uint32_t log2n = 0;
   while ((1u << log2n) < n) {
@@ -168,7 +575,15 @@ int main(int argc, char **argv) {
 
   // --- Backend.
   FhnBackendInfo *info = toyfhe_fhn_get_info();
-  FhnBackendCtx *ctx = toyfhe_fhn_create(nullptr);
+  char config[64] = "";
+  if (packed != 0) {
+    std::snprintf(config, sizeof(config), "{\"packed\": true, \"ring_dim\": %u}", packed);
+  }
+  FhnBackendCtx *ctx = toyfhe_fhn_create(config);
+  if (ctx == nullptr) {
+    std::fprintf(stderr, "FATAL: backend creation failed (config %s)\n", config);
+    return 1;
+  }
   FhnKernelTable *full_table = toyfhe_fhn_get_kernels(ctx);
 
   // --- Build ONE program: inputs are ids 1..n (rows) and n+1 (v).
@@ -239,6 +654,8 @@ int main(int argc, char **argv) {
   }
   FhnKernelTable primitive_table = {static_cast<uint32_t>(primitive_entries.size()), primitive_entries.data()};
   fhenomenon::FhnDefaultExecutor decomposed_executor(&primitive_table);
+  // (c) parallel: the full table with ToyFHE's thread-safety flags.
+  fhenomenon::FhnDefaultExecutor parallel_executor(full_table, toyfhe_fhn_kernel_flags, ctx);
 
   // --- Correctness on BOTH paths before timing anything.
   if (fused_executor.execute(ctx, prog, bufs.data()) != 0 ||
@@ -251,14 +668,76 @@ int main(int argc, char **argv) {
     std::fprintf(stderr, "FATAL: decomposed path failed correctness check\n");
     return 1;
   }
+  std::unique_ptr<fhenomenon::FhnThreadPool> pool;
+  if (threads > 0) {
+    pool = std::make_unique<fhenomenon::FhnThreadPool>(threads);
+    if (parallel_executor.executeParallel(ctx, prog, bufs.data(), *pool) != 0 ||
+        !check_outputs("parallel", ctx, prog, bufs.data(), n, expected)) {
+      std::fprintf(stderr, "FATAL: parallel path failed correctness check\n");
+      return 1;
+    }
+  }
+
+  // (d) batched: the full table plus ToyFHE's batched kernels. Request r
+  // gets its own buffer table; inputs are shared read-only across requests.
+  fhenomenon::FhnDefaultExecutor batched_executor(full_table, nullptr, nullptr, toyfhe_fhn_get_batch_kernels(ctx));
+  fhenomenon::FhnDefaultExecutor fallback_executor(full_table);
+  std::vector<std::vector<FhnBuffer *>> request_bufs(batch);
+  std::vector<FhnBuffer **> request_tables(batch, nullptr);
+  for (uint32_t r = 0; r < batch; ++r) {
+    request_bufs[r].assign(num_buffers, nullptr);
+    for (uint32_t id = 0; id < num_buffers; ++id) {
+      request_bufs[r][id] = id <= v_id ? bufs[id] : toyfhe_fhn_buffer_alloc(ctx);
+    }
+    request_tables[r] = request_bufs[r].data();
+  }
+  if (batch > 0) {
+    for (fhenomenon::FhnDefaultExecutor *executor : {&fallback_executor, &batched_executor}) {
+      if (executor->executeBatch(ctx, prog, request_tables.data(), batch) != 0) {
+        std::fprintf(stderr, "FATAL: batched path failed\n");
+        return 1;
+      }
+      for (uint32_t r = 0; r < batch; ++r) {
+        if (!check_outputs("batched", ctx, prog, request_tables[r], n, expected)) {
+          std::fprintf(stderr, "FATAL: batched path failed correctness check (request %u)\n", r);
+          return 1;
+        }
+      }
+    }
+  }
 
   // --- Movement-plan stats (reporting only). The movement plan operates on
   // the program IR, which is identical for both dispatch paths.
   report_movement_plan("program", prog, budget);
 
   // --- Timing.
-  const TimingStats fused = time_path("fused", fused_executor, ctx, prog, bufs.data(), reps);
-  const TimingStats decomposed = time_path("decomposed", decomposed_executor, ctx, prog, bufs.data(), reps);
+  const TimingStats fused =
+    time_path("fused", reps, [&] { return fused_executor.execute(ctx, prog, bufs.data()); });
+  const TimingStats decomposed =
+    time_path("decomposed", reps, [&] { return decomposed_executor.execute(ctx, prog, bufs.data()); });
+  TimingStats parallel;
+  if (pool) {
+    parallel = time_path("parallel", reps,
+                         [&] { return parallel_executor.executeParallel(ctx, prog, bufs.data(), *pool); });
+  }
+
+  TimingStats looped_requests, fallback_requests, batched_requests;
+  if (batch > 0) {
+    looped_requests = time_path("looped requests", reps, [&] {
+      for (uint32_t r = 0; r < batch; ++r) {
+        const int rc = fused_executor.execute(ctx, prog, request_tables[r]);
+        if (rc != 0)
+          return rc;
+      }
+      return 0;
+    });
+    fallback_requests = time_path("fallback requests", reps, [&] {
+      return fallback_executor.executeBatch(ctx, prog, request_tables.data(), batch);
+    });
+    batched_requests = time_path("batched requests", reps, [&] {
+      return batched_executor.executeBatch(ctx, prog, request_tables.data(), batch);
+    });
+  }
 
   // --- Instruction counts: fused = program length; decomposed expands
   // HMULT -> 3 (MULT_CC + RELINEARIZE + RESCALE) and HROT_ADD -> 2
@@ -281,7 +760,14 @@ int main(int argc, char **argv) {
 
   // --- Report.
   std::printf("# FHN encrypted matvec benchmark (fused vs decomposed)\n\n");
-  std::printf("backend: %s %s | n = %u | reps = %u\n\n", info->name, info->version, n, reps);
+  std::printf("backend: %s %s | n = %u | reps = %u\n", info->name, info->version, n, reps);
+  if (packed != 0) {
+    std::printf("mode: packed RLWE, ring dimension %u, %llu bytes per ciphertext\n", packed,
+                static_cast<unsigned long long>(toyfhe_fhn_level_bytes(ctx, 0)));
+  } else {
+    std::printf("mode: one toy ciphertext per slot\n");
+  }
+  std::printf("\n");
   std::printf("ToyFHE is a CPU reference toy: fused-vs-decomposed deltas here reflect executor dispatch and "
               "memory-pass overhead only. Real backend numbers (GPU kernel-launch and key-switch fusion) come "
               "from running the same program on a hardware backend.\n\n");
@@ -291,8 +777,61 @@ int main(int argc, char **argv) {
               fused.min_ms, decomposed.median_ms / fused.median_ms);
   std::printf("| decomposed | %llu | %.3f | %.3f | 1.00x |\n", static_cast<unsigned long long>(decomposed_count),
               decomposed.median_ms, decomposed.min_ms);
+  if (pool) {
+    std::printf("| fused, %u threads | %llu | %.3f | %.3f | %.2fx |\n", pool->threadCount(),
+                static_cast<unsigned long long>(fused_count), parallel.median_ms, parallel.min_ms,
+                decomposed.median_ms / parallel.median_ms);
+  }
+
+  if (batch > 0) {
+    std::printf("\n| %u requests | median ms | min ms | ms / request | speedup |\n", batch);
+    std::printf("|------|----------:|-------:|-------------:|--------:|\n");
+    std::printf("| looped execute | %.3f | %.3f | %.3f | 1.00x |\n", looped_requests.median_ms,
+                looped_requests.min_ms, looped_requests.median_ms / batch);
+    std::printf("| executeBatch, per-request kernels | %.3f | %.3f | %.3f | %.2fx |\n", fallback_requests.median_ms,
+                fallback_requests.min_ms, fallback_requests.median_ms / batch,
+                looped_requests.median_ms / fallback_requests.median_ms);
+    std::printf("| executeBatch, batched kernels | %.3f | %.3f | %.3f | %.2fx |\n", batched_requests.median_ms,
+                batched_requests.min_ms, batched_requests.median_ms / batch,
+                looped_requests.median_ms / batched_requests.median_ms);
+  }
+
+  if (packed == 0) {
+    // The matvec program again, on a lazy and an eager context alike.
+    RotationCase matvec{"matvec (decomposed)", prog, {}, {}};
+    for (uint32_t row = 0; row < n; ++row) {
+      matvec.inputs.push_back(M[row]);
+      matvec.expected.push_back(std::vector<int64_t>(n, expected[row]));
+    }
+    matvec.inputs.push_back(v);
+    const RotationCase cases[3] = {matvec, reduce_tree_case(n), conv1d_case(n)};
+    FhnBackendCtx *eager = toyfhe_fhn_create("{\"lazy_rotate\": false}");
+    std::printf("\n| program, %u slots | rotations | eager rotate ms | lazy rotate ms | speedup |\n", n);
+    std::printf("|------|----------:|----------------:|---------------:|--------:|\n");
+    for (const RotationCase &c : cases) {
+      const TimingStats eager_stats = time_rotation_case(c, eager, decomposed_executor, n, reps, "eager");
+      const TimingStats lazy_stats = time_rotation_case(c, ctx, decomposed_executor, n, reps, "lazy");
+      std::printf("| %s | %u | %.3f | %.3f | %.2fx |\n", c.name, count_rotations(c.prog, true),
+                  eager_stats.median_ms, lazy_stats.median_ms, eager_stats.median_ms / lazy_stats.median_ms);
+    }
+    for (std::size_t k = 1; k < 3; ++k) {
+      fhn_program_free(cases[k].prog);
+    }
+    toyfhe_fhn_destroy(eager);
+  }
+
+  if (packed == 0 && slot_threads > 0) {
+    report_slot_threads(n, reps, M, v, slot_threads, slot_grain);
+  }
+
+  report_slot_kernels(n, reps, M);
 
   // --- Cleanup.
+  for (uint32_t r = 0; r < batch; ++r) {
+    for (uint32_t id = v_id + 1; id < num_buffers; ++id) {
+      toyfhe_fhn_buffer_free(ctx, request_bufs[r][id]);
+    }
+  }
   for (uint32_t i = 0; i < num_buffers; ++i) {
     toyfhe_fhn_buffer_free(ctx, bufs[i]);
   }
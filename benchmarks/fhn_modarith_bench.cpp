@@ -0,0 +1,214 @@
+// fhn-bench-modarith — ToyFHE's modular arithmetic policies head to head.
+//
+// The first table times the raw policies of Crypto/ToyFheModArith.h on n
+// random residue pairs per modulus: the product a * b mod q and the sum
+// a + b mod q, each policy instantiated as its own loop. The baseline is
+// what the Engine did before the policies: a 128-bit product and a 128-bit
+// `%`, and a 64-bit `%` with a sign fix for sums. Every policy's results are
+// checked against the baseline before anything is timed.
+//
+// The second table runs the Engine end to end (encrypt, add, integral
+// multiplyPlain, decrypt) per value under Parameters::reduction Auto and
+// forced Barrett, for the default power-of-two q and an odd q, checking
+// every decrypted result.
+
+#include "Crypto/ToyFHE.h"
+#include "Crypto/ToyFheModArith.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+
+namespace toy = fhenomenon::toyfhe;
+
+// Median ns per element over reps runs of body.
+double time_ns(uint32_t reps, std::size_t n, const std::function<void()> &body) {
+  std::vector<double> samples;
+  samples.reserve(reps);
+  for (uint32_t r = 0; r < reps; ++r) {
+    const auto t0 = std::chrono::steady_clock::now();
+    body();
+    const auto t1 = std::chrono::steady_clock::now();
+    samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  const std::size_t mid = samples.size() / 2;
+  const double median = (samples.size() % 2 != 0) ? samples[mid] : 0.5 * (samples[mid - 1] + samples[mid]);
+  return median / static_cast<double>(n);
+}
+
+#if defined(__SIZEOF_INT128__)
+// The pre-policy Engine arithmetic, as a policy.
+class WideDivisionModulus {
+  public:
+  explicit WideDivisionModulus(int64_t q) : q_(q) {}
+  int64_t reduce(int64_t value) const {
+    const int64_t r = value % q_;
+    return r < 0 ? r + q_ : r;
+  }
+  int64_t mul(int64_t a, int64_t b) const {
+    __extension__ using wide_int = __int128;
+    const int64_t r = static_cast<int64_t>(static_cast<wide_int>(a) * b % q_);
+    return r < 0 ? r + q_ : r;
+  }
+
+  private:
+  int64_t q_;
+};
+#endif
+
+struct Row {
+  const char *policy;
+  double mul_ns;
+  double add_ns;
+};
+
+// Fills products and sums, then times both loops; each instantiation is
+// a loop specialized for one policy.
+template <typename Modulus>
+Row run_policy(const char *label, const Modulus &m, const std::vector<int64_t> &a, const std::vector<int64_t> &b,
+               std::vector<int64_t> &products, std::vector<int64_t> &sums, uint32_t reps) {
+  const std::size_t n = a.size();
+  auto mul_loop = [&] {
+    for (std::size_t i = 0; i < n; ++i)
+      products[i] = m.mul(a[i], b[i]);
+  };
+  auto add_loop = [&] {
+    for (std::size_t i = 0; i < n; ++i)
+      sums[i] = m.reduce(a[i] + b[i]);
+  };
+  mul_loop();
+  add_loop();
+  Row row{label, 0.0, 0.0};
+  row.mul_ns = time_ns(reps, n, mul_loop);
+  row.add_ns = time_ns(reps, n, add_loop);
+  return row;
+}
+
+void report_policies(const char *q_label, int64_t q, std::size_t n, uint32_t reps) {
+  std::mt19937_64 rng(static_cast<uint64_t>(q));
+  std::uniform_int_distribution<int64_t> dist(0, q - 1);
+  std::vector<int64_t> a(n);
+  std::vector<int64_t> b(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    a[i] = dist(rng);
+    b[i] = dist(rng);
+  }
+  std::vector<int64_t> ref_products(n);
+  std::vector<int64_t> ref_sums(n);
+  std::vector<int64_t> products(n);
+  std::vector<int64_t> sums(n);
+
+  std::vector<Row> rows;
+  auto check = [&](const char *label) {
+    if (products != ref_products || sums != ref_sums) {
+      std::fprintf(stderr, "FATAL: %s disagrees with the reference for q = %s\n", label, q_label);
+      std::exit(1);
+    }
+  };
+#if defined(__SIZEOF_INT128__)
+  rows.push_back(run_policy("128-bit %", WideDivisionModulus(q), a, b, ref_products, ref_sums, reps));
+#else
+  run_policy("barrett", toy::BarrettModulus(q), a, b, ref_products, ref_sums, 1);
+#endif
+  if (toy::modarith::isPowerOfTwo(q)) {
+    rows.push_back(run_policy("power-of-two", toy::PowerOfTwoModulus(q), a, b, products, sums, reps));
+    check("power-of-two");
+  }
+  rows.push_back(run_policy("barrett", toy::BarrettModulus(q), a, b, products, sums, reps));
+  check("barrett");
+  if ((q & 1) != 0) {
+    rows.push_back(run_policy("montgomery", toy::MontgomeryModulus(q), a, b, products, sums, reps));
+    check("montgomery");
+  }
+
+  const double base_mul = rows.front().mul_ns;
+  const double base_add = rows.front().add_ns;
+  for (const Row &row : rows) {
+    std::printf("| %s | %s | %.2f | %.2fx | %.2f | %.2fx |\n", q_label, row.policy, row.mul_ns, base_mul / row.mul_ns,
+                row.add_ns, base_add / row.add_ns);
+  }
+}
+
+// encrypt(x), add to itself, multiply by 3, decrypt: expects 6x.
+void report_engine(const char *q_label, const toy::Parameters &base, std::size_t n, uint32_t reps) {
+  for (toy::ModReduction reduction : {toy::ModReduction::Auto, toy::ModReduction::Barrett}) {
+    toy::Parameters params = base;
+    params.reduction = reduction;
+    toy::Engine engine;
+    engine.initialize(params);
+    engine.generateKeys(7);
+
+    std::vector<int64_t> decrypted(n);
+    auto body = [&] {
+      for (std::size_t i = 0; i < n; ++i) {
+        const toy::Ciphertext ct = engine.encryptInt(static_cast<int64_t>(i % 1000) - 500);
+        decrypted[i] = engine.decryptInt(engine.multiplyPlain(engine.add(ct, ct), 3.0));
+      }
+    };
+    body();
+    for (std::size_t i = 0; i < n; ++i) {
+      if (decrypted[i] != 6 * (static_cast<int64_t>(i % 1000) - 500)) {
+        std::fprintf(stderr, "FATAL: engine under %s decrypted %lld for value %zu (q = %s)\n",
+                     toy::modReductionName(engine.modReduction()), static_cast<long long>(decrypted[i]), i, q_label);
+        std::exit(1);
+      }
+    }
+    std::printf("| %s | %s | %s | %.1f |\n", q_label, toy::modReductionName(reduction),
+                toy::modReductionName(engine.modReduction()), time_ns(reps, n, body));
+  }
+}
+
+void usage(const char *argv0) {
+  std::fprintf(stderr, "usage: %s [--n <values, default 1048576>] [--reps <default 5>]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::size_t n = std::size_t{1} << 20;
+  uint32_t reps = 5;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
+      n = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+      reps = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (n == 0 || reps == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  const int64_t one = 1;
+  std::printf("# ToyFHE modular arithmetic benchmark\n\n");
+  std::printf("n = %zu | reps = %u\n\n", n, reps);
+  std::printf("| q | policy | mul ns | vs baseline | add ns | vs baseline |\n");
+  std::printf("|---|--------|-------:|------------:|-------:|------------:|\n");
+  report_policies("2^58", one << 58, n, reps);
+  report_policies("2^58 + 2^32", (one << 58) + (one << 32), n, reps);
+  report_policies("2^61 - 1", (one << 61) - 1, n, reps);
+
+  // An odd q must be a multiple of an odd t: t = 3^20 < 2^32, q = t * (2^26 + 1).
+  toy::Parameters odd;
+  odd.t = 3486784401;
+  odd.q = odd.t * ((one << 26) + 1);
+  const std::size_t engine_n = std::max<std::size_t>(1, n / 16);
+  std::printf("\n| q | requested | selected | engine ns / value |\n");
+  std::printf("|---|-----------|----------|------------------:|\n");
+  report_engine("2^58", toy::Parameters{}, engine_n, reps);
+  report_engine("3^20 * (2^26 + 1)", odd, engine_n, reps);
+  return 0;
+}
@@ -0,0 +1,200 @@
+// fhn-bench-plan — FhnMovementPlan::analyze on million-instruction programs.
+//
+// The synthetic program mimics CNN inference lowered to straight-line FHE:
+// layer after layer of `width` channels, each output channel a 1-D
+// convolution over `taps` neighbouring input channels:
+//   acc = MULT_CS(in[o])
+//   acc = ADD_CC(acc, MULT_CS(ROTATE(in[o + t])))   t = 1 .. taps - 1
+// Every input channel is read `taps` times spread across its layer, so the
+// live set hovers around one to two layers' width and a budget of half a
+// layer keeps Belady evicting and prefetching throughout. The program is
+// cut at --instructions; its last result is the output.
+//
+// Each row plans the same program under one configuration: unbudgeted (with
+// and without slot assignment), budgeted under Belady and Lru, byte mode
+// with a level model, and budgeted with rematerialization and lookahead.
+
+#include "FHN/FhnMovementPlan.h"
+#include "FHN/fhn_program.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace {
+
+struct TimingStats {
+  double median_ms = 0.0;
+  double min_ms = 0.0;
+};
+
+// reset runs untimed before each rep: releasing the previous plan is not
+// part of planning.
+TimingStats time_path(const char *label, uint32_t reps, const std::function<void()> &reset,
+                      const std::function<int()> &run) {
+  std::vector<double> samples;
+  samples.reserve(reps);
+  for (uint32_t r = 0; r < reps; ++r) {
+    reset();
+    const auto t0 = std::chrono::steady_clock::now();
+    const int rc = run();
+    const auto t1 = std::chrono::steady_clock::now();
+    if (rc != 0) {
+      std::fprintf(stderr, "FATAL: planning failed on the %s configuration (rep %u)\n", label, r);
+      std::exit(1);
+    }
+    samples.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  TimingStats stats;
+  stats.min_ms = samples.front();
+  const std::size_t mid = samples.size() / 2;
+  stats.median_ms = (samples.size() % 2 != 0) ? samples[mid] : 0.5 * (samples[mid - 1] + samples[mid]);
+  return stats;
+}
+
+// Inputs 1 .. width, then one id per instruction in program order. Whole
+// layers are generated and the tail beyond n dropped.
+FhnProgram *build_conv_program(uint32_t n, uint32_t width, uint32_t taps) {
+  std::vector<FhnInstruction> insts;
+  insts.reserve(static_cast<std::size_t>(n) + 3 * static_cast<std::size_t>(width) * taps);
+  auto emit = [&insts, width](FhnOpCode opcode, uint32_t a, uint32_t b, int64_t param) {
+    FhnInstruction inst{};
+    inst.opcode = opcode;
+    inst.result_id = width + 1 + static_cast<uint32_t>(insts.size());
+    inst.operands[0] = a;
+    inst.operands[1] = b;
+    inst.params[0] = param;
+    inst.fparams[0] = 3.0;
+    insts.push_back(inst);
+    return inst.result_id;
+  };
+  std::vector<uint32_t> layer(width);
+  for (uint32_t k = 0; k < width; ++k)
+    layer[k] = k + 1;
+  std::vector<uint32_t> next(width);
+  while (insts.size() < n) {
+    for (uint32_t o = 0; o < width; ++o) {
+      uint32_t acc = emit(FHN_MULT_CS, layer[o], 0, 0);
+      for (uint32_t t = 1; t < taps; ++t) {
+        const uint32_t rotated = emit(FHN_ROTATE, layer[(o + t) % width], 0, static_cast<int64_t>(t));
+        acc = emit(FHN_ADD_CC, acc, emit(FHN_MULT_CS, rotated, 0, 0), 0);
+      }
+      next[o] = acc;
+    }
+    layer.swap(next);
+  }
+
+  FhnProgram *prog = fhn_program_alloc(n, width, 1);
+  if (prog == nullptr)
+    return nullptr;
+  for (uint32_t k = 0; k < width; ++k)
+    prog->input_ids[k] = k + 1;
+  std::copy(insts.begin(), insts.begin() + n, prog->instructions);
+  prog->output_ids[0] = prog->instructions[n - 1].result_id;
+  return prog;
+}
+
+void usage(const char *argv0) {
+  std::fprintf(stderr,
+               "usage: %s [--instructions <default 1000000>] [--width <channels, default 32>] "
+               "[--taps <default 3>] [--reps <default 3>]\n",
+               argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t n = 1000000;
+  uint32_t width = 32;
+  uint32_t taps = 3;
+  uint32_t reps = 3;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--instructions") == 0 && i + 1 < argc) {
+      n = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+      width = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--taps") == 0 && i + 1 < argc) {
+      taps = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+      reps = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (n == 0 || width < 2 || taps == 0 || taps > width || reps == 0) {
+    std::fprintf(stderr, "error: need --instructions >= 1, --width >= 2, 1 <= --taps <= --width, --reps >= 1\n");
+    return 1;
+  }
+
+  FhnProgram *prog = build_conv_program(n, width, taps);
+  if (prog == nullptr) {
+    std::fprintf(stderr, "FATAL: program allocation failed\n");
+    return 1;
+  }
+  const std::vector<uint32_t> pinned = {prog->output_ids[0]};
+
+  // One level, 1 MiB per ciphertext: byte mode plans the same residency as
+  // slot mode, through the byte-denominated paths.
+  fhenomenon::FhnLevelModel model;
+  model.fresh_level = 0;
+  model.bytes_by_level = {1u << 20};
+  for (FhnOpCode opcode : {FHN_MULT_CS, FHN_ROTATE, FHN_ADD_CC})
+    model.effects[opcode] = FHN_LEVEL_PRESERVE;
+
+  const uint32_t budget = width / 2 + 4;
+  fhenomenon::FhnPlanOptions slots;
+  slots.assign_slots = true;
+  fhenomenon::FhnPlanOptions remat_lookahead;
+  remat_lookahead.rematerialize = true;
+  remat_lookahead.prefetch_lookahead = 4;
+
+  struct Config {
+    const char *label;
+    uint64_t budget;
+    fhenomenon::FhnEvictionPolicy policy;
+    const fhenomenon::FhnLevelModel *model;
+    const fhenomenon::FhnPlanOptions *options;
+  };
+  const fhenomenon::FhnPlanOptions defaults;
+  const Config configs[] = {
+    {"unbudgeted", 0, fhenomenon::FhnEvictionPolicy::Belady, nullptr, &defaults},
+    {"unbudgeted + slots", 0, fhenomenon::FhnEvictionPolicy::Belady, nullptr, &slots},
+    {"budget, Belady", budget, fhenomenon::FhnEvictionPolicy::Belady, nullptr, &defaults},
+    {"budget, Lru", budget, fhenomenon::FhnEvictionPolicy::Lru, nullptr, &defaults},
+    {"budget, Belady, bytes", uint64_t{budget} << 20, fhenomenon::FhnEvictionPolicy::Belady, &model, &defaults},
+    {"budget, Belady, remat + lookahead 4", budget, fhenomenon::FhnEvictionPolicy::Belady, nullptr,
+     &remat_lookahead},
+  };
+
+  std::printf("# FHN movement planning benchmark (FhnMovementPlan::analyze)\n\n");
+  std::printf("instructions = %u | width = %u | taps = %u | budget = %u buffers | reps = %u\n\n", n, width, taps,
+              budget, reps);
+  std::printf("| configuration | median ms | min ms | ns / instruction | high water | evictions | prefetches "
+              "| recomputes | hoisted |\n");
+  std::printf("|---------------|----------:|-------:|-----------------:|-----------:|----------:|-----------:"
+              "|-----------:|--------:|\n");
+  for (const Config &config : configs) {
+    std::optional<fhenomenon::FhnMovementPlan> plan;
+    const TimingStats timing = time_path(config.label, reps, [&] { plan.reset(); }, [&] {
+      plan = fhenomenon::FhnMovementPlan::analyze(*prog, pinned, config.budget, config.policy, config.model,
+                                                  *config.options);
+      return plan ? 0 : 1;
+    });
+    const fhenomenon::FhnMovementPlan::Stats &stats = plan->stats();
+    std::printf("| %s | %.1f | %.1f | %.1f | %u | %u | %u | %u | %u |\n", config.label, timing.median_ms,
+                timing.min_ms, timing.median_ms * 1e6 / static_cast<double>(n), stats.high_water, stats.evict_count,
+                stats.prefetch_count, stats.recompute_count, stats.hoisted_prefetch_count);
+  }
+
+  fhn_program_free(prog);
+  return 0;
+}
@@ -12,7 +12,9 @@ namespace fhenomenon {
 
 class Backend;
 class FhenonBase;
+class FhnBufferPool;
 class FhnDefaultExecutor;
+class FhnPlanCache;
 
 template <typename T> class Fhenon;
 
@@ -38,15 +40,30 @@ struct FhnRuntime {
   // Optional movement hooks; null = single memory space, movement skipped.
   FhnBufferPrefetchFn prefetch = nullptr;
   FhnBufferEvictFn evict = nullptr;
+  // Optional async prefetch pair; null = prefetches run synchronously.
+  FhnBufferPrefetchAsyncFn prefetch_async = nullptr;
+  FhnBufferFenceFn fence = nullptr;
   // Optional level model (all-or-nothing trio); null = no byte budgets.
   FhnFreshLevelFn fresh_level = nullptr;
   FhnLevelBytesFn level_bytes = nullptr;
   FhnOpcodeLevelEffectFn opcode_level_effect = nullptr;
+  // Optional async group (all-or-nothing); null = synchronous only.
+  FhnSubmitFn submit = nullptr;
+  FhnPollFn poll = nullptr;
+  FhnWaitFn wait = nullptr;
+  FhnGetOutputsFn get_outputs = nullptr;
+  FhnExecFreeFn exec_free = nullptr;
   // Keeps the backend context (and, for dlopened backends, the library
   // itself) alive for as long as any buffer allocated through this runtime
   // exists. Buffer deleters must capture it, or a Fhenon outliving its
   // backend would free through a destroyed context / unloaded library.
   std::shared_ptr<void> keepalive;
+  // Optional recycler for planned allocs/frees, shared by every session on
+  // the backend; null = straight buffer_alloc/buffer_free.
+  FhnBufferPool *pool = nullptr;
+  // Optional cache of executable programs and movement plans by program
+  // structure, shared by every session on the backend; null = plan every run.
+  FhnPlanCache *plan_cache = nullptr;
 };
 
 enum class BackendType {
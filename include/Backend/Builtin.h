@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Backend/Backend.h"
+#include "FHN/FhnBufferPool.h"
+#include "FHN/FhnPlanCache.h"
 #include "FHN/FhnDefaultExecutor.h"
 #include "FHN/ToyFheKernels.h"
 #include "Fhenon.h"
@@ -43,6 +45,8 @@ class BuiltinBackend final : public Backend {
   FhnBackendCtx *fhn_ctx_ = nullptr;
   FhnKernelTable *fhn_table_ = nullptr;
   std::unique_ptr<FhnDefaultExecutor> fhn_executor_;
+  std::unique_ptr<FhnBufferPool> fhn_pool_;      // recycles session-planned buffers
+  std::unique_ptr<FhnPlanCache> fhn_plan_cache_; // plans repeated session shapes once
 
   // Extract the FHN buffer from an entity, verifying this backend owns it.
   std::shared_ptr<FhnBuffer> bufferOf(const FhenonBase &entity, const char *opName) const;
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Backend/Backend.h"
+#include "FHN/FhnBufferPool.h"
+#include "FHN/FhnPlanCache.h"
 #include "FHN/FhnDefaultExecutor.h"
 #include "FHN/fhn_backend_api.h"
 
@@ -65,6 +67,8 @@ class ExternalBackend : public Backend {
   FhnBackendCtx *fhn_ctx_ = nullptr;
   FhnKernelTable *fhn_table_ = nullptr;
   std::unique_ptr<FhnDefaultExecutor> executor_;
+  std::unique_ptr<FhnBufferPool> pool_;      // recycles session-planned buffers
+  std::unique_ptr<FhnPlanCache> plan_cache_; // plans repeated session shapes once
   FhnRuntime runtime_{};
 };
 
@@ -1,15 +1,24 @@
 #pragma once
 
+#include "Crypto/ToyFheModArith.h"
+#include "Crypto/ToyFhePhilox.h"
+#include "Crypto/ToyFheSimd.h"
+
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <random>
+#include <variant>
+#include <vector>
 
 namespace fhenomenon::toyfhe {
 
 enum class Encoding { Integer, FixedPoint };
 
 struct Parameters {
-  int64_t q = static_cast<int64_t>(1) << 58;     // Ciphertext modulus (must be a multiple of t)
+  int64_t q = static_cast<int64_t>(1) << 58;     // Ciphertext modulus (a multiple of t, at most 2^62)
   int64_t t = static_cast<int64_t>(1) << 32;     // Plaintext modulus
   int64_t scale = static_cast<int64_t>(1) << 16; // Fixed-point scale base
   // Fresh-encryption noise bound. Multiplication noise grows with message
@@ -19,6 +28,10 @@ struct Parameters {
   // degrade gracefully into off-by-small errors, as in a real leveled scheme
   // without modulus switching.
   int64_t noise_bound = static_cast<int64_t>(1) << 3;
+  // How the Engine reduces modulo q; see ToyFheModArith.h. Explicit choices
+  // the modulus cannot take (PowerOfTwo for other q, Montgomery for even q)
+  // make initialize() throw.
+  ModReduction reduction = ModReduction::Auto;
 };
 
 struct Ciphertext {
@@ -30,16 +43,86 @@ struct Ciphertext {
   std::shared_ptr<Ciphertext> clone() const { return std::make_shared<Ciphertext>(*this); }
 };
 
+// Multi-slot ciphertext in structure-of-arrays layout: slot i is the pair
+// (c0[i], c1[i]), every slot shares one scale_power and encoding, and the
+// residues stay in [0, q), so slot-wise arithmetic runs as the contiguous
+// SIMD kernels of ToyFheSimd.h.
+struct CiphertextVec {
+  std::vector<int64_t> c0;
+  std::vector<int64_t> c1;
+  int scale_power = 0;
+  Encoding encoding = Encoding::Integer;
+
+  std::size_t size() const { return c0.size(); }
+  bool empty() const { return c0.empty(); }
+  void resize(std::size_t n) {
+    c0.resize(n);
+    c1.resize(n);
+  }
+  Ciphertext slot(std::size_t i) const { return Ciphertext{c0[i], c1[i], scale_power, encoding}; }
+};
+
+// A CiphertextVec read through a cyclic left rotation: logical slot i is
+// stored slot (i + rotation) mod size(). The slot-wise Engine operations
+// take their operands as views and apply the rotation inside their own
+// pass over the slots, so rotating a vector is O(1) bookkeeping. Converts
+// implicitly from a CiphertextVec (rotation 0) and must not outlive it.
+struct VecView {
+  const CiphertextVec *vec;
+  std::size_t rotation;
+
+  VecView(const CiphertextVec &cipher, std::size_t distance = 0)
+      : vec(&cipher), rotation(cipher.empty() ? 0 : distance % cipher.size()) {}
+
+  std::size_t size() const { return vec->size(); }
+  Ciphertext slot(std::size_t i) const {
+    const std::size_t stored = i + rotation;
+    return vec->slot(stored < size() ? stored : stored - size());
+  }
+  // The same slots rotated left by a further `distance`.
+  VecView rotated(std::size_t distance) const {
+    return VecView(*vec, empty() ? 0 : rotation + distance % size());
+  }
+  bool empty() const { return vec->empty(); }
+};
+
+// Splits the slot loops of an Engine's vector operations and bulk
+// encryption across threads;
+// see Engine::setSlotRunner(). run() calls chunk(arg, begin, end) for
+// consecutive ranges covering [0, n), possibly concurrently, and returns
+// once every call has. Chunks write disjoint slots, so any split is valid.
+// `cost` is the loop's rough time per slot in SIMD slot additions (from 1
+// for the SIMD kernels to 64 for ciphertext products), for sizing chunks.
+class SlotRunner {
+  public:
+  using Chunk = void (*)(void *arg, std::size_t begin, std::size_t end);
+
+  virtual ~SlotRunner() = default;
+  virtual void run(std::size_t n, std::size_t cost, Chunk chunk, void *arg) = 0;
+};
+
 // ToyFHE is a deliberately insecure single-slot toy scheme. Relinearization
 // and rescaling decode with the secret key, which the Engine holds. It exists
 // to make FHN semantics observable from a fresh clone — scale/level
 // bookkeeping, HMULT = mult + relin + rescale — not to provide security.
+//
+// Every const member is safe to call concurrently: operations that draw
+// fresh randomness (encryption and the re-encrypting multiplies) serialize
+// on an internal RNG mutex, except bulk encryption and the vector
+// multiplies, which reserve their own range of a counter-based stream (one
+// block per slot, whichever thread encodes it); everything else only
+// reads keys and parameters.
 class Engine {
   public:
   Engine();
 
   void initialize(const Parameters &params);
   void generateKeys();
+  // Deterministic keys: engines seeded alike hold the same secret key, so
+  // a ciphertext one encrypts the others can evaluate and decrypt (several
+  // contexts standing in for devices of one key owner). Encryption
+  // randomness still comes from the engine's own RNG.
+  void generateKeys(uint64_t seed);
 
   bool isInitialized() const { return initialized_; }
   bool areKeysGenerated() const { return keysGenerated_; }
@@ -55,25 +138,115 @@ class Engine {
   int64_t decryptInt(const Ciphertext &cipher) const;
   double decryptDouble(const Ciphertext &cipher) const;
 
+  // Slot-wise counterparts over CiphertextVec. Binary operations need equal
+  // slot counts and align the operand at the lower scale first, as add()
+  // does per slot; `out` may be an operand. Additions, negation and
+  // integral scalar multiplication run the SIMD kernels of the engine's Isa;
+  // ciphertext products and fractional scalars go slot by slot through the
+  // single-slot paths above. Operands are views: each kernel reads a
+  // rotated operand as at most three contiguous runs, and `out` always
+  // holds the result unrotated. Results reuse `out`'s capacity, and once it
+  // and this thread's scratch are warm no operation allocates: raised
+  // scales are applied block by block on the stack.
+  CiphertextVec encryptIntVec(const int64_t *values, std::size_t n) const;
+  // The same into existing storage, reusing its capacity.
+  void encryptIntVec(const int64_t *values, std::size_t n, CiphertextVec &out) const;
+  void decryptIntVec(VecView cipher, int64_t *out) const;
+  void addVec(VecView lhs, VecView rhs, CiphertextVec &out) const;
+  void subVec(VecView lhs, VecView rhs, CiphertextVec &out) const;
+  // out[i] = lhs[(i + distance) mod n] + rhs[i]: a left rotation of lhs
+  // fused into the addition.
+  void rotateAddVec(VecView lhs, std::size_t distance, VecView rhs, CiphertextVec &out) const;
+  void negateVec(VecView cipher, CiphertextVec &out) const;
+  void multiplyVec(VecView lhs, VecView rhs, CiphertextVec &out) const;
+  void multiplyPlainVec(VecView cipher, double scalar, CiphertextVec &out) const;
+  // The view's slots in logical order: two contiguous copies.
+  static void materializeVec(VecView cipher, CiphertextVec &out);
+
+  // addVec() and multiplyVec() for `count` independent requests: *out[r]
+  // from lhs[r] and rhs[r]. When every request has request 0's slot count
+  // and operand scales and no out[r] is its own operand read through a
+  // rotation, keys, scales and (multiplying) the Philox range are settled
+  // once and a single slot loop covers all count * n slots; otherwise each
+  // request runs the single op. Either way the ciphertexts are those of
+  // count single calls in order. out[r] must not be another request's
+  // operand.
+  void addVecBatch(const VecView *lhs, const VecView *rhs, CiphertextVec *const *out, std::size_t count) const;
+  void multiplyVecBatch(const VecView *lhs, const VecView *rhs, CiphertextVec *const *out, std::size_t count) const;
+
+  // Bulk encryption of n integers at scale 0 into c0[i], c1[i] — what
+  // encryptIntVec() and n encryptInt() calls produce, but drawing `a` and
+  // the noise for whole blocks of slots from a Philox stream (on the
+  // engine's Isa) instead of one mt19937_64 sample each under the RNG
+  // mutex. Each call reserves n consecutive counters atomically, so
+  // concurrent calls never share randomness. The range splits through the
+  // slot runner if set, like the vector operations' slot loops; the
+  // ciphertexts come out the same however it splits.
+  void encryptIntBulk(const int64_t *values, std::size_t n, int64_t *c0, int64_t *c1) const;
+  // Restart the bulk stream at counter 0 under a fixed key: reproducible
+  // bulk ciphertexts and vector products for tests and benchmarks.
+  void seedBulkEncryption(uint64_t seed);
+
+  // Instruction set of the vector kernels: the CPU's widest by default.
+  // An unsupported Isa is ignored (returns false).
+  bool setSimdIsa(simd::Isa isa);
+  simd::Isa simdIsa() const { return isa_; }
+
+  // Reduction policy initialize() resolved Parameters::reduction to.
+  ModReduction modReduction() const { return reduction_; }
+
+  // Where the vector operations and bulk encryption run their slot loops:
+  // nullptr, the default, keeps them on the calling thread. Not owned; must
+  // outlive its use by this engine.
+  void setSlotRunner(SlotRunner *runner) { slotRunner_ = runner; }
+  SlotRunner *slotRunner() const { return slotRunner_; }
+
   private:
   Ciphertext encryptEncoded(int64_t message, Encoding encoding, int scalePower) const;
   Ciphertext encodeRaw(int64_t value, Encoding encoding, int scalePower) const;
+  // Bulk slots [begin, end), whose randomness is Philox block first + i.
+  void encryptBulkRange(const int64_t *values, std::size_t begin, std::size_t end, uint64_t first, int64_t *c0,
+                        int64_t *c1) const;
   Ciphertext multiplyDecoded(const Ciphertext &cipher, int64_t factor, int64_t divisor, Encoding encoding,
                              int scalePower) const;
+  // multiplyDecoded() before re-encoding: the delta-scaled product in [0, q).
+  int64_t productRaw(const Ciphertext &cipher, int64_t factor, int64_t divisor) const;
+  // Fresh ciphertexts of count (at most 256) delta-scaled values, masked
+  // and noised from Philox blocks block, block + 1, ...
+  void encodeBulk(const int64_t *scaled, std::size_t count, uint64_t block, int64_t *c0, int64_t *c1) const;
   int64_t decodeRaw(const Ciphertext &cipher) const;
   Ciphertext alignScale(const Ciphertext &cipher, int targetScale) const;
   Ciphertext multiplyPlainInternal(const Ciphertext &cipher, int64_t scalar, int scalePowerIncrease) const;
+  // Callers hold rngMutex_.
   int64_t sampleUniform() const;
   int64_t sampleNoise() const;
   static int64_t centeredMod(int64_t value, int64_t modulus);
   int64_t delta() const { return params_.q / params_.t; }
   long double scaleFactor(int scalePower) const;
+  // An operand of a slot-wise op writing `out`, copied into this thread's
+  // scratch vector `which` (0 or 1) when it is `out` read through a
+  // rotation: the wrapped run would read slots already overwritten.
+  static VecView unaliased(VecView cipher, const CiphertextVec &out, std::size_t which);
+  // scale^levels mod q, the factor that raises a ciphertext `levels` scales.
+  int64_t scaleLift(int levels) const;
+  static void requireSameSize(VecView lhs, VecView rhs);
+  // Whether a batch qualifies for the shared slot loop (see addVecBatch()).
+  static bool uniformBatch(const VecView *lhs, const VecView *rhs, CiphertextVec *const *out, std::size_t count);
 
   Parameters params_{};
   bool initialized_;
   bool keysGenerated_;
   int64_t secretKey_;
+  mutable std::mutex rngMutex_;
   mutable std::mt19937_64 rng_;
+  Philox4x32 bulkRng_;
+  mutable std::atomic<uint64_t> bulkCounter_{0}; // next unreserved Philox block
+  simd::Isa isa_ = simd::best();
+  SlotRunner *slotRunner_ = nullptr;
+  // Scalar hot paths visit this once per operation, so each runs as a body
+  // specialized for the policy's reduction.
+  std::variant<PowerOfTwoModulus, BarrettModulus, MontgomeryModulus> modulus_{PowerOfTwoModulus(Parameters{}.q)};
+  ModReduction reduction_ = ModReduction::PowerOfTwo;
 };
 
 } // namespace fhenomenon::toyfhe
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstdint>
+
+// Modular arithmetic policies behind toyfhe::Engine. Each reduces modulo a
+// fixed q in [2, 2^62] without a 128-bit division, and the Engine picks one
+// from Parameters at initialize() and instantiates its hot paths once per
+// policy (see Engine::modulus_). The shared interface:
+//
+//   int64_t modulus() const;
+//   int64_t reduce(int64_t value) const;     // any value -> [0, q)
+//   int64_t mul(int64_t a, int64_t b) const; // any a, b  -> a * b mod q
+//
+// Everything is inline so each instantiation compiles to straight-line code.
+namespace fhenomenon::toyfhe {
+
+enum class ModReduction {
+  Auto,       // PowerOfTwo when q is a power of two, Montgomery when q is odd, else Barrett
+  PowerOfTwo, // q = 2^k: a mask
+  Barrett,    // any q
+  Montgomery, // odd q
+};
+
+const char *modReductionName(ModReduction reduction);
+
+namespace modarith {
+
+inline bool isPowerOfTwo(int64_t q) { return q > 0 && (q & (q - 1)) == 0; }
+
+// Full 64x64 -> 128-bit product as (hi, lo).
+inline uint64_t mulWide(uint64_t a, uint64_t b, uint64_t &hi) {
+#if defined(__SIZEOF_INT128__)
+  __extension__ using wide_uint = unsigned __int128;
+  const wide_uint product = static_cast<wide_uint>(a) * b;
+  hi = static_cast<uint64_t>(product >> 64);
+  return static_cast<uint64_t>(product);
+#else
+  const uint64_t a_lo = a & 0xffffffffu;
+  const uint64_t a_hi = a >> 32;
+  const uint64_t b_lo = b & 0xffffffffu;
+  const uint64_t b_hi = b >> 32;
+  const uint64_t ll = a_lo * b_lo;
+  const uint64_t lh = a_lo * b_hi;
+  const uint64_t hl = a_hi * b_lo;
+  const uint64_t cross = (ll >> 32) + (lh & 0xffffffffu) + (hl & 0xffffffffu);
+  hi = a_hi * b_hi + (lh >> 32) + (hl >> 32) + (cross >> 32);
+  return (cross << 32) | (ll & 0xffffffffu);
+#endif
+}
+
+// r - bound if r >= bound, else r, as a mask rather than a branch: how often
+// a reduction needs its correction depends on the data, so a branch there
+// mispredicts at random.
+inline uint64_t subtractIfAtLeast(uint64_t r, uint64_t bound) {
+  return r - (bound & (0 - static_cast<uint64_t>(r >= bound)));
+}
+
+// Fold a value that is usually already in [-q, 2q) — sums and differences
+// of residues — without dividing; anything else takes one 64-bit `%`. The
+// in-range test is predictable, the corrections are selects: whether a
+// random sum wraps is a coin flip no branch predictor wins.
+inline int64_t reduceNear(int64_t value, int64_t q) {
+  if (value >= -q && value - q < q) {
+    const int64_t r = value < 0 ? value + q : value;
+    return r >= q ? r - q : r;
+  }
+  const int64_t r = value % q;
+  return r < 0 ? r + q : r;
+}
+
+} // namespace modarith
+
+// q = 2^k. Two's complement wraps modulo 2^64, so masking the low k bits of
+// a sum or a wrapped 64-bit product is already the residue, sign included.
+class PowerOfTwoModulus {
+  public:
+  explicit PowerOfTwoModulus(int64_t q) : q_(q), mask_(static_cast<uint64_t>(q) - 1) {}
+
+  int64_t modulus() const { return q_; }
+  int64_t reduce(int64_t value) const { return static_cast<int64_t>(static_cast<uint64_t>(value) & mask_); }
+  int64_t mul(int64_t a, int64_t b) const {
+    return static_cast<int64_t>((static_cast<uint64_t>(a) * static_cast<uint64_t>(b)) & mask_);
+  }
+
+  private:
+  int64_t q_;
+  uint64_t mask_;
+};
+
+// Barrett reduction (HAC 14.42) with b = 2: for q of k bits, any product
+// x < q^2 reduces with two 64x64 multiplies and two corrective
+// subtractions. mu is floor((4^k - 1) / q) rather than floor(4^k / q): the
+// two differ only when q is a power of two, where the latter is 2^(k+1) and
+// no longer fits 64 bits for q = 2^62; the former costs one more correction.
+class BarrettModulus {
+  public:
+  explicit BarrettModulus(int64_t q) : q_(q), k_(0), mu_(0) {
+    while (k_ < 63 && (static_cast<uint64_t>(1) << k_) <= static_cast<uint64_t>(q))
+      ++k_;
+    // Long division of 2k one-bits by q, one quotient bit at a time.
+    uint64_t rem = 0;
+    for (unsigned i = 0; i < 2 * k_; ++i) {
+      rem = (rem << 1) | 1;
+      mu_ <<= 1;
+      if (rem >= static_cast<uint64_t>(q)) {
+        rem -= static_cast<uint64_t>(q);
+        mu_ |= 1;
+      }
+    }
+  }
+
+  int64_t modulus() const { return q_; }
+  int64_t reduce(int64_t value) const { return modarith::reduceNear(value, q_); }
+  int64_t mul(int64_t a, int64_t b) const {
+    uint64_t hi = 0;
+    const uint64_t lo = modarith::mulWide(static_cast<uint64_t>(reduce(a)), static_cast<uint64_t>(reduce(b)), hi);
+    return reduceWide(hi, lo);
+  }
+
+  private:
+  // x = hi:lo < q^2.
+  int64_t reduceWide(uint64_t hi, uint64_t lo) const {
+    const unsigned shift = k_ - 1;
+    const uint64_t q1 = shift == 0 ? lo : (lo >> shift) | (hi << (64 - shift));
+    uint64_t q2_hi = 0;
+    const uint64_t q2_lo = modarith::mulWide(q1, mu_, q2_hi);
+    const unsigned down = k_ + 1;
+    const uint64_t q3 = down >= 64 ? q2_hi >> (down - 64) : (q2_lo >> down) | (q2_hi << (64 - down));
+    // The true remainder is below 4q <= 2^64, so the low words suffice,
+    // and two corrections bring it into [0, q).
+    const uint64_t uq = static_cast<uint64_t>(q_);
+    const uint64_t r = modarith::subtractIfAtLeast(lo - q3 * uq, 2 * uq);
+    return static_cast<int64_t>(modarith::subtractIfAtLeast(r, uq));
+  }
+
+  int64_t q_;
+  unsigned k_;
+  uint64_t mu_;
+};
+
+// Montgomery reduction with R = 2^64, for odd q. The Engine keeps residues
+// in standard form, so mul() converts on the fly: REDC(REDC(a * b) * R^2)
+// = a * b mod q, four 64x64 multiplies and no division.
+class MontgomeryModulus {
+  public:
+  explicit MontgomeryModulus(int64_t q) : q_(q), qinv_neg_(0), r2_(0) {
+    const uint64_t uq = static_cast<uint64_t>(q);
+    // Newton's iteration doubles the correct low bits of q^-1 mod 2^64;
+    // q * q == 1 mod 8 seeds three of them.
+    uint64_t inv = uq;
+    for (int i = 0; i < 5; ++i)
+      inv *= 2 - uq * inv;
+    qinv_neg_ = 0 - inv;
+    // R mod q, then doubled 64 more times: R^2 mod q.
+    uint64_t r = (0 - uq) % uq;
+    for (int i = 0; i < 64; ++i) {
+      r <<= 1;
+      if (r >= uq)
+        r -= uq;
+    }
+    r2_ = r;
+  }
+
+  int64_t modulus() const { return q_; }
+  int64_t reduce(int64_t value) const { return modarith::reduceNear(value, q_); }
+  int64_t mul(int64_t a, int64_t b) const {
+    uint64_t hi = 0;
+    uint64_t lo = modarith::mulWide(static_cast<uint64_t>(reduce(a)), static_cast<uint64_t>(reduce(b)), hi);
+    lo = modarith::mulWide(redc(hi, lo), r2_, hi);
+    return static_cast<int64_t>(redc(hi, lo));
+  }
+
+  private:
+  // hi:lo * R^-1 mod q, for hi:lo < q * R.
+  uint64_t redc(uint64_t hi, uint64_t lo) const {
+    const uint64_t uq = static_cast<uint64_t>(q_);
+    const uint64_t m = lo * qinv_neg_;
+    uint64_t mq_hi = 0;
+    const uint64_t mq_lo = modarith::mulWide(m, uq, mq_hi);
+    // lo + mq_lo is 0 mod 2^64 by construction; only its carry survives.
+    const uint64_t carry = (lo + mq_lo) < lo ? 1 : 0;
+    return modarith::subtractIfAtLeast(hi + mq_hi + carry, uq);
+  }
+
+  int64_t q_;
+  uint64_t qinv_neg_;
+  uint64_t r2_;
+};
+
+} // namespace fhenomenon::toyfhe
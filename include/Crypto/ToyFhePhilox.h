@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Crypto/ToyFheSimd.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+// 3", SC'11): a counter-based generator whose block i is a pure function
+// of (key, i). Any range of blocks can be produced independently — by
+// another thread, or out of order — with results identical to a serial
+// walk, which is what bulk encryption needs to split across threads and
+// fill whole arrays per call. Not a cryptographic PRNG; neither is ToyFHE.
+namespace fhenomenon::toyfhe {
+
+class Philox4x32 {
+  public:
+  explicit Philox4x32(uint64_t key = 0) : key_(key) {}
+
+  uint64_t key() const { return key_; }
+
+  // The 128-bit block at counter (index, stream).
+  std::array<uint32_t, 4> block(uint64_t index, uint64_t stream = 0) const;
+
+  // Blocks index first .. first + count - 1 of `stream`, as two 64-bit
+  // words each: lo[i] = words 0 and 1, hi[i] = words 2 and 3 (little end
+  // first). The rounds run over lanes of blocks with the vector width of
+  // `isa` (falling back to scalar when unsupported).
+  void fill(uint64_t first, std::size_t count, uint64_t stream, uint64_t *lo, uint64_t *hi,
+            simd::Isa isa = simd::best()) const;
+
+  private:
+  uint64_t key_;
+};
+
+} // namespace fhenomenon::toyfhe
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "Crypto/ToyFheModArith.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace fhenomenon::toyfhe {
+
+// Packed ("RLWE") ToyFHE: one ciphertext is a pair of degree-N polynomials
+// over Z_q[X]/(X^N + 1) carrying N plaintext slots mod t. The scheme is
+// BGV without modulus switching — NTT-domain arithmetic, relinearization
+// and Galois-automorphism rotation by gadget key switching, batched slot
+// encoding — at parameters chosen for speed, not security. With the
+// defaults the noise budget covers one ciphertext-ciphertext multiply
+// followed by a rotate-and-add reduction over up to 512 slots (N = 1024);
+// noiseBudgetBits() reports what is left.
+struct RlweParameters {
+  std::size_t ring_dim = 1024; // N: a power of two in [16, 32768]; N / 2 slots per row
+  int64_t q = (static_cast<int64_t>(1) << 60) - (static_cast<int64_t>(1) << 18) + 1; // prime, 1 mod 2^17
+  int64_t t = 786433;          // 3 * 2^18 + 1: prime, 1 mod 2N (batching); slots hold values mod t
+  int64_t noise_bound = 1;     // fresh error coefficients uniform in [-B, B]
+  int digit_bits = 12;         // key-switching gadget base 2^digit_bits
+};
+
+// Negacyclic number-theoretic transform of length n modulo a prime q with
+// 2n | q - 1. forward() maps coefficients (natural order) to evaluations
+// at the odd powers of a primitive 2n-th root psi in bit-reversed order:
+// slot i holds a(psi^exponent(i)). inverse() undoes it. Butterflies
+// multiply by precomputed twiddles in Shoup form; values stay in [0, q).
+class RlweNtt {
+  public:
+  RlweNtt() = default;
+  // Throws std::runtime_error when q has no primitive 2n-th root.
+  RlweNtt(std::size_t n, int64_t q);
+
+  std::size_t size() const { return n_; }
+  uint64_t modulus() const { return q_; }
+  // Odd exponent e (mod 2n) of the evaluation point forward() leaves at i.
+  std::size_t exponent(std::size_t i) const;
+
+  void forward(uint64_t *a) const;
+  void inverse(uint64_t *a) const;
+
+  private:
+  std::size_t n_ = 0;
+  unsigned log_n_ = 0;
+  uint64_t q_ = 0;
+  std::vector<uint64_t> psi_rev_;
+  std::vector<uint64_t> psi_rev_shoup_;
+  std::vector<uint64_t> psi_inv_rev_;
+  std::vector<uint64_t> psi_inv_rev_shoup_;
+  uint64_t n_inv_ = 0;
+  uint64_t n_inv_shoup_ = 0;
+};
+
+// Both polynomials in NTT form mod q. `slots` is the logical vector length
+// n: the plaintext vector sits replicated N / (2n) times along each row of
+// N / 2 slots, so the row rotation is cyclic in n.
+struct RlweCiphertext {
+  std::vector<uint64_t> c0;
+  std::vector<uint64_t> c1;
+  std::size_t slots = 0;
+};
+
+// Const members are safe to call concurrently, as with Engine: encryption
+// serializes on the RNG mutex, everything else only reads keys. Operations
+// take operands of one slot count (std::runtime_error otherwise) and `out`
+// may alias any operand.
+class RlweEngine {
+  public:
+  RlweEngine();
+
+  void initialize(const RlweParameters &params);
+  void generateKeys();
+  void generateKeys(uint64_t seed);
+
+  bool isInitialized() const { return initialized_; }
+  bool areKeysGenerated() const { return keysGenerated_; }
+  const RlweParameters &parameters() const { return params_; }
+  // Largest vector a ciphertext holds: N / 2. Vector lengths must divide it.
+  std::size_t rowSlots() const { return params_.ring_dim / 2; }
+
+  RlweCiphertext encrypt(const int64_t *values, std::size_t n) const;
+  // Writes the ciphertext's `slots` values, centered into (-t/2, t/2].
+  void decrypt(const RlweCiphertext &cipher, int64_t *out) const;
+
+  void add(const RlweCiphertext &lhs, const RlweCiphertext &rhs, RlweCiphertext &out) const;
+  void sub(const RlweCiphertext &lhs, const RlweCiphertext &rhs, RlweCiphertext &out) const;
+  void negate(const RlweCiphertext &cipher, RlweCiphertext &out) const;
+  void addPlain(const RlweCiphertext &cipher, int64_t scalar, RlweCiphertext &out) const;
+  void multiplyPlain(const RlweCiphertext &cipher, int64_t scalar, RlweCiphertext &out) const;
+  // Tensor product, then relinearization back to two polynomials.
+  void multiply(const RlweCiphertext &lhs, const RlweCiphertext &rhs, RlweCiphertext &out) const;
+  // out[i] = cipher[(i + distance) mod slots]: one automorphism and key
+  // switch per set bit of the reduced distance.
+  void rotate(const RlweCiphertext &cipher, std::size_t distance, RlweCiphertext &out) const;
+
+  // log2(q / 2) minus log2 of the largest decrypted coefficient: bits of
+  // noise growth left before decryption fails. Negative means already lost.
+  int noiseBudgetBits(const RlweCiphertext &cipher) const;
+
+  private:
+  // Gadget key switching from some secret s' to s: k0[i] + k1[i] * s =
+  // t * e_i + 2^(i * digit_bits) * s', all in NTT form.
+  struct SwitchKey {
+    std::vector<std::vector<uint64_t>> k0;
+    std::vector<std::vector<uint64_t>> k1;
+  };
+  // Rotation left by 2^k within a row: the automorphism X -> X^(5^(2^k)),
+  // as an evaluation-index permutation, and its switching key.
+  struct GaloisKey {
+    std::vector<uint32_t> permutation;
+    SwitchKey key;
+  };
+
+  void generateKeysFrom(std::mt19937_64 &keyRng);
+  SwitchKey makeSwitchKey(const std::vector<uint64_t> &fromNtt, std::mt19937_64 &keyRng) const;
+  // acc0 += sum_i digit_i(d) * k0[i], acc1 += ... * k1[i]; d in NTT form.
+  void keySwitch(const std::vector<uint64_t> &dNtt, const SwitchKey &key, std::vector<uint64_t> &acc0,
+                 std::vector<uint64_t> &acc1) const;
+  // Coefficients of c0 + c1 * s, centered into (-q/2, q/2].
+  std::vector<int64_t> decryptCoefficients(const RlweCiphertext &cipher) const;
+  void sampleError(std::vector<uint64_t> &coeffs, std::mt19937_64 &rng) const;
+  void sampleUniformNtt(std::vector<uint64_t> &evals, std::mt19937_64 &rng) const;
+  void requireKeys() const;
+  static void requireSameSlots(const RlweCiphertext &lhs, const RlweCiphertext &rhs);
+  uint64_t mulQ(uint64_t a, uint64_t b) const;
+  uint64_t addQ(uint64_t a, uint64_t b) const;
+  uint64_t subQ(uint64_t a, uint64_t b) const;
+
+  RlweParameters params_{};
+  bool initialized_;
+  bool keysGenerated_;
+  BarrettModulus modQ_{2};
+  BarrettModulus modT_{2};
+  RlweNtt nttQ_;
+  RlweNtt nttT_;
+  std::size_t digits_ = 0;
+  // Evaluation index (in nttT_ order) of plaintext slot s = row * N/2 + j.
+  std::vector<uint32_t> slotIndex_;
+  std::vector<uint64_t> secretNtt_;
+  SwitchKey relinKey_;
+  std::vector<GaloisKey> galoisKeys_; // [k]: rotation by 2^k
+  mutable std::mutex rngMutex_;
+  mutable std::mt19937_64 rng_;
+};
+
+} // namespace fhenomenon::toyfhe
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Slot-wise modular arithmetic behind toyfhe::CiphertextVec. Every kernel
+// reads and writes residues in [0, q) with q <= 2^62 (so a sum of two never
+// overflows), and `out` may alias either input. The AVX2 and AVX-512 paths
+// are compiled per function (target attributes) and picked at run time, so
+// the library needs no -march flag; elsewhere only the scalar path exists.
+namespace fhenomenon::toyfhe::simd {
+
+enum class Isa { Scalar, Avx2, Avx512 };
+
+// Widest instruction set this CPU supports (detected once).
+Isa best();
+bool supported(Isa isa);
+const char *name(Isa isa);
+
+void addMod(Isa isa, const int64_t *a, const int64_t *b, int64_t *out, std::size_t n, int64_t q);
+void subMod(Isa isa, const int64_t *a, const int64_t *b, int64_t *out, std::size_t n, int64_t q);
+void negateMod(Isa isa, const int64_t *a, int64_t *out, std::size_t n, int64_t q);
+// out = a * scalar mod q, for any signed scalar. Vectorized when q is a
+// power of two (the default modulus), where the product's low 64 bits
+// suffice; other moduli take the scalar Barrett path whatever the Isa.
+void mulScalarMod(Isa isa, const int64_t *a, int64_t scalar, int64_t *out, std::size_t n, int64_t q);
+
+} // namespace fhenomenon::toyfhe::simd
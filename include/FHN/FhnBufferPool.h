@@ -0,0 +1,93 @@
+#pragma once
+
+#include "FHN/fhn_backend_api.h"
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace fhenomenon {
+
+// Host-side recycler for backend buffers, keyed by byte class (the level
+// model's bytes at a buffer's level; 0 when the caller has no model).
+// Plan-aware execution (FhnMovementHooks::pool) acquires a buffer for every
+// planned alloc and releases it at its planned free, so a buffer freed by
+// one instruction serves a later alloc of the same class — in the same run
+// or the next — instead of a buffer_free/buffer_alloc round trip through
+// the backend. A recycled buffer keeps its previous contents (and whatever
+// storage the backend hangs off it); kernels overwrite their result, so
+// nothing reads the stale value.
+//
+// Idle buffers are capped (count and bytes, oldest freed first when
+// over) and aged: endRun() frees buffers that stayed idle through
+// max_idle_runs consecutive runs. Thread-safe: one pool may serve every
+// Session on a backend.
+class FhnBufferPool {
+  public:
+  struct Limits {
+    uint32_t max_idle_buffers = 256; // 0 = keep nothing idle
+    uint64_t max_idle_bytes = 0;     // Σ byte class over idle buffers, 0 = unlimited
+    uint32_t max_idle_runs = 4;      // endRun() age-out, 0 = never
+  };
+
+  struct Stats {
+    uint64_t hits = 0;    // acquires served from an idle buffer
+    uint64_t misses = 0;  // acquires that called buffer_alloc
+    uint64_t trimmed = 0; // idle buffers released through buffer_free
+    uint32_t idle_buffers = 0;
+    uint64_t idle_bytes = 0;
+
+    double hitRate() const {
+      const uint64_t total = hits + misses;
+      return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+    }
+  };
+
+  FhnBufferPool(FhnBackendCtx *ctx, FhnBufferAllocFn alloc, FhnBufferFreeFn free) : FhnBufferPool(ctx, alloc, free, {}) {}
+  FhnBufferPool(FhnBackendCtx *ctx, FhnBufferAllocFn alloc, FhnBufferFreeFn free, Limits limits);
+  ~FhnBufferPool(); // frees every idle buffer
+
+  FhnBufferPool(const FhnBufferPool &) = delete;
+  FhnBufferPool &operator=(const FhnBufferPool &) = delete;
+
+  // The most recently released idle buffer of byte_class (the warmest),
+  // else a fresh buffer_alloc. nullptr only if buffer_alloc fails.
+  FhnBuffer *acquire(uint64_t byte_class);
+
+  // Hands buf back for reuse; may free the oldest idle buffers to respect
+  // the caps. buf must come from this pool's backend.
+  void release(FhnBuffer *buf, uint64_t byte_class);
+
+  // Marks the end of one program run and applies the max_idle_runs age-out.
+  void endRun();
+
+  // Frees idle buffers, oldest first, until at most keep_buffers remain.
+  void trim(uint32_t keep_buffers = 0);
+
+  Stats stats() const;
+
+  private:
+  struct Idle {
+    FhnBuffer *buf;
+    uint64_t byte_class;
+    uint64_t run; // run_ at release
+  };
+
+  void freeOldest(); // requires mutex_; idle_ non-empty
+  void enforceCaps();
+
+  FhnBackendCtx *ctx_;
+  FhnBufferAllocFn alloc_;
+  FhnBufferFreeFn free_;
+  Limits limits_;
+
+  mutable std::mutex mutex_;
+  std::list<Idle> idle_; // release order: front = oldest
+  std::unordered_map<uint64_t, std::vector<std::list<Idle>::iterator>> by_class_; // each ascending by age
+  uint64_t run_ = 0;
+  Stats stats_;
+};
+
+} // namespace fhenomenon
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/fhn_backend_api.h"
+#include "FHN/fhn_program.h"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace fhenomenon {
+
+// An FhnProgram resolved once against one executor's kernel table, for
+// callers that run the same program many times.
+//
+// compile() does all per-instruction bookkeeping up front: kernel pointers
+// are looked up, fused opcodes the table lacks are expanded into their
+// primitive steps (the same rules FhnDefaultExecutor applies at run time),
+// and every step's operand ids are recorded. bind() then turns those ids
+// into buffer pointers for one buffer table, so run() is a straight loop of
+// indirect calls — no hashing, no opcode switch, no operand-array rebuild.
+//
+// The compiled program copies the instructions it needs; the source program
+// and the executor may be destroyed afterwards. Kernel pointers stay valid
+// only as long as the backend that produced the table.
+class FhnCompiledProgram {
+  public:
+  // nullopt on ABI version mismatch or if any instruction cannot be
+  // resolved (no kernel and no applicable decomposition).
+  static std::optional<FhnCompiledProgram> compile(const FhnDefaultExecutor &executor, const FhnProgram &program);
+
+  // Steps hold pointers into the owned instruction copy: movable only.
+  FhnCompiledProgram(FhnCompiledProgram &&) = default;
+  FhnCompiledProgram &operator=(FhnCompiledProgram &&) = default;
+  FhnCompiledProgram(const FhnCompiledProgram &) = delete;
+  FhnCompiledProgram &operator=(const FhnCompiledProgram &) = delete;
+
+  // Pre-bind every step to buffers (indexed by id, as for execute()). Must
+  // be called again whenever an entry of the table is replaced.
+  void bind(FhnBuffer **buffers);
+
+  // Run every step against the bound table. Returns 0 on success, the
+  // first non-zero kernel status otherwise, and -1 if bind() was never
+  // called.
+  int run(FhnBackendCtx *ctx) const;
+
+  // bind() + run().
+  int execute(FhnBackendCtx *ctx, FhnBuffer **buffers) {
+    bind(buffers);
+    return run(ctx);
+  }
+
+  uint32_t instructionCount() const { return static_cast<uint32_t>(instructions_.size()); }
+  // Kernel calls per run(): instructionCount() plus decomposition fan-out.
+  uint32_t stepCount() const { return static_cast<uint32_t>(steps_.size()); }
+
+  private:
+  FhnCompiledProgram() = default;
+
+  struct Step {
+    FhnKernelFn fn = nullptr;
+    FhnBuffer *result = nullptr;
+    const FhnBuffer *operands[4] = {nullptr, nullptr, nullptr, nullptr};
+    const int64_t *params = nullptr;
+    const double *fparams = nullptr;
+  };
+
+  std::vector<FhnInstruction> instructions_; // params/fparams storage
+  std::vector<Step> steps_;
+  std::vector<uint32_t> slots_; // per step: result id, then operands[0..3] (0 = unused)
+  bool bound_ = false;
+};
+
+} // namespace fhenomenon
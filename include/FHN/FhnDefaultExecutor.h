@@ -1,11 +1,19 @@
 #pragma once
 
 #include "FHN/FhnMovementPlan.h"
+#include "FHN/FhnTrace.h"
 #include "FHN/fhn_backend_api.h"
-#include <unordered_map>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
 
 namespace fhenomenon {
 
+class FhnBufferPool;
+class FhnSpillFile;
+class FhnThreadPool;
+
 // Runtime services for plan-aware execution. ctx is passed through to every
 // hook; prefetch/evict may be null (single memory space: actions skipped).
 struct FhnMovementHooks {
@@ -14,32 +22,223 @@ struct FhnMovementHooks {
   FhnBufferFreeFn buffer_free = nullptr;
   FhnBufferPrefetchFn prefetch = nullptr;
   FhnBufferEvictFn evict = nullptr;
+  // Optional pair: planned prefetch_async actions start copies that their
+  // fence actions wait on. Without both, a prefetch_async runs as a
+  // synchronous prefetch where it is issued and fences are skipped.
+  FhnBufferPrefetchAsyncFn prefetch_async = nullptr;
+  FhnBufferFenceFn fence = nullptr;
+  // Optional: planned allocs/frees go through the pool (keyed by
+  // FhnMovementPlan::byteClass) instead of buffer_alloc/buffer_free, which
+  // may then be null.
+  FhnBufferPool *pool = nullptr;
+  // Disk tier (FhnPlanOptions::host_budget): a spill serializes the buffer
+  // into spill_file and releases it; an unspill allocates a fresh buffer
+  // and deserializes the value back. A plan with either action fails
+  // without all three.
+  FhnBufferSerializeFn serialize = nullptr;
+  FhnBufferDeserializeFn deserialize = nullptr;
+  FhnSpillFile *spill_file = nullptr;
+  // Multi-device execution (see FhnPartitioner): carry out the plan's send
+  // and receive actions. send hands a copy of buffer to copy.device;
+  // receive blocks until copy.value arrives from copy.device and returns
+  // the buffer, which the plan then owns (nullptr: the peer failed). A
+  // plan with either action fails without the hook.
+  std::function<int(const FhnPeerCopy &copy, const FhnBuffer *buffer)> send = nullptr;
+  std::function<FhnBuffer *(const FhnPeerCopy &copy)> receive = nullptr;
+};
+
+// The backend's optional async group (all five or none, see
+// fhn_backend_api.h). buffer_free releases outputs the host abandons.
+struct FhnAsyncHooks {
+  FhnBackendCtx *ctx = nullptr;
+  FhnSubmitFn submit = nullptr;
+  FhnPollFn poll = nullptr;
+  FhnWaitFn wait = nullptr;
+  FhnGetOutputsFn get_outputs = nullptr;
+  FhnExecFreeFn exec_free = nullptr;
+  FhnBufferFreeFn buffer_free = nullptr;
+
+  bool available() const { return submit && poll && wait && get_outputs && exec_free && buffer_free; }
+};
+
+// One kernel call an instruction resolves to. result_id/operands are buffer
+// ids (operand 0 = unused); params/fparams come from the source instruction.
+struct FhnKernelStep {
+  FhnOpCode opcode = FHN_OPCODE_COUNT;
+  FhnKernelFn fn = nullptr;
+  uint32_t result_id = 0;
+  uint32_t operands[4] = {0, 0, 0, 0};
 };
 
 class FhnDefaultExecutor {
   public:
-  explicit FhnDefaultExecutor(FhnKernelTable *table);
+  // Longest decomposition: HMULT -> MULT_CC + RELINEARIZE + RESCALE.
+  static constexpr uint32_t kMaxSteps = 3;
+
+  // kernel_flags (optional fhn_kernel_flags export) is queried once per
+  // registered opcode against ctx; without it every kernel is serial.
+  // batch_table (optional fhn_get_batch_kernels result) serves
+  // executeBatch(); entries whose opcode has no regular kernel are ignored.
+  explicit FhnDefaultExecutor(FhnKernelTable *table, FhnKernelFlagsFn kernel_flags = nullptr,
+                              FhnBackendCtx *ctx = nullptr, FhnBatchKernelTable *batch_table = nullptr);
 
   bool supports(FhnOpCode opcode) const;
 
+  // Registered kernel for opcode, or nullptr (also for out-of-range values).
+  FhnKernelFn kernel(FhnOpCode opcode) const {
+    const auto index = static_cast<uint32_t>(opcode);
+    return index < kernels_.size() ? kernels_[index] : nullptr;
+  }
+
+  // Registered kernel's table name for opcode, or nullptr.
+  const char *kernelName(FhnOpCode opcode) const {
+    const auto index = static_cast<uint32_t>(opcode);
+    return index < names_.size() ? names_[index] : nullptr;
+  }
+
+  // Registered batched kernel for opcode, or nullptr.
+  FhnBatchKernelFn batchKernel(FhnOpCode opcode) const {
+    const auto index = static_cast<uint32_t>(opcode);
+    return index < batch_kernels_.size() ? batch_kernels_[index] : nullptr;
+  }
+
+  // Resolve one instruction to the kernel calls that implement it: its own
+  // kernel when registered (unless kernel costs say its decomposition is
+  // cheaper at level), else the decomposition into registered primitives.
+  // level -1 takes the level-independent choice (see setKernelCosts).
+  // Writes up to kMaxSteps entries into steps and returns how many; 0
+  // means the instruction cannot run on this kernel table.
+  uint32_t resolve(const FhnInstruction &inst, FhnKernelStep *steps, int64_t level = -1) const;
+
+  // Per-opcode cost estimates (optional fhn_get_kernel_costs result). For
+  // every fused opcode with both a registered kernel and a decomposition
+  // into registered primitives, the cheaper path is chosen; a
+  // decomposition costs the sum of its steps. With a level model the choice
+  // is made per level 0..fresh_level, and every entry point (both
+  // execute() overloads, executeParallel, executeBatch and
+  // FhnCompiledProgram::compile) follows each instruction's operand level;
+  // without a model the fresh-level choice applies. Opcodes lacking an estimate for
+  // any kernel involved keep their own kernel. nullptr restores the
+  // default: a registered kernel always wins.
+  void setKernelCosts(const FhnKernelCostTable *costs, const FhnLevelModel *model = nullptr);
+
+  // True when opcode has a registered kernel that kernel costs displaced
+  // in favour of its decomposition at level (-1: level-independent choice).
+  bool prefersDecomposition(FhnOpCode opcode, int64_t level = -1) const;
+
+  // Operand level of every instruction under the cost model's level
+  // effects, the level to resolve() it at; empty (resolve at -1) unless
+  // the kernel choice is level-dependent.
+  std::vector<int64_t> instructionLevels(const FhnProgram &program) const;
+
+  // FhnKernelFlag bits declared for opcode's kernel (0 if none/unknown).
+  uint32_t kernelFlags(FhnOpCode opcode) const {
+    const auto index = static_cast<uint32_t>(opcode);
+    return index < flags_.size() ? flags_[index] : 0u;
+  }
+
+  // Attach (or, with nullptr, detach) a trace sink. Both execute()
+  // overloads then record one FhnTraceEvent per instruction; with no sink
+  // the only cost is a null check per instruction. The sink is not owned
+  // and must outlive its attachment.
+  void setTraceSink(FhnTrace *trace) { trace_ = trace; }
+  FhnTrace *traceSink() const { return trace_; }
+
+  // Level the def-use DAG into wavefronts: instruction indices grouped so
+  // that every instruction in wave k depends (true, anti or output
+  // dependence on a buffer id) only on instructions in waves < k. Program
+  // order is kept within a wave.
+  static std::vector<std::vector<uint32_t>> wavefronts(const FhnProgram &program);
+
   // Execute a program by dispatching each instruction to kernel functions.
   // buffers is indexed by result_id.
   // Returns 0 on success, non-zero on error.
   int execute(FhnBackendCtx *ctx, const FhnProgram *program, FhnBuffer **buffers);
 
   // Plan-aware execution: applies plan.at(i) around each instruction
-  // (evict -> alloc -> prefetch before, free after). buffers arrives with
-  // input ids filled; planned allocations are written into it. On failure
-  // every plan-allocated id not yet freed is freed and nulled.
+  // (receive -> level_down -> evict -> spill -> alloc -> unspill ->
+  // prefetch before, send -> free after); level_down runs the table's
+  // FHN_LEVEL_DOWN kernel in place and fails without one. buffers arrives
+  // with input ids filled; planned allocations, receives and restored
+  // spills are written into it. On failure every plan-allocated, received
+  // or restored id not yet freed is freed and nulled, after any copy still
+  // in flight is fenced, and spilled values are dropped from the file. With hooks.pool, "allocated"/"freed"
+  // mean acquired from/released to the pool, and every run ends with
+  // pool->endRun().
   int execute(const FhnMovementHooks &hooks, const FhnProgram *program, FhnBuffer **buffers,
               const FhnMovementPlan &plan);
 
+  // Wavefront-parallel execution. Each wave's instructions whose resolved
+  // kernels are all FHN_KERNEL_THREAD_SAFE run concurrently on pool; the
+  // rest of the wave then runs serially on the calling thread with no other
+  // kernel in flight. Every instruction is resolved before any runs, so an
+  // unsupported opcode fails without side effects. Returns 0 on success,
+  // else a failing kernel's status; no later wave starts after a failure.
+  int executeParallel(FhnBackendCtx *ctx, const FhnProgram *program, FhnBuffer **buffers, FhnThreadPool &pool);
+
+  // Run one program for n independent requests: tables[r] is request r's
+  // buffer table, indexed by id as in execute(). Instruction-major, so each
+  // resolved kernel call covers all n requests at once — one batched kernel
+  // call where the backend registers one, else a loop of regular calls.
+  // Every instruction is resolved before any runs. Returns 0 on success,
+  // -1 on an unresolvable instruction, else the first failing status.
+  int executeBatch(FhnBackendCtx *ctx, const FhnProgram *program, FhnBuffer ***tables, uint32_t n);
+
+  // Filled by prepare with the batch's inputs, in program->input_ids order.
+  using FhnPrepareFn = std::function<int(uint32_t batch, FhnBuffer **inputs)>;
+  // Receives a batch's inputs and its outputs (program->output_ids order,
+  // nullptr if the batch failed or was abandoned). The callee owns every
+  // buffer; both arrays are valid only for the duration of the call.
+  using FhnConsumeFn = std::function<void(uint32_t batch, FhnBuffer **inputs, FhnBuffer **outputs)>;
+
+  // Async pipelined execution of one program over num_batches input
+  // batches on the backend's async group. Batch b + 1 is prepared (host-side
+  // encryption, typically) and submitted before batch b is waited on, so
+  // host work overlaps backend execution with two batches in flight. Every
+  // batch prepare() was called for reaches consume() exactly once, in batch
+  // order. Kernels run on the backend, not through this executor's table.
+  // Returns 0 on success; on failure the in-flight batches are drained and
+  // the first error is returned.
+  static int executePipelined(const FhnAsyncHooks &hooks, const FhnProgram *program, uint32_t num_batches,
+                              const FhnPrepareFn &prepare, const FhnConsumeFn &consume);
+
   private:
-  std::unordered_map<int, FhnKernelFn> dispatch_;
+  // Dense opcode-indexed dispatch: one load per instruction, no hashing.
+  std::array<FhnKernelFn, FHN_OPCODE_COUNT> kernels_{};
+  std::array<uint32_t, FHN_OPCODE_COUNT> flags_{};
+  std::array<FhnBatchKernelFn, FHN_OPCODE_COUNT> batch_kernels_{};
+  std::array<const char *, FHN_OPCODE_COUNT> names_{};
+  // execute()'s dispatch table: kernels_ minus the kernels displaced by
+  // their cheaper decomposition, which route through resolve() instead.
+  std::array<FhnKernelFn, FHN_OPCODE_COUNT> direct_{};
+  // Level-dependent choice, decompose_at_[level][opcode]; empty unless
+  // the cheaper path differs between levels.
+  std::vector<std::array<bool, FHN_OPCODE_COUNT>> decompose_at_;
+  int64_t fresh_level_ = 0;
+  std::array<FhnLevelEffect, FHN_OPCODE_COUNT> level_effects_{};
+  FhnTrace *trace_ = nullptr;
+
+  FhnKernelFn directKernel(FhnOpCode opcode) const {
+    const auto index = static_cast<uint32_t>(opcode);
+    return index < direct_.size() ? direct_[index] : nullptr;
+  }
+
+  // Decomposition of a fused instruction into registered primitives (0
+  // steps if it has none); nested fused steps follow the choice at level.
+  uint32_t decomposition(const FhnInstruction &inst, FhnKernelStep *steps, int64_t level) const;
 
   // Attempt to decompose a fused opcode into primitives.
   // Returns true if decomposition succeeded.
-  bool decompose(FhnBackendCtx *ctx, const FhnInstruction &inst, FhnBuffer **buffers);
+  bool decompose(FhnBackendCtx *ctx, const FhnInstruction &inst, FhnBuffer **buffers, int64_t level = -1);
+
+  // Record instruction index's trace event: kernels ran from start_ns to
+  // now, after movement_ns of pre-instruction movement (act, if planned).
+  void traceInstruction(uint32_t index, const FhnInstruction &inst, int64_t level, uint64_t start_ns,
+                        uint64_t movement_ns, const FhnMovementActions *act) const;
+
+  // Run pre-resolved steps of one instruction. Returns the kernel status.
+  static int runSteps(FhnBackendCtx *ctx, const FhnInstruction &inst, const FhnKernelStep *steps, uint32_t count,
+                      FhnBuffer **buffers);
 };
 
 } // namespace fhenomenon
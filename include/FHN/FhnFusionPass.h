@@ -0,0 +1,43 @@
+#pragma once
+
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/fhn_program.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace fhenomenon {
+
+// Peephole pass that folds primitive sequences back into the backend's
+// fused kernels — the inverse of FhnDefaultExecutor's decomposition:
+//
+//   t = ROTATE(x, d);  y = ADD_CC(t, z) | ADD_CC(z, t)  ->  y = HROT_ADD(x, z, d)
+//   t = MULT_CS(x, s); y = ADD_CC(t, z) | ADD_CC(z, t)  ->  y = MAD(x, z, s)
+//   t = MULT_CC(a, b); u = RELINEARIZE(t); v = RESCALE(u)  ->  v = HMULT(a, b)
+//
+// A sequence fuses only when the executor's table registers the fused
+// opcode itself, every intermediate value is read exactly once (by the next
+// step of the pattern) and is neither a program output nor preserved, the
+// producer's operands are not overwritten before the consumer runs, and the
+// fused result does not alias its addend (HROT_ADD/MAD decompositions
+// write the result before reading it). Unmatched instructions are copied
+// unchanged and in order.
+class FhnFusionPass {
+  public:
+  struct Stats {
+    uint32_t hrot_add = 0;
+    uint32_t mad = 0;
+    uint32_t hmult = 0;
+
+    uint32_t fused() const { return hrot_add + mad + hmult; }
+  };
+
+  // Returns a new program (release with fhn_program_free) with the same
+  // inputs and outputs, or nullptr on ABI version mismatch or allocation
+  // failure. preserved: ids whose final value the caller reads besides the
+  // program outputs (e.g. Session write-back targets).
+  static FhnProgram *run(const FhnDefaultExecutor &executor, const FhnProgram &program,
+                         const std::vector<uint32_t> &preserved = {}, Stats *stats = nullptr);
+};
+
+} // namespace fhenomenon
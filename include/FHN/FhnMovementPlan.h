@@ -3,8 +3,12 @@
 #include "FHN/fhn_backend_api.h"
 #include "FHN/fhn_program.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <optional>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -26,14 +30,161 @@ struct FhnLevelModel {
   std::unordered_map<int, FhnLevelEffect> effects; // key: FhnOpCode
 };
 
-// One instruction slot's data movement actions.
-// Pre-instruction order is evict -> alloc -> prefetch: evictions make room
-// before allocations and transfers claim it. free applies post-instruction.
+// One inter-device copy of a partitioned program (see FhnPartitioner).
+struct FhnPeerCopy {
+  uint32_t id = 0;     // buffer id in this plan's table (a slot with assign_slots)
+  uint32_t device = 0; // the peer: destination of a send, source of a receive
+  uint32_t value = 0;  // id in the unpartitioned program; pairs a send with its receive
+};
+
+// An in-place level reduction ahead of an eviction (see
+// FhnPlanOptions::level_down_before_evict).
+struct FhnLevelDown {
+  uint32_t id = 0;   // buffer id in this plan's table (a slot with assign_slots)
+  int64_t level = 0; // FHN_LEVEL_DOWN target: the highest level any remaining use needs
+};
+
+// Optional analyze() passes. Both default off/on so that a caller that
+// never passes options keeps the one-buffer-per-id plan.
+struct FhnPlanOptions {
+  // Color ids onto physical buffer slots by liveness interval: an id whose
+  // lifetime has ended hands its slot (and, unbudgeted, its buffer) to a
+  // later def. The plan then describes a rewritten program (program())
+  // whose ids are slots, and callers index their buffer table by slotOf().
+  bool assign_slots = false;
+  // With assign_slots: let a result take the slot of an operand that dies
+  // at the same instruction, as the kernel aliasing contract allows — never
+  // the addend of HROT_ADD/HCONJ_ADD/MAD, which their decompositions read
+  // after writing the result.
+  bool in_place = true;
+  // Budgeted plans: when the eviction victim is cheaper to recompute than
+  // to move out and back, discard it (no transfer) and re-run its defining
+  // instruction right before its next use. Only unpinned instruction
+  // results qualify, and only while that instruction's operands stay alive
+  // until the reuse without themselves being discarded; they join that
+  // instruction's working set, which must still fit the budget.
+  bool rematerialize = false;
+  // Recompute estimates by opcode (e.g. a backend's fhn_get_kernel_costs),
+  // weighed against a round trip of 2 * cost(id) * transfer_ns_per_unit,
+  // cost(id) being bytes with a level model and 1 otherwise. Opcodes the
+  // table omits are never recomputed. Null: the cheap linear ops (ADD/SUB,
+  // NEGATE, plaintext and scalar MULT) always recompute, nothing else does.
+  const FhnKernelCostTable *remat_costs = nullptr;
+  double transfer_ns_per_unit = 0.0;
+  // Start each prefetch up to this many instructions before its use, as an
+  // asynchronous copy (prefetch_async) that the use waits on (fence), so
+  // the transfer overlaps the compute in between. A prefetch never moves
+  // above the eviction it undoes, nor is a peer_receives input's first
+  // prefetch hoisted at all (its receive would move ahead of this
+  // device's sends), and under a budget it moves only across instructions
+  // whose peak residency still fits with it in flight. 0 = off.
+  uint32_t prefetch_lookahead = 0;
+  // Multi-device partitions (FhnPartitioner fills both). peer_sends: ids
+  // this program defines that peer devices read, each with the devices to
+  // send it to; the send follows the def, before any free. peer_receives:
+  // inputs that arrive from a peer device rather than from the caller,
+  // each received before the first action that touches it. analyze()
+  // rejects a send of an id the program does not define, and a receive of
+  // one that is not an input.
+  std::unordered_map<uint32_t, std::vector<uint32_t>> peer_sends;
+  std::unordered_map<uint32_t, uint32_t> peer_receives; // input id -> source device
+  // Byte mode: before evicting a value that every remaining use reads at a
+  // lower level than it holds — a use needs only the lowest level among its
+  // operands, or LEVEL_DOWN's target — lower it in place (FHN_LEVEL_DOWN)
+  // to the highest level those uses need, so the eviction and the
+  // prefetches that bring it back move that level's bytes. The level trace
+  // is unchanged. Residency stays budgeted at the def level's bytes (the
+  // buffer's capacity), so eviction choices do not change either. Never
+  // applies to pinned ids or to operands a pending recomputation reads.
+  // Executing the plan needs an FHN_LEVEL_DOWN kernel.
+  bool level_down_before_evict = false;
+  // Third tier: bound the host memory that holds evicted values too.
+  // Whenever the values parked on the host — evicted and not yet
+  // prefetched back — would exceed host_budget (in device_budget's units,
+  // each value at its def level), spill the one prefetched farthest ahead
+  // (Belady again, ties to the lower id) to disk, and restore it (unspill)
+  // right before that prefetch, sync or async. Pinned ids stay on the host
+  // — the caller holds their buffers — and the plan is rejected if they
+  // alone exceed the budget. 0 = unbounded host (two tiers). Executing
+  // spills needs the serialization hooks and a spill file (see
+  // FhnMovementHooks).
+  uint64_t host_budget = 0;
+  // Disk-tier time per unit spilled or restored, the counterpart of
+  // transfer_ns_per_unit for the device link; both price Stats::movement_ns.
+  double spill_ns_per_unit = 0.0;
+  // Record a per-instruction residency timeline (FhnMovementPlan::timeline).
+  // Off by default: it holds every instruction's resident set.
+  bool record_timeline = false;
+};
+
+// A read-only run of one instruction's actions of one kind, inside the
+// plan's flat storage; valid while the plan is.
+template <typename T> class FhnActionSpan {
+  public:
+  using value_type = T;
+  using iterator = const T *;
+  using const_iterator = const T *;
+
+  FhnActionSpan() = default;
+  FhnActionSpan(const T *data, std::size_t size) : data_(data), size_(size) {}
+
+  const T *begin() const { return data_; }
+  const T *end() const { return data_ + size_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const T &operator[](std::size_t k) const { return data_[k]; }
+
+  friend bool operator==(const FhnActionSpan &a, const FhnActionSpan &b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end());
+  }
+  friend bool operator==(const FhnActionSpan &a, const std::vector<T> &b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end());
+  }
+
+  private:
+  const T *data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+// One instruction slot's data movement actions, as views into the plan.
+// Pre-instruction order is receive -> level_down -> evict -> spill ->
+// discard -> alloc -> unspill -> prefetch -> fence -> recompute ->
+// prefetch_async: values from peer devices land first, values shrink
+// right before they are evicted, evictions (and the spills they force)
+// and discards make room before allocations and transfers claim it,
+// spilled values are back on the host before any prefetch reads them,
+// recomputation runs once its operands are resident, and asynchronous
+// prefetches for later instructions start last so they overlap this one.
+// send, then free, apply post-instruction.
 struct FhnMovementActions {
-  std::vector<uint32_t> evict;
-  std::vector<uint32_t> alloc;
-  std::vector<uint32_t> prefetch;
-  std::vector<uint32_t> free;
+  FhnActionSpan<FhnPeerCopy> receive;     // wait for a peer's send; the buffer lands like a caller-provided input
+  FhnActionSpan<FhnLevelDown> level_down; // run FHN_LEVEL_DOWN in place on an id evicted next
+  FhnActionSpan<uint32_t> evict;
+  FhnActionSpan<uint32_t> spill;   // serialize an evicted value to disk and release its buffer
+  FhnActionSpan<uint32_t> discard; // freed without a transfer; recomputed before next use
+  FhnActionSpan<uint32_t> alloc;
+  FhnActionSpan<uint32_t> unspill; // restore a spilled value into a fresh buffer, still evicted
+  FhnActionSpan<uint32_t> prefetch;
+  FhnActionSpan<uint32_t> fence;          // wait for an earlier prefetch_async of each id to complete
+  FhnActionSpan<uint32_t> recompute;      // indices of earlier instructions to re-run into a fresh result buffer
+  FhnActionSpan<uint32_t> prefetch_async; // start copies that a later instruction fences
+  FhnActionSpan<FhnPeerCopy> send;        // copy a just-defined value to a peer device
+  FhnActionSpan<uint32_t> free;
+};
+
+// One instruction of a plan's residency timeline
+// (FhnPlanOptions::record_timeline), at the instruction's peak: after its
+// pre-instruction actions, before its frees — the point Stats::high_water
+// measures.
+struct FhnTimelinePoint {
+  std::vector<uint32_t> resident; // device-resident ids (slots with assign_slots), ascending
+  uint64_t resident_bytes = 0;    // Σ byteClass over resident (model only, else 0)
+  uint32_t transfers = 0;         // evictions and prefetches (sync or async) in its actions
+  uint64_t transfer_bytes = 0;    // their bytes at the level moved (model only, else 0)
+  // Residency reaches the plan's high water here (high_water_bytes in byte
+  // mode): the instructions that size device memory, and under a budget
+  // the ones it binds at.
+  bool bottleneck = false;
 };
 
 // A runtime data movement schedule for one FhnProgram.
@@ -44,6 +195,14 @@ struct FhnMovementActions {
 // under a device budget — Belady-optimal eviction (evict the resident
 // buffer whose next use is farthest; exact here, not a heuristic, because
 // the future is fully known).
+//
+// Per-id state lives in flat arrays indexed by id, sized like the buffer
+// table (tableSize()), and a precomputed next-use chain plus a heap of
+// residents keep budgeted planning at O(n log k) for n instructions and k
+// resident buffers — fast enough for multi-million-instruction programs.
+// The actions themselves are stored per kind in CSR form (an offset per
+// instruction into one flat array), so planning allocates per kind, not
+// per instruction.
 class FhnMovementPlan {
   public:
   struct Stats {
@@ -51,7 +210,33 @@ class FhnMovementPlan {
     uint32_t alloc_count = 0;
     uint32_t prefetch_count = 0;
     uint32_t evict_count = 0;
-    uint64_t high_water_bytes = 0; // max simultaneously resident bytes (model only, else 0)
+    uint32_t recompute_count = 0;        // rematerialize: discards, each recomputed once
+    uint32_t hoisted_prefetch_count = 0; // prefetch_lookahead: prefetches issued async ahead of their use
+    uint64_t hoist_distance = 0;         // Σ instructions those prefetches run ahead
+    uint32_t send_count = 0;             // peer_sends: copies to other devices
+    uint32_t receive_count = 0;          // peer_receives: copies from other devices
+    uint32_t level_down_count = 0;       // level_down_before_evict: in-place level reductions
+    uint64_t high_water_bytes = 0;       // max simultaneously resident bytes (model only, else 0)
+    // Model only: bytes moved by evictions and prefetches (sync or async),
+    // each at the level its value holds when it moves, and the bytes level
+    // reductions saved against moving every value at its def level.
+    uint64_t transfer_bytes = 0;
+    uint64_t level_down_saved_bytes = 0;
+    // host_budget: values spilled to disk (each restored once), and the
+    // most units ever parked on the host.
+    uint32_t spill_count = 0;
+    uint64_t host_high_water = 0;
+    // Estimated movement time: units crossing the device link (evictions
+    // and prefetches) at transfer_ns_per_unit plus units spilled and
+    // restored at spill_ns_per_unit — bytes at the level moved in byte
+    // mode, one per value otherwise.
+    double movement_ns = 0.0;
+    // Allocs (and recomputations) an FhnBufferPool serves from buffers the
+    // plan freed or discarded earlier, per byte class: starting from an
+    // empty pool (first run), and starting from what the previous run left
+    // idle (steady state, no pool caps).
+    uint32_t pool_hits = 0;
+    uint32_t pool_warm_hits = 0;
   };
 
   // pinned: ids that must survive execution; the plan never frees them.
@@ -71,21 +256,102 @@ class FhnMovementPlan {
   // A zero-instruction program has no action slots, so unused unpinned
   // inputs are not freed in that (degenerate) case; callers that can
   // produce such programs must pin or free their inputs themselves.
+  // options: see FhnPlanOptions. With assign_slots, every action and
+  // stat refers to slots, not ids. Unbudgeted, a released slot keeps its
+  // buffer until a later def reuses it (no free/alloc pair); under a
+  // budget, only exact-size reuse is allowed and a reused slot is freed
+  // and re-allocated, so residency never exceeds what the budget admitted.
   static std::optional<FhnMovementPlan> analyze(const FhnProgram &program, const std::vector<uint32_t> &pinned,
                                                 uint64_t device_budget = 0,
                                                 FhnEvictionPolicy policy = FhnEvictionPolicy::Belady,
-                                                const FhnLevelModel *model = nullptr);
+                                                const FhnLevelModel *model = nullptr,
+                                                const FhnPlanOptions &options = FhnPlanOptions());
 
-  const FhnMovementActions &at(uint32_t inst_index) const { return actions_[inst_index]; }
+  // Views into the plan's storage: they stay valid while the plan does.
+  FhnMovementActions at(uint32_t i) const {
+    return {receive_.row(i), level_down_.row(i), evict_.row(i), spill_.row(i), discard_.row(i),
+            alloc_.row(i), unspill_.row(i), prefetch_.row(i), fence_.row(i), recompute_.row(i),
+            prefetch_async_.row(i), send_.row(i), free_.row(i)};
+  }
   const Stats &stats() const { return stats_; }
+  // FhnBufferPool key for id (a slot with assign_slots): bytes at its
+  // level — the slot's capacity — in byte mode, else 0.
+  uint64_t byteClass(uint32_t id) const { return id < byte_class_.size() ? byte_class_[id] : 0; }
   // Used to reject executing a plan against a different program.
-  uint32_t instructionCount() const { return static_cast<uint32_t>(actions_.size()); }
+  uint32_t instructionCount() const { return instruction_count_; }
+
+  // Slot assignment (FhnPlanOptions::assign_slots). Without it, slotOf is
+  // the identity and program() is nullptr: execute the analyzed program.
+  // With it, execute program() — the analyzed program with every id
+  // replaced by its slot — against a table of tableSize() buffers, placing
+  // input id k at slotOf(k) and reading output id k back from slotOf(k).
+  uint32_t slotOf(uint32_t id) const {
+    if (!program_)
+      return id;
+    return id < slot_of_.size() ? slot_of_[id] : 0;
+  }
+  uint32_t tableSize() const { return table_size_; }
+  const FhnProgram *program() const { return program_.get(); }
+
+  // One point per instruction with FhnPlanOptions::record_timeline, else
+  // empty.
+  const std::vector<FhnTimelinePoint> &timeline() const { return timeline_; }
+  // timeline() as CSV — a header row, then one row per instruction with the
+  // resident set space-separated in the last column — and as a JSON array
+  // of one object per instruction.
+  std::string timelineCsv() const;
+  std::string timelineJson() const;
 
   private:
   FhnMovementPlan() = default;
 
-  std::vector<FhnMovementActions> actions_;
+  // One kind of action for every instruction in CSR form: instruction i's
+  // actions are items[offsets[i], offsets[i + 1]). No offsets: no
+  // instruction has any. analyze() fills rows in instruction order.
+  template <typename T> struct ActionTable {
+    std::vector<uint32_t> offsets;
+    std::vector<T> items;
+
+    FhnActionSpan<T> row(uint32_t i) const {
+      if (offsets.empty())
+        return {};
+      return {items.data() + offsets[i], offsets[i + 1] - offsets[i]};
+    }
+    // Appends to instruction i's row; i never decreases between calls.
+    void push(uint32_t i, const T &item) {
+      if (offsets.size() <= i)
+        offsets.resize(static_cast<std::size_t>(i) + 1, static_cast<uint32_t>(items.size()));
+      items.push_back(item);
+    }
+    // Closes the rows of an n-instruction plan.
+    void seal(uint32_t n) {
+      if (items.empty())
+        offsets.clear();
+      else
+        offsets.resize(static_cast<std::size_t>(n) + 1, static_cast<uint32_t>(items.size()));
+    }
+  };
+
+  uint32_t instruction_count_ = 0;
+  ActionTable<FhnPeerCopy> receive_;
+  ActionTable<FhnLevelDown> level_down_;
+  ActionTable<uint32_t> evict_;
+  ActionTable<uint32_t> spill_;
+  ActionTable<uint32_t> discard_;
+  ActionTable<uint32_t> alloc_;
+  ActionTable<uint32_t> unspill_;
+  ActionTable<uint32_t> prefetch_;
+  ActionTable<uint32_t> fence_;
+  ActionTable<uint32_t> recompute_;
+  ActionTable<uint32_t> prefetch_async_;
+  ActionTable<FhnPeerCopy> send_;
+  ActionTable<uint32_t> free_;
+  std::vector<uint64_t> byte_class_;          // by id (slot with assign_slots); byte mode only
+  std::vector<uint32_t> slot_of_;             // by id; assign_slots only
+  std::shared_ptr<const FhnProgram> program_; // assign_slots only; shared keeps the plan copyable
+  uint32_t table_size_ = 1;
   Stats stats_;
+  std::vector<FhnTimelinePoint> timeline_; // record_timeline only
 };
 
 } // namespace fhenomenon
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnMovementPlan.h"
+#include "FHN/fhn_program.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fhenomenon {
+
+// FhnPartitioner's cost estimates.
+struct FhnPartitionOptions {
+  // Estimated cost per instruction: its opcode's base_ns in this table
+  // (1 for opcodes it omits), or 1 each without a table.
+  const FhnKernelCostTable *costs = nullptr;
+  // Estimated cost of one inter-device copy, in the same unit.
+  double transfer_cost = 1.0;
+};
+
+// Splits one FhnProgram across N contexts of a backend — one per device —
+// and runs the parts concurrently, copying ciphertexts between contexts
+// where an instruction reads a value another device computed.
+//
+// Instructions are list-scheduled in program order onto the device where
+// they would finish first, estimating each device as an in-order queue:
+// an instruction starts once its device is free and its operands are
+// there, an operand computed (or homed) elsewhere arriving one
+// transfer_cost after it is ready, and each value is copied to a device at
+// most once. Ties go to fewer new copies, then the lighter device. A chain
+// therefore stays on one device unless another is idle long enough to pay
+// for the copy, and independent subtrees spread out. Inputs live on the
+// device of their first reader; other readers get a copy before the run.
+// When the estimate comes out no better than one device, everything stays
+// on device 0.
+//
+// Each part keeps its instructions in source order and the source ids, so
+// each device's plan is an ordinary FhnMovementPlan of its own program
+// (budgets, rematerialization, lookahead and slots all apply per device),
+// extended with send/receive actions for the copies. Every receive waits
+// for a send of an earlier source instruction and sits at the value's
+// first use — lookahead never hoists it above this device's own sends —
+// so running the parts concurrently cannot deadlock.
+class FhnPartitioner {
+  public:
+  struct Stats {
+    uint32_t transfers = 0;   // inter-device copies: results read elsewhere, and inputs read away from home
+    double serial = 0.0;      // Σ instruction cost: the estimated makespan on one device
+    double makespan = 0.0;    // estimated finish of the last instruction, copies included
+    std::vector<double> load; // Σ instruction cost by device
+  };
+
+  // One device's share of the program.
+  struct Part {
+    // Its instructions in source order. Inputs: the source inputs homed
+    // here, then — in first-need order — copies of inputs homed elsewhere
+    // and values received from peers. Outputs: the source outputs homed
+    // here.
+    std::shared_ptr<const FhnProgram> program;
+    std::vector<uint32_t> pinned; // the caller's pinned ids homed here
+    FhnPlanOptions options;       // peer_sends/peer_receives; pass to analyze()
+  };
+
+  struct Partition {
+    std::vector<Part> parts;                                 // by device
+    std::vector<uint32_t> device_of;                         // by source instruction
+    std::unordered_map<uint32_t, uint32_t> home;             // id -> device defining it (inputs: first reader, else 0)
+    std::vector<std::pair<uint32_t, uint32_t>> input_copies; // (input id, device) copied before the run
+    Stats stats;
+  };
+
+  // Execution resources of one device. Devices may share an executor that
+  // has no trace sink attached.
+  struct Device {
+    FhnDefaultExecutor *executor = nullptr;
+    // ctx, buffer_alloc/buffer_free and any movement hooks or pool for this
+    // device's plan; execute() supplies send and receive.
+    FhnMovementHooks hooks;
+    // Required when the partition copies anything (see fhn_buffer_copy_peer).
+    FhnBufferCopyPeerFn copy_peer = nullptr;
+  };
+
+  // nullopt on ABI version mismatch, num_devices == 0, an invalid program
+  // (zero/duplicate defs, an operand used before or without a def) or
+  // allocation failure. pinned: as for FhnMovementPlan::analyze, in source
+  // ids; each part pins the ones it homes.
+  static std::optional<Partition> partition(const FhnProgram &program, const std::vector<uint32_t> &pinned,
+                                            uint32_t num_devices,
+                                            const FhnPartitionOptions &options = FhnPartitionOptions());
+
+  // Runs every part concurrently, one thread per device: part d on
+  // devices[d] under plans[d], analyzed from parts[d] with its options.
+  // tables[d] is device d's buffer table, indexed as plans[d] expects
+  // (ids, or slots with assign_slots). The caller fills each source input
+  // on its home device; execute() copies inputs to the other devices that
+  // read them, and each output ends up on its home device. Returns 0 on
+  // success, else the first failing device's status (-1 for a bad
+  // argument or a failed copy); peers then stop at their next receive, and
+  // the copies the failed run left behind are released.
+  static int execute(const Partition &partition, const std::vector<Device> &devices,
+                     const std::vector<FhnMovementPlan> &plans, const std::vector<FhnBuffer **> &tables);
+};
+
+} // namespace fhenomenon
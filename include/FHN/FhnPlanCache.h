@@ -0,0 +1,98 @@
+#pragma once
+
+#include "FHN/FhnMovementPlan.h"
+#include "FHN/fhn_program.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace fhenomenon {
+
+// LRU cache of executable programs and their movement plans, keyed by the
+// structure of the lowered program plus the pinned set and device budget.
+// A Session whose recorded graph lowers to the same program as an earlier
+// run skips the fusion pass and FhnMovementPlan::analyze and goes straight
+// to execution. Lowering itself still runs: it produces the per-run
+// id -> entity bindings.
+//
+// Lookups compare the full key, not just its fingerprint, so a hash
+// collision costs a miss, never a wrong plan. Thread-safe: one cache may
+// serve every Session on a backend.
+class FhnPlanCache {
+  public:
+  // What a hit hands back: the program to execute (the lowered program
+  // after any caller rewrites such as fusion) and its plan. Shared so an
+  // entry evicted mid-run stays alive for the run that holds it.
+  struct Entry {
+    std::shared_ptr<const FhnProgram> program;
+    FhnMovementPlan plan;
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0; // LRU entries dropped to respect capacity
+    uint32_t entries = 0;
+
+    double hitRate() const {
+      const uint64_t total = hits + misses;
+      return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+    }
+  };
+
+  explicit FhnPlanCache(std::size_t capacity = 64) : capacity_(capacity) {}
+
+  FhnPlanCache(const FhnPlanCache &) = delete;
+  FhnPlanCache &operator=(const FhnPlanCache &) = delete;
+
+  // Structural hash of everything that shapes a plan: instructions
+  // (opcode, ids, params, fparams bit patterns), input and output ids, the
+  // pinned set (order and duplicates ignored) and the device budget.
+  static uint64_t fingerprint(const FhnProgram &program, const std::vector<uint32_t> &pinned, uint64_t device_budget);
+
+  // The cached entry for this key, promoted to most recently used, or
+  // nullptr (counted as a miss).
+  std::shared_ptr<const Entry> find(const FhnProgram &program, const std::vector<uint32_t> &pinned,
+                                    uint64_t device_budget);
+
+  // Caches entry under this key, replacing an existing one, and evicts the
+  // least recently used entries beyond capacity. A zero capacity caches
+  // nothing.
+  void insert(const FhnProgram &program, const std::vector<uint32_t> &pinned, uint64_t device_budget,
+              std::shared_ptr<const Entry> entry);
+
+  void clear();
+  Stats stats() const;
+
+  private:
+  struct Key {
+    uint64_t fingerprint = 0;
+    std::vector<FhnInstruction> instructions;
+    std::vector<uint32_t> inputs;
+    std::vector<uint32_t> outputs;
+    std::vector<uint32_t> pinned; // sorted, deduplicated
+    uint64_t device_budget = 0;
+
+    bool operator==(const Key &other) const;
+  };
+  struct Node {
+    Key key;
+    std::shared_ptr<const Entry> entry;
+  };
+
+  static Key makeKey(const FhnProgram &program, const std::vector<uint32_t> &pinned, uint64_t device_budget);
+  std::list<Node>::iterator lookup(const Key &key); // requires mutex_; lru_.end() if absent
+
+  std::size_t capacity_;
+  mutable std::mutex mutex_;
+  std::list<Node> lru_; // front = most recently used
+  std::unordered_multimap<uint64_t, std::list<Node>::iterator> by_fingerprint_;
+  Stats stats_;
+};
+
+} // namespace fhenomenon
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "FHN/FhnMovementPlan.h"
+#include "FHN/fhn_program.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace fhenomenon {
+
+// Memory-minimizing instruction reordering, run before
+// FhnMovementPlan::analyze. Lowering emits a post-order DFS per root,
+// which can open many independent subtrees before closing any (wide-front
+// opens all 24 partial products, and their 72 inputs, before the first
+// reduction). This pass list-schedules the dependence DAG (true, anti and
+// output dependences on buffer ids, so any valid order is kept valid)
+// Sethi–Ullman style: among the ready instructions it takes the one that
+// grows the live set least — weighted by byte class under a level model —
+// preferring instructions that retire their operands, then the smaller
+// instantaneous peak, then program order.
+//
+// The greedy order is only adopted when the movement plan says it is
+// better: fewer transfers under a device budget (then a lower high water),
+// else a lower high water (bytes under a model, else buffers). Otherwise
+// the original order is returned, so the pass never makes a plan worse.
+class FhnSchedulePass {
+  public:
+  struct Stats {
+    bool reordered = false; // the greedy order won
+    uint32_t moved = 0;     // instructions whose index changed
+    FhnMovementPlan::Stats before;
+    FhnMovementPlan::Stats after; // == before unless reordered
+  };
+
+  // Returns a new program (release with fhn_program_free) with the same
+  // inputs, outputs and instructions in a dependence-respecting order, or
+  // nullptr on ABI version mismatch, allocation failure or a program
+  // analyze() rejects. pinned, device_budget and model are passed to
+  // analyze() unchanged to score both orders.
+  static FhnProgram *run(const FhnProgram &program, const std::vector<uint32_t> &pinned, uint64_t device_budget = 0,
+                         const FhnLevelModel *model = nullptr, Stats *stats = nullptr);
+};
+
+} // namespace fhenomenon
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace fhenomenon {
+
+// Disk tier for plan-aware execution: a memory-mapped scratch file holding
+// the serialized buffers a plan spilled (FhnMovementActions::spill) until
+// they are restored (unspill). Extents are carved first-fit from a free
+// list and coalesced on release; when none fits, the file grows (at least
+// doubling) and is remapped. The kernel page cache absorbs the writes, so
+// a spill costs a memcpy until memory pressure pushes the pages to disk.
+// The file is removed on destruction. Not thread-safe: one spill file per
+// executing thread.
+class FhnSpillFile {
+  public:
+  struct Extent {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+  };
+
+  struct Stats {
+    uint64_t file_bytes = 0;       // current file (and mapping) size
+    uint64_t live_bytes = 0;       // Σ size over reserved extents
+    uint64_t high_water_bytes = 0; // max live_bytes
+    uint64_t reserves = 0;
+    uint64_t grows = 0; // file extensions (each a remap)
+  };
+
+  // Creates (or truncates) the file at path. nullptr if it cannot be created.
+  static std::unique_ptr<FhnSpillFile> create(const std::string &path);
+  ~FhnSpillFile(); // unmaps, closes and removes the file
+
+  FhnSpillFile(const FhnSpillFile &) = delete;
+  FhnSpillFile &operator=(const FhnSpillFile &) = delete;
+
+  // size > 0 bytes of the file, growing it as needed; nullopt if the file
+  // cannot grow (disk full, mapping failure).
+  std::optional<Extent> reserve(uint64_t size);
+  // Hands the extent back for reuse.
+  void release(const Extent &extent);
+  // The extent's bytes in the mapping. Valid until the next reserve(),
+  // which may remap.
+  unsigned char *data(const Extent &extent) const { return base_ + extent.offset; }
+
+  const std::string &path() const { return path_; }
+  const Stats &stats() const { return stats_; }
+
+  private:
+  FhnSpillFile(int fd, std::string path) : fd_(fd), path_(std::move(path)) {}
+  bool grow(uint64_t min_bytes);
+  void insertFree(uint64_t offset, uint64_t size); // coalesces with its neighbours
+
+  int fd_;
+  std::string path_;
+  unsigned char *base_ = nullptr;
+  std::map<uint64_t, uint64_t> free_; // offset -> size, disjoint and non-adjacent
+  Stats stats_;
+};
+
+} // namespace fhenomenon
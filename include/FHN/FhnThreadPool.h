@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fhenomenon {
+
+// Fixed-size work-stealing pool for fork-join batches of FHE kernels.
+//
+// parallelFor() deals task indices round-robin onto one deque per
+// participant (the calling thread is participant 0). Each participant pops
+// from the back of its own deque and, once empty, steals from the front of
+// the others', so a batch whose kernels vary widely in cost still finishes
+// together. Tasks are coarse (one kernel call each), so a mutex per deque is
+// cheap relative to the work it hands out.
+class FhnThreadPool {
+  public:
+  // threads: total participants including the caller; 0 = hardware
+  // concurrency. A pool of 1 runs everything on the calling thread.
+  explicit FhnThreadPool(uint32_t threads = 0);
+  ~FhnThreadPool();
+
+  FhnThreadPool(const FhnThreadPool &) = delete;
+  FhnThreadPool &operator=(const FhnThreadPool &) = delete;
+
+  uint32_t threadCount() const { return static_cast<uint32_t>(queues_.size()); }
+
+  // Run fn(i) for every i in [0, count) and return once all calls have
+  // returned. fn must not throw and must not call parallelFor on this pool.
+  void parallelFor(uint32_t count, const std::function<void(uint32_t)> &fn);
+
+  private:
+  struct Task {
+    const std::function<void(uint32_t)> *fn;
+    uint32_t index;
+  };
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool popOrSteal(std::size_t self, Task &task);
+  void drain(std::size_t self);
+  void workerLoop(std::size_t self);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_; // guards generation_/stop_; pairs with wake_/done_
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  uint64_t generation_ = 0;
+  bool stop_ = false;
+  std::atomic<uint32_t> pending_{0};
+};
+
+} // namespace fhenomenon
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "FHN/fhn_program.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fhenomenon {
+
+// One executed instruction as seen by FhnDefaultExecutor::execute().
+struct FhnTraceEvent {
+  static constexpr uint32_t kMaxKernels = 3; // FhnDefaultExecutor::kMaxSteps
+
+  uint32_t track = 0; // FhnTrace::beginTrack() id current at record time
+  uint32_t index = 0; // instruction index in its program
+  FhnOpCode opcode = FHN_NOP;
+  bool decomposed = false; // ran as its primitive decomposition
+  // Registered kernel names in call order: the instruction's own kernel, or
+  // each primitive of its decomposition. Owned by the backend's table.
+  uint32_t num_kernels = 0;
+  const char *kernels[kMaxKernels] = {nullptr, nullptr, nullptr};
+  uint64_t start_ns = 0;    // first kernel call, since the trace's origin
+  uint64_t duration_ns = 0; // all kernel calls of the instruction
+  // Plan-aware execution only: the instruction's movement actions and the
+  // time spent on the pre-instruction ones (level_down, evict, spill,
+  // discard, alloc, unspill, prefetch, fence, recompute, prefetch_async).
+  uint64_t movement_ns = 0;
+  uint32_t evict = 0;
+  uint32_t alloc = 0;
+  uint32_t prefetch = 0;
+  uint32_t free = 0;
+  uint32_t discard = 0;
+  uint32_t recompute = 0;
+  uint32_t prefetch_async = 0;
+  uint32_t fence = 0;
+  uint32_t level_down = 0;
+  uint32_t spill = 0;
+  uint32_t unspill = 0;
+};
+
+// Trace sink for FhnDefaultExecutor::setTraceSink(). Collects one event per
+// executed instruction and renders them as Chrome trace JSON (load in
+// chrome://tracing or Perfetto) or as a per-opcode latency summary.
+// Not thread-safe: attach one sink per executing thread.
+class FhnTrace {
+  public:
+  // Latency histogram buckets: bucket b counts durations in [2^b, 2^(b+1))
+  // ns (bucket 0 also takes 0 ns); the last bucket is open-ended.
+  static constexpr uint32_t kBuckets = 40;
+
+  struct OpcodeSummary {
+    FhnOpCode opcode = FHN_NOP;
+    uint32_t count = 0;
+    uint32_t decomposed = 0;
+    uint64_t total_ns = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p90_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t max_ns = 0;
+    std::array<uint32_t, kBuckets> buckets{};
+  };
+
+  FhnTrace() : origin_(std::chrono::steady_clock::now()) {}
+
+  // Nanoseconds since construction (or the last clear()).
+  uint64_t now() const {
+    return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin_).count());
+  }
+
+  // Start a named track (a row in the trace viewer, e.g. one per program);
+  // later events are recorded on it. Track 0 ("main") always exists.
+  uint32_t beginTrack(const std::string &name);
+
+  void record(FhnTraceEvent event) {
+    event.track = track_;
+    events_.push_back(event);
+  }
+
+  const std::vector<FhnTraceEvent> &events() const { return events_; }
+
+  // Drops every event and track and restarts the clock.
+  void clear();
+
+  // Per-opcode latency statistics, heaviest total time first.
+  std::vector<OpcodeSummary> summarize() const;
+
+  // summarize() as a fixed-width table with a log2 histogram per opcode.
+  std::string histogramText() const;
+
+  // Chrome trace event format: one complete ("X") event per instruction
+  // plus one per non-empty movement phase, on the instruction's track.
+  std::string chromeJson() const;
+
+  // Writes chromeJson() to path. Returns 0 on success, -1 on I/O failure.
+  int writeChromeJson(const std::string &path) const;
+
+  static const char *opcodeName(FhnOpCode opcode);
+
+  private:
+  std::chrono::steady_clock::time_point origin_;
+  std::vector<FhnTraceEvent> events_;
+  std::vector<std::string> tracks_{"main"};
+  uint32_t track_ = 0;
+};
+
+} // namespace fhenomenon
@@ -6,7 +6,18 @@
 extern "C" {
 #endif
 
-// The required backend exports for ToyFHE
+// The required backend exports for ToyFHE. config_json may set
+// {"key_seed": N}: contexts created with the same seed share a secret key;
+// {"packed": true, "ring_dim": N}: vectors encrypt into one RLWE
+// ciphertext (see Crypto/ToyFheRlwe.h); {"lazy_rotate": false}: ROTATE
+// copies vector slots into rotated order instead of recording an offset
+// over the source's shared slots; {"slot_threads": T, "slot_grain": G}:
+// vector kernels and bulk encryption (encrypt_batch, encrypt_vec) split
+// their slots across a pool of T threads (0 = hardware concurrency;
+// default 1, no pool) in chunks of at least G SIMD slot additions' worth
+// of work (default 65536; a ciphertext product counts 64, encrypting a
+// slot 8); {"encrypt_threads": T} sizes that pool when slot_threads is
+// not given.
 uint32_t toyfhe_fhn_get_abi_version(void);
 FhnBackendInfo *toyfhe_fhn_get_info(void);
 FhnBackendCtx *toyfhe_fhn_create(const char *config_json);
@@ -16,10 +27,16 @@ FhnKernelTable *toyfhe_fhn_get_kernels(FhnBackendCtx *ctx);
 // Host-side data plane (trusted; never dispatched from an FhnProgram)
 FhnBuffer *toyfhe_fhn_buffer_alloc(FhnBackendCtx *ctx);
 void toyfhe_fhn_buffer_free(FhnBackendCtx *ctx, FhnBuffer *buf);
+// Peer copy between contexts created with the same key_seed (-1 otherwise).
+int toyfhe_fhn_buffer_copy_peer(FhnBackendCtx *dst_ctx, FhnBuffer *dst, FhnBackendCtx *src_ctx, const FhnBuffer *src);
+// Serialization pair (see fhn_backend_api.h): every buffer kind round-trips.
+uint64_t toyfhe_fhn_buffer_serialize(FhnBackendCtx *ctx, const FhnBuffer *buffer, void *out, uint64_t capacity);
+int toyfhe_fhn_buffer_deserialize(FhnBackendCtx *ctx, FhnBuffer *buffer, const void *in, uint64_t size);
 int toyfhe_fhn_encrypt_i64(FhnBackendCtx *ctx, FhnBuffer *out, int64_t value);
 int toyfhe_fhn_encrypt_f64(FhnBackendCtx *ctx, FhnBuffer *out, double value);
 int toyfhe_fhn_decrypt_i64(FhnBackendCtx *ctx, const FhnBuffer *in, int64_t *value_out);
 int toyfhe_fhn_decrypt_f64(FhnBackendCtx *ctx, const FhnBuffer *in, double *value_out);
+int toyfhe_fhn_encrypt_batch_i64(FhnBackendCtx *ctx, FhnBuffer *const *outs, const int64_t *values, uint32_t count);
 
 // Vector (multi-slot) data plane. ToyFHE is single-slot, so a vector
 // ciphertext is represented as a CiphertextVec buffer packing n independent
@@ -39,6 +56,23 @@ int64_t toyfhe_fhn_fresh_level(FhnBackendCtx *ctx);
 uint64_t toyfhe_fhn_level_bytes(FhnBackendCtx *ctx, int64_t level);
 FhnLevelEffect toyfhe_fhn_opcode_level_effect(FhnBackendCtx *ctx, FhnOpCode opcode);
 
+// Kernel capability flags. The Engine serializes its RNG internally, so
+// every registered kernel is FHN_KERNEL_THREAD_SAFE.
+uint32_t toyfhe_fhn_kernel_flags(FhnBackendCtx *ctx, FhnOpCode opcode);
+
+// Batched forms of the vector (multi-slot) kernels: ADD_CC, MULT_CC, HMULT,
+// ROTATE and HROT_ADD. Scalar operands fall back to the per-request kernel.
+FhnBatchKernelTable *toyfhe_fhn_get_batch_kernels(FhnBackendCtx *ctx);
+
+// Async execution on a ctx-owned worker thread (see fhn_backend_api.h for
+// the contract). Host-side encryption on the same ctx may run concurrently.
+FhnExecHandle *toyfhe_fhn_submit(FhnBackendCtx *ctx, const FhnProgram *program, FhnBuffer **inputs,
+                                 uint32_t num_inputs);
+int toyfhe_fhn_poll(FhnExecHandle *handle);
+int toyfhe_fhn_wait(FhnExecHandle *handle);
+FhnBuffer **toyfhe_fhn_get_outputs(FhnExecHandle *handle, uint32_t *num_outputs);
+void toyfhe_fhn_exec_free(FhnExecHandle *handle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -92,6 +92,49 @@ typedef void (*FhnBufferFreeFn)(FhnBackendCtx *ctx, FhnBuffer *buffer);
 typedef int (*FhnBufferPrefetchFn)(FhnBackendCtx *ctx, FhnBuffer *buffer);
 typedef int (*FhnBufferEvictFn)(FhnBackendCtx *ctx, FhnBuffer *buffer);
 
+/* ── Optional asynchronous prefetch (data plane) ──
+   Lets the host overlap H2D copies with compute. Both exports appear
+   TOGETHER, and only alongside the prefetch/evict pair, or the group is
+   ignored with a warning. Additive: no FHN_ABI_VERSION bump.
+
+   fhn_buffer_prefetch_async: start making the buffer compute-resident and
+   return without waiting. No-op if already resident or in flight.
+   fhn_buffer_fence: block until the buffer's outstanding async prefetch
+   has completed; no-op if none. The host fences a buffer before any
+   kernel reads it and before evicting or freeing it. 0 on success. */
+typedef int (*FhnBufferPrefetchAsyncFn)(FhnBackendCtx *ctx, FhnBuffer *buffer);
+typedef int (*FhnBufferFenceFn)(FhnBackendCtx *ctx, FhnBuffer *buffer);
+
+/* ── Optional peer copy (data plane) ──
+   For hosts that run one program across several contexts of the same
+   backend (one per device, see FhnPartitioner). Additive: no
+   FHN_ABI_VERSION bump.
+
+   fhn_buffer_copy_peer: make dst, a buffer allocated on dst_ctx, hold a
+   copy of src's ciphertext, which lives on src_ctx (device-to-device
+   where the hardware allows it). The contexts must share key material —
+   how is backend configuration. Called from the thread driving src_ctx
+   while kernels may be running on dst_ctx, so it must not disturb them.
+   Non-zero if the contexts cannot exchange ciphertexts. */
+typedef int (*FhnBufferCopyPeerFn)(FhnBackendCtx *dst_ctx, FhnBuffer *dst, FhnBackendCtx *src_ctx,
+                                   const FhnBuffer *src);
+
+/* ── Optional serialization (data plane) ──
+   A buffer's contents as a flat byte string and back, e.g. for a host
+   that spills buffers to disk (see FhnSpillFile). Both exports appear
+   TOGETHER or the pair is ignored with a warning. Additive: no
+   FHN_ABI_VERSION bump.
+
+   fhn_buffer_serialize: the size of buffer's serialized form; when out is
+   non-NULL and capacity covers that size, also writes it to out. 0 on
+   failure (never a valid size). Callable in either residency state.
+   fhn_buffer_deserialize: make buffer (from fhn_buffer_alloc on a context
+   of the same backend) hold what fhn_buffer_serialize wrote, resident on
+   the host side when the backend has the movement pair (a prefetch
+   follows). 0 on success, non-zero on a malformed or truncated string. */
+typedef uint64_t (*FhnBufferSerializeFn)(FhnBackendCtx *ctx, const FhnBuffer *buffer, void *out, uint64_t capacity);
+typedef int (*FhnBufferDeserializeFn)(FhnBackendCtx *ctx, FhnBuffer *buffer, const void *in, uint64_t size);
+
 /* Level effect of a compute opcode, declared by CKKS-family backends for
    byte-accurate movement planning (see fhn_fresh_level/fhn_level_bytes/
    fhn_opcode_level_effect, resolved as an all-or-nothing trio). */
@@ -109,12 +152,113 @@ typedef int64_t (*FhnFreshLevelFn)(FhnBackendCtx *ctx);
 typedef uint64_t (*FhnLevelBytesFn)(FhnBackendCtx *ctx, int64_t level);
 typedef FhnLevelEffect (*FhnOpcodeLevelEffectFn)(FhnBackendCtx *ctx, FhnOpCode opcode);
 
+/* ── Optional kernel capability flags ──
+   fhn_kernel_flags(ctx, opcode) returns a bitmask of FhnKernelFlag bits
+   for the kernel registered under opcode (0 for unregistered opcodes).
+
+   FHN_KERNEL_THREAD_SAFE: the kernel may run concurrently with any other
+   thread-safe kernel on the same ctx, provided no two concurrent calls
+   write the same result buffer and none writes a buffer another reads.
+   A kernel without the bit is only ever called while no other kernel runs
+   on ctx (e.g. it draws from a shared, unsynchronized RNG).
+
+   Optional and additive: absent means no bits set (every kernel serial);
+   no FHN_ABI_VERSION bump. */
+typedef enum FhnKernelFlag {
+  FHN_KERNEL_THREAD_SAFE = 1,
+} FhnKernelFlag;
+typedef uint32_t (*FhnKernelFlagsFn)(FhnBackendCtx *ctx, FhnOpCode opcode);
+
+/* ── Optional batched kernels ──
+   One call runs the same instruction for count independent requests
+   (one program shape, many buffer tables). Request r reads operands
+   [r * 4, r * 4 + 4) (NULL = unused, as in FhnKernelFn) and writes
+   results[r]; params/fparams are shared by every request. Distinct
+   requests never share a result buffer; within a request the FhnKernelFn
+   aliasing rule applies. Returns 0 on success; on failure every result is
+   unspecified.
+
+   fhn_get_batch_kernels lists the batched entries. Each opcode must also
+   have a regular kernel-table entry: the executor resolves instructions
+   through the regular table and uses a batched entry only to dispatch the
+   resolved kernel across requests. Optional and additive: absent means the
+   executor loops the regular kernel per request; no FHN_ABI_VERSION bump. */
+typedef int (*FhnBatchKernelFn)(FhnBackendCtx *ctx, uint32_t count, FhnBuffer *const *results,
+                                const FhnBuffer *const *operands, const int64_t *params, const double *fparams);
+
+typedef struct FhnBatchKernelEntry {
+  FhnOpCode opcode;
+  FhnBatchKernelFn fn; /* NULL = not batched */
+  const char *name;    /* for debugging/logging */
+} FhnBatchKernelEntry;
+
+typedef struct FhnBatchKernelTable {
+  uint32_t num_kernels;
+  FhnBatchKernelEntry *kernels;
+} FhnBatchKernelTable;
+
+typedef FhnBatchKernelTable *(*FhnGetBatchKernelsFn)(FhnBackendCtx *ctx);
+
+/* ── Optional kernel cost estimates ──
+   fhn_get_kernel_costs lists estimated costs for registered kernels, in
+   nanoseconds or any other unit used consistently across the table. A
+   kernel's cost at ciphertext level L is base_ns + per_level_ns * L, so
+   CKKS-family backends can express cost growing with the limb count
+   (levels as declared by the level model; per_level_ns = 0 when
+   level-independent). The executor uses the table to pick, per
+   instruction, the cheaper of a fused opcode's own kernel and its
+   decomposition into primitives. Opcodes without an entry are never
+   compared. fhn-calibrate measures a loaded backend and writes these
+   numbers out. Optional and additive: absent means a registered fused
+   kernel always wins; no FHN_ABI_VERSION bump. */
+typedef struct FhnKernelCost {
+  FhnOpCode opcode;
+  double base_ns;      /* estimated cost at level 0 */
+  double per_level_ns; /* added per level above 0 */
+} FhnKernelCost;
+
+typedef struct FhnKernelCostTable {
+  uint32_t num_costs;
+  FhnKernelCost *costs;
+} FhnKernelCostTable;
+
+typedef FhnKernelCostTable *(*FhnGetKernelCostsFn)(FhnBackendCtx *ctx);
+
 typedef int (*FhnEncryptInt64Fn)(FhnBackendCtx *ctx, FhnBuffer *out, int64_t value);
 typedef int (*FhnEncryptDoubleFn)(FhnBackendCtx *ctx, FhnBuffer *out, double value);
 typedef int (*FhnDecryptInt64Fn)(FhnBackendCtx *ctx, const FhnBuffer *in, int64_t *value_out);
 typedef int (*FhnDecryptDoubleFn)(FhnBackendCtx *ctx, const FhnBuffer *in, double *value_out);
 
-/* Optional advanced exports (NULL if not provided) */
+/* ── Optional bulk encryption (data plane) ──
+   fhn_encrypt_batch_i64: encrypt values[i] into outs[i] for i < count,
+   each a scalar ciphertext as fhn_encrypt_i64 would produce, in one call
+   the backend may vectorize and parallelize. 0 on success. Additive: no
+   FHN_ABI_VERSION bump; hosts fall back to fhn_encrypt_i64 per value. */
+typedef int (*FhnEncryptBatchInt64Fn)(FhnBackendCtx *ctx, FhnBuffer *const *outs, const int64_t *values,
+                                      uint32_t count);
+
+/* ── Optional async execution (control plane) ──
+   Resolved as an all-or-nothing group of five; additive, no
+   FHN_ABI_VERSION bump.
+
+   fhn_submit: queue program for execution and return immediately. inputs
+   holds num_inputs (== program->num_inputs) buffers in input_ids order;
+   the backend borrows them and the host must neither modify nor free them
+   until the handle completes. The backend copies the program, so the host
+   may free it once fhn_submit returns. NULL on rejection (bad arguments,
+   ABI mismatch).
+   fhn_poll: 0 while running, 1 once completed successfully, < 0 on failure.
+   Never blocks.
+   fhn_wait: block until completion; 0 on success, non-zero on failure.
+   fhn_get_outputs: after successful completion, the program's outputs in
+   output_ids order, written count in *num_outputs. Every returned buffer is
+   a distinct backend buffer (an output that names an input id is a copy),
+   and ownership passes to the host (release with fhn_buffer_free). Only the
+   first call transfers anything; NULL before completion, after failure, or
+   once collected. The array itself stays valid until fhn_exec_free.
+   fhn_exec_free: wait for completion if still running, then release the
+   handle and any outputs not collected. Every handle must be freed before
+   fhn_destroy. */
 typedef FhnExecHandle *(*FhnSubmitFn)(FhnBackendCtx *ctx, const FhnProgram *program, FhnBuffer **inputs,
                                       uint32_t num_inputs);
 typedef int (*FhnPollFn)(FhnExecHandle *handle);
@@ -136,12 +280,22 @@ typedef struct FhnBackendVTable {
   /* Optional movement hooks (NULL if not provided by backend) */
   FhnBufferPrefetchFn prefetch;
   FhnBufferEvictFn evict;
+  /* Optional async prefetch pair (NULL if not provided by backend) */
+  FhnBufferPrefetchAsyncFn prefetch_async;
+  FhnBufferFenceFn fence;
+  /* Optional peer copy between contexts (NULL if not provided by backend) */
+  FhnBufferCopyPeerFn copy_peer;
+  /* Optional serialization pair (NULL if not provided by backend) */
+  FhnBufferSerializeFn serialize;
+  FhnBufferDeserializeFn deserialize;
   FhnEncryptInt64Fn encrypt_i64;
   FhnEncryptDoubleFn encrypt_f64;
   FhnDecryptInt64Fn decrypt_i64;
   FhnDecryptDoubleFn decrypt_f64;
+  /* Optional bulk encryption (NULL if not provided by backend) */
+  FhnEncryptBatchInt64Fn encrypt_batch_i64;
 
-  /* Optional (NULL if not provided by backend) */
+  /* Optional async group (all NULL if not provided by backend) */
   FhnSubmitFn submit;
   FhnPollFn poll;
   FhnWaitFn wait;
@@ -152,6 +306,15 @@ typedef struct FhnBackendVTable {
   FhnFreshLevelFn fresh_level;
   FhnLevelBytesFn level_bytes;
   FhnOpcodeLevelEffectFn opcode_level_effect;
+
+  /* Optional kernel capability flags (NULL if not provided by backend) */
+  FhnKernelFlagsFn kernel_flags;
+
+  /* Optional batched kernel table (NULL if not provided by backend) */
+  FhnGetBatchKernelsFn get_batch_kernels;
+
+  /* Optional kernel cost estimates (NULL if not provided by backend) */
+  FhnGetKernelCostsFn get_kernel_costs;
 } FhnBackendVTable;
 
 #ifdef __cplusplus
@@ -22,6 +22,9 @@ struct SessionAliasDeleter {
   void operator()(const void *) const noexcept {}
 };
 
+// A runAsync() submission awaiting sync(); defined in Session.cpp.
+struct SessionPendingRun;
+
 class Session final : public std::enable_shared_from_this<Session> {
   public:
   static std::shared_ptr<Session> create(const Backend &backend) {
@@ -31,10 +34,8 @@ class Session final : public std::enable_shared_from_this<Session> {
 
   static std::shared_ptr<Session> getSession() { return session_ptr_; }
 
-  ~Session() {
-    if (session_ptr_.get() == this)
-      session_ptr_ = nullptr;
-  }
+  // Discards a pending runAsync() submission without writing it back.
+  ~Session();
 
   template <typename T> void setEntity(const void *key, Fhenon<T> &entity) {
     entity_map_[key] = std::any(std::reference_wrapper<Fhenon<T>>(entity));
@@ -95,6 +96,16 @@ class Session final : public std::enable_shared_from_this<Session> {
   template <typename T> void saveOp(std::shared_ptr<scheduler::Operation<T>> op);
   template <typename Op> void run(Op &&ops);
 
+  // Like run(), but on a backend exporting the async group the lowered
+  // program is submitted and runAsync() returns without waiting, so the
+  // caller can encrypt the next inputs while the backend computes. Results
+  // land in the bound variables at sync(), which must happen while they are
+  // still alive; run(), runAsync() and sync() each complete a pending
+  // submission first. Without async support this is a synchronous run().
+  template <typename Op> void runAsync(Op &&ops);
+  void sync();
+  bool hasPendingRun() const { return pending_ != nullptr; }
+
   bool isActive() { return (session_ptr_ == nullptr) ? false : active_; }
 
   // Null-safe recording check: safe to call when no session was ever
@@ -117,13 +128,13 @@ class Session final : public std::enable_shared_from_this<Session> {
   private:
   // prevent direct instantiation
 
-  explicit Session(const Backend &backend)
-    : active_(false), backend_(backend), scheduler_(std::make_unique<scheduler::Scheduler>(backend)) {}
+  explicit Session(const Backend &backend);
 
   Session(const Session &) = delete;
   Session &operator=(const Session &) = delete;
 
-  void optimize();
+  template <typename Op> void record(Op &&ops, bool async);
+  void optimize(bool async);
 
   // Drop all recording state so a later run() starts fresh: recorded
   // operations hold aliases to caller-owned variables, and entity_map_ holds
@@ -150,6 +161,8 @@ class Session final : public std::enable_shared_from_this<Session> {
   std::vector<std::shared_ptr<scheduler::OperationBase>> operations_;
   // Map for reference of Fhenon
   std::unordered_map<const void *, std::any> entity_map_;
+  // Submitted by runAsync(), written back by sync().
+  std::unique_ptr<SessionPendingRun> pending_;
 
   // `thread_local` variable to save current session
   static thread_local std::shared_ptr<Session> session_ptr_;
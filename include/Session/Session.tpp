@@ -7,7 +7,15 @@ namespace fhenomenon {
 // Contract: Fhenon variables used inside `ops` must be declared in a scope
 // enclosing this call (and belong() to a profile) — recorded operations alias
 // them in place, and evaluation happens after the lambda body returns.
-template <typename Op> void Session::run(Op &&ops) {
+template <typename Op> void Session::run(Op &&ops) { record(std::forward<Op>(ops), /*async=*/false); }
+
+// Same contract as run(), extended to the matching sync().
+template <typename Op> void Session::runAsync(Op &&ops) { record(std::forward<Op>(ops), /*async=*/true); }
+
+template <typename Op> void Session::record(Op &&ops, bool async) {
+  // The new recording may read what the pending run writes back.
+  sync();
+
   LOG_MESSAGE("Session: begin");
   if (session_ptr_ == nullptr)
     session_ptr_ = shared_from_this();
@@ -17,8 +25,8 @@ template <typename Op> void Session::run(Op &&ops) {
     // Run lambda to capture operations
     ops();
 
-    // Build, optimize, and evaluate the recorded graph.
-    optimize();
+    // Build, optimize, and evaluate (or submit) the recorded graph.
+    optimize(async);
   } catch (...) {
     endRun();
     throw;
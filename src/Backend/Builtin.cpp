@@ -60,16 +60,38 @@ BuiltinBackend::BuiltinBackend() {
   ctx_core_ = std::shared_ptr<FhnBackendCtx>(toyfhe_fhn_create(nullptr), &toyfhe_fhn_destroy);
   fhn_ctx_ = ctx_core_.get();
   fhn_table_ = toyfhe_fhn_get_kernels(fhn_ctx_);
-  fhn_executor_ = std::make_unique<FhnDefaultExecutor>(fhn_table_);
+  fhn_executor_ = std::make_unique<FhnDefaultExecutor>(fhn_table_, toyfhe_fhn_kernel_flags, fhn_ctx_,
+                                                       toyfhe_fhn_get_batch_kernels(fhn_ctx_));
 #ifndef FHENOMENON_USE_TFHE
   // ToyFHE has a single memory space and exports no movement hooks, but it
-  // does declare a flat level model directly (no dlsym resolution needed).
-  runtime_ = {fhn_ctx_, fhn_executor_.get(),    toyfhe_fhn_buffer_alloc, toyfhe_fhn_buffer_free,         nullptr,
-              nullptr,  toyfhe_fhn_fresh_level, toyfhe_fhn_level_bytes,  toyfhe_fhn_opcode_level_effect, ctx_core_};
+  // does declare a flat level model and the async group directly (no dlsym
+  // resolution needed).
+  runtime_ = {fhn_ctx_,
+              fhn_executor_.get(),
+              toyfhe_fhn_buffer_alloc,
+              toyfhe_fhn_buffer_free,
+              nullptr,
+              nullptr,
+              nullptr,
+              nullptr,
+              toyfhe_fhn_fresh_level,
+              toyfhe_fhn_level_bytes,
+              toyfhe_fhn_opcode_level_effect,
+              toyfhe_fhn_submit,
+              toyfhe_fhn_poll,
+              toyfhe_fhn_wait,
+              toyfhe_fhn_get_outputs,
+              toyfhe_fhn_exec_free,
+              ctx_core_};
+  fhn_pool_ = std::make_unique<FhnBufferPool>(fhn_ctx_, toyfhe_fhn_buffer_alloc, toyfhe_fhn_buffer_free);
+  runtime_.pool = fhn_pool_.get();
+  fhn_plan_cache_ = std::make_unique<FhnPlanCache>();
+  runtime_.plan_cache = fhn_plan_cache_.get();
 #endif
 }
 
 BuiltinBackend::~BuiltinBackend() {
+  fhn_pool_.reset(); // idle buffers go back through the live context
   fhn_executor_.reset();
   fhn_ctx_ = nullptr;
   ctx_core_.reset(); // context destroyed once the last buffer releases it
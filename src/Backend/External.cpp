@@ -62,6 +62,8 @@ ExternalBackend::ExternalBackend(const std::string &libraryPath, const char *con
   vtable_.encrypt_f64 = reinterpret_cast<FhnEncryptDoubleFn>(dlsym(dl_handle_, sym("fhn_encrypt_f64").c_str()));
   vtable_.decrypt_i64 = reinterpret_cast<FhnDecryptInt64Fn>(dlsym(dl_handle_, sym("fhn_decrypt_i64").c_str()));
   vtable_.decrypt_f64 = reinterpret_cast<FhnDecryptDoubleFn>(dlsym(dl_handle_, sym("fhn_decrypt_f64").c_str()));
+  vtable_.encrypt_batch_i64 =
+    reinterpret_cast<FhnEncryptBatchInt64Fn>(dlsym(dl_handle_, sym("fhn_encrypt_batch_i64").c_str()));
   // Optional movement hooks: absent means a single memory space.
   vtable_.prefetch = reinterpret_cast<FhnBufferPrefetchFn>(dlsym(dl_handle_, sym("fhn_buffer_prefetch").c_str()));
   vtable_.evict = reinterpret_cast<FhnBufferEvictFn>(dlsym(dl_handle_, sym("fhn_buffer_evict").c_str()));
@@ -75,6 +77,32 @@ ExternalBackend::ExternalBackend(const std::string &libraryPath, const char *con
     vtable_.prefetch = nullptr;
     vtable_.evict = nullptr;
   }
+  // Optional async prefetch pair, on top of the movement pair: a lone
+  // fence has nothing to wait for, and an async prefetch nobody can fence
+  // would let a kernel read a buffer mid-copy.
+  vtable_.prefetch_async =
+    reinterpret_cast<FhnBufferPrefetchAsyncFn>(dlsym(dl_handle_, sym("fhn_buffer_prefetch_async").c_str()));
+  vtable_.fence = reinterpret_cast<FhnBufferFenceFn>(dlsym(dl_handle_, sym("fhn_buffer_fence").c_str()));
+  if ((vtable_.prefetch_async != nullptr) != (vtable_.fence != nullptr) ||
+      (vtable_.prefetch_async != nullptr && vtable_.prefetch == nullptr)) {
+    LOG_MESSAGE("ExternalBackend: fhn_buffer_prefetch_async/fhn_buffer_fence need each other and the "
+                "movement pair; ignoring them (prefetches stay synchronous)");
+    vtable_.prefetch_async = nullptr;
+    vtable_.fence = nullptr;
+  }
+  // Optional peer copy: only multi-context hosts use it.
+  vtable_.copy_peer = reinterpret_cast<FhnBufferCopyPeerFn>(dlsym(dl_handle_, sym("fhn_buffer_copy_peer").c_str()));
+  // Optional serialization pair: a spilled buffer nobody can restore is
+  // lost, so a lone export counts as neither.
+  vtable_.serialize = reinterpret_cast<FhnBufferSerializeFn>(dlsym(dl_handle_, sym("fhn_buffer_serialize").c_str()));
+  vtable_.deserialize =
+    reinterpret_cast<FhnBufferDeserializeFn>(dlsym(dl_handle_, sym("fhn_buffer_deserialize").c_str()));
+  if ((vtable_.serialize != nullptr) != (vtable_.deserialize != nullptr)) {
+    LOG_MESSAGE("ExternalBackend: backend exports only one of fhn_buffer_serialize/"
+                "fhn_buffer_deserialize; ignoring the half-pair (spilling disabled)");
+    vtable_.serialize = nullptr;
+    vtable_.deserialize = nullptr;
+  }
 
   // Optional level model trio: fhn_fresh_level/fhn_level_bytes/
   // fhn_opcode_level_effect. Byte-accurate movement planning needs all
@@ -95,12 +123,35 @@ ExternalBackend::ExternalBackend(const std::string &libraryPath, const char *con
     vtable_.opcode_level_effect = nullptr;
   }
 
+  // Optional kernel capability flags: absent means every kernel is serial.
+  vtable_.kernel_flags = reinterpret_cast<FhnKernelFlagsFn>(dlsym(dl_handle_, sym("fhn_kernel_flags").c_str()));
+  // Optional batched kernels: absent means executeBatch loops per request.
+  vtable_.get_batch_kernels =
+    reinterpret_cast<FhnGetBatchKernelsFn>(dlsym(dl_handle_, sym("fhn_get_batch_kernels").c_str()));
+  // Optional cost estimates: absent means a registered fused kernel always
+  // wins over its decomposition.
+  vtable_.get_kernel_costs =
+    reinterpret_cast<FhnGetKernelCostsFn>(dlsym(dl_handle_, sym("fhn_get_kernel_costs").c_str()));
+
   // 5. Resolve optional advanced symbols (NULL if absent)
   vtable_.submit = reinterpret_cast<FhnSubmitFn>(dlsym(dl_handle_, sym("fhn_submit").c_str()));
   vtable_.poll = reinterpret_cast<FhnPollFn>(dlsym(dl_handle_, sym("fhn_poll").c_str()));
   vtable_.wait = reinterpret_cast<FhnWaitFn>(dlsym(dl_handle_, sym("fhn_wait").c_str()));
   vtable_.get_outputs = reinterpret_cast<FhnGetOutputsFn>(dlsym(dl_handle_, sym("fhn_get_outputs").c_str()));
   vtable_.exec_free = reinterpret_cast<FhnExecFreeFn>(dlsym(dl_handle_, sym("fhn_exec_free").c_str()));
+  // The async group is all-or-nothing like the level trio: a host cannot
+  // drive a submission it can neither wait on, collect nor free.
+  const int async_count = (vtable_.submit != nullptr) + (vtable_.poll != nullptr) + (vtable_.wait != nullptr) +
+                          (vtable_.get_outputs != nullptr) + (vtable_.exec_free != nullptr);
+  if (async_count != 0 && async_count != 5) {
+    LOG_MESSAGE("ExternalBackend: backend exports only part of the fhn_submit/fhn_poll/fhn_wait/"
+                "fhn_get_outputs/fhn_exec_free group; ignoring the group (async disabled)");
+    vtable_.submit = nullptr;
+    vtable_.poll = nullptr;
+    vtable_.wait = nullptr;
+    vtable_.get_outputs = nullptr;
+    vtable_.exec_free = nullptr;
+  }
 
   // 6. Get backend info
   info_ = vtable_.get_info();
@@ -122,7 +173,19 @@ ExternalBackend::ExternalBackend(const std::string &libraryPath, const char *con
     throw std::runtime_error("ExternalBackend: fhn_get_kernels returned null");
   }
 
-  executor_ = std::make_unique<FhnDefaultExecutor>(fhn_table_);
+  FhnBatchKernelTable *batch_table = vtable_.get_batch_kernels ? vtable_.get_batch_kernels(fhn_ctx_) : nullptr;
+  executor_ = std::make_unique<FhnDefaultExecutor>(fhn_table_, vtable_.kernel_flags, fhn_ctx_, batch_table);
+  if (vtable_.get_kernel_costs) {
+    // Level-dependent costs are evaluated against the backend's own level
+    // model when it declares one.
+    FhnLevelModel model;
+    if (vtable_.fresh_level) {
+      model.fresh_level = vtable_.fresh_level(fhn_ctx_);
+      for (int op = 0; op < FHN_OPCODE_COUNT; ++op)
+        model.effects[op] = vtable_.opcode_level_effect(fhn_ctx_, static_cast<FhnOpCode>(op));
+    }
+    executor_->setKernelCosts(vtable_.get_kernel_costs(fhn_ctx_), vtable_.fresh_level ? &model : nullptr);
+  }
 
   // From here on the LibCore owns the context and the library handle;
   // buffer deleters share it, so teardown waits for the last buffer.
@@ -131,8 +194,27 @@ ExternalBackend::ExternalBackend(const std::string &libraryPath, const char *con
   core_->destroy = vtable_.destroy;
   core_->ctx = fhn_ctx_;
 
-  runtime_ = {fhn_ctx_,      executor_.get(),     vtable_.buffer_alloc, vtable_.buffer_free,         vtable_.prefetch,
-              vtable_.evict, vtable_.fresh_level, vtable_.level_bytes,  vtable_.opcode_level_effect, core_};
+  runtime_ = {fhn_ctx_,
+              executor_.get(),
+              vtable_.buffer_alloc,
+              vtable_.buffer_free,
+              vtable_.prefetch,
+              vtable_.evict,
+              vtable_.prefetch_async,
+              vtable_.fence,
+              vtable_.fresh_level,
+              vtable_.level_bytes,
+              vtable_.opcode_level_effect,
+              vtable_.submit,
+              vtable_.poll,
+              vtable_.wait,
+              vtable_.get_outputs,
+              vtable_.exec_free,
+              core_};
+  pool_ = std::make_unique<FhnBufferPool>(fhn_ctx_, vtable_.buffer_alloc, vtable_.buffer_free);
+  runtime_.pool = pool_.get();
+  plan_cache_ = std::make_unique<FhnPlanCache>();
+  runtime_.plan_cache = plan_cache_.get();
 
   std::cout << "ExternalBackend loaded: " << info_->name << " v" << info_->version
             << " (device_type=" << static_cast<int>(info_->device_type) << ")" << std::endl;
@@ -141,7 +223,9 @@ ExternalBackend::ExternalBackend(const std::string &libraryPath, const char *con
 ExternalBackend::~ExternalBackend() {
   // The executor references the kernel table inside the library, so it must
   // go first; the context and library are then released through core_ and
-  // destroyed once the last outstanding buffer drops its reference.
+  // destroyed once the last outstanding buffer drops its reference. Idle
+  // pooled buffers are freed first, while the library is certainly loaded.
+  pool_.reset();
   executor_.reset();
   fhn_ctx_ = nullptr;
   dl_handle_ = nullptr;
@@ -16,40 +16,126 @@ int64_t mod(int64_t value, int64_t modulus) {
   return result;
 }
 
-#if defined(__SIZEOF_INT128__)
-__extension__ int64_t mulMod(int64_t lhs, int64_t rhs, int64_t modulus) {
-  using wide_int = __int128;
-  wide_int wide = static_cast<wide_int>(lhs) * static_cast<wide_int>(rhs);
-  int64_t result = static_cast<int64_t>(wide % modulus);
-  if (result < 0) {
-    result += modulus;
+bool isApproximatelyInteger(double scalar, long double tolerance = 1e-9L) {
+  const long double scalar_ld = static_cast<long double>(scalar);
+  const long double rounded_ld = static_cast<long double>(std::llround(scalar));
+  return std::fabs(scalar_ld - rounded_ld) <= tolerance;
+}
+
+// Slots per stack block in the kernels that stage values on the stack.
+constexpr std::size_t kBlock = 256;
+
+// Calls run(lhsAt, rhsAt, outAt, count) for each maximal run of logical
+// slots in [begin, end) over which both views' stored slots are
+// contiguous: one run when neither is rotated, at most three otherwise.
+template <typename Run>
+void forEachRun(const VecView &lhs, const VecView &rhs, std::size_t begin, std::size_t end, Run run) {
+  const std::size_t n = lhs.size();
+  std::size_t a = lhs.rotation + begin < n ? lhs.rotation + begin : lhs.rotation + begin - n;
+  std::size_t b = rhs.rotation + begin < n ? rhs.rotation + begin : rhs.rotation + begin - n;
+  for (std::size_t i = begin; i < end;) {
+    const std::size_t count = std::min({end - i, n - a, n - b});
+    run(a, b, i, count);
+    i += count;
+    a = a + count == n ? 0 : a + count;
+    b = b + count == n ? 0 : b + count;
   }
-  return result;
 }
-#else
-int64_t mulMod(int64_t lhs, int64_t rhs, int64_t modulus) {
-  lhs = mod(lhs, modulus);
-  rhs = mod(rhs, modulus);
-  int64_t result = 0;
-  while (rhs > 0) {
-    if (rhs & 1) {
-      result = mod(result + lhs, modulus);
-    }
-    lhs = mod(lhs + lhs, modulus);
-    rhs >>= 1;
+
+// kernel(a, b, out, count) over the views' runs in [begin, end) with lhs
+// read as
+// lhs * liftA and rhs as rhs * liftB (mod q). Lifts of 1 read the stored
+// slots directly, the same-scale case; any other lift scales a stack block
+// of the operand at a time, so aligning scales never copies the vector.
+// Each block is read before its output is written: out may alias an
+// unrotated operand.
+template <typename Kernel>
+void liftedRuns(simd::Isa isa, int64_t q, const VecView &lhs, int64_t liftA, const VecView &rhs, int64_t liftB,
+                CiphertextVec &out, std::size_t begin, std::size_t end, Kernel kernel) {
+  int64_t liftedA[kBlock];
+  int64_t liftedB[kBlock];
+  for (auto part : {&CiphertextVec::c0, &CiphertextVec::c1}) {
+    const int64_t *a = (lhs.vec->*part).data();
+    const int64_t *b = (rhs.vec->*part).data();
+    int64_t *o = (out.*part).data();
+    forEachRun(lhs, rhs, begin, end, [&](std::size_t ia, std::size_t ib, std::size_t io, std::size_t count) {
+      if (liftA == 1 && liftB == 1) {
+        kernel(a + ia, b + ib, o + io, count);
+        return;
+      }
+      for (std::size_t done = 0; done < count; done += kBlock) {
+        const std::size_t len = std::min(kBlock, count - done);
+        const int64_t *pa = a + ia + done;
+        const int64_t *pb = b + ib + done;
+        if (liftA != 1) {
+          simd::mulScalarMod(isa, pa, liftA, liftedA, len, q);
+          pa = liftedA;
+        }
+        if (liftB != 1) {
+          simd::mulScalarMod(isa, pb, liftB, liftedB, len, q);
+          pb = liftedB;
+        }
+        kernel(pa, pb, o + io + done, len);
+      }
+    });
   }
-  return result;
 }
-#endif
 
-bool isApproximatelyInteger(double scalar, long double tolerance = 1e-9L) {
-  const long double scalar_ld = static_cast<long double>(scalar);
-  const long double rounded_ld = static_cast<long double>(std::llround(scalar));
-  return std::fabs(scalar_ld - rounded_ld) <= tolerance;
+// Per-slot costs handed to a SlotRunner, in SIMD slot additions: roughly
+// the measured time per slot of each kind of loop.
+constexpr std::size_t kSimdCost = 1;     // add, sub, negate, integral scalar multiply
+constexpr std::size_t kEncryptCost = 8;  // bulk encryption
+constexpr std::size_t kDecryptCost = 16; // slot-by-slot decryption
+constexpr std::size_t kProductCost = 64; // decode, 128-bit multiply-divide, re-encode
+
+// body(begin, end) over [0, n): through the runner's split when there is
+// one, else in one call on this thread.
+template <typename Body> void forSlotChunks(SlotRunner *runner, std::size_t n, std::size_t cost, Body &body) {
+  if (runner == nullptr) {
+    body(std::size_t{0}, n);
+    return;
+  }
+  runner->run(
+    n, cost, [](void *arg, std::size_t begin, std::size_t end) { (*static_cast<Body *>(arg))(begin, end); },
+    &body);
+}
+
+// each(r, begin, end) for the slots of each request that batch slots
+// [begin, end) cover, requests laid end to end n slots apiece.
+template <typename Each> void forEachRequest(std::size_t n, std::size_t begin, std::size_t end, Each each) {
+  for (std::size_t g = begin; g < end;) {
+    const std::size_t r = g / n;
+    const std::size_t first = g - r * n;
+    const std::size_t last = std::min(n, first + (end - g));
+    each(r, first, last);
+    g += last - first;
+  }
+}
+
+// Where vector ops copy an operand that aliases their output through a
+// rotation: per thread, so the capacity carries over from call to call.
+CiphertextVec &vecScratch(std::size_t which) {
+  thread_local CiphertextVec scratch[2];
+  return scratch[which];
 }
 } // namespace
 
-Engine::Engine() : initialized_(false), keysGenerated_(false), secretKey_(0), rng_(std::random_device{}()) {}
+const char *modReductionName(ModReduction reduction) {
+  switch (reduction) {
+  case ModReduction::Auto:
+    return "auto";
+  case ModReduction::PowerOfTwo:
+    return "power-of-two";
+  case ModReduction::Barrett:
+    return "barrett";
+  case ModReduction::Montgomery:
+    return "montgomery";
+  }
+  return "unknown";
+}
+
+Engine::Engine()
+    : initialized_(false), keysGenerated_(false), secretKey_(0), rng_(std::random_device{}()), bulkRng_(rng_()) {}
 
 void Engine::initialize(const Parameters &params) {
   if (params.q <= params.t) {
@@ -60,9 +146,42 @@ void Engine::initialize(const Parameters &params) {
     // which requires q to be an exact multiple of t.
     throw std::runtime_error("ToyFHE: ciphertext modulus q must be a multiple of plaintext modulus t");
   }
+  if (params.q > (static_cast<int64_t>(1) << 62)) {
+    // Slot-wise kernels add two residues in int64 before reducing.
+    throw std::runtime_error("ToyFHE: ciphertext modulus q must be at most 2^62");
+  }
   if (params.scale <= 1) {
     throw std::runtime_error("ToyFHE: scale must be greater than 1");
   }
+
+  ModReduction reduction = params.reduction;
+  if (reduction == ModReduction::Auto) {
+    if (modarith::isPowerOfTwo(params.q)) {
+      reduction = ModReduction::PowerOfTwo;
+    } else if ((params.q & 1) != 0) {
+      reduction = ModReduction::Montgomery;
+    } else {
+      reduction = ModReduction::Barrett;
+    }
+  }
+  switch (reduction) {
+  case ModReduction::PowerOfTwo:
+    if (!modarith::isPowerOfTwo(params.q)) {
+      throw std::runtime_error("ToyFHE: power-of-two reduction needs q to be a power of two");
+    }
+    modulus_ = PowerOfTwoModulus(params.q);
+    break;
+  case ModReduction::Montgomery:
+    if ((params.q & 1) == 0) {
+      throw std::runtime_error("ToyFHE: Montgomery reduction needs an odd q");
+    }
+    modulus_ = MontgomeryModulus(params.q);
+    break;
+  default:
+    modulus_ = BarrettModulus(params.q);
+    break;
+  }
+  reduction_ = reduction;
   params_ = params;
   initialized_ = true;
 }
@@ -72,20 +191,38 @@ void Engine::generateKeys() {
     throw std::runtime_error("ToyFHE: call initialize() before generateKeys()");
   }
   std::uniform_int_distribution<int64_t> dist(1, params_.t - 1);
-  secretKey_ = dist(rng_);
+  {
+    std::lock_guard<std::mutex> lock(rngMutex_);
+    secretKey_ = dist(rng_);
+  }
   keysGenerated_ = true;
   LOG_MESSAGE("ToyFHE: Generated secret key " << secretKey_);
 }
 
+void Engine::generateKeys(uint64_t seed) {
+  if (!initialized_) {
+    throw std::runtime_error("ToyFHE: call initialize() before generateKeys()");
+  }
+  std::mt19937_64 keyRng(seed);
+  std::uniform_int_distribution<int64_t> dist(1, params_.t - 1);
+  secretKey_ = dist(keyRng);
+  keysGenerated_ = true;
+  LOG_MESSAGE("ToyFHE: Generated secret key " << secretKey_ << " from seed " << seed);
+}
+
 // Wrap an already delta-scaled value (in [0, q)) into a fresh ciphertext.
 Ciphertext Engine::encodeRaw(int64_t value, Encoding encoding, int scalePower) const {
-  const int64_t a = sampleUniform();
-  const int64_t e = sampleNoise();
+  int64_t a = 0;
+  int64_t e = 0;
+  {
+    std::lock_guard<std::mutex> lock(rngMutex_);
+    a = sampleUniform();
+    e = sampleNoise();
+  }
 
   Ciphertext ciphertext;
   ciphertext.c1 = a;
-  const int64_t secretProd = mulMod(a, secretKey_, params_.q);
-  ciphertext.c0 = mod(value - secretProd + e, params_.q);
+  std::visit([&](const auto &m) { ciphertext.c0 = m.reduce(value - m.mul(a, secretKey_) + e); }, modulus_);
   ciphertext.scale_power = scalePower;
   ciphertext.encoding = encoding;
   return ciphertext;
@@ -97,7 +234,8 @@ Ciphertext Engine::encryptEncoded(int64_t message, Encoding encoding, int scaleP
   }
 
   const int64_t plain = mod(message, params_.t);
-  return encodeRaw(mulMod(delta(), plain, params_.q), encoding, scalePower);
+  const int64_t scaled = std::visit([&](const auto &m) { return m.mul(delta(), plain); }, modulus_);
+  return encodeRaw(scaled, encoding, scalePower);
 }
 
 Ciphertext Engine::encryptInt(int64_t value) const { return encryptEncoded(value, Encoding::Integer, 0); }
@@ -126,8 +264,12 @@ Ciphertext Engine::add(const Ciphertext &lhs, const Ciphertext &rhs) const {
   Ciphertext right = alignScale(rhs, targetScale);
 
   Ciphertext result;
-  result.c0 = mod(left.c0 + right.c0, params_.q);
-  result.c1 = mod(left.c1 + right.c1, params_.q);
+  std::visit(
+    [&](const auto &m) {
+      result.c0 = m.reduce(left.c0 + right.c0);
+      result.c1 = m.reduce(left.c1 + right.c1);
+    },
+    modulus_);
   result.scale_power = targetScale;
   result.encoding = (left.encoding == Encoding::FixedPoint || right.encoding == Encoding::FixedPoint)
                       ? Encoding::FixedPoint
@@ -143,6 +285,10 @@ Ciphertext Engine::add(const Ciphertext &lhs, const Ciphertext &rhs) const {
 // relinearization this replaces; see the Engine comment in ToyFHE.h.
 Ciphertext Engine::multiplyDecoded(const Ciphertext &cipher, int64_t factor, int64_t divisor, Encoding encoding,
                                    int scalePower) const {
+  return encodeRaw(productRaw(cipher, factor, divisor), encoding, scalePower);
+}
+
+int64_t Engine::productRaw(const Ciphertext &cipher, int64_t factor, int64_t divisor) const {
   const int64_t p = centeredMod(decodeRaw(cipher), params_.q);
 
 #if defined(__SIZEOF_INT128__)
@@ -168,8 +314,7 @@ Ciphertext Engine::multiplyDecoded(const Ciphertext &cipher, int64_t factor, int
   const long double reduced = std::fmod(approx, static_cast<long double>(params_.q));
   const int64_t value = mod(static_cast<int64_t>(std::llround(reduced)), params_.q);
 #endif
-
-  return encodeRaw(value, encoding, scalePower);
+  return value;
 }
 
 Ciphertext Engine::multiply(const Ciphertext &lhs, const Ciphertext &rhs) const {
@@ -200,8 +345,12 @@ Ciphertext Engine::multiply(const Ciphertext &lhs, const Ciphertext &rhs) const
 
 Ciphertext Engine::multiplyPlainInternal(const Ciphertext &cipher, int64_t scalar, int scalePowerIncrease) const {
   Ciphertext result;
-  result.c0 = mulMod(cipher.c0, scalar, params_.q);
-  result.c1 = mulMod(cipher.c1, scalar, params_.q);
+  std::visit(
+    [&](const auto &m) {
+      result.c0 = m.mul(cipher.c0, scalar);
+      result.c1 = m.mul(cipher.c1, scalar);
+    },
+    modulus_);
   result.scale_power = cipher.scale_power + scalePowerIncrease;
   result.encoding =
     (scalePowerIncrease > 0 || cipher.encoding == Encoding::FixedPoint) ? Encoding::FixedPoint : Encoding::Integer;
@@ -224,8 +373,7 @@ Ciphertext Engine::addPlain(const Ciphertext &cipher, double scalar) const {
   const long double factor = scaleFactor(result.scale_power);
   const int64_t encodedScalar = static_cast<int64_t>(std::llround(static_cast<long double>(scalar) * factor));
   const int64_t plain = mod(encodedScalar, params_.t);
-  const int64_t scaled = mulMod(delta(), plain, params_.q);
-  result.c0 = mod(result.c0 + scaled, params_.q);
+  std::visit([&](const auto &m) { result.c0 = m.reduce(result.c0 + m.mul(delta(), plain)); }, modulus_);
   return result;
 }
 
@@ -255,8 +403,7 @@ Ciphertext Engine::multiplyPlain(const Ciphertext &cipher, double scalar) const
 }
 
 int64_t Engine::decodeRaw(const Ciphertext &cipher) const {
-  const int64_t prod = mulMod(cipher.c1, secretKey_, params_.q);
-  return mod(cipher.c0 + prod, params_.q);
+  return std::visit([&](const auto &m) { return m.reduce(cipher.c0 + m.mul(cipher.c1, secretKey_)); }, modulus_);
 }
 
 int64_t Engine::decryptInt(const Ciphertext &cipher) const {
@@ -279,6 +426,409 @@ double Engine::decryptDouble(const Ciphertext &cipher) const {
   return static_cast<double>(static_cast<long double>(decoded) / factor);
 }
 
+// --- Vector (structure-of-arrays) operations ---
+
+bool Engine::setSimdIsa(simd::Isa isa) {
+  if (!simd::supported(isa)) {
+    return false;
+  }
+  isa_ = isa;
+  return true;
+}
+
+void Engine::requireSameSize(VecView lhs, VecView rhs) {
+  if (lhs.size() != rhs.size()) {
+    throw std::runtime_error("ToyFHE: vector operands differ in slot count");
+  }
+}
+
+VecView Engine::unaliased(VecView cipher, const CiphertextVec &out, std::size_t which) {
+  if (cipher.vec != &out || cipher.rotation == 0) {
+    return cipher;
+  }
+  CiphertextVec &scratch = vecScratch(which);
+  scratch = out; // reuses the scratch's capacity
+  return VecView(scratch, cipher.rotation);
+}
+
+int64_t Engine::scaleLift(int levels) const {
+  int64_t lift = 1;
+  for (int level = 0; level < levels; ++level) {
+    lift = std::visit([&](const auto &m) { return m.mul(lift, params_.scale); }, modulus_);
+  }
+  return lift;
+}
+
+void Engine::materializeVec(VecView cipher, CiphertextVec &out) {
+  const std::size_t d = cipher.rotation;
+  if (cipher.vec == &out) {
+    std::rotate(out.c0.begin(), out.c0.begin() + static_cast<std::ptrdiff_t>(d), out.c0.end());
+    std::rotate(out.c1.begin(), out.c1.begin() + static_cast<std::ptrdiff_t>(d), out.c1.end());
+    return;
+  }
+  out.resize(cipher.size());
+  for (auto part : {&CiphertextVec::c0, &CiphertextVec::c1}) {
+    const std::vector<int64_t> &src = cipher.vec->*part;
+    const auto split = src.begin() + static_cast<std::ptrdiff_t>(d);
+    std::copy(src.begin(), split, std::copy(split, src.end(), (out.*part).begin()));
+  }
+  out.scale_power = cipher.vec->scale_power;
+  out.encoding = cipher.vec->encoding;
+}
+
+CiphertextVec Engine::encryptIntVec(const int64_t *values, std::size_t n) const {
+  CiphertextVec result;
+  encryptIntVec(values, n, result);
+  return result;
+}
+
+void Engine::encryptIntVec(const int64_t *values, std::size_t n, CiphertextVec &out) const {
+  out.resize(n);
+  encryptIntBulk(values, n, out.c0.data(), out.c1.data());
+  out.scale_power = 0;
+  out.encoding = Encoding::Integer;
+}
+
+void Engine::encryptIntBulk(const int64_t *values, std::size_t n, int64_t *c0, int64_t *c1) const {
+  if (!keysGenerated_) {
+    throw std::runtime_error("ToyFHE: keys not generated");
+  }
+  const uint64_t first = bulkCounter_.fetch_add(n, std::memory_order_relaxed);
+  // Slot i's randomness depends only on first + i, so any split is
+  // invisible in the output.
+  auto range = [&](std::size_t begin, std::size_t end) { encryptBulkRange(values, begin, end, first, c0, c1); };
+  forSlotChunks(slotRunner_, n, kEncryptCost, range);
+}
+
+void Engine::encryptBulkRange(const int64_t *values, std::size_t begin, std::size_t end, uint64_t first, int64_t *c0,
+                              int64_t *c1) const {
+  int64_t scaled[kBlock];
+  for (std::size_t base = begin; base < end; base += kBlock) {
+    const std::size_t count = std::min(kBlock, end - base);
+    std::visit(
+      [&](const auto &m) {
+        for (std::size_t i = 0; i < count; ++i) {
+          scaled[i] = m.mul(delta(), mod(values[base + i], params_.t));
+        }
+      },
+      modulus_);
+    encodeBulk(scaled, count, first + base, c0 + base, c1 + base);
+  }
+}
+
+// Philox block i gives 128 bits: the low 64 pick a in [0, q) and the high
+// 64 the noise in [-B, B], each by a multiply-high (bias below range / 2^64,
+// none for power-of-two q).
+void Engine::encodeBulk(const int64_t *scaled, std::size_t count, uint64_t block, int64_t *c0, int64_t *c1) const {
+  uint64_t uniform[kBlock];
+  uint64_t noise[kBlock];
+  bulkRng_.fill(block, count, 0, uniform, noise, isa_);
+  const uint64_t q = static_cast<uint64_t>(params_.q);
+  const uint64_t noiseSpan = 2 * static_cast<uint64_t>(params_.noise_bound) + 1;
+  std::visit(
+    [&](const auto &m) {
+      for (std::size_t i = 0; i < count; ++i) {
+        uint64_t hi = 0;
+        modarith::mulWide(uniform[i], q, hi);
+        const int64_t a = static_cast<int64_t>(hi);
+        modarith::mulWide(noise[i], noiseSpan, hi);
+        const int64_t e = static_cast<int64_t>(hi) - params_.noise_bound;
+        c0[i] = m.reduce(scaled[i] - m.mul(a, secretKey_) + e);
+        c1[i] = a;
+      }
+    },
+    modulus_);
+}
+
+void Engine::seedBulkEncryption(uint64_t seed) {
+  bulkRng_ = Philox4x32(seed);
+  bulkCounter_.store(0, std::memory_order_relaxed);
+}
+
+void Engine::decryptIntVec(VecView cipher, int64_t *out) const {
+  auto range = [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      out[i] = decryptInt(cipher.slot(i));
+    }
+  };
+  forSlotChunks(slotRunner_, cipher.size(), kDecryptCost, range);
+}
+
+void Engine::addVec(VecView lhs, VecView rhs, CiphertextVec &out) const {
+  rotateAddVec(lhs, 0, rhs, out);
+}
+
+void Engine::rotateAddVec(VecView lhs, std::size_t distance, VecView rhs, CiphertextVec &out) const {
+  if (!keysGenerated_) {
+    throw std::runtime_error("ToyFHE: keys not generated");
+  }
+  requireSameSize(lhs, rhs);
+
+  const int targetScale = std::max(lhs.vec->scale_power, rhs.vec->scale_power);
+  const Encoding encoding =
+    (lhs.vec->encoding == Encoding::FixedPoint || rhs.vec->encoding == Encoding::FixedPoint) ? Encoding::FixedPoint
+                                                                                              : Encoding::Integer;
+  const VecView left = unaliased(lhs.rotated(distance), out, 0);
+  const VecView right = unaliased(rhs, out, 1);
+  const int64_t liftLeft = scaleLift(targetScale - left.vec->scale_power);
+  const int64_t liftRight = scaleLift(targetScale - right.vec->scale_power);
+
+  out.resize(lhs.size());
+  auto range = [&](std::size_t begin, std::size_t end) {
+    liftedRuns(isa_, params_.q, left, liftLeft, right, liftRight, out, begin, end,
+               [&](const int64_t *a, const int64_t *b, int64_t *o, std::size_t count) {
+                 simd::addMod(isa_, a, b, o, count, params_.q);
+               });
+  };
+  forSlotChunks(slotRunner_, out.size(), kSimdCost, range);
+  out.scale_power = targetScale;
+  out.encoding = encoding;
+}
+
+void Engine::subVec(VecView lhs, VecView rhs, CiphertextVec &out) const {
+  if (!keysGenerated_) {
+    throw std::runtime_error("ToyFHE: keys not generated");
+  }
+  requireSameSize(lhs, rhs);
+
+  const int targetScale = std::max(lhs.vec->scale_power, rhs.vec->scale_power);
+  const Encoding encoding =
+    (lhs.vec->encoding == Encoding::FixedPoint || rhs.vec->encoding == Encoding::FixedPoint) ? Encoding::FixedPoint
+                                                                                              : Encoding::Integer;
+  const VecView left = unaliased(lhs, out, 0);
+  const VecView right = unaliased(rhs, out, 1);
+  const int64_t liftLeft = scaleLift(targetScale - left.vec->scale_power);
+  const int64_t liftRight = scaleLift(targetScale - right.vec->scale_power);
+
+  out.resize(lhs.size());
+  auto range = [&](std::size_t begin, std::size_t end) {
+    liftedRuns(isa_, params_.q, left, liftLeft, right, liftRight, out, begin, end,
+               [&](const int64_t *a, const int64_t *b, int64_t *o, std::size_t count) {
+                 simd::subMod(isa_, a, b, o, count, params_.q);
+               });
+  };
+  forSlotChunks(slotRunner_, out.size(), kSimdCost, range);
+  out.scale_power = targetScale;
+  out.encoding = encoding;
+}
+
+void Engine::negateVec(VecView cipher, CiphertextVec &out) const {
+  const VecView src = unaliased(cipher, out, 0);
+  const int scalePower = src.vec->scale_power;
+  const Encoding encoding = src.vec->encoding;
+  out.resize(src.size());
+  auto range = [&](std::size_t begin, std::size_t end) {
+    for (auto part : {&CiphertextVec::c0, &CiphertextVec::c1}) {
+      const int64_t *a = (src.vec->*part).data();
+      int64_t *o = (out.*part).data();
+      forEachRun(src, src, begin, end, [&](std::size_t ia, std::size_t, std::size_t io, std::size_t count) {
+        simd::negateMod(isa_, a + ia, o + io, count, params_.q);
+      });
+    }
+  };
+  forSlotChunks(slotRunner_, out.size(), kSimdCost, range);
+  out.scale_power = scalePower;
+  out.encoding = encoding;
+}
+
+void Engine::multiplyVec(VecView lhs, VecView rhs, CiphertextVec &out) const {
+  if (!keysGenerated_) {
+    throw std::runtime_error("ToyFHE: keys not generated");
+  }
+  requireSameSize(lhs, rhs);
+  // Once a rotated alias of out is copied aside, every block of slots is
+  // read before it is written, so out may alias either operand.
+  const VecView left = unaliased(lhs, out, 0);
+  const VecView right = unaliased(rhs, out, 1);
+
+  // multiply() slot by slot, its scale bookkeeping done once for all.
+  const Encoding encoding =
+    (left.vec->encoding == Encoding::FixedPoint || right.vec->encoding == Encoding::FixedPoint) ? Encoding::FixedPoint
+                                                                                                : Encoding::Integer;
+  int scalePower = left.vec->scale_power + right.vec->scale_power;
+  int64_t divisor = delta();
+  while (encoding == Encoding::FixedPoint && scalePower > 1) {
+    divisor *= params_.scale;
+    --scalePower;
+  }
+
+  out.resize(left.size());
+  const uint64_t first = bulkCounter_.fetch_add(out.size(), std::memory_order_relaxed);
+  auto range = [&](std::size_t begin, std::size_t end) {
+    int64_t products[kBlock];
+    for (std::size_t base = begin; base < end; base += kBlock) {
+      const std::size_t count = std::min(kBlock, end - base);
+      for (std::size_t i = 0; i < count; ++i) {
+        const int64_t factor = centeredMod(decodeRaw(right.slot(base + i)), params_.q);
+        products[i] = productRaw(left.slot(base + i), factor, divisor);
+      }
+      encodeBulk(products, count, first + base, out.c0.data() + base, out.c1.data() + base);
+    }
+  };
+  forSlotChunks(slotRunner_, out.size(), kProductCost, range);
+  out.scale_power = scalePower;
+  out.encoding = encoding;
+}
+
+bool Engine::uniformBatch(const VecView *lhs, const VecView *rhs, CiphertextVec *const *out, std::size_t count) {
+  if (count == 0 || lhs[0].empty()) {
+    return false;
+  }
+  const CiphertextVec &left = *lhs[0].vec;
+  const CiphertextVec &right = *rhs[0].vec;
+  for (std::size_t r = 0; r < count; ++r) {
+    const CiphertextVec &a = *lhs[r].vec;
+    const CiphertextVec &b = *rhs[r].vec;
+    if (lhs[r].size() != left.size() || rhs[r].size() != left.size() || a.scale_power != left.scale_power ||
+        a.encoding != left.encoding || b.scale_power != right.scale_power || b.encoding != right.encoding) {
+      return false;
+    }
+    if ((&a == out[r] && lhs[r].rotation != 0) || (&b == out[r] && rhs[r].rotation != 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Engine::addVecBatch(const VecView *lhs, const VecView *rhs, CiphertextVec *const *out, std::size_t count) const {
+  if (!uniformBatch(lhs, rhs, out, count)) {
+    for (std::size_t r = 0; r < count; ++r) {
+      addVec(lhs[r], rhs[r], *out[r]);
+    }
+    return;
+  }
+  if (!keysGenerated_) {
+    throw std::runtime_error("ToyFHE: keys not generated");
+  }
+
+  // rotateAddVec()'s bookkeeping, once for every request.
+  const CiphertextVec &left = *lhs[0].vec;
+  const CiphertextVec &right = *rhs[0].vec;
+  const int targetScale = std::max(left.scale_power, right.scale_power);
+  const Encoding encoding =
+    (left.encoding == Encoding::FixedPoint || right.encoding == Encoding::FixedPoint) ? Encoding::FixedPoint
+                                                                                      : Encoding::Integer;
+  const int64_t liftLeft = scaleLift(targetScale - left.scale_power);
+  const int64_t liftRight = scaleLift(targetScale - right.scale_power);
+  const std::size_t n = lhs[0].size();
+
+  for (std::size_t r = 0; r < count; ++r) {
+    out[r]->resize(n);
+  }
+  auto range = [&](std::size_t begin, std::size_t end) {
+    forEachRequest(n, begin, end, [&](std::size_t r, std::size_t first, std::size_t last) {
+      liftedRuns(isa_, params_.q, lhs[r], liftLeft, rhs[r], liftRight, *out[r], first, last,
+                 [&](const int64_t *a, const int64_t *b, int64_t *o, std::size_t slots) {
+                   simd::addMod(isa_, a, b, o, slots, params_.q);
+                 });
+    });
+  };
+  forSlotChunks(slotRunner_, n * count, kSimdCost, range);
+  for (std::size_t r = 0; r < count; ++r) {
+    out[r]->scale_power = targetScale;
+    out[r]->encoding = encoding;
+  }
+}
+
+void Engine::multiplyVecBatch(const VecView *lhs, const VecView *rhs, CiphertextVec *const *out,
+                              std::size_t count) const {
+  if (!uniformBatch(lhs, rhs, out, count)) {
+    for (std::size_t r = 0; r < count; ++r) {
+      multiplyVec(lhs[r], rhs[r], *out[r]);
+    }
+    return;
+  }
+  if (!keysGenerated_) {
+    throw std::runtime_error("ToyFHE: keys not generated");
+  }
+
+  // multiplyVec()'s bookkeeping, once for every request. Request r takes
+  // the Philox blocks its own call would have reserved: first + r * n on.
+  const CiphertextVec &left = *lhs[0].vec;
+  const CiphertextVec &right = *rhs[0].vec;
+  const Encoding encoding =
+    (left.encoding == Encoding::FixedPoint || right.encoding == Encoding::FixedPoint) ? Encoding::FixedPoint
+                                                                                      : Encoding::Integer;
+  int scalePower = left.scale_power + right.scale_power;
+  int64_t divisor = delta();
+  while (encoding == Encoding::FixedPoint && scalePower > 1) {
+    divisor *= params_.scale;
+    --scalePower;
+  }
+  const std::size_t n = lhs[0].size();
+
+  for (std::size_t r = 0; r < count; ++r) {
+    out[r]->resize(n);
+  }
+  const uint64_t first = bulkCounter_.fetch_add(n * count, std::memory_order_relaxed);
+  auto range = [&](std::size_t begin, std::size_t end) {
+    forEachRequest(n, begin, end, [&](std::size_t r, std::size_t from, std::size_t to) {
+      int64_t products[kBlock];
+      CiphertextVec &o = *out[r];
+      for (std::size_t base = from; base < to; base += kBlock) {
+        const std::size_t slots = std::min(kBlock, to - base);
+        for (std::size_t i = 0; i < slots; ++i) {
+          const int64_t factor = centeredMod(decodeRaw(rhs[r].slot(base + i)), params_.q);
+          products[i] = productRaw(lhs[r].slot(base + i), factor, divisor);
+        }
+        encodeBulk(products, slots, first + r * n + base, o.c0.data() + base, o.c1.data() + base);
+      }
+    });
+  };
+  forSlotChunks(slotRunner_, n * count, kProductCost, range);
+  for (std::size_t r = 0; r < count; ++r) {
+    out[r]->scale_power = scalePower;
+    out[r]->encoding = encoding;
+  }
+}
+
+void Engine::multiplyPlainVec(VecView cipher, double scalar, CiphertextVec &out) const {
+  if (!keysGenerated_) {
+    throw std::runtime_error("ToyFHE: keys not generated");
+  }
+
+  const VecView src = unaliased(cipher, out, 0);
+  const int scalePower = src.vec->scale_power;
+  const Encoding encoding = src.vec->encoding;
+  out.resize(src.size());
+  if (isApproximatelyInteger(scalar)) {
+    const int64_t factor = static_cast<int64_t>(std::llround(scalar));
+    auto range = [&](std::size_t begin, std::size_t end) {
+      for (auto part : {&CiphertextVec::c0, &CiphertextVec::c1}) {
+        const int64_t *a = (src.vec->*part).data();
+        int64_t *o = (out.*part).data();
+        forEachRun(src, src, begin, end, [&](std::size_t ia, std::size_t, std::size_t io, std::size_t count) {
+          simd::mulScalarMod(isa_, a + ia, factor, o + io, count, params_.q);
+        });
+      }
+    };
+    forSlotChunks(slotRunner_, out.size(), kSimdCost, range);
+    out.scale_power = scalePower;
+    out.encoding = encoding;
+    return;
+  }
+
+  // multiplyPlain()'s fractional path slot by slot: fixed-point inputs keep
+  // their scale level, integer inputs move to fixed-point at one level.
+  const long double scaledScalar = static_cast<long double>(scalar) * scaleFactor(1);
+  const int64_t encoded = static_cast<int64_t>(std::llround(scaledScalar));
+  const int64_t divisor = scalePower >= 1 ? params_.scale : 1;
+  const uint64_t first = bulkCounter_.fetch_add(out.size(), std::memory_order_relaxed);
+  auto range = [&](std::size_t begin, std::size_t end) {
+    int64_t products[kBlock];
+    for (std::size_t base = begin; base < end; base += kBlock) {
+      const std::size_t count = std::min(kBlock, end - base);
+      for (std::size_t i = 0; i < count; ++i) {
+        products[i] = productRaw(src.slot(base + i), encoded, divisor);
+      }
+      encodeBulk(products, count, first + base, out.c0.data() + base, out.c1.data() + base);
+    }
+  };
+  forSlotChunks(slotRunner_, out.size(), kProductCost, range);
+  out.scale_power = scalePower >= 1 ? scalePower : scalePower + 1;
+  out.encoding = Encoding::FixedPoint;
+}
+
 int64_t Engine::sampleUniform() const {
   std::uniform_int_distribution<int64_t> dist(0, params_.q - 1);
   return dist(rng_);
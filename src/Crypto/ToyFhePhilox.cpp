@@ -0,0 +1,174 @@
+#include "Crypto/ToyFhePhilox.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TOYFHE_PHILOX_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TOYFHE_PHILOX_INLINE inline __attribute__((always_inline))
+#else
+#define TOYFHE_PHILOX_INLINE inline
+#endif
+
+namespace fhenomenon::toyfhe {
+
+namespace {
+
+constexpr uint32_t kM0 = 0xD2511F53u;
+constexpr uint32_t kM1 = 0xCD9E8D57u;
+constexpr uint32_t kW0 = 0x9E3779B9u; // golden ratio
+constexpr uint32_t kW1 = 0xBB67AE85u; // sqrt(3) - 1
+constexpr std::size_t kLanes = 16;
+
+// Ten rounds on L counters at once, one array per counter word, so the
+// scalar path keeps L independent multiply chains in flight. Also the tail
+// of every vector loop.
+template <std::size_t L>
+TOYFHE_PHILOX_INLINE void philoxLanes(uint64_t first, uint64_t stream, uint64_t key, uint64_t *lo, uint64_t *hi) {
+  uint32_t x0[L];
+  uint32_t x1[L];
+  uint32_t x2[L];
+  uint32_t x3[L];
+  for (std::size_t l = 0; l < L; ++l) {
+    const uint64_t index = first + l;
+    x0[l] = static_cast<uint32_t>(index);
+    x1[l] = static_cast<uint32_t>(index >> 32);
+    x2[l] = static_cast<uint32_t>(stream);
+    x3[l] = static_cast<uint32_t>(stream >> 32);
+  }
+  uint32_t k0 = static_cast<uint32_t>(key);
+  uint32_t k1 = static_cast<uint32_t>(key >> 32);
+  for (int round = 0; round < 10; ++round) {
+    for (std::size_t l = 0; l < L; ++l) {
+      const uint64_t p0 = static_cast<uint64_t>(kM0) * x0[l];
+      const uint64_t p1 = static_cast<uint64_t>(kM1) * x2[l];
+      const uint32_t y0 = static_cast<uint32_t>(p1 >> 32) ^ x1[l] ^ k0;
+      const uint32_t y2 = static_cast<uint32_t>(p0 >> 32) ^ x3[l] ^ k1;
+      x1[l] = static_cast<uint32_t>(p1);
+      x3[l] = static_cast<uint32_t>(p0);
+      x0[l] = y0;
+      x2[l] = y2;
+    }
+    k0 += kW0;
+    k1 += kW1;
+  }
+  for (std::size_t l = 0; l < L; ++l) {
+    lo[l] = x0[l] | (static_cast<uint64_t>(x1[l]) << 32);
+    hi[l] = x2[l] | (static_cast<uint64_t>(x3[l]) << 32);
+  }
+}
+
+void fillScalar(uint64_t first, std::size_t count, uint64_t stream, uint64_t key, uint64_t *lo, uint64_t *hi) {
+  std::size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes)
+    philoxLanes<kLanes>(first + i, stream, key, lo + i, hi + i);
+  for (; i < count; ++i)
+    philoxLanes<1>(first + i, stream, key, lo + i, hi + i);
+}
+
+#if defined(TOYFHE_PHILOX_X86)
+
+// --- Vector paths: one block per 64-bit lane, each counter word in the low
+// half of its lane. mul_epu32 reads only that half and yields the full
+// 32x32 -> 64-bit product, so the upper halves may carry garbage between
+// rounds and are masked off once at the end.
+
+__attribute__((target("avx2"))) void fillAvx2(uint64_t first, std::size_t count, uint64_t stream, uint64_t key,
+                                               uint64_t *lo, uint64_t *hi) {
+  const __m256i m0 = _mm256_set1_epi64x(kM0);
+  const __m256i m1 = _mm256_set1_epi64x(kM1);
+  const __m256i low = _mm256_set1_epi64x(0xFFFFFFFFll);
+  const __m256i step = _mm256_setr_epi64x(0, 1, 2, 3);
+  const __m256i s0 = _mm256_set1_epi64x(static_cast<int64_t>(stream & 0xFFFFFFFFu));
+  const __m256i s1 = _mm256_set1_epi64x(static_cast<int64_t>(stream >> 32));
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i x0 = _mm256_add_epi64(_mm256_set1_epi64x(static_cast<int64_t>(first + i)), step);
+    __m256i x1 = _mm256_srli_epi64(x0, 32);
+    __m256i x2 = s0;
+    __m256i x3 = s1;
+    uint32_t k0 = static_cast<uint32_t>(key);
+    uint32_t k1 = static_cast<uint32_t>(key >> 32);
+    for (int round = 0; round < 10; ++round) {
+      const __m256i p0 = _mm256_mul_epu32(x0, m0);
+      const __m256i p1 = _mm256_mul_epu32(x2, m1);
+      x0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), x1), _mm256_set1_epi64x(k0));
+      x2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), x3), _mm256_set1_epi64x(k1));
+      x1 = p1;
+      x3 = p0;
+      k0 += kW0;
+      k1 += kW1;
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lo + i),
+                        _mm256_or_si256(_mm256_and_si256(x0, low), _mm256_slli_epi64(x1, 32)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(hi + i),
+                        _mm256_or_si256(_mm256_and_si256(x2, low), _mm256_slli_epi64(x3, 32)));
+  }
+  for (; i < count; ++i)
+    philoxLanes<1>(first + i, stream, key, lo + i, hi + i);
+}
+
+__attribute__((target("avx512f"))) void fillAvx512(uint64_t first, std::size_t count, uint64_t stream, uint64_t key,
+                                                    uint64_t *lo, uint64_t *hi) {
+  // Full-mask maskz_ forms: the unmasked shift and multiply intrinsics read an
+  // undefined passthrough register that GCC 12 flags as maybe-uninitialized.
+  const __mmask8 all = 0xFF;
+  const __m512i m0 = _mm512_set1_epi64(kM0);
+  const __m512i m1 = _mm512_set1_epi64(kM1);
+  const __m512i low = _mm512_set1_epi64(0xFFFFFFFFll);
+  const __m512i step = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m512i s0 = _mm512_set1_epi64(static_cast<int64_t>(stream & 0xFFFFFFFFu));
+  const __m512i s1 = _mm512_set1_epi64(static_cast<int64_t>(stream >> 32));
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m512i x0 = _mm512_add_epi64(_mm512_set1_epi64(static_cast<int64_t>(first + i)), step);
+    __m512i x1 = _mm512_maskz_srli_epi64(all, x0, 32);
+    __m512i x2 = s0;
+    __m512i x3 = s1;
+    uint32_t k0 = static_cast<uint32_t>(key);
+    uint32_t k1 = static_cast<uint32_t>(key >> 32);
+    for (int round = 0; round < 10; ++round) {
+      const __m512i p0 = _mm512_maskz_mul_epu32(all, x0, m0);
+      const __m512i p1 = _mm512_maskz_mul_epu32(all, x2, m1);
+      x0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_maskz_srli_epi64(all, p1, 32), x1), _mm512_set1_epi64(k0));
+      x2 = _mm512_xor_si512(_mm512_xor_si512(_mm512_maskz_srli_epi64(all, p0, 32), x3), _mm512_set1_epi64(k1));
+      x1 = p1;
+      x3 = p0;
+      k0 += kW0;
+      k1 += kW1;
+    }
+    _mm512_storeu_si512(lo + i, _mm512_or_si512(_mm512_and_si512(x0, low), _mm512_maskz_slli_epi64(all, x1, 32)));
+    _mm512_storeu_si512(hi + i, _mm512_or_si512(_mm512_and_si512(x2, low), _mm512_maskz_slli_epi64(all, x3, 32)));
+  }
+  for (; i < count; ++i)
+    philoxLanes<1>(first + i, stream, key, lo + i, hi + i);
+}
+
+#endif // TOYFHE_PHILOX_X86
+
+} // namespace
+
+std::array<uint32_t, 4> Philox4x32::block(uint64_t index, uint64_t stream) const {
+  uint64_t lo = 0;
+  uint64_t hi = 0;
+  philoxLanes<1>(index, stream, key_, &lo, &hi);
+  return {static_cast<uint32_t>(lo), static_cast<uint32_t>(lo >> 32), static_cast<uint32_t>(hi),
+          static_cast<uint32_t>(hi >> 32)};
+}
+
+void Philox4x32::fill(uint64_t first, std::size_t count, uint64_t stream, uint64_t *lo, uint64_t *hi,
+                      simd::Isa isa) const {
+  switch (simd::supported(isa) ? isa : simd::Isa::Scalar) {
+#if defined(TOYFHE_PHILOX_X86)
+  case simd::Isa::Avx512:
+    return fillAvx512(first, count, stream, key_, lo, hi);
+  case simd::Isa::Avx2:
+    return fillAvx2(first, count, stream, key_, lo, hi);
+#endif
+  default:
+    return fillScalar(first, count, stream, key_, lo, hi);
+  }
+}
+
+} // namespace fhenomenon::toyfhe
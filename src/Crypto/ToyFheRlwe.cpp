@@ -0,0 +1,556 @@
+#include "Crypto/ToyFheRlwe.h"
+#include "Utils/log.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace fhenomenon::toyfhe {
+
+namespace {
+
+std::size_t bitReverse(std::size_t x, unsigned bits) {
+  std::size_t r = 0;
+  for (unsigned i = 0; i < bits; ++i) {
+    r = (r << 1) | (x & 1);
+    x >>= 1;
+  }
+  return r;
+}
+
+unsigned bitLength(uint64_t x) {
+  unsigned bits = 0;
+  while (bits < 64 && (x >> bits) != 0) {
+    ++bits;
+  }
+  return bits;
+}
+
+uint64_t mulMod(const BarrettModulus &m, uint64_t a, uint64_t b) {
+  return static_cast<uint64_t>(m.mul(static_cast<int64_t>(a), static_cast<int64_t>(b)));
+}
+
+uint64_t powMod(const BarrettModulus &m, uint64_t base, uint64_t exponent) {
+  uint64_t result = 1;
+  while (exponent != 0) {
+    if (exponent & 1) {
+      result = mulMod(m, result, base);
+    }
+    base = mulMod(m, base, base);
+    exponent >>= 1;
+  }
+  return result;
+}
+
+// floor(w * 2^64 / q) for w < q, by long division.
+uint64_t shoupFactor(uint64_t w, uint64_t q) {
+  uint64_t rem = w;
+  uint64_t quotient = 0;
+  for (int i = 0; i < 64; ++i) {
+    rem <<= 1;
+    quotient <<= 1;
+    if (rem >= q) {
+      rem -= q;
+      quotient |= 1;
+    }
+  }
+  return quotient;
+}
+
+// a * w mod q for a constant w with Shoup factor wShoup: one high and two
+// low multiplies, no division.
+uint64_t mulShoup(uint64_t a, uint64_t w, uint64_t wShoup, uint64_t q) {
+  uint64_t hi = 0;
+  modarith::mulWide(a, wShoup, hi);
+  return modarith::subtractIfAtLeast(a * w - hi * q, q);
+}
+
+uint64_t addMod(uint64_t a, uint64_t b, uint64_t q) { return modarith::subtractIfAtLeast(a + b, q); }
+
+uint64_t subMod(uint64_t a, uint64_t b, uint64_t q) { return a >= b ? a - b : a + q - b; }
+
+// Residue of a small signed value.
+uint64_t lift(int64_t value, uint64_t q) {
+  return value < 0 ? q - static_cast<uint64_t>(-value) : static_cast<uint64_t>(value);
+}
+
+int64_t center(uint64_t value, uint64_t q) {
+  return value > q / 2 ? -static_cast<int64_t>(q - value) : static_cast<int64_t>(value);
+}
+
+} // namespace
+
+// --- NTT ---
+
+RlweNtt::RlweNtt(std::size_t n, int64_t q) : n_(n), q_(static_cast<uint64_t>(q)) {
+  if (n < 2 || (n & (n - 1)) != 0) {
+    throw std::runtime_error("ToyFHE packed: NTT length must be a power of two");
+  }
+  if (q < 3 || (q_ - 1) % (2 * n) != 0) {
+    throw std::runtime_error("ToyFHE packed: modulus must be 1 mod 2N");
+  }
+  while ((std::size_t{1} << log_n_) < n) {
+    ++log_n_;
+  }
+
+  // psi = x^((q - 1) / 2n) has order dividing 2n; psi^n = -1 pins it to
+  // exactly 2n.
+  const BarrettModulus m(q);
+  uint64_t psi = 0;
+  for (uint64_t x = 2; x < 1000 && psi == 0; ++x) {
+    const uint64_t candidate = powMod(m, x, (q_ - 1) / (2 * n));
+    if (powMod(m, candidate, n) == q_ - 1) {
+      psi = candidate;
+    }
+  }
+  if (psi == 0) {
+    throw std::runtime_error("ToyFHE packed: no primitive 2N-th root of unity mod q");
+  }
+  const uint64_t psiInv = powMod(m, psi, q_ - 2);
+
+  psi_rev_.resize(n);
+  psi_inv_rev_.resize(n);
+  uint64_t power = 1;
+  uint64_t powerInv = 1;
+  for (std::size_t i = 0; i < n; ++i) {
+    psi_rev_[bitReverse(i, log_n_)] = power;
+    psi_inv_rev_[bitReverse(i, log_n_)] = powerInv;
+    power = mulMod(m, power, psi);
+    powerInv = mulMod(m, powerInv, psiInv);
+  }
+  psi_rev_shoup_.resize(n);
+  psi_inv_rev_shoup_.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    psi_rev_shoup_[i] = shoupFactor(psi_rev_[i], q_);
+    psi_inv_rev_shoup_[i] = shoupFactor(psi_inv_rev_[i], q_);
+  }
+  n_inv_ = powMod(m, n, q_ - 2);
+  n_inv_shoup_ = shoupFactor(n_inv_, q_);
+}
+
+std::size_t RlweNtt::exponent(std::size_t i) const { return 2 * bitReverse(i, log_n_) + 1; }
+
+// Cooley-Tukey butterflies with the psi powers folded in (Longa-Naehrig,
+// Algorithm 1): natural-order coefficients to bit-reversed evaluations.
+void RlweNtt::forward(uint64_t *a) const {
+  std::size_t t = n_;
+  for (std::size_t m = 1; m < n_; m <<= 1) {
+    t >>= 1;
+    for (std::size_t i = 0; i < m; ++i) {
+      const uint64_t w = psi_rev_[m + i];
+      const uint64_t wShoup = psi_rev_shoup_[m + i];
+      uint64_t *x = a + 2 * i * t;
+      uint64_t *y = x + t;
+      for (std::size_t j = 0; j < t; ++j) {
+        const uint64_t u = x[j];
+        const uint64_t v = mulShoup(y[j], w, wShoup, q_);
+        x[j] = addMod(u, v, q_);
+        y[j] = subMod(u, v, q_);
+      }
+    }
+  }
+}
+
+// Gentleman-Sande butterflies (Algorithm 2), then the 1/n scaling.
+void RlweNtt::inverse(uint64_t *a) const {
+  std::size_t t = 1;
+  for (std::size_t m = n_; m > 1; m >>= 1) {
+    const std::size_t h = m >> 1;
+    for (std::size_t i = 0; i < h; ++i) {
+      const uint64_t w = psi_inv_rev_[h + i];
+      const uint64_t wShoup = psi_inv_rev_shoup_[h + i];
+      uint64_t *x = a + 2 * i * t;
+      uint64_t *y = x + t;
+      for (std::size_t j = 0; j < t; ++j) {
+        const uint64_t u = x[j];
+        const uint64_t v = y[j];
+        x[j] = addMod(u, v, q_);
+        y[j] = mulShoup(subMod(u, v, q_), w, wShoup, q_);
+      }
+    }
+    t <<= 1;
+  }
+  for (std::size_t j = 0; j < n_; ++j) {
+    a[j] = mulShoup(a[j], n_inv_, n_inv_shoup_, q_);
+  }
+}
+
+// --- Engine ---
+
+RlweEngine::RlweEngine() : initialized_(false), keysGenerated_(false), rng_(std::random_device{}()) {}
+
+void RlweEngine::initialize(const RlweParameters &params) {
+  const std::size_t n = params.ring_dim;
+  if (n < 16 || n > 32768 || (n & (n - 1)) != 0) {
+    throw std::runtime_error("ToyFHE packed: ring_dim must be a power of two in [16, 32768]");
+  }
+  if (params.t < 3 || params.q <= params.t || params.q > (static_cast<int64_t>(1) << 62)) {
+    throw std::runtime_error("ToyFHE packed: need 3 <= t < q <= 2^62");
+  }
+  if (params.digit_bits < 1 || params.digit_bits > 30 || params.noise_bound < 0) {
+    throw std::runtime_error("ToyFHE packed: digit_bits must be in [1, 30] and noise_bound non-negative");
+  }
+  // Both moduli need primitive 2N-th roots: q for the ciphertext NTT, t for
+  // slot batching.
+  nttQ_ = RlweNtt(n, params.q);
+  nttT_ = RlweNtt(n, params.t);
+  modQ_ = BarrettModulus(params.q);
+  modT_ = BarrettModulus(params.t);
+  const unsigned qBits = bitLength(static_cast<uint64_t>(params.q));
+  const unsigned digitBits = static_cast<unsigned>(params.digit_bits);
+  digits_ = (qBits + digitBits - 1) / digitBits;
+
+  // Slot j of row 0 evaluates at psi^(5^j), of row 1 at psi^(-5^j): the
+  // automorphism X -> X^5 then shifts both rows left by one.
+  const std::size_t twoN = 2 * n;
+  std::vector<uint32_t> indexOfExponent(twoN, 0);
+  for (std::size_t i = 0; i < n; ++i) {
+    indexOfExponent[nttT_.exponent(i)] = static_cast<uint32_t>(i);
+  }
+  slotIndex_.resize(n);
+  std::size_t e = 1;
+  for (std::size_t j = 0; j < n / 2; ++j) {
+    slotIndex_[j] = indexOfExponent[e];
+    slotIndex_[n / 2 + j] = indexOfExponent[twoN - e];
+    e = (e * 5) % twoN;
+  }
+
+  params_ = params;
+  keysGenerated_ = false;
+  initialized_ = true;
+}
+
+void RlweEngine::generateKeys() {
+  if (!initialized_) {
+    throw std::runtime_error("ToyFHE packed: call initialize() before generateKeys()");
+  }
+  uint64_t seed = 0;
+  {
+    std::lock_guard<std::mutex> lock(rngMutex_);
+    seed = rng_();
+  }
+  std::mt19937_64 keyRng(seed);
+  generateKeysFrom(keyRng);
+}
+
+void RlweEngine::generateKeys(uint64_t seed) {
+  if (!initialized_) {
+    throw std::runtime_error("ToyFHE packed: call initialize() before generateKeys()");
+  }
+  std::mt19937_64 keyRng(seed);
+  generateKeysFrom(keyRng);
+}
+
+void RlweEngine::generateKeysFrom(std::mt19937_64 &keyRng) {
+  const std::size_t n = params_.ring_dim;
+  const uint64_t q = nttQ_.modulus();
+
+  // Ternary secret.
+  std::uniform_int_distribution<int64_t> ternary(-1, 1);
+  secretNtt_.assign(n, 0);
+  for (uint64_t &coeff : secretNtt_) {
+    coeff = lift(ternary(keyRng), q);
+  }
+  nttQ_.forward(secretNtt_.data());
+
+  std::vector<uint64_t> secretSquared(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    secretSquared[i] = mulQ(secretNtt_[i], secretNtt_[i]);
+  }
+  relinKey_ = makeSwitchKey(secretSquared, keyRng);
+
+  std::vector<uint32_t> indexOfExponent(2 * n, 0);
+  for (std::size_t i = 0; i < n; ++i) {
+    indexOfExponent[nttQ_.exponent(i)] = static_cast<uint32_t>(i);
+  }
+  galoisKeys_.clear();
+  std::size_t galois = 5;
+  for (std::size_t step = 1; step < n / 2; step <<= 1) {
+    GaloisKey key;
+    key.permutation.resize(n);
+    std::vector<uint64_t> rotatedSecret(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      key.permutation[i] = indexOfExponent[(galois * nttQ_.exponent(i)) % (2 * n)];
+      rotatedSecret[i] = secretNtt_[key.permutation[i]];
+    }
+    key.key = makeSwitchKey(rotatedSecret, keyRng);
+    galoisKeys_.push_back(std::move(key));
+    galois = (galois * galois) % (2 * n);
+  }
+
+  keysGenerated_ = true;
+  LOG_MESSAGE("ToyFHE packed: generated keys for N = " << n << " (" << galoisKeys_.size() << " rotation keys)");
+}
+
+RlweEngine::SwitchKey RlweEngine::makeSwitchKey(const std::vector<uint64_t> &fromNtt,
+                                                std::mt19937_64 &keyRng) const {
+  const std::size_t n = params_.ring_dim;
+  const uint64_t tq = static_cast<uint64_t>(params_.t);
+  SwitchKey key;
+  key.k0.resize(digits_);
+  key.k1.resize(digits_);
+  uint64_t gadget = 1;
+  const uint64_t base = mulMod(modQ_, static_cast<uint64_t>(1) << params_.digit_bits, 1);
+  std::vector<uint64_t> error(n);
+  for (std::size_t d = 0; d < digits_; ++d) {
+    std::vector<uint64_t> &k0 = key.k0[d];
+    std::vector<uint64_t> &k1 = key.k1[d];
+    k1.resize(n);
+    sampleUniformNtt(k1, keyRng);
+    sampleError(error, keyRng);
+    nttQ_.forward(error.data());
+    k0.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      const uint64_t noise = mulQ(tq, error[i]);
+      k0[i] = addQ(subQ(noise, mulQ(k1[i], secretNtt_[i])), mulQ(gadget, fromNtt[i]));
+    }
+    gadget = mulQ(gadget, base);
+  }
+  return key;
+}
+
+void RlweEngine::keySwitch(const std::vector<uint64_t> &dNtt, const SwitchKey &key, std::vector<uint64_t> &acc0,
+                           std::vector<uint64_t> &acc1) const {
+  const std::size_t n = params_.ring_dim;
+  const unsigned digitBits = static_cast<unsigned>(params_.digit_bits);
+  const uint64_t mask = (static_cast<uint64_t>(1) << digitBits) - 1;
+  std::vector<uint64_t> coeffs(dNtt);
+  nttQ_.inverse(coeffs.data());
+  std::vector<uint64_t> digit(n);
+  for (std::size_t d = 0; d < digits_; ++d) {
+    const unsigned shift = static_cast<unsigned>(d) * digitBits;
+    for (std::size_t i = 0; i < n; ++i) {
+      digit[i] = (coeffs[i] >> shift) & mask;
+    }
+    nttQ_.forward(digit.data());
+    const std::vector<uint64_t> &k0 = key.k0[d];
+    const std::vector<uint64_t> &k1 = key.k1[d];
+    for (std::size_t i = 0; i < n; ++i) {
+      acc0[i] = addQ(acc0[i], mulQ(digit[i], k0[i]));
+      acc1[i] = addQ(acc1[i], mulQ(digit[i], k1[i]));
+    }
+  }
+}
+
+void RlweEngine::sampleError(std::vector<uint64_t> &coeffs, std::mt19937_64 &rng) const {
+  std::uniform_int_distribution<int64_t> dist(-params_.noise_bound, params_.noise_bound);
+  for (uint64_t &coeff : coeffs) {
+    coeff = lift(dist(rng), nttQ_.modulus());
+  }
+}
+
+// A uniform polynomial is uniform in either domain, so it is drawn directly
+// in NTT form.
+void RlweEngine::sampleUniformNtt(std::vector<uint64_t> &evals, std::mt19937_64 &rng) const {
+  std::uniform_int_distribution<uint64_t> dist(0, nttQ_.modulus() - 1);
+  for (uint64_t &value : evals) {
+    value = dist(rng);
+  }
+}
+
+void RlweEngine::requireKeys() const {
+  if (!keysGenerated_) {
+    throw std::runtime_error("ToyFHE packed: keys not generated");
+  }
+}
+
+void RlweEngine::requireSameSlots(const RlweCiphertext &lhs, const RlweCiphertext &rhs) {
+  if (lhs.slots != rhs.slots || lhs.c0.size() != rhs.c0.size()) {
+    throw std::runtime_error("ToyFHE packed: operands differ in slot count");
+  }
+}
+
+uint64_t RlweEngine::mulQ(uint64_t a, uint64_t b) const { return mulMod(modQ_, a, b); }
+
+uint64_t RlweEngine::addQ(uint64_t a, uint64_t b) const { return addMod(a, b, nttQ_.modulus()); }
+
+uint64_t RlweEngine::subQ(uint64_t a, uint64_t b) const { return subMod(a, b, nttQ_.modulus()); }
+
+RlweCiphertext RlweEngine::encrypt(const int64_t *values, std::size_t n) const {
+  requireKeys();
+  const std::size_t ringDim = params_.ring_dim;
+  if (n == 0 || rowSlots() % n != 0) {
+    throw std::runtime_error("ToyFHE packed: vector length must divide N / 2");
+  }
+  const uint64_t q = nttQ_.modulus();
+  const uint64_t t = nttT_.modulus();
+
+  // Batch-encode: every row repeats the vector, so slot s holds values[s mod n].
+  std::vector<uint64_t> plain(ringDim);
+  for (std::size_t s = 0; s < ringDim; ++s) {
+    plain[slotIndex_[s]] = static_cast<uint64_t>(modT_.reduce(values[s % n]));
+  }
+  nttT_.inverse(plain.data());
+
+  RlweCiphertext cipher;
+  cipher.slots = n;
+  cipher.c0.resize(ringDim);
+  cipher.c1.resize(ringDim);
+  std::vector<uint64_t> error(ringDim);
+  {
+    std::lock_guard<std::mutex> lock(rngMutex_);
+    sampleError(error, rng_);
+    sampleUniformNtt(cipher.c1, rng_);
+  }
+  // m + t * e, centered so the plaintext's own size stays below t / 2.
+  const uint64_t tq = t % q;
+  for (std::size_t i = 0; i < ringDim; ++i) {
+    error[i] = addQ(lift(center(plain[i], t), q), mulQ(tq, error[i]));
+  }
+  nttQ_.forward(error.data());
+  for (std::size_t i = 0; i < ringDim; ++i) {
+    cipher.c0[i] = subQ(error[i], mulQ(cipher.c1[i], secretNtt_[i]));
+  }
+  return cipher;
+}
+
+std::vector<int64_t> RlweEngine::decryptCoefficients(const RlweCiphertext &cipher) const {
+  requireKeys();
+  const std::size_t ringDim = params_.ring_dim;
+  if (cipher.c0.size() != ringDim || cipher.c1.size() != ringDim) {
+    throw std::runtime_error("ToyFHE packed: ciphertext ring dimension mismatch");
+  }
+  std::vector<uint64_t> phase(ringDim);
+  for (std::size_t i = 0; i < ringDim; ++i) {
+    phase[i] = addQ(cipher.c0[i], mulQ(cipher.c1[i], secretNtt_[i]));
+  }
+  nttQ_.inverse(phase.data());
+  std::vector<int64_t> coeffs(ringDim);
+  for (std::size_t i = 0; i < ringDim; ++i) {
+    coeffs[i] = center(phase[i], nttQ_.modulus());
+  }
+  return coeffs;
+}
+
+void RlweEngine::decrypt(const RlweCiphertext &cipher, int64_t *out) const {
+  const std::vector<int64_t> coeffs = decryptCoefficients(cipher);
+  const uint64_t t = nttT_.modulus();
+  std::vector<uint64_t> plain(coeffs.size());
+  for (std::size_t i = 0; i < coeffs.size(); ++i) {
+    plain[i] = static_cast<uint64_t>(modT_.reduce(coeffs[i]));
+  }
+  nttT_.forward(plain.data());
+  for (std::size_t j = 0; j < cipher.slots; ++j) {
+    out[j] = center(plain[slotIndex_[j]], t);
+  }
+}
+
+int RlweEngine::noiseBudgetBits(const RlweCiphertext &cipher) const {
+  uint64_t largest = 0;
+  for (int64_t coeff : decryptCoefficients(cipher)) {
+    largest = std::max(largest, static_cast<uint64_t>(coeff < 0 ? -coeff : coeff));
+  }
+  return static_cast<int>(bitLength(nttQ_.modulus() / 2)) - static_cast<int>(bitLength(largest));
+}
+
+void RlweEngine::add(const RlweCiphertext &lhs, const RlweCiphertext &rhs, RlweCiphertext &out) const {
+  requireSameSlots(lhs, rhs);
+  const std::size_t n = lhs.c0.size();
+  out.c0.resize(n);
+  out.c1.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    out.c0[i] = addQ(lhs.c0[i], rhs.c0[i]);
+    out.c1[i] = addQ(lhs.c1[i], rhs.c1[i]);
+  }
+  out.slots = lhs.slots;
+}
+
+void RlweEngine::sub(const RlweCiphertext &lhs, const RlweCiphertext &rhs, RlweCiphertext &out) const {
+  requireSameSlots(lhs, rhs);
+  const std::size_t n = lhs.c0.size();
+  out.c0.resize(n);
+  out.c1.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    out.c0[i] = subQ(lhs.c0[i], rhs.c0[i]);
+    out.c1[i] = subQ(lhs.c1[i], rhs.c1[i]);
+  }
+  out.slots = lhs.slots;
+}
+
+void RlweEngine::negate(const RlweCiphertext &cipher, RlweCiphertext &out) const {
+  const std::size_t n = cipher.c0.size();
+  out.c0.resize(n);
+  out.c1.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    out.c0[i] = subQ(0, cipher.c0[i]);
+    out.c1[i] = subQ(0, cipher.c1[i]);
+  }
+  out.slots = cipher.slots;
+}
+
+// A constant plaintext polynomial evaluates to itself in every slot and at
+// every NTT point, so adding it touches c0's evaluations directly.
+void RlweEngine::addPlain(const RlweCiphertext &cipher, int64_t scalar, RlweCiphertext &out) const {
+  const uint64_t t = nttT_.modulus();
+  const uint64_t constant = lift(center(static_cast<uint64_t>(modT_.reduce(scalar)), t), nttQ_.modulus());
+  if (&out != &cipher) {
+    out = cipher;
+  }
+  for (uint64_t &value : out.c0) {
+    value = addQ(value, constant);
+  }
+}
+
+// Noise grows by |scalar mod t|, centered.
+void RlweEngine::multiplyPlain(const RlweCiphertext &cipher, int64_t scalar, RlweCiphertext &out) const {
+  const uint64_t t = nttT_.modulus();
+  const uint64_t factor = lift(center(static_cast<uint64_t>(modT_.reduce(scalar)), t), nttQ_.modulus());
+  const std::size_t n = cipher.c0.size();
+  out.c0.resize(n);
+  out.c1.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    out.c0[i] = mulQ(cipher.c0[i], factor);
+    out.c1[i] = mulQ(cipher.c1[i], factor);
+  }
+  out.slots = cipher.slots;
+}
+
+void RlweEngine::multiply(const RlweCiphertext &lhs, const RlweCiphertext &rhs, RlweCiphertext &out) const {
+  requireKeys();
+  requireSameSlots(lhs, rhs);
+  const std::size_t n = lhs.c0.size();
+  // (a0 + a1 s)(b0 + b1 s) = d0 + d1 s + d2 s^2, pointwise in NTT form.
+  std::vector<uint64_t> d0(n);
+  std::vector<uint64_t> d1(n);
+  std::vector<uint64_t> d2(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    d0[i] = mulQ(lhs.c0[i], rhs.c0[i]);
+    d1[i] = addQ(mulQ(lhs.c0[i], rhs.c1[i]), mulQ(lhs.c1[i], rhs.c0[i]));
+    d2[i] = mulQ(lhs.c1[i], rhs.c1[i]);
+  }
+  keySwitch(d2, relinKey_, d0, d1);
+  out.slots = lhs.slots;
+  out.c0 = std::move(d0);
+  out.c1 = std::move(d1);
+}
+
+void RlweEngine::rotate(const RlweCiphertext &cipher, std::size_t distance, RlweCiphertext &out) const {
+  requireKeys();
+  if (cipher.slots == 0) {
+    throw std::runtime_error("ToyFHE packed: cannot rotate an empty ciphertext");
+  }
+  std::size_t d = distance % cipher.slots;
+  if (&out != &cipher) {
+    out = cipher;
+  }
+  const std::size_t n = out.c0.size();
+  std::vector<uint64_t> c0(n);
+  std::vector<uint64_t> c1(n);
+  for (std::size_t k = 0; d != 0; ++k, d >>= 1) {
+    if ((d & 1) == 0) {
+      continue;
+    }
+    // The automorphism permutes evaluations; the result decrypts under the
+    // rotated secret until its c1 is switched back to s.
+    const GaloisKey &galois = galoisKeys_[k];
+    for (std::size_t i = 0; i < n; ++i) {
+      c0[i] = out.c0[galois.permutation[i]];
+      c1[i] = out.c1[galois.permutation[i]];
+    }
+    std::fill(out.c1.begin(), out.c1.end(), 0);
+    out.c0.swap(c0);
+    keySwitch(c1, galois.key, out.c0, out.c1);
+  }
+}
+
+} // namespace fhenomenon::toyfhe
@@ -0,0 +1,253 @@
+#include "Crypto/ToyFheSimd.h"
+#include "Crypto/ToyFheModArith.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TOYFHE_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace fhenomenon::toyfhe::simd {
+
+namespace {
+
+using modarith::isPowerOfTwo;
+
+int64_t reduce(int64_t value, int64_t q) {
+  const int64_t r = value % q;
+  return r < 0 ? r + q : r;
+}
+
+// --- Scalar reference; also the tail of every vector loop ---
+
+void addScalar(const int64_t *a, const int64_t *b, int64_t *out, std::size_t n, int64_t q) {
+  for (std::size_t i = 0; i < n; ++i) {
+    const int64_t s = a[i] + b[i];
+    out[i] = s >= q ? s - q : s;
+  }
+}
+
+void subScalar(const int64_t *a, const int64_t *b, int64_t *out, std::size_t n, int64_t q) {
+  for (std::size_t i = 0; i < n; ++i) {
+    const int64_t d = a[i] - b[i];
+    out[i] = d < 0 ? d + q : d;
+  }
+}
+
+void negateScalar(const int64_t *a, int64_t *out, std::size_t n, int64_t q) {
+  for (std::size_t i = 0; i < n; ++i)
+    out[i] = a[i] == 0 ? 0 : q - a[i];
+}
+
+// s is already reduced into [0, q).
+void mulScalarScalar(const int64_t *a, int64_t s, int64_t *out, std::size_t n, int64_t q) {
+  if (isPowerOfTwo(q)) {
+    const PowerOfTwoModulus modulus(q);
+    for (std::size_t i = 0; i < n; ++i)
+      out[i] = modulus.mul(a[i], s);
+    return;
+  }
+  const BarrettModulus modulus(q);
+  for (std::size_t i = 0; i < n; ++i)
+    out[i] = modulus.mul(a[i], s);
+}
+
+#if defined(TOYFHE_SIMD_X86)
+
+// --- AVX2: four residues per 256-bit lane; no unsigned 64-bit compare, but
+// residues and their sums stay below 2^63, so the signed one serves.
+
+__attribute__((target("avx2"))) void addAvx2(const int64_t *a, const int64_t *b, int64_t *out, std::size_t n,
+                                              int64_t q) {
+  const __m256i vq = _mm256_set1_epi64x(q);
+  const __m256i top = _mm256_set1_epi64x(q - 1);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256i s = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+    const __m256i over = _mm256_cmpgt_epi64(s, top);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_sub_epi64(s, _mm256_and_si256(over, vq)));
+  }
+  addScalar(a + i, b + i, out + i, n - i, q);
+}
+
+__attribute__((target("avx2"))) void subAvx2(const int64_t *a, const int64_t *b, int64_t *out, std::size_t n,
+                                              int64_t q) {
+  const __m256i vq = _mm256_set1_epi64x(q);
+  const __m256i zero = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256i d = _mm256_sub_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+    const __m256i under = _mm256_cmpgt_epi64(zero, d);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_add_epi64(d, _mm256_and_si256(under, vq)));
+  }
+  subScalar(a + i, b + i, out + i, n - i, q);
+}
+
+__attribute__((target("avx2"))) void negateAvx2(const int64_t *a, int64_t *out, std::size_t n, int64_t q) {
+  const __m256i vq = _mm256_set1_epi64x(q);
+  const __m256i zero = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    const __m256i is_zero = _mm256_cmpeq_epi64(x, zero);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_andnot_si256(is_zero, _mm256_sub_epi64(vq, x)));
+  }
+  negateScalar(a + i, out + i, n - i, q);
+}
+
+// Power-of-two q only. AVX2 has no 64-bit mullo: the low 64 bits of x * s
+// are lo(x)lo(s) + ((hi(x)lo(s) + lo(x)hi(s)) << 32).
+__attribute__((target("avx2"))) void mulScalarAvx2(const int64_t *a, int64_t s, int64_t *out, std::size_t n,
+                                                    int64_t q) {
+  const __m256i vs = _mm256_set1_epi64x(s);
+  const __m256i vs_hi = _mm256_srli_epi64(vs, 32);
+  const __m256i mask = _mm256_set1_epi64x(q - 1);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), vs), _mm256_mul_epu32(x, vs_hi));
+    const __m256i product = _mm256_add_epi64(_mm256_mul_epu32(x, vs), _mm256_slli_epi64(cross, 32));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_and_si256(product, mask));
+  }
+  mulScalarScalar(a + i, s, out + i, n - i, q);
+}
+
+// --- AVX-512: eight residues per lane, mask registers for the corrections.
+
+__attribute__((target("avx512f"))) void addAvx512(const int64_t *a, const int64_t *b, int64_t *out, std::size_t n,
+                                                   int64_t q) {
+  const __m512i vq = _mm512_set1_epi64(q);
+  const __m512i top = _mm512_set1_epi64(q - 1);
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m512i s = _mm512_add_epi64(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+    _mm512_storeu_si512(out + i, _mm512_mask_sub_epi64(s, _mm512_cmpgt_epi64_mask(s, top), s, vq));
+  }
+  addScalar(a + i, b + i, out + i, n - i, q);
+}
+
+__attribute__((target("avx512f"))) void subAvx512(const int64_t *a, const int64_t *b, int64_t *out, std::size_t n,
+                                                   int64_t q) {
+  const __m512i vq = _mm512_set1_epi64(q);
+  const __m512i zero = _mm512_setzero_si512();
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m512i d = _mm512_sub_epi64(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+    _mm512_storeu_si512(out + i, _mm512_mask_add_epi64(d, _mm512_cmplt_epi64_mask(d, zero), d, vq));
+  }
+  subScalar(a + i, b + i, out + i, n - i, q);
+}
+
+__attribute__((target("avx512f"))) void negateAvx512(const int64_t *a, int64_t *out, std::size_t n, int64_t q) {
+  const __m512i vq = _mm512_set1_epi64(q);
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m512i x = _mm512_loadu_si512(a + i);
+    _mm512_storeu_si512(out + i, _mm512_maskz_sub_epi64(_mm512_test_epi64_mask(x, x), vq, x));
+  }
+  negateScalar(a + i, out + i, n - i, q);
+}
+
+// Power-of-two q only; AVX-512DQ has the 64-bit mullo.
+__attribute__((target("avx512f,avx512dq"))) void mulScalarAvx512(const int64_t *a, int64_t s, int64_t *out,
+                                                                  std::size_t n, int64_t q) {
+  const __m512i vs = _mm512_set1_epi64(s);
+  const __m512i mask = _mm512_set1_epi64(q - 1);
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm512_storeu_si512(out + i, _mm512_and_si512(_mm512_mullo_epi64(_mm512_loadu_si512(a + i), vs), mask));
+  mulScalarScalar(a + i, s, out + i, n - i, q);
+}
+
+#endif // TOYFHE_SIMD_X86
+
+Isa detect() {
+#if defined(TOYFHE_SIMD_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+    return Isa::Avx512;
+  if (__builtin_cpu_supports("avx2"))
+    return Isa::Avx2;
+#endif
+  return Isa::Scalar;
+}
+
+// An unsupported request runs the scalar path rather than faulting.
+Isa usable(Isa isa) { return supported(isa) ? isa : Isa::Scalar; }
+
+} // namespace
+
+Isa best() {
+  static const Isa detected = detect();
+  return detected;
+}
+
+bool supported(Isa isa) { return static_cast<int>(isa) <= static_cast<int>(best()); }
+
+const char *name(Isa isa) {
+  switch (isa) {
+  case Isa::Scalar:
+    return "scalar";
+  case Isa::Avx2:
+    return "avx2";
+  case Isa::Avx512:
+    return "avx512";
+  }
+  return "unknown";
+}
+
+void addMod(Isa isa, const int64_t *a, const int64_t *b, int64_t *out, std::size_t n, int64_t q) {
+  switch (usable(isa)) {
+#if defined(TOYFHE_SIMD_X86)
+  case Isa::Avx512:
+    return addAvx512(a, b, out, n, q);
+  case Isa::Avx2:
+    return addAvx2(a, b, out, n, q);
+#endif
+  default:
+    return addScalar(a, b, out, n, q);
+  }
+}
+
+void subMod(Isa isa, const int64_t *a, const int64_t *b, int64_t *out, std::size_t n, int64_t q) {
+  switch (usable(isa)) {
+#if defined(TOYFHE_SIMD_X86)
+  case Isa::Avx512:
+    return subAvx512(a, b, out, n, q);
+  case Isa::Avx2:
+    return subAvx2(a, b, out, n, q);
+#endif
+  default:
+    return subScalar(a, b, out, n, q);
+  }
+}
+
+void negateMod(Isa isa, const int64_t *a, int64_t *out, std::size_t n, int64_t q) {
+  switch (usable(isa)) {
+#if defined(TOYFHE_SIMD_X86)
+  case Isa::Avx512:
+    return negateAvx512(a, out, n, q);
+  case Isa::Avx2:
+    return negateAvx2(a, out, n, q);
+#endif
+  default:
+    return negateScalar(a, out, n, q);
+  }
+}
+
+void mulScalarMod(Isa isa, const int64_t *a, int64_t scalar, int64_t *out, std::size_t n, int64_t q) {
+  const int64_t s = reduce(scalar, q);
+  switch (isPowerOfTwo(q) ? usable(isa) : Isa::Scalar) {
+#if defined(TOYFHE_SIMD_X86)
+  case Isa::Avx512:
+    return mulScalarAvx512(a, s, out, n, q);
+  case Isa::Avx2:
+    return mulScalarAvx2(a, s, out, n, q);
+#endif
+  default:
+    return mulScalarScalar(a, s, out, n, q);
+  }
+}
+
+} // namespace fhenomenon::toyfhe::simd
@@ -0,0 +1,80 @@
+#include "FHN/FhnBufferPool.h"
+
+#include <iterator>
+
+namespace fhenomenon {
+
+FhnBufferPool::FhnBufferPool(FhnBackendCtx *ctx, FhnBufferAllocFn alloc, FhnBufferFreeFn free, Limits limits)
+  : ctx_(ctx), alloc_(alloc), free_(free), limits_(limits) {}
+
+FhnBufferPool::~FhnBufferPool() { trim(0); }
+
+FhnBuffer *FhnBufferPool::acquire(uint64_t byte_class) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_class_.find(byte_class);
+    if (it != by_class_.end() && !it->second.empty()) {
+      const auto node = it->second.back();
+      it->second.pop_back();
+      FhnBuffer *buf = node->buf;
+      idle_.erase(node);
+      --stats_.idle_buffers;
+      stats_.idle_bytes -= byte_class;
+      ++stats_.hits;
+      return buf;
+    }
+    ++stats_.misses;
+  }
+  return alloc_(ctx_);
+}
+
+void FhnBufferPool::release(FhnBuffer *buf, uint64_t byte_class) {
+  if (!buf)
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  idle_.push_back(Idle{buf, byte_class, run_});
+  by_class_[byte_class].push_back(std::prev(idle_.end()));
+  ++stats_.idle_buffers;
+  stats_.idle_bytes += byte_class;
+  enforceCaps();
+}
+
+void FhnBufferPool::endRun() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++run_;
+  if (limits_.max_idle_runs == 0)
+    return;
+  while (!idle_.empty() && run_ - idle_.front().run >= limits_.max_idle_runs)
+    freeOldest();
+}
+
+void FhnBufferPool::trim(uint32_t keep_buffers) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (stats_.idle_buffers > keep_buffers)
+    freeOldest();
+}
+
+FhnBufferPool::Stats FhnBufferPool::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void FhnBufferPool::freeOldest() {
+  const Idle oldest = idle_.front();
+  // The oldest idle buffer is also the oldest of its class.
+  auto &nodes = by_class_[oldest.byte_class];
+  nodes.erase(nodes.begin());
+  idle_.pop_front();
+  --stats_.idle_buffers;
+  stats_.idle_bytes -= oldest.byte_class;
+  ++stats_.trimmed;
+  free_(ctx_, oldest.buf);
+}
+
+void FhnBufferPool::enforceCaps() {
+  while (!idle_.empty() && (stats_.idle_buffers > limits_.max_idle_buffers ||
+                            (limits_.max_idle_bytes > 0 && stats_.idle_bytes > limits_.max_idle_bytes)))
+    freeOldest();
+}
+
+} // namespace fhenomenon
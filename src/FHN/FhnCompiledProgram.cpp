@@ -0,0 +1,66 @@
+#include "FHN/FhnCompiledProgram.h"
+
+namespace fhenomenon {
+
+namespace {
+constexpr std::size_t kSlotsPerStep = 5; // result + 4 operands
+} // namespace
+
+std::optional<FhnCompiledProgram> FhnCompiledProgram::compile(const FhnDefaultExecutor &executor,
+                                                              const FhnProgram &program) {
+  // Same gate as FhnDefaultExecutor::execute: a different ABI revision may
+  // renumber opcodes, so none of its instructions can be resolved.
+  if (program.version != FHN_ABI_VERSION)
+    return std::nullopt;
+
+  FhnCompiledProgram compiled;
+  compiled.instructions_.assign(program.instructions, program.instructions + program.num_instructions);
+  compiled.steps_.reserve(program.num_instructions);
+  compiled.slots_.reserve(program.num_instructions * kSlotsPerStep);
+
+  const std::vector<int64_t> levels = executor.instructionLevels(program);
+  for (std::size_t i = 0; i < compiled.instructions_.size(); ++i) {
+    const FhnInstruction &inst = compiled.instructions_[i];
+    FhnKernelStep resolved[FhnDefaultExecutor::kMaxSteps];
+    const uint32_t count = executor.resolve(inst, resolved, levels.empty() ? -1 : levels[i]);
+    if (count == 0)
+      return std::nullopt;
+    for (uint32_t s = 0; s < count; ++s) {
+      Step step;
+      step.fn = resolved[s].fn;
+      step.params = inst.params;
+      step.fparams = inst.fparams;
+      compiled.steps_.push_back(step);
+      compiled.slots_.push_back(resolved[s].result_id);
+      for (int j = 0; j < 4; ++j)
+        compiled.slots_.push_back(resolved[s].operands[j]);
+    }
+  }
+  return compiled;
+}
+
+void FhnCompiledProgram::bind(FhnBuffer **buffers) {
+  bound_ = buffers != nullptr;
+  if (!bound_)
+    return;
+  const uint32_t *slot = slots_.data();
+  for (Step &step : steps_) {
+    step.result = buffers[slot[0]];
+    for (std::size_t j = 0; j < 4; ++j)
+      step.operands[j] = slot[j + 1] != 0 ? buffers[slot[j + 1]] : nullptr;
+    slot += kSlotsPerStep;
+  }
+}
+
+int FhnCompiledProgram::run(FhnBackendCtx *ctx) const {
+  if (!bound_)
+    return -1;
+  for (const Step &step : steps_) {
+    const int rc = step.fn(ctx, step.result, step.operands, step.params, step.fparams);
+    if (rc != 0)
+      return rc;
+  }
+  return 0;
+}
+
+} // namespace fhenomenon
@@ -1,24 +1,48 @@
 #include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnBufferPool.h"
+#include "FHN/FhnSpillFile.h"
+#include "FHN/FhnThreadPool.h"
 
 #include <algorithm>
+#include <atomic>
+#include <limits>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
 namespace fhenomenon {
 
-FhnDefaultExecutor::FhnDefaultExecutor(FhnKernelTable *table) {
+FhnDefaultExecutor::FhnDefaultExecutor(FhnKernelTable *table, FhnKernelFlagsFn kernel_flags, FhnBackendCtx *ctx,
+                                       FhnBatchKernelTable *batch_table) {
   if (!table)
     return;
   for (uint32_t i = 0; i < table->num_kernels; ++i) {
     const FhnKernelEntry &entry = table->kernels[i];
-    if (entry.fn != nullptr) {
-      dispatch_[static_cast<int>(entry.opcode)] = entry.fn;
+    // Opcodes outside this ABI revision's range are ignored, exactly as an
+    // unknown key was never dispatched by the previous map-based table.
+    if (entry.fn != nullptr && static_cast<uint32_t>(entry.opcode) < kernels_.size()) {
+      kernels_[static_cast<uint32_t>(entry.opcode)] = entry.fn;
+      names_[static_cast<uint32_t>(entry.opcode)] = entry.name;
+    }
+  }
+  direct_ = kernels_;
+  if (kernel_flags) {
+    for (uint32_t op = 0; op < kernels_.size(); ++op) {
+      if (kernels_[op] != nullptr)
+        flags_[op] = kernel_flags(ctx, static_cast<FhnOpCode>(op));
+    }
+  }
+  if (batch_table) {
+    for (uint32_t i = 0; i < batch_table->num_kernels; ++i) {
+      const FhnBatchKernelEntry &entry = batch_table->kernels[i];
+      const auto op = static_cast<uint32_t>(entry.opcode);
+      if (entry.fn != nullptr && op < batch_kernels_.size() && kernels_[op] != nullptr)
+        batch_kernels_[op] = entry.fn;
     }
   }
 }
 
-bool FhnDefaultExecutor::supports(FhnOpCode opcode) const {
-  return dispatch_.find(static_cast<int>(opcode)) != dispatch_.end();
-}
+bool FhnDefaultExecutor::supports(FhnOpCode opcode) const { return kernel(opcode) != nullptr; }
 
 int FhnDefaultExecutor::execute(FhnBackendCtx *ctx, const FhnProgram *program, FhnBuffer **buffers) {
   if (!program || !buffers)
@@ -28,14 +52,20 @@ int FhnDefaultExecutor::execute(FhnBackendCtx *ctx, const FhnProgram *program, F
   if (program->version != FHN_ABI_VERSION)
     return -1;
 
+  const std::vector<int64_t> levels = instructionLevels(*program);
   for (uint32_t i = 0; i < program->num_instructions; ++i) {
     const FhnInstruction &inst = program->instructions[i];
+    const int64_t level = levels.empty() ? -1 : levels[i];
+    const uint64_t start_ns = trace_ ? trace_->now() : 0;
 
-    auto it = dispatch_.find(static_cast<int>(inst.opcode));
-    if (it == dispatch_.end()) {
-      if (!decompose(ctx, inst, buffers)) {
+    FhnKernelFn fn = level < 0 ? directKernel(inst.opcode)
+                               : (prefersDecomposition(inst.opcode, level) ? nullptr : kernel(inst.opcode));
+    if (fn == nullptr) {
+      if (!decompose(ctx, inst, buffers, level)) {
         return -1;
       }
+      if (trace_)
+        traceInstruction(i, inst, level, start_ns, 0, nullptr);
       continue;
     }
 
@@ -47,10 +77,11 @@ int FhnDefaultExecutor::execute(FhnBackendCtx *ctx, const FhnProgram *program, F
       }
     }
 
-    FhnKernelFn fn = it->second;
     int rc = fn(ctx, buffers[inst.result_id], ops, inst.params, inst.fparams);
     if (rc != 0)
       return rc;
+    if (trace_)
+      traceInstruction(i, inst, level, start_ns, 0, nullptr);
   }
 
   return 0;
@@ -58,7 +89,7 @@ int FhnDefaultExecutor::execute(FhnBackendCtx *ctx, const FhnProgram *program, F
 
 int FhnDefaultExecutor::execute(const FhnMovementHooks &hooks, const FhnProgram *program, FhnBuffer **buffers,
                                 const FhnMovementPlan &plan) {
-  if (!program || !buffers || !hooks.buffer_alloc || !hooks.buffer_free)
+  if (!program || !buffers || (!hooks.pool && (!hooks.buffer_alloc || !hooks.buffer_free)))
     return -1;
   if (program->version != FHN_ABI_VERSION)
     return -1;
@@ -68,146 +99,642 @@ int FhnDefaultExecutor::execute(const FhnMovementHooks &hooks, const FhnProgram
   if (plan.instructionCount() != program->num_instructions)
     return -1;
 
-  std::vector<uint32_t> owned; // plan-allocated ids not yet freed
+  auto acquire = [&](uint32_t id) {
+    return hooks.pool ? hooks.pool->acquire(plan.byteClass(id)) : hooks.buffer_alloc(hooks.ctx);
+  };
+  auto release = [&](uint32_t id) {
+    if (hooks.pool)
+      hooks.pool->release(buffers[id], plan.byteClass(id));
+    else
+      hooks.buffer_free(hooks.ctx, buffers[id]);
+    buffers[id] = nullptr;
+  };
+
+  std::vector<uint32_t> owned;     // plan-allocated ids not yet freed
+  std::vector<uint32_t> in_flight; // async prefetches not yet fenced
+  std::unordered_map<uint32_t, FhnSpillFile::Extent> spilled; // by id, until restored
+  const bool async = hooks.prefetch_async && hooks.fence;
+  const bool can_spill = hooks.serialize && hooks.deserialize && hooks.spill_file;
   auto fail = [&](int rc) {
+    for (uint32_t id : in_flight)
+      hooks.fence(hooks.ctx, buffers[id]); // best effort: the buffer is released next
+    for (const auto &entry : spilled)
+      hooks.spill_file->release(entry.second);
     for (uint32_t id : owned) {
-      if (buffers[id]) {
-        hooks.buffer_free(hooks.ctx, buffers[id]);
-        buffers[id] = nullptr;
-      }
+      if (buffers[id])
+        release(id);
     }
+    if (hooks.pool)
+      hooks.pool->endRun();
     return rc;
   };
 
+  const std::vector<int64_t> levels = instructionLevels(*program);
+  // One instruction's kernel (or decomposition), also used to recompute
+  // discarded values.
+  auto dispatch = [&](uint32_t index) {
+    const FhnInstruction &inst = program->instructions[index];
+    const int64_t level = levels.empty() ? -1 : levels[index];
+    FhnKernelFn fn = level < 0 ? directKernel(inst.opcode)
+                               : (prefersDecomposition(inst.opcode, level) ? nullptr : kernel(inst.opcode));
+    if (fn == nullptr)
+      return decompose(hooks.ctx, inst, buffers, level) ? 0 : -1;
+    const FhnBuffer *ops[4] = {nullptr, nullptr, nullptr, nullptr};
+    for (int j = 0; j < 4; ++j) {
+      if (inst.operands[j] != 0)
+        ops[j] = buffers[inst.operands[j]];
+    }
+    return fn(hooks.ctx, buffers[inst.result_id], ops, inst.params, inst.fparams);
+  };
+
   for (uint32_t i = 0; i < program->num_instructions; ++i) {
-    const FhnMovementActions &act = plan.at(i);
+    const FhnMovementActions act = plan.at(i);
+    const uint64_t movement_start_ns = trace_ ? trace_->now() : 0;
 
+    for (const FhnPeerCopy &copy : act.receive) {
+      buffers[copy.id] = hooks.receive ? hooks.receive(copy) : nullptr;
+      if (!buffers[copy.id])
+        return fail(-1);
+      owned.push_back(copy.id);
+    }
+    for (const FhnLevelDown &down : act.level_down) {
+      FhnKernelFn level_down = kernel(FHN_LEVEL_DOWN);
+      const FhnBuffer *ops[4] = {buffers[down.id], nullptr, nullptr, nullptr};
+      const int64_t params[4] = {down.level, 0, 0, 0};
+      const double fparams[2] = {0.0, 0.0};
+      const int rc = level_down ? level_down(hooks.ctx, buffers[down.id], ops, params, fparams) : -1;
+      if (rc != 0)
+        return fail(rc);
+    }
     for (uint32_t id : act.evict) {
       if (hooks.evict && hooks.evict(hooks.ctx, buffers[id]) != 0)
         return fail(-1);
     }
+    for (uint32_t id : act.spill) {
+      if (!can_spill)
+        return fail(-1);
+      const uint64_t size = hooks.serialize(hooks.ctx, buffers[id], nullptr, 0);
+      const std::optional<FhnSpillFile::Extent> extent =
+        size != 0 ? hooks.spill_file->reserve(size) : std::optional<FhnSpillFile::Extent>();
+      if (!extent)
+        return fail(-1);
+      spilled[id] = *extent;
+      if (hooks.serialize(hooks.ctx, buffers[id], hooks.spill_file->data(*extent), size) != size)
+        return fail(-1);
+      release(id);
+    }
+    for (uint32_t id : act.discard) {
+      release(id);
+      owned.erase(std::remove(owned.begin(), owned.end(), id), owned.end());
+    }
     for (uint32_t id : act.alloc) {
-      buffers[id] = hooks.buffer_alloc(hooks.ctx);
+      buffers[id] = acquire(id);
       if (!buffers[id])
         return fail(-1);
       owned.push_back(id);
     }
+    for (uint32_t id : act.unspill) {
+      auto it = spilled.find(id);
+      if (!can_spill || it == spilled.end())
+        return fail(-1);
+      buffers[id] = acquire(id);
+      if (!buffers[id])
+        return fail(-1);
+      // A spilled caller input comes back in a buffer the plan owns.
+      if (std::find(owned.begin(), owned.end(), id) == owned.end())
+        owned.push_back(id);
+      const FhnSpillFile::Extent extent = it->second;
+      spilled.erase(it);
+      const int rc = hooks.deserialize(hooks.ctx, buffers[id], hooks.spill_file->data(extent), extent.size);
+      hooks.spill_file->release(extent);
+      if (rc != 0)
+        return fail(-1);
+    }
     for (uint32_t id : act.prefetch) {
       if (hooks.prefetch && hooks.prefetch(hooks.ctx, buffers[id]) != 0)
         return fail(-1);
     }
-
-    const FhnInstruction &inst = program->instructions[i];
-    auto it = dispatch_.find(static_cast<int>(inst.opcode));
-    if (it == dispatch_.end()) {
-      if (!decompose(hooks.ctx, inst, buffers))
+    for (uint32_t id : act.fence) {
+      if (!async)
+        continue;
+      in_flight.erase(std::remove(in_flight.begin(), in_flight.end(), id), in_flight.end());
+      if (hooks.fence(hooks.ctx, buffers[id]) != 0)
         return fail(-1);
-    } else {
-      const FhnBuffer *ops[4] = {nullptr, nullptr, nullptr, nullptr};
-      for (int j = 0; j < 4; ++j) {
-        if (inst.operands[j] != 0)
-          ops[j] = buffers[inst.operands[j]];
-      }
-      const int rc = it->second(hooks.ctx, buffers[inst.result_id], ops, inst.params, inst.fparams);
+    }
+    for (uint32_t k : act.recompute) {
+      const uint32_t id = program->instructions[k].result_id;
+      buffers[id] = acquire(id);
+      if (!buffers[id])
+        return fail(-1);
+      owned.push_back(id);
+      const int rc = dispatch(k);
       if (rc != 0)
         return fail(rc);
     }
+    for (uint32_t id : act.prefetch_async) {
+      if (async) {
+        if (hooks.prefetch_async(hooks.ctx, buffers[id]) != 0)
+          return fail(-1);
+        in_flight.push_back(id);
+      } else if (hooks.prefetch && hooks.prefetch(hooks.ctx, buffers[id]) != 0) {
+        return fail(-1);
+      }
+    }
+
+    const FhnInstruction &inst = program->instructions[i];
+    const int64_t level = levels.empty() ? -1 : levels[i];
+    const uint64_t start_ns = trace_ ? trace_->now() : 0;
+    const int rc = dispatch(i);
+    if (rc != 0)
+      return fail(rc);
+    if (trace_)
+      traceInstruction(i, inst, level, start_ns, start_ns - movement_start_ns, &act);
 
+    for (const FhnPeerCopy &copy : act.send) {
+      if (!hooks.send || hooks.send(copy, buffers[copy.id]) != 0)
+        return fail(-1);
+    }
     for (uint32_t id : act.free) {
-      hooks.buffer_free(hooks.ctx, buffers[id]);
-      buffers[id] = nullptr;
+      release(id);
       owned.erase(std::remove(owned.begin(), owned.end(), id), owned.end());
     }
   }
 
+  if (hooks.pool)
+    hooks.pool->endRun();
   return 0;
 }
 
-bool FhnDefaultExecutor::decompose(FhnBackendCtx *ctx, const FhnInstruction &inst, FhnBuffer **buffers) {
-  auto call = [&](FhnOpCode op, FhnBuffer *res, const FhnBuffer *const *ops, const int64_t *params,
-                  const double *fparams) -> int {
-    auto it = dispatch_.find(static_cast<int>(op));
-    if (it == dispatch_.end())
-      return -1;
-    return it->second(ctx, res, ops, params, fparams);
+uint32_t FhnDefaultExecutor::resolve(const FhnInstruction &inst, FhnKernelStep *steps, int64_t level) const {
+  FhnKernelFn own = kernel(inst.opcode);
+  if (own == nullptr || prefersDecomposition(inst.opcode, level)) {
+    const uint32_t count = decomposition(inst, steps, level);
+    // A decomposition that is cheaper in general may still not apply to
+    // this instruction (e.g. MAD whose result aliases its addend).
+    if (count != 0 || own == nullptr)
+      return count;
+  }
+  steps[0] = FhnKernelStep{inst.opcode, own, inst.result_id, {0, 0, 0, 0}};
+  for (int j = 0; j < 4; ++j)
+    steps[0].operands[j] = inst.operands[j];
+  return 1;
+}
+
+uint32_t FhnDefaultExecutor::decomposition(const FhnInstruction &inst, FhnKernelStep *steps, int64_t level) const {
+  auto step = [&](FhnOpCode op, uint32_t a, uint32_t b) {
+    return FhnKernelStep{op, kernel(op), inst.result_id, {a, b, 0, 0}};
   };
 
   switch (inst.opcode) {
   case FHN_HMULT: {
     // Must have MULT_CC at minimum
-    if (dispatch_.find(static_cast<int>(FHN_MULT_CC)) == dispatch_.end())
-      return false;
-
-    const FhnBuffer *ops[] = {buffers[inst.operands[0]], buffers[inst.operands[1]], nullptr, nullptr};
-    if (call(FHN_MULT_CC, buffers[inst.result_id], ops, inst.params, inst.fparams) != 0)
-      return false;
-
+    if (!supports(FHN_MULT_CC))
+      return 0;
+    uint32_t count = 0;
+    steps[count++] = step(FHN_MULT_CC, inst.operands[0], inst.operands[1]);
     // RELINEARIZE and RESCALE are optional in the sense that a backend may
     // not register them — but if a registered kernel fails, that failure
     // must propagate, not be swallowed.
-    const FhnBuffer *self_ops[] = {buffers[inst.result_id], nullptr, nullptr, nullptr};
-    if (dispatch_.count(static_cast<int>(FHN_RELINEARIZE))) {
-      if (call(FHN_RELINEARIZE, buffers[inst.result_id], self_ops, inst.params, inst.fparams) != 0)
-        return false;
-    }
-    if (dispatch_.count(static_cast<int>(FHN_RESCALE))) {
-      if (call(FHN_RESCALE, buffers[inst.result_id], self_ops, inst.params, inst.fparams) != 0)
-        return false;
-    }
-
-    return true;
+    if (supports(FHN_RELINEARIZE))
+      steps[count++] = step(FHN_RELINEARIZE, inst.result_id, 0);
+    if (supports(FHN_RESCALE))
+      steps[count++] = step(FHN_RESCALE, inst.result_id, 0);
+    return count;
   }
-  case FHN_HROT: {
+  case FHN_HROT:
     // FHN_ROTATE is a complete key-switched rotation by convention, so the
     // fused HROT decomposes to a single ROTATE. (A MULT_KEY + ROTATE
     // sequence would apply the evaluation key twice and silently corrupt
     // the ciphertext.)
-    if (!dispatch_.count(static_cast<int>(FHN_ROTATE)))
-      return false;
-    const FhnBuffer *ops[] = {buffers[inst.operands[0]], nullptr, nullptr, nullptr};
-    return call(FHN_ROTATE, buffers[inst.result_id], ops, inst.params, inst.fparams) == 0;
-  }
+    if (!supports(FHN_ROTATE))
+      return 0;
+    steps[0] = step(FHN_ROTATE, inst.operands[0], 0);
+    return 1;
   case FHN_HROT_ADD: {
-    // Decompose HROT part first
+    // HROT part first: the fused HROT kernel if registered, else its
+    // decomposition.
+    if (!supports(FHN_ADD_CC))
+      return 0;
     FhnInstruction hrot_inst = inst;
     hrot_inst.opcode = FHN_HROT;
-    bool ok;
-    if (dispatch_.count(static_cast<int>(FHN_HROT))) {
-      const FhnBuffer *ops[] = {buffers[inst.operands[0]], nullptr, nullptr, nullptr};
-      ok = call(FHN_HROT, buffers[inst.result_id], ops, inst.params, inst.fparams) == 0;
-    } else {
-      ok = decompose(ctx, hrot_inst, buffers);
-    }
-    if (!ok || !dispatch_.count(static_cast<int>(FHN_ADD_CC)))
-      return false;
-    const FhnBuffer *add_ops[] = {buffers[inst.result_id], buffers[inst.operands[1]], nullptr, nullptr};
-    return call(FHN_ADD_CC, buffers[inst.result_id], add_ops, inst.params, inst.fparams) == 0;
-  }
-  case FHN_HCONJ_ADD: {
-    if (!dispatch_.count(static_cast<int>(FHN_CONJUGATE)) || !dispatch_.count(static_cast<int>(FHN_ADD_CC)))
-      return false;
-    const FhnBuffer *ops[] = {buffers[inst.operands[0]], nullptr, nullptr, nullptr};
-    if (call(FHN_CONJUGATE, buffers[inst.result_id], ops, inst.params, inst.fparams) != 0)
-      return false;
-    const FhnBuffer *add_ops[] = {buffers[inst.result_id], buffers[inst.operands[1]], nullptr, nullptr};
-    return call(FHN_ADD_CC, buffers[inst.result_id], add_ops, inst.params, inst.fparams) == 0;
-  }
-  case FHN_MAD: {
+    hrot_inst.operands[1] = 0; // the addend belongs to the ADD_CC step
+    const uint32_t count = resolve(hrot_inst, steps, level);
+    if (count == 0)
+      return 0;
+    steps[count] = step(FHN_ADD_CC, inst.result_id, inst.operands[1]);
+    return count + 1;
+  }
+  case FHN_HCONJ_ADD:
+    if (!supports(FHN_CONJUGATE) || !supports(FHN_ADD_CC))
+      return 0;
+    steps[0] = step(FHN_CONJUGATE, inst.operands[0], 0);
+    steps[1] = step(FHN_ADD_CC, inst.result_id, inst.operands[1]);
+    return 2;
+  case FHN_MAD:
     // res = a * fparams[0] + b. The multiply lands in the result buffer
     // before b is read, so b must be present and must not alias res.
     if (inst.operands[1] == 0 || inst.operands[1] == inst.result_id)
-      return false;
-    if (!dispatch_.count(static_cast<int>(FHN_MULT_CS)) || !dispatch_.count(static_cast<int>(FHN_ADD_CC)))
-      return false;
-    const FhnBuffer *mult_ops[] = {buffers[inst.operands[0]], nullptr, nullptr, nullptr};
-    if (call(FHN_MULT_CS, buffers[inst.result_id], mult_ops, inst.params, inst.fparams) != 0)
-      return false;
-    const FhnBuffer *add_ops[] = {buffers[inst.result_id], buffers[inst.operands[1]], nullptr, nullptr};
-    return call(FHN_ADD_CC, buffers[inst.result_id], add_ops, inst.params, inst.fparams) == 0;
-  }
+      return 0;
+    if (!supports(FHN_MULT_CS) || !supports(FHN_ADD_CC))
+      return 0;
+    steps[0] = step(FHN_MULT_CS, inst.operands[0], 0);
+    steps[1] = step(FHN_ADD_CC, inst.result_id, inst.operands[1]);
+    return 2;
   default:
+    return 0;
+  }
+}
+
+void FhnDefaultExecutor::setKernelCosts(const FhnKernelCostTable *costs, const FhnLevelModel *model) {
+  direct_ = kernels_;
+  decompose_at_.clear();
+  fresh_level_ = 0;
+  level_effects_.fill(FHN_LEVEL_PRESERVE);
+  if (!costs)
+    return;
+
+  std::array<bool, FHN_OPCODE_COUNT> known{};
+  std::array<double, FHN_OPCODE_COUNT> base{};
+  std::array<double, FHN_OPCODE_COUNT> per_level{};
+  for (uint32_t i = 0; i < costs->num_costs; ++i) {
+    const auto op = static_cast<uint32_t>(costs->costs[i].opcode);
+    if (op < known.size()) {
+      known[op] = true;
+      base[op] = costs->costs[i].base_ns;
+      per_level[op] = costs->costs[i].per_level_ns;
+    }
+  }
+  if (model && model->fresh_level > 0) {
+    fresh_level_ = model->fresh_level;
+    for (const auto &[op, effect] : model->effects) {
+      if (op >= 0 && static_cast<uint32_t>(op) < level_effects_.size())
+        level_effects_[static_cast<uint32_t>(op)] = effect;
+    }
+  }
+
+  // Decide level by level, opcodes in enum order: a fused opcode whose
+  // decomposition nests another (HROT_ADD -> HROT) sees the nested choice
+  // already made. decompose_at_ is consulted by prefersDecomposition()
+  // while it is being filled.
+  decompose_at_.assign(static_cast<std::size_t>(fresh_level_) + 1, std::array<bool, FHN_OPCODE_COUNT>{});
+  for (int64_t level = 0; level <= fresh_level_; ++level) {
+    auto &choice = decompose_at_[static_cast<std::size_t>(level)];
+    for (uint32_t op = 0; op < FHN_OPCODE_COUNT; ++op) {
+      if (kernels_[op] == nullptr || !known[op])
+        continue;
+      FhnInstruction probe{};
+      probe.opcode = static_cast<FhnOpCode>(op);
+      probe.result_id = 1;
+      probe.operands[0] = 2;
+      probe.operands[1] = 3;
+      FhnKernelStep steps[kMaxSteps];
+      const uint32_t count = decomposition(probe, steps, level);
+      if (count == 0)
+        continue;
+      const double lvl = static_cast<double>(level);
+      double decomposed = 0.0;
+      bool priced = true;
+      for (uint32_t k = 0; k < count && priced; ++k) {
+        const auto step_op = static_cast<uint32_t>(steps[k].opcode);
+        priced = known[step_op];
+        decomposed += base[step_op] + per_level[step_op] * lvl;
+      }
+      choice[op] = priced && decomposed < base[op] + per_level[op] * lvl;
+    }
+  }
+
+  const auto &fresh = decompose_at_[static_cast<std::size_t>(fresh_level_)];
+  for (uint32_t op = 0; op < FHN_OPCODE_COUNT; ++op) {
+    if (fresh[op])
+      direct_[op] = nullptr;
+  }
+  // Keep the per-level table only when some level disagrees with the
+  // fresh-level choice; otherwise execute() needs no level tracking.
+  if (std::all_of(decompose_at_.begin(), decompose_at_.end(), [&](const auto &c) { return c == fresh; })) {
+    decompose_at_.clear();
+  }
+}
+
+bool FhnDefaultExecutor::prefersDecomposition(FhnOpCode opcode, int64_t level) const {
+  const auto index = static_cast<uint32_t>(opcode);
+  if (index >= kernels_.size() || kernels_[index] == nullptr)
     return false;
+  if (decompose_at_.empty() || level < 0)
+    return direct_[index] == nullptr;
+  const int64_t clamped = std::min(level, fresh_level_);
+  return decompose_at_[static_cast<std::size_t>(clamped)][index];
+}
+
+std::vector<int64_t> FhnDefaultExecutor::instructionLevels(const FhnProgram &program) const {
+  std::vector<int64_t> levels;
+  if (decompose_at_.empty())
+    return levels;
+  levels.resize(program.num_instructions);
+  std::unordered_map<uint32_t, int64_t> level_of; // undefined ids: fresh inputs
+  for (uint32_t i = 0; i < program.num_instructions; ++i) {
+    const FhnInstruction &inst = program.instructions[i];
+    int64_t level = fresh_level_;
+    for (uint32_t id : inst.operands) {
+      if (id == 0)
+        continue;
+      auto it = level_of.find(id);
+      if (it != level_of.end())
+        level = std::min(level, it->second);
+    }
+    levels[i] = std::max<int64_t>(level, 0);
+    const auto op = static_cast<uint32_t>(inst.opcode);
+    const FhnLevelEffect effect = op < level_effects_.size() ? level_effects_[op] : FHN_LEVEL_PRESERVE;
+    if (effect == FHN_LEVEL_CONSUME)
+      level -= 1;
+    else if (effect == FHN_LEVEL_SET_PARAM0)
+      level = inst.params[0];
+    level_of[inst.result_id] = level;
+  }
+  return levels;
+}
+
+bool FhnDefaultExecutor::decompose(FhnBackendCtx *ctx, const FhnInstruction &inst, FhnBuffer **buffers,
+                                   int64_t level) {
+  FhnKernelStep steps[kMaxSteps];
+  const uint32_t count = resolve(inst, steps, level);
+  return count != 0 && runSteps(ctx, inst, steps, count, buffers) == 0;
+}
+
+void FhnDefaultExecutor::traceInstruction(uint32_t index, const FhnInstruction &inst, int64_t level,
+                                          uint64_t start_ns, uint64_t movement_ns,
+                                          const FhnMovementActions *act) const {
+  static_assert(FhnTraceEvent::kMaxKernels == kMaxSteps, "trace events must hold a full decomposition");
+  const uint64_t end_ns = trace_->now();
+  FhnTraceEvent event;
+  event.index = index;
+  event.opcode = inst.opcode;
+  event.start_ns = start_ns;
+  event.duration_ns = end_ns - start_ns;
+  event.movement_ns = movement_ns;
+  // Re-resolving after the fact keeps resolution off the untraced path.
+  FhnKernelStep steps[kMaxSteps];
+  event.num_kernels = resolve(inst, steps, level);
+  event.decomposed = event.num_kernels != 1 || steps[0].opcode != inst.opcode;
+  for (uint32_t s = 0; s < event.num_kernels; ++s)
+    event.kernels[s] = kernelName(steps[s].opcode);
+  if (act) {
+    event.evict = static_cast<uint32_t>(act->evict.size());
+    event.alloc = static_cast<uint32_t>(act->alloc.size());
+    event.prefetch = static_cast<uint32_t>(act->prefetch.size());
+    event.free = static_cast<uint32_t>(act->free.size());
+    event.discard = static_cast<uint32_t>(act->discard.size());
+    event.recompute = static_cast<uint32_t>(act->recompute.size());
+    event.prefetch_async = static_cast<uint32_t>(act->prefetch_async.size());
+    event.fence = static_cast<uint32_t>(act->fence.size());
+    event.level_down = static_cast<uint32_t>(act->level_down.size());
+    event.spill = static_cast<uint32_t>(act->spill.size());
+    event.unspill = static_cast<uint32_t>(act->unspill.size());
+  }
+  trace_->record(event);
+}
+
+int FhnDefaultExecutor::runSteps(FhnBackendCtx *ctx, const FhnInstruction &inst, const FhnKernelStep *steps,
+                                 uint32_t count, FhnBuffer **buffers) {
+  for (uint32_t s = 0; s < count; ++s) {
+    const FhnKernelStep &st = steps[s];
+    const FhnBuffer *ops[4] = {nullptr, nullptr, nullptr, nullptr};
+    for (int j = 0; j < 4; ++j) {
+      if (st.operands[j] != 0)
+        ops[j] = buffers[st.operands[j]];
+    }
+    const int rc = st.fn(ctx, buffers[st.result_id], ops, inst.params, inst.fparams);
+    if (rc != 0)
+      return rc;
+  }
+  return 0;
+}
+
+std::vector<std::vector<uint32_t>> FhnDefaultExecutor::wavefronts(const FhnProgram &program) {
+  // Per buffer id: wave of its latest writer and latest reader (+1, so 0
+  // means "none yet"). Program inputs have no writer.
+  struct Access {
+    uint32_t write = 0;
+    uint32_t read = 0;
+  };
+  std::unordered_map<uint32_t, Access> access;
+  std::vector<std::vector<uint32_t>> waves;
+
+  for (uint32_t i = 0; i < program.num_instructions; ++i) {
+    const FhnInstruction &inst = program.instructions[i];
+    uint32_t wave = 0;
+    // True dependence: after the writer of every operand.
+    for (uint32_t id : inst.operands) {
+      if (id != 0)
+        wave = std::max(wave, access[id].write);
+    }
+    // Output and anti dependence: after the previous writer of the result
+    // and after every earlier reader of the value it overwrites.
+    const Access &res = access[inst.result_id];
+    wave = std::max({wave, res.write, res.read});
+
+    if (wave == waves.size())
+      waves.emplace_back();
+    waves[wave].push_back(i);
+
+    for (uint32_t id : inst.operands) {
+      if (id != 0)
+        access[id].read = std::max(access[id].read, wave + 1);
+    }
+    access[inst.result_id].write = wave + 1;
+  }
+  return waves;
+}
+
+int FhnDefaultExecutor::executeParallel(FhnBackendCtx *ctx, const FhnProgram *program, FhnBuffer **buffers,
+                                        FhnThreadPool &pool) {
+  if (!program || !buffers)
+    return -1;
+  if (program->version != FHN_ABI_VERSION)
+    return -1;
+
+  // Resolve everything up front: kernels and thread-safety per instruction.
+  const uint32_t n = program->num_instructions;
+  const std::vector<int64_t> levels = instructionLevels(*program);
+  std::vector<FhnKernelStep> steps(static_cast<std::size_t>(n) * kMaxSteps);
+  std::vector<uint32_t> step_count(n, 0);
+  std::vector<char> thread_safe(n, 1);
+  for (uint32_t i = 0; i < n; ++i) {
+    FhnKernelStep *own = &steps[static_cast<std::size_t>(i) * kMaxSteps];
+    step_count[i] = resolve(program->instructions[i], own, levels.empty() ? -1 : levels[i]);
+    if (step_count[i] == 0)
+      return -1;
+    for (uint32_t s = 0; s < step_count[i]; ++s) {
+      if ((kernelFlags(own[s].opcode) & FHN_KERNEL_THREAD_SAFE) == 0)
+        thread_safe[i] = 0;
+    }
+  }
+
+  auto run = [&](uint32_t i) {
+    return runSteps(ctx, program->instructions[i], &steps[static_cast<std::size_t>(i) * kMaxSteps], step_count[i],
+                    buffers);
+  };
+
+  std::vector<uint32_t> parallel;
+  std::vector<uint32_t> serial;
+  for (const std::vector<uint32_t> &wave : wavefronts(*program)) {
+    parallel.clear();
+    serial.clear();
+    for (uint32_t i : wave)
+      (thread_safe[i] ? parallel : serial).push_back(i);
+
+    // Earliest failing instruction wins, so the reported status does not
+    // depend on thread timing.
+    std::atomic<uint32_t> failed_at{std::numeric_limits<uint32_t>::max()};
+    std::vector<int> status(parallel.size(), 0);
+    pool.parallelFor(static_cast<uint32_t>(parallel.size()), [&](uint32_t k) {
+      status[k] = run(parallel[k]);
+      if (status[k] != 0) {
+        uint32_t prev = failed_at.load();
+        while (parallel[k] < prev && !failed_at.compare_exchange_weak(prev, parallel[k])) {
+        }
+      }
+    });
+    if (failed_at.load() != std::numeric_limits<uint32_t>::max()) {
+      for (std::size_t k = 0; k < parallel.size(); ++k) {
+        if (parallel[k] == failed_at.load())
+          return status[k];
+      }
+    }
+
+    for (uint32_t i : serial) {
+      const int rc = run(i);
+      if (rc != 0)
+        return rc;
+    }
+  }
+  return 0;
+}
+
+int FhnDefaultExecutor::executeBatch(FhnBackendCtx *ctx, const FhnProgram *program, FhnBuffer ***tables,
+                                     uint32_t n) {
+  if (!program || (n > 0 && !tables))
+    return -1;
+  if (program->version != FHN_ABI_VERSION)
+    return -1;
+
+  const uint32_t count = program->num_instructions;
+  const std::vector<int64_t> levels = instructionLevels(*program);
+  std::vector<FhnKernelStep> steps(static_cast<std::size_t>(count) * kMaxSteps);
+  std::vector<uint32_t> step_count(count, 0);
+  for (uint32_t i = 0; i < count; ++i) {
+    step_count[i] = resolve(program->instructions[i], &steps[static_cast<std::size_t>(i) * kMaxSteps],
+                            levels.empty() ? -1 : levels[i]);
+    if (step_count[i] == 0)
+      return -1;
+  }
+
+  // Per-request operand rows and results, rebuilt for every step.
+  std::vector<const FhnBuffer *> operands(static_cast<std::size_t>(n) * 4, nullptr);
+  std::vector<FhnBuffer *> results(n, nullptr);
+  for (uint32_t i = 0; i < count; ++i) {
+    const FhnInstruction &inst = program->instructions[i];
+    for (uint32_t s = 0; s < step_count[i]; ++s) {
+      const FhnKernelStep &st = steps[static_cast<std::size_t>(i) * kMaxSteps + s];
+      for (uint32_t r = 0; r < n; ++r) {
+        FhnBuffer **buffers = tables[r];
+        results[r] = buffers[st.result_id];
+        for (uint32_t j = 0; j < 4; ++j)
+          operands[static_cast<std::size_t>(r) * 4 + j] = st.operands[j] != 0 ? buffers[st.operands[j]] : nullptr;
+      }
+
+      if (FhnBatchKernelFn batched = batchKernel(st.opcode)) {
+        const int rc = batched(ctx, n, results.data(), operands.data(), inst.params, inst.fparams);
+        if (rc != 0)
+          return rc;
+        continue;
+      }
+      for (uint32_t r = 0; r < n; ++r) {
+        const int rc = st.fn(ctx, results[r], &operands[static_cast<std::size_t>(r) * 4], inst.params, inst.fparams);
+        if (rc != 0)
+          return rc;
+      }
+    }
+  }
+  return 0;
+}
+
+int FhnDefaultExecutor::executePipelined(const FhnAsyncHooks &hooks, const FhnProgram *program, uint32_t num_batches,
+                                         const FhnPrepareFn &prepare, const FhnConsumeFn &consume) {
+  if (!program || !hooks.available() || !prepare || !consume)
+    return -1;
+  if (program->version != FHN_ABI_VERSION)
+    return -1;
+
+  // Double-buffered input slots: batch b uses slots[b % 2], which batch
+  // b - 2 released before b is prepared.
+  struct Slot {
+    std::vector<FhnBuffer *> inputs;
+    FhnExecHandle *handle = nullptr;
+  };
+  Slot slots[2];
+  for (Slot &slot : slots)
+    slot.inputs.assign(program->num_inputs, nullptr);
+
+  auto release = [&](uint32_t batch, FhnBuffer **outputs) {
+    Slot &slot = slots[batch % 2];
+    consume(batch, slot.inputs.data(), outputs);
+    std::fill(slot.inputs.begin(), slot.inputs.end(), nullptr);
+  };
+  // Wait for an in-flight batch, hand it to consume, free its handle.
+  auto finish = [&](uint32_t batch) {
+    Slot &slot = slots[batch % 2];
+    int rc = hooks.wait(slot.handle);
+    FhnBuffer **outputs = nullptr;
+    if (rc == 0) {
+      uint32_t count = 0;
+      outputs = hooks.get_outputs(slot.handle, &count);
+      if (outputs && count != program->num_outputs) {
+        for (uint32_t k = 0; k < count; ++k)
+          hooks.buffer_free(hooks.ctx, outputs[k]);
+        outputs = nullptr;
+      }
+      if (!outputs)
+        rc = -1;
+    }
+    release(batch, outputs);
+    hooks.exec_free(slot.handle);
+    slot.handle = nullptr;
+    return rc;
+  };
+
+  uint32_t next_finish = 0;
+  for (uint32_t b = 0; b < num_batches; ++b) {
+    Slot &slot = slots[b % 2];
+    int rc = prepare(b, slot.inputs.data());
+    if (rc == 0) {
+      slot.handle = hooks.submit(hooks.ctx, program, slot.inputs.data(), program->num_inputs);
+      if (!slot.handle)
+        rc = -1;
+    }
+    if (rc != 0) {
+      while (next_finish < b)
+        finish(next_finish++);
+      release(b, nullptr);
+      return rc;
+    }
+    // Batch b is queued behind b - 1: collect b - 1 while b runs.
+    if (b > 0) {
+      rc = finish(next_finish++);
+      if (rc != 0) {
+        while (next_finish <= b)
+          finish(next_finish++);
+        return rc;
+      }
+    }
+  }
+
+  int error = 0;
+  while (next_finish < num_batches) {
+    const int rc = finish(next_finish++);
+    if (rc != 0 && error == 0)
+      error = rc;
   }
+  return error;
 }
 
 } // namespace fhenomenon
@@ -0,0 +1,150 @@
+#include "FHN/FhnFusionPass.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fhenomenon {
+
+namespace {
+
+constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+} // namespace
+
+FhnProgram *FhnFusionPass::run(const FhnDefaultExecutor &executor, const FhnProgram &program,
+                               const std::vector<uint32_t> &preserved, Stats *stats) {
+  if (program.version != FHN_ABI_VERSION)
+    return nullptr;
+
+  // Def-use over value versions: an id may be overwritten, so uses are
+  // counted per defining instruction, and every operand remembers which
+  // instruction produced the version it reads (kNone = program input).
+  const uint32_t n = program.num_instructions;
+  std::vector<uint32_t> uses(n, 0);
+  std::vector<std::array<uint32_t, 4>> source(n);
+  std::unordered_map<uint32_t, uint32_t> current;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> writers; // ascending
+  for (uint32_t i = 0; i < n; ++i) {
+    const FhnInstruction &inst = program.instructions[i];
+    for (std::size_t k = 0; k < 4; ++k) {
+      source[i][k] = kNone;
+      if (inst.operands[k] == 0)
+        continue;
+      auto it = current.find(inst.operands[k]);
+      if (it != current.end()) {
+        source[i][k] = it->second;
+        ++uses[it->second];
+      }
+    }
+    current[inst.result_id] = i;
+    writers[inst.result_id].push_back(i);
+  }
+  std::vector<char> final_def(n, 0);
+  for (const auto &[id, i] : current) {
+    (void)id;
+    final_def[i] = 1;
+  }
+  std::unordered_set<uint32_t> kept(preserved.begin(), preserved.end());
+  kept.insert(program.output_ids, program.output_ids + program.num_outputs);
+
+  auto written_between = [&](uint32_t id, uint32_t after, uint32_t before) {
+    auto it = writers.find(id);
+    if (it == writers.end())
+      return false;
+    auto next = std::upper_bound(it->second.begin(), it->second.end(), after);
+    return next != it->second.end() && *next < before;
+  };
+
+  std::vector<FhnInstruction> insts(program.instructions, program.instructions + n);
+  std::vector<char> removed(n, 0);
+
+  // The instruction producing operand k of `reader` if it is an `op` whose
+  // value nothing else reads and whose operands still hold the same values
+  // at `consumer`, where the fused instruction will run; else kNone.
+  auto producer = [&](uint32_t reader, std::size_t k, FhnOpCode op, uint32_t consumer) {
+    const uint32_t p = source[reader][k];
+    if (p == kNone || removed[p] || insts[p].opcode != op || uses[p] != 1)
+      return kNone;
+    if (final_def[p] && kept.count(insts[p].result_id))
+      return kNone;
+    for (uint32_t id : insts[p].operands) {
+      if (id != 0 && written_between(id, p, consumer))
+        return kNone;
+    }
+    return p;
+  };
+
+  Stats local;
+  // Only fuse into kernels the executor would actually call: under cost
+  // estimates a fused kernel may lose to its own decomposition.
+  auto fusable = [&](FhnOpCode op) { return executor.kernel(op) != nullptr && !executor.prefersDecomposition(op); };
+  const bool has_hrot_add = fusable(FHN_HROT_ADD);
+  const bool has_mad = fusable(FHN_MAD);
+  const bool has_hmult = fusable(FHN_HMULT);
+
+  for (uint32_t j = 0; j < n; ++j) {
+    FhnInstruction &inst = insts[j];
+    if (inst.opcode == FHN_ADD_CC && inst.operands[2] == 0 && inst.operands[3] == 0) {
+      for (std::size_t k = 0; k < 2; ++k) {
+        const uint32_t addend = inst.operands[1 - k];
+        if (addend == 0 || addend == inst.result_id)
+          break;
+        uint32_t p = has_hrot_add ? producer(j, k, FHN_ROTATE, j) : kNone;
+        if (p != kNone) {
+          const FhnInstruction &rot = insts[p];
+          inst.opcode = FHN_HROT_ADD;
+          inst.operands[0] = rot.operands[0];
+          inst.operands[1] = addend;
+          std::copy(std::begin(rot.params), std::end(rot.params), std::begin(inst.params));
+          removed[p] = 1;
+          ++local.hrot_add;
+          break;
+        }
+        p = has_mad ? producer(j, k, FHN_MULT_CS, j) : kNone;
+        if (p != kNone) {
+          const FhnInstruction &mul = insts[p];
+          inst.opcode = FHN_MAD;
+          inst.operands[0] = mul.operands[0];
+          inst.operands[1] = addend;
+          inst.fparams[0] = mul.fparams[0];
+          removed[p] = 1;
+          ++local.mad;
+          break;
+        }
+      }
+    } else if (inst.opcode == FHN_RESCALE && has_hmult) {
+      const uint32_t relin = producer(j, 0, FHN_RELINEARIZE, j);
+      const uint32_t mult = relin == kNone ? kNone : producer(relin, 0, FHN_MULT_CC, j);
+      if (mult != kNone) {
+        const FhnInstruction &mul = insts[mult];
+        inst.opcode = FHN_HMULT;
+        std::copy(std::begin(mul.operands), std::end(mul.operands), std::begin(inst.operands));
+        std::copy(std::begin(mul.params), std::end(mul.params), std::begin(inst.params));
+        removed[relin] = 1;
+        removed[mult] = 1;
+        ++local.hmult;
+      }
+    }
+  }
+
+  const auto kept_count = static_cast<uint32_t>(std::count(removed.begin(), removed.end(), 0));
+  FhnProgram *out = fhn_program_alloc(kept_count, program.num_inputs, program.num_outputs);
+  if (!out)
+    return nullptr;
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    if (!removed[i])
+      out->instructions[next++] = insts[i];
+  }
+  std::copy(program.input_ids, program.input_ids + program.num_inputs, out->input_ids);
+  std::copy(program.output_ids, program.output_ids + program.num_outputs, out->output_ids);
+  if (stats)
+    *stats = local;
+  return out;
+}
+
+} // namespace fhenomenon
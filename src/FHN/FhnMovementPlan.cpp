@@ -1,60 +1,154 @@
 #include "FHN/FhnMovementPlan.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <functional>
 #include <limits>
-#include <set>
-#include <unordered_map>
-#include <unordered_set>
+#include <string>
+#include <utility>
 
 namespace fhenomenon {
 
+namespace {
+
+// Rematerialization without a cost table: linear ops whose recomputation
+// is far cheaper than any host round trip of a ciphertext.
+bool cheapToRecompute(FhnOpCode op) {
+  switch (op) {
+  case FHN_ADD_CC:
+  case FHN_ADD_CP:
+  case FHN_ADD_CS:
+  case FHN_SUB_CC:
+  case FHN_SUB_CP:
+  case FHN_SUB_SC:
+  case FHN_NEGATE:
+  case FHN_MULT_CP:
+  case FHN_MULT_CS:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Drops the entries a pass cancelled (zeroed ids) from an action table's
+// rows, keeping the rest in order.
+template <typename Table> void dropCancelled(Table &table) {
+  uint32_t kept = 0;
+  uint32_t begin = 0;
+  for (std::size_t i = 1; i < table.offsets.size(); ++i) {
+    const uint32_t end = table.offsets[i];
+    for (uint32_t k = begin; k < end; ++k)
+      if (table.items[k] != 0)
+        table.items[kept++] = table.items[k];
+    begin = end;
+    table.offsets[i] = kept;
+  }
+  table.items.resize(kept);
+}
+
+// Fills an action table from (instruction, action) entries listed out of
+// instruction order; entries of one instruction keep their listed order.
+template <typename Table, typename T>
+void fillRows(Table &table, uint32_t n, std::vector<std::pair<uint32_t, T>> &entries) {
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const std::pair<uint32_t, T> &a, const std::pair<uint32_t, T> &b) { return a.first < b.first; });
+  for (const auto &[i, item] : entries)
+    table.push(i, item);
+  table.seal(n);
+}
+
+} // namespace
+
 std::optional<FhnMovementPlan> FhnMovementPlan::analyze(const FhnProgram &program, const std::vector<uint32_t> &pinned,
                                                         uint64_t device_budget, FhnEvictionPolicy policy,
-                                                        const FhnLevelModel *model) {
+                                                        const FhnLevelModel *model, const FhnPlanOptions &options) {
+  constexpr int64_t kUndefined = -2;
   constexpr int64_t kBeforeProgram = -1;
   constexpr int64_t kNever = std::numeric_limits<int64_t>::max();
+  const uint32_t n = program.num_instructions;
+
+  // Per-id state is indexed by id, up to the largest defined one: the
+  // buffer table size callers allocate anyway.
+  uint32_t max_id = 0;
+  for (uint32_t k = 0; k < program.num_inputs; ++k)
+    max_id = std::max(max_id, program.input_ids[k]);
+  for (uint32_t i = 0; i < n; ++i)
+    max_id = std::max(max_id, program.instructions[i].result_id);
+  const std::size_t num_ids = static_cast<std::size_t>(max_id) + 1;
 
   // Definitions: inputs are defined before the program; each instruction
   // defines its (single-assignment) result id.
-  std::unordered_map<uint32_t, int64_t> def_pos;
-  for (uint32_t i = 0; i < program.num_inputs; ++i) {
-    const uint32_t id = program.input_ids[i];
-    if (id == 0 || !def_pos.emplace(id, kBeforeProgram).second)
+  std::vector<int64_t> def_pos(num_ids, kUndefined);
+  auto def_of = [&](uint32_t id) { return id <= max_id ? def_pos[id] : kUndefined; };
+  for (uint32_t k = 0; k < program.num_inputs; ++k) {
+    const uint32_t id = program.input_ids[k];
+    if (id == 0 || def_pos[id] != kUndefined)
       return std::nullopt;
+    def_pos[id] = kBeforeProgram;
   }
-  for (uint32_t i = 0; i < program.num_instructions; ++i) {
+  for (uint32_t i = 0; i < n; ++i) {
     const uint32_t id = program.instructions[i].result_id;
-    if (id == 0 || !def_pos.emplace(id, static_cast<int64_t>(i)).second)
+    if (id == 0 || def_pos[id] != kUndefined)
+      return std::nullopt;
+    def_pos[id] = static_cast<int64_t>(i);
+  }
+
+  // Peer copies send instruction results and receive inputs.
+  for (const auto &[id, devices] : options.peer_sends) {
+    if (def_of(id) < 0)
+      return std::nullopt;
+  }
+  for (const auto &[id, device] : options.peer_receives) {
+    if (def_of(id) != kBeforeProgram || n == 0)
       return std::nullopt;
   }
 
-  // Uses, ascending per id by construction. Every use must be after a def.
-  std::unordered_map<uint32_t, std::vector<int64_t>> uses;
-  for (uint32_t i = 0; i < program.num_instructions; ++i) {
+  // Uses. Every use must be after a def. The next-use chain links each
+  // operand slot to its id's following use: chain[4 * i + j] is the first
+  // use of operands[j] after instruction i, and next_use[id] — advanced as
+  // the plan walks the program — the first use at or after the current
+  // instruction.
+  std::vector<int64_t> last_use(num_ids, kBeforeProgram); // kBeforeProgram: never used
+  for (uint32_t i = 0; i < n; ++i) {
     const FhnInstruction &inst = program.instructions[i];
-    for (int j = 0; j < 4; ++j) {
+    for (std::size_t j = 0; j < 4; ++j) {
       const uint32_t id = inst.operands[j];
       if (id == 0)
         continue;
-      auto it = def_pos.find(id);
-      if (it == def_pos.end() || it->second >= static_cast<int64_t>(i))
+      const int64_t def = def_of(id);
+      if (def == kUndefined || def >= static_cast<int64_t>(i))
         return std::nullopt;
-      uses[id].push_back(static_cast<int64_t>(i));
+      last_use[id] = static_cast<int64_t>(i);
+    }
+  }
+  std::vector<int64_t> next_use(num_ids, kNever);
+  std::vector<int64_t> chain(static_cast<std::size_t>(n) * 4, kNever);
+  for (uint32_t i = n; i-- > 0;) {
+    const FhnInstruction &inst = program.instructions[i];
+    for (std::size_t j = 0; j < 4; ++j) {
+      if (inst.operands[j] != 0)
+        chain[4 * static_cast<std::size_t>(i) + j] = next_use[inst.operands[j]];
+    }
+    for (std::size_t j = 0; j < 4; ++j) {
+      if (inst.operands[j] != 0)
+        next_use[inst.operands[j]] = static_cast<int64_t>(i);
     }
   }
 
   // Level inference: ids are single-assignment, so every id's level is
   // static and can be computed once, up front. Only runs in byte mode.
-  std::unordered_map<uint32_t, int64_t> level_of;
+  std::vector<int64_t> level_of;
   if (model) {
     if (model->fresh_level < 0 || model->bytes_by_level.size() < static_cast<size_t>(model->fresh_level) + 1)
       return std::nullopt;
     for (uint64_t b : model->bytes_by_level)
       if (b == 0)
         return std::nullopt;
+    level_of.assign(num_ids, 0);
     for (uint32_t i = 0; i < program.num_inputs; ++i)
       level_of[program.input_ids[i]] = model->fresh_level;
-    for (uint32_t i = 0; i < program.num_instructions; ++i) {
+    for (uint32_t i = 0; i < n; ++i) {
       const FhnInstruction &inst = program.instructions[i];
       auto eff = model->effects.find(static_cast<int>(inst.opcode));
       if (eff == model->effects.end())
@@ -62,7 +156,7 @@ std::optional<FhnMovementPlan> FhnMovementPlan::analyze(const FhnProgram &progra
       int64_t min_level = model->fresh_level;
       for (int j = 0; j < 4; ++j)
         if (inst.operands[j] != 0)
-          min_level = std::min(min_level, level_of.at(inst.operands[j]));
+          min_level = std::min(min_level, level_of[inst.operands[j]]);
       int64_t result_level = min_level;
       switch (eff->second) {
       case FHN_LEVEL_PRESERVE:
@@ -87,48 +181,201 @@ std::optional<FhnMovementPlan> FhnMovementPlan::analyze(const FhnProgram &progra
     }
   }
 
+  // Level reductions ahead of evictions: the level each use of an operand
+  // needs (the lowest among its operands, or LEVEL_DOWN's target), as a
+  // maximum over the rest of the operand's uses — need_from[4 * i + j]
+  // covers the uses of operands[j] at instruction i and after.
+  const bool lower_before_evict = model && options.level_down_before_evict;
+  std::vector<int64_t> need_from;
+  std::vector<int64_t> level_now; // by id, as reductions apply
+  if (lower_before_evict) {
+    need_from.assign(static_cast<std::size_t>(n) * 4, 0);
+    std::vector<int64_t> rolling(num_ids, 0);
+    for (uint32_t i = n; i-- > 0;) {
+      const FhnInstruction &inst = program.instructions[i];
+      int64_t need = model->fresh_level;
+      if (model->effects.at(static_cast<int>(inst.opcode)) == FHN_LEVEL_SET_PARAM0) {
+        need = inst.params[0];
+      } else {
+        for (std::size_t j = 0; j < 4; ++j)
+          if (inst.operands[j] != 0)
+            need = std::min(need, level_of[inst.operands[j]]);
+      }
+      for (std::size_t j = 0; j < 4; ++j) {
+        if (inst.operands[j] != 0) {
+          int64_t &r = rolling[inst.operands[j]];
+          r = std::max(r, need);
+          need_from[4 * static_cast<std::size_t>(i) + j] = r;
+        }
+      }
+    }
+    level_now = level_of;
+  }
+
   // Unit cost of holding an id resident: bytes in byte mode, 1 in slot
   // mode — this single function keeps the no-model path bit-identical.
   auto cost = [&](uint32_t id) -> uint64_t {
-    return model ? model->bytes_by_level[static_cast<size_t>(level_of.at(id))] : 1;
+    return model ? model->bytes_by_level[static_cast<size_t>(level_of[id])] : 1;
   };
 
-  const std::unordered_set<uint32_t> pinned_set(pinned.begin(), pinned.end());
+  std::vector<char> is_pinned(num_ids, 0);
+  for (uint32_t id : pinned) {
+    if (id <= max_id)
+      is_pinned[id] = 1;
+  }
 
-  // First use strictly after position `pos` (kNever if none).
-  auto next_use_after = [&uses](uint32_t id, int64_t pos) -> int64_t {
-    auto it = uses.find(id);
-    if (it == uses.end())
-      return kNever;
-    const auto &v = it->second;
-    auto p = std::upper_bound(v.begin(), v.end(), pos);
-    return p == v.end() ? kNever : *p;
+  FhnMovementPlan plan;
+  plan.instruction_count_ = n;
+  if (model) {
+    plan.byte_class_.assign(num_ids, 0);
+    for (uint32_t id = 1; id <= max_id; ++id) {
+      if (def_pos[id] != kUndefined)
+        plan.byte_class_[id] = cost(id);
+    }
+  }
+  std::vector<char> resident(num_ids, 0);
+  uint32_t resident_count = 0;
+  uint64_t resident_units = 0;                 // Σ cost(id) for resident ids — bytes in byte mode, else count
+  std::vector<int64_t> last_touch(num_ids, -1); // position of most recent def/prefetch/use
+  auto enter = [&](uint32_t id) {
+    resident[id] = 1;
+    ++resident_count;
+    resident_units += cost(id);
+  };
+  auto leave = [&](uint32_t id) {
+    resident[id] = 0;
+    --resident_count;
+    resident_units -= cost(id);
   };
 
-  FhnMovementPlan plan;
-  plan.actions_.resize(program.num_instructions);
-  std::set<uint32_t> resident;                      // ordered: deterministic Belady tie-break on lower id
-  uint64_t resident_units = 0;                      // Σ cost(id) for id in resident — bytes in byte mode, else count
-  std::unordered_map<uint32_t, int64_t> last_touch; // position of most recent def/prefetch/use
+  // Rematerialization state: discarded ids, the live operands each pending
+  // recomputation relies on (never discarded themselves), and the extra
+  // working-set members those operands add at the recomputing instruction
+  // — a list per position threaded through flat arrays: support_head by
+  // position, support_next and support_id by entry.
+  constexpr uint32_t kNoSupport = std::numeric_limits<uint32_t>::max();
+  std::vector<char> discarded(num_ids, 0);
+  std::vector<uint32_t> supporting(num_ids, 0);
+  std::vector<uint32_t> support_head(options.rematerialize ? n : 0, kNoSupport);
+  std::vector<uint32_t> support_next;
+  std::vector<uint32_t> support_id;
+
+  // Distinct operands of the instruction at pos, ascending.
+  auto operands_of = [&program](int64_t pos, std::vector<uint32_t> &ids) {
+    const FhnInstruction &inst = program.instructions[static_cast<std::size_t>(pos)];
+    ids.clear();
+    for (std::size_t j = 0; j < 4; ++j)
+      if (inst.operands[j] != 0)
+        ids.push_back(inst.operands[j]);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  };
+  // Its working set: result, operands and any operands of discarded values
+  // recomputed there; ascending.
+  auto working_at = [&](int64_t pos, std::vector<uint32_t> &ids) {
+    operands_of(pos, ids);
+    ids.push_back(program.instructions[static_cast<std::size_t>(pos)].result_id);
+    if (!support_id.empty()) {
+      for (uint32_t e = support_head[static_cast<std::size_t>(pos)]; e != kNoSupport; e = support_next[e])
+        ids.push_back(support_id[e]);
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  };
+  auto contains = [](const std::vector<uint32_t> &ids, uint32_t id) {
+    return std::binary_search(ids.begin(), ids.end(), id);
+  };
 
-  for (uint32_t i = 0; i < program.num_instructions; ++i) {
+  // Whether evicting `id` (next used at `reuse`) should instead discard it
+  // and recompute it there; see FhnPlanOptions::rematerialize.
+  std::vector<uint32_t> deps;
+  std::vector<uint32_t> reuse_working;
+  auto should_discard = [&](uint32_t id, int64_t reuse) {
+    if (!options.rematerialize || reuse == kNever || is_pinned[id] || supporting[id] > 0)
+      return false;
+    const int64_t def = def_pos[id];
+    if (def < 0)
+      return false; // inputs have nothing to re-run
+    const FhnInstruction &d = program.instructions[static_cast<std::size_t>(def)];
+    operands_of(def, deps);
+    for (uint32_t o : deps)
+      if (discarded[o] || (!is_pinned[o] && last_use[o] < reuse))
+        return false; // operand gone (or going) by the reuse
+    if (options.remat_costs) {
+      const FhnKernelCostTable &table = *options.remat_costs;
+      const FhnKernelCost *est = nullptr;
+      for (uint32_t k = 0; k < table.num_costs && !est; ++k)
+        if (table.costs[k].opcode == d.opcode)
+          est = &table.costs[k];
+      if (!est)
+        return false;
+      int64_t level = 0;
+      if (model) {
+        level = model->fresh_level;
+        for (uint32_t o : deps)
+          level = std::min(level, level_of[o]);
+      }
+      const double recompute_ns = est->base_ns + est->per_level_ns * static_cast<double>(level);
+      if (recompute_ns >= 2.0 * static_cast<double>(cost(id)) * options.transfer_ns_per_unit)
+        return false;
+    } else if (!cheapToRecompute(d.opcode)) {
+      return false;
+    }
+    working_at(reuse, reuse_working);
+    reuse_working.insert(reuse_working.end(), deps.begin(), deps.end());
+    std::sort(reuse_working.begin(), reuse_working.end());
+    reuse_working.erase(std::unique(reuse_working.begin(), reuse_working.end()), reuse_working.end());
+    uint64_t units = 0;
+    for (uint32_t w : reuse_working)
+      units += cost(w);
+    return units <= device_budget;
+  };
+
+  // Eviction candidates (budgeted plans only): a max-heap of residents
+  // keyed by next use (Belady) or by staleness of the last touch (Lru),
+  // ties to the lower id. Keys only change for an instruction's working
+  // set, which is re-pushed after it; an entry is current while its id is
+  // resident and its stamp is the id's latest. Stale entries are dropped as
+  // they surface, or swept once they outnumber the residents.
+  struct Victim {
+    int64_t key;
+    uint32_t id;
+    uint32_t stamp;
+  };
+  auto lower = [](const Victim &a, const Victim &b) { return a.key < b.key || (a.key == b.key && a.id > b.id); };
+  std::vector<Victim> heap;
+  std::vector<Victim> held; // current entries of the working set, popped while looking past them
+  std::vector<uint32_t> stamp(device_budget > 0 ? num_ids : 0, 0);
+  auto is_current = [&](const Victim &v) { return resident[v.id] && stamp[v.id] == v.stamp; };
+  auto push_victim = [&](uint32_t id) {
+    const int64_t key = policy == FhnEvictionPolicy::Belady ? next_use[id] : -last_touch[id];
+    heap.push_back({key, id, ++stamp[id]});
+    std::push_heap(heap.begin(), heap.end(), lower);
+  };
+
+  std::vector<uint32_t> operand_set;
+  std::vector<uint32_t> working;
+  std::vector<uint32_t> to_recompute;
+  std::vector<uint32_t> to_prefetch;
+  for (uint32_t i = 0; i < n; ++i) {
     const FhnInstruction &inst = program.instructions[i];
-    FhnMovementActions &act = plan.actions_[i];
     const int64_t pos = static_cast<int64_t>(i);
 
-    std::set<uint32_t> working;
-    working.insert(inst.result_id);
-    std::set<uint32_t> operand_set;
-    for (int j = 0; j < 4; ++j)
-      if (inst.operands[j] != 0) {
-        working.insert(inst.operands[j]);
-        operand_set.insert(inst.operands[j]);
-      }
+    // Working set: result, operands and any operands of discarded values
+    // recomputed here.
+    operands_of(pos, operand_set);
+    working_at(pos, working);
 
-    std::vector<uint32_t> to_prefetch;
-    for (uint32_t id : operand_set)
-      if (!resident.count(id))
+    to_recompute.clear();
+    to_prefetch.clear();
+    for (uint32_t id : working) {
+      if (id == inst.result_id || resident[id])
+        continue;
+      if (discarded[id])
+        to_recompute.push_back(id);
+      else
         to_prefetch.push_back(id);
+    }
 
     if (device_budget > 0) {
       uint64_t working_units = 0;
@@ -139,90 +386,704 @@ std::optional<FhnMovementPlan> FhnMovementPlan::analyze(const FhnProgram &progra
       // Belady: make room for the result alloc + missing operands by
       // evicting residents (outside the working set) whose next use is
       // farthest; kNever (no future use) sorts farthest of all, and the
-      // ordered set breaks ties on the lower id.
+      // heap breaks ties on the lower id.
       uint64_t incoming_units = cost(inst.result_id);
       for (uint32_t id : to_prefetch)
         incoming_units += cost(id);
+      for (uint32_t id : to_recompute)
+        incoming_units += cost(id);
       while (resident_units + incoming_units > device_budget) {
         bool found = false;
         uint32_t victim = 0;
-        int64_t victim_key = 0;
-        for (uint32_t id : resident) {
-          if (working.count(id))
+        held.clear();
+        while (!found && !heap.empty()) {
+          std::pop_heap(heap.begin(), heap.end(), lower);
+          const Victim top = heap.back();
+          heap.pop_back();
+          if (!is_current(top))
+            continue;
+          if (contains(working, top.id)) {
+            held.push_back(top);
             continue;
-          if (policy == FhnEvictionPolicy::Belady) {
-            const int64_t nu = next_use_after(id, pos - 1);
-            if (!found || nu > victim_key) {
-              found = true;
-              victim = id;
-              victim_key = nu;
-            }
-          } else { // Lru: oldest last touch wins; strict < keeps the lower id on ties
-            const int64_t lt = last_touch.count(id) ? last_touch.at(id) : -1;
-            if (!found || lt < victim_key) {
-              found = true;
-              victim = id;
-              victim_key = lt;
-            }
           }
+          found = true;
+          victim = top.id;
+        }
+        for (const Victim &v : held) {
+          heap.push_back(v);
+          std::push_heap(heap.begin(), heap.end(), lower);
         }
         if (!found)
           return std::nullopt; // working set already fills the device
-        act.evict.push_back(victim);
-        resident.erase(victim);
-        resident_units -= cost(victim);
-        plan.stats_.evict_count++;
+        const int64_t reuse = next_use[victim]; // not used here: its first use after pos
+        if (should_discard(victim, reuse)) {
+          plan.discard_.push(i, victim);
+          discarded[victim] = 1;
+          working_at(reuse, reuse_working);
+          operands_of(def_pos[victim], deps);
+          for (uint32_t o : deps) {
+            ++supporting[o];
+            if (!contains(reuse_working, o)) {
+              uint32_t &head = support_head[static_cast<std::size_t>(reuse)];
+              support_next.push_back(head);
+              support_id.push_back(o);
+              head = static_cast<uint32_t>(support_id.size() - 1);
+            }
+          }
+        } else {
+          if (lower_before_evict && reuse != kNever && !is_pinned[victim] && supporting[victim] == 0) {
+            const FhnInstruction &use = program.instructions[static_cast<std::size_t>(reuse)];
+            const std::size_t j = static_cast<std::size_t>(
+              std::find(std::begin(use.operands), std::end(use.operands), victim) - std::begin(use.operands));
+            const int64_t need = need_from[4 * static_cast<std::size_t>(reuse) + j];
+            const auto &bytes = model->bytes_by_level;
+            if (need < level_now[victim] &&
+                bytes[static_cast<std::size_t>(need)] < bytes[static_cast<std::size_t>(level_now[victim])]) {
+              plan.level_down_.push(i, {victim, need});
+              level_now[victim] = need;
+              plan.stats_.level_down_count++;
+            }
+          }
+          plan.evict_.push(i, victim);
+          plan.stats_.evict_count++;
+        }
+        leave(victim);
       }
     }
 
-    act.alloc.push_back(inst.result_id);
-    resident.insert(inst.result_id);
-    resident_units += cost(inst.result_id);
+    plan.alloc_.push(i, inst.result_id);
+    enter(inst.result_id);
     last_touch[inst.result_id] = pos;
     plan.stats_.alloc_count++;
 
     for (uint32_t id : to_prefetch) {
-      act.prefetch.push_back(id);
-      resident.insert(id);
-      resident_units += cost(id);
+      plan.prefetch_.push(i, id);
+      enter(id);
       last_touch[id] = pos;
       plan.stats_.prefetch_count++;
     }
 
-    plan.stats_.high_water = std::max(plan.stats_.high_water, static_cast<uint32_t>(resident.size()));
+    for (uint32_t id : to_recompute) {
+      const int64_t def = def_pos[id];
+      plan.recompute_.push(i, static_cast<uint32_t>(def));
+      discarded[id] = 0;
+      operands_of(def, deps);
+      for (uint32_t o : deps)
+        --supporting[o];
+      enter(id);
+      last_touch[id] = pos;
+      plan.stats_.recompute_count++;
+    }
+
+    plan.stats_.high_water = std::max(plan.stats_.high_water, resident_count);
     if (model)
       plan.stats_.high_water_bytes = std::max(plan.stats_.high_water_bytes, resident_units);
 
-    // Touch every operand for LRU tracking.
+    // Touch every operand for LRU tracking, and advance its next use.
     for (uint32_t id : operand_set)
       last_touch[id] = pos;
+    for (std::size_t j = 0; j < 4; ++j) {
+      if (inst.operands[j] != 0)
+        next_use[inst.operands[j]] = chain[4 * static_cast<std::size_t>(i) + j];
+    }
 
     // Free everything whose last use has passed: operands with no later
     // use, and a result nothing ever reads.
     for (uint32_t id : working) {
-      if (pinned_set.count(id))
+      if (is_pinned[id] || next_use[id] != kNever)
         continue;
-      const bool dead = (id == inst.result_id) ? (uses.find(id) == uses.end()) : (next_use_after(id, pos) == kNever);
-      if (dead) {
-        act.free.push_back(id);
-        resident.erase(id);
-        resident_units -= cost(id);
+      plan.free_.push(i, id);
+      leave(id);
+    }
+
+    if (device_budget > 0) {
+      for (uint32_t id : working) {
+        if (resident[id])
+          push_victim(id);
+      }
+      if (heap.size() > 2 * static_cast<std::size_t>(resident_count) + 64) {
+        heap.erase(std::remove_if(heap.begin(), heap.end(), [&](const Victim &v) { return !is_current(v); }),
+                   heap.end());
+        std::make_heap(heap.begin(), heap.end(), lower);
       }
     }
   }
 
   // Epilogue: unused, unpinned inputs were never resident but their
   // lifetime still belongs to the plan — release them at the end.
-  if (program.num_instructions > 0) {
-    FhnMovementActions &last = plan.actions_[program.num_instructions - 1];
+  if (n > 0) {
     for (uint32_t k = 0; k < program.num_inputs; ++k) {
       const uint32_t id = program.input_ids[k];
-      if (!pinned_set.count(id) && uses.find(id) == uses.end())
-        last.free.push_back(id);
+      if (!is_pinned[id] && last_use[id] == kBeforeProgram)
+        plan.free_.push(n - 1, id);
     }
   }
+  for (ActionTable<uint32_t> *table :
+       {&plan.evict_, &plan.discard_, &plan.alloc_, &plan.prefetch_, &plan.recompute_, &plan.free_})
+    table->seal(n);
+  plan.level_down_.seal(n);
+
+  // Lookahead: replay the actions for each instruction's peak residency
+  // (after its pre-instruction actions, before its frees), then hoist each
+  // prefetch, in program order, to the earliest of the prefetch_lookahead
+  // preceding instructions it fits across. The copy is in flight while the
+  // instructions in between run; the use fences it.
+  if (options.prefetch_lookahead > 0) {
+    struct Candidate {
+      uint32_t use;
+      uint32_t id;
+      uint32_t lo; // first instruction after the id's last eviction (inputs: 0; received: n, never hoisted)
+    };
+    std::vector<Candidate> candidates;
+    std::vector<uint32_t> count_at(n, 0);
+    std::vector<uint64_t> units_at(n, 0);
+    std::vector<uint32_t> evicted_before(num_ids, 0);
+    std::vector<char> live(num_ids, 0);
+    uint32_t live_count = 0;
+    uint64_t live_units = 0;
+    auto enter_live = [&](uint32_t id) {
+      if (!live[id]) {
+        live[id] = 1;
+        ++live_count;
+        live_units += cost(id);
+      }
+    };
+    auto leave_live = [&](uint32_t id) {
+      if (live[id]) {
+        live[id] = 0;
+        --live_count;
+        live_units -= cost(id);
+      }
+    };
+    // A received input's first prefetch stays at its use: the receive
+    // precedes it, and hoisted it would wait on the peer ahead of sends
+    // this device makes in between, which the peer may be waiting on.
+    for (const auto &[id, device] : options.peer_receives)
+      evicted_before[id] = n;
+    for (uint32_t i = 0; i < n; ++i) {
+      const FhnMovementActions act = plan.at(i);
+      for (uint32_t id : act.evict) {
+        leave_live(id);
+        evicted_before[id] = i + 1;
+      }
+      for (uint32_t id : act.discard)
+        leave_live(id);
+      for (uint32_t id : act.alloc)
+        enter_live(id);
+      for (uint32_t id : act.prefetch) {
+        enter_live(id);
+        candidates.push_back({i, id, evicted_before[id]});
+      }
+      for (uint32_t k : act.recompute)
+        enter_live(program.instructions[k].result_id);
+      count_at[i] = live_count;
+      units_at[i] = live_units;
+      for (uint32_t id : act.free)
+        leave_live(id);
+    }
+
+    // Candidates list the sync prefetches in storage order, so candidate k
+    // is prefetch_.items[k]: a hoisted one is cancelled there.
+    std::vector<std::pair<uint32_t, uint32_t>> hoisted; // (issue, id)
+    for (std::size_t k = 0; k < candidates.size(); ++k) {
+      const Candidate &c = candidates[k];
+      const uint32_t floor = std::max(c.lo, c.use > options.prefetch_lookahead ? c.use - options.prefetch_lookahead : 0);
+      uint32_t issue = c.use;
+      while (issue > floor && (device_budget == 0 || units_at[issue - 1] + cost(c.id) <= device_budget))
+        --issue;
+      if (issue == c.use)
+        continue;
+      plan.prefetch_.items[k] = 0;
+      hoisted.push_back({issue, c.id});
+      plan.fence_.push(c.use, c.id);
+      for (uint32_t t = issue; t < c.use; ++t) {
+        ++count_at[t];
+        units_at[t] += cost(c.id);
+      }
+      plan.stats_.hoisted_prefetch_count++;
+      plan.stats_.hoist_distance += c.use - issue;
+    }
+    dropCancelled(plan.prefetch_);
+    fillRows(plan.prefetch_async_, n, hoisted);
+    plan.fence_.seal(n);
+    for (uint32_t t = 0; t < n; ++t) {
+      plan.stats_.high_water = std::max(plan.stats_.high_water, count_at[t]);
+      if (model)
+        plan.stats_.high_water_bytes = std::max(plan.stats_.high_water_bytes, units_at[t]);
+    }
+  }
+
+  // Peer copies, in id order: a send follows its def, while the value is
+  // resident and before any free; a receive precedes the first action that
+  // touches its id (a prefetch, possibly hoisted, or else its first use or
+  // its free).
+  if (!options.peer_sends.empty() || !options.peer_receives.empty()) {
+    // By id: the devices each sent id goes to, and each received id's
+    // source and first touch (n: not received).
+    std::vector<const std::vector<uint32_t> *> send_to(num_ids, nullptr);
+    for (const auto &[id, devices] : options.peer_sends)
+      send_to[id] = &devices;
+    std::vector<uint32_t> source(num_ids, 0);
+    std::vector<uint32_t> first_touch(num_ids, n);
+    for (const auto &[id, device] : options.peer_receives) {
+      source[id] = device;
+      first_touch[id] = n - 1; // the last instruction when nothing before it touches the id
+    }
+    std::vector<std::pair<uint32_t, FhnPeerCopy>> copies; // (instruction, copy)
+    for (uint32_t id = 1; id <= max_id; ++id) {
+      if (!send_to[id])
+        continue;
+      for (uint32_t device : *send_to[id]) {
+        copies.push_back({static_cast<uint32_t>(def_pos[id]), {id, device, id}});
+        plan.stats_.send_count++;
+      }
+    }
+    fillRows(plan.send_, n, copies);
+
+    auto touch = [&](uint32_t i, uint32_t id) {
+      if (first_touch[id] == n - 1)
+        first_touch[id] = i;
+    };
+    for (uint32_t i = 0; i + 1 < n; ++i) {
+      const FhnMovementActions act = plan.at(i);
+      for (const FhnActionSpan<uint32_t> *ids : {&act.evict, &act.prefetch, &act.prefetch_async, &act.free})
+        for (uint32_t id : *ids)
+          touch(i, id);
+      for (uint32_t id : program.instructions[i].operands)
+        if (id != 0)
+          touch(i, id);
+    }
+    copies.clear();
+    for (uint32_t id = 1; id <= max_id; ++id) {
+      if (first_touch[id] == n)
+        continue;
+      copies.push_back({first_touch[id], {id, source[id], id}});
+      plan.stats_.receive_count++;
+    }
+    fillRows(plan.receive_, n, copies);
+  }
+
+  // Host tier: each evicted value is parked on the host from its eviction
+  // until the prefetch that brings it back (the next one of its id, sync
+  // or async); whenever the parked units exceed host_budget, the unpinned
+  // value returning farthest ahead is spilled and restored right before
+  // that prefetch.
+  if (options.host_budget > 0) {
+    // Each eviction's return instruction (n: never, a pinned value kept to
+    // the end), in program order, found walking backwards.
+    std::vector<uint32_t> returns;
+    std::vector<uint32_t> next_return(num_ids, n);
+    for (uint32_t i = n; i-- > 0;) {
+      const FhnMovementActions act = plan.at(i);
+      for (const FhnActionSpan<uint32_t> *ids : {&act.prefetch, &act.prefetch_async})
+        for (uint32_t id : *ids)
+          next_return[id] = i;
+      for (std::size_t k = act.evict.size(); k-- > 0;)
+        returns.push_back(next_return[act.evict[k]]);
+    }
+    std::reverse(returns.begin(), returns.end());
+
+    // Spill candidates: a max-heap by return, ties to the lower id; an
+    // entry is current while its id is parked from that same eviction.
+    struct Parked {
+      uint32_t ret;
+      uint32_t id;
+      uint32_t eviction;
+    };
+    auto nearer = [](const Parked &a, const Parked &b) { return a.ret < b.ret || (a.ret == b.ret && a.id > b.id); };
+    std::vector<Parked> candidates;
+    std::vector<uint32_t> parked_by(num_ids, 0); // 1 + eviction index while parked, else 0
+    std::vector<char> spilled(num_ids, 0);
+    uint64_t host_units = 0;
+    uint32_t eviction = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      const FhnMovementActions act = plan.at(i);
+      for (uint32_t id : act.evict) {
+        parked_by[id] = eviction + 1;
+        host_units += cost(id);
+        if (!is_pinned[id]) {
+          candidates.push_back({returns[eviction], id, eviction});
+          std::push_heap(candidates.begin(), candidates.end(), nearer);
+        }
+        ++eviction;
+      }
+      while (host_units > options.host_budget) {
+        while (!candidates.empty() && parked_by[candidates.front().id] != candidates.front().eviction + 1) {
+          std::pop_heap(candidates.begin(), candidates.end(), nearer);
+          candidates.pop_back();
+        }
+        if (candidates.empty())
+          return std::nullopt; // pinned values alone overflow the host
+        const uint32_t victim = candidates.front().id;
+        std::pop_heap(candidates.begin(), candidates.end(), nearer);
+        candidates.pop_back();
+        plan.spill_.push(i, victim);
+        parked_by[victim] = 0;
+        spilled[victim] = 1;
+        host_units -= cost(victim);
+        plan.stats_.spill_count++;
+      }
+      plan.stats_.host_high_water = std::max(plan.stats_.host_high_water, host_units);
+      for (const FhnActionSpan<uint32_t> *ids : {&act.prefetch, &act.prefetch_async}) {
+        for (uint32_t id : *ids) {
+          if (parked_by[id] != 0) {
+            parked_by[id] = 0;
+            host_units -= cost(id);
+          } else if (spilled[id]) {
+            spilled[id] = 0;
+            plan.unspill_.push(i, id);
+          }
+        }
+      }
+    }
+    plan.spill_.seal(n);
+    plan.unspill_.seal(n);
+  }
+
+  // Transfer volume: every eviction and prefetch moves its value at the
+  // level it holds at that point (byte mode), as do spills and restores.
+  {
+    std::vector<int64_t> level = level_of; // empty without a model
+    auto units = [&](uint32_t id) -> uint64_t {
+      return model ? model->bytes_by_level[static_cast<std::size_t>(level[id])] : 1;
+    };
+    uint64_t link_units = 0;
+    uint64_t disk_units = 0;
+    if (options.record_timeline)
+      plan.timeline_.resize(n);
+    for (uint32_t i = 0; i < n; ++i) {
+      const FhnMovementActions act = plan.at(i);
+      for (const FhnLevelDown &down : act.level_down)
+        level[down.id] = down.level;
+      for (const FhnActionSpan<uint32_t> *ids : {&act.evict, &act.prefetch, &act.prefetch_async}) {
+        for (uint32_t id : *ids) {
+          const uint64_t moved = units(id);
+          link_units += moved;
+          if (model) {
+            plan.stats_.transfer_bytes += moved;
+            plan.stats_.level_down_saved_bytes += cost(id) - moved;
+          }
+          if (options.record_timeline) {
+            plan.timeline_[i].transfers++;
+            if (model)
+              plan.timeline_[i].transfer_bytes += moved;
+          }
+        }
+      }
+      for (const FhnActionSpan<uint32_t> *ids : {&act.spill, &act.unspill})
+        for (uint32_t id : *ids)
+          disk_units += units(id);
+    }
+    plan.stats_.movement_ns = static_cast<double>(link_units) * options.transfer_ns_per_unit +
+                              static_cast<double>(disk_units) * options.spill_ns_per_unit;
+  }
+
+  plan.table_size_ = max_id + 1;
+
+  if (options.assign_slots) {
+    // Interval coloring over the lifetimes the loop above fixed: an id
+    // holds its slot from its def (inputs: before the program) until the
+    // instruction that frees it. Visiting defs in program order and giving
+    // each the best-fitting released slot colors the interval graph.
+    std::vector<uint64_t> capacity(1, 0); // by slot; slot 0 = no operand
+    std::vector<uint32_t> &slot_of = plan.slot_of_;
+    slot_of.assign(num_ids, 0);
+    auto open_slot = [&](uint32_t id) {
+      slot_of[id] = static_cast<uint32_t>(capacity.size());
+      capacity.push_back(cost(id));
+    };
+    for (uint32_t k = 0; k < program.num_inputs; ++k)
+      open_slot(program.input_ids[k]);
+
+    // Released slots: a min-heap of slots per capacity (the few distinct
+    // costs), taken best fit, ties to the lower slot. Each remembers the
+    // free that released it (its index in free_.items), so an unbudgeted
+    // reuse can cancel that free and keep the buffer. Cancelled allocs and
+    // frees are zeroed in place and dropped once coloring is done.
+    std::vector<uint64_t> capacities(1, 1);
+    if (model)
+      capacities = model->bytes_by_level;
+    std::sort(capacities.begin(), capacities.end());
+    capacities.erase(std::unique(capacities.begin(), capacities.end()), capacities.end());
+    auto capacity_class = [&](uint64_t units) {
+      return static_cast<std::size_t>(std::lower_bound(capacities.begin(), capacities.end(), units) -
+                                      capacities.begin());
+    };
+    std::vector<std::vector<uint32_t>> released(capacities.size());
+    std::vector<uint32_t> released_by(num_ids); // by slot
+    auto cancel = [](ActionTable<uint32_t> &table, uint32_t i, uint32_t id) {
+      const auto row = table.items.begin() + table.offsets[i];
+      *std::find(row, table.items.begin() + table.offsets[i + 1], id) = 0;
+    };
+
+    for (uint32_t i = 0; i < n; ++i) {
+      const FhnInstruction &inst = program.instructions[i];
+      const FhnMovementActions act = plan.at(i);
+      const uint32_t r = inst.result_id;
+      // Under a budget a slot's resident bytes are its capacity, so only
+      // an exact fit keeps residency within what the loop above admitted.
+      auto fits = [&](uint32_t slot) {
+        return device_budget > 0 ? capacity[slot] == cost(r) : capacity[slot] >= cost(r);
+      };
+
+      bool placed = false;
+      if (options.in_place) {
+        const bool reads_addend_late =
+          inst.opcode == FHN_HROT_ADD || inst.opcode == FHN_HCONJ_ADD || inst.opcode == FHN_MAD;
+        const uint32_t addend_slot = inst.operands[1] != 0 ? slot_of[inst.operands[1]] : 0;
+        for (std::size_t j = 0; j < 4 && !placed; ++j) {
+          const uint32_t o = inst.operands[j];
+          if (o == 0 || (reads_addend_late && j != 0))
+            continue;
+          const uint32_t slot = slot_of[o];
+          if ((reads_addend_late && slot == addend_slot) || !fits(slot) ||
+              std::find(act.free.begin(), act.free.end(), o) == act.free.end())
+            continue;
+          // o dies here: r takes over its live buffer, no alloc, no free.
+          slot_of[r] = slot;
+          cancel(plan.alloc_, i, r);
+          cancel(plan.free_, i, o);
+          placed = true;
+        }
+      }
+      if (!placed) {
+        std::size_t c = capacity_class(cost(r));
+        while (c < released.size() && released[c].empty())
+          ++c;
+        if (c < released.size() && fits(released[c].front())) {
+          std::vector<uint32_t> &slots = released[c];
+          const uint32_t slot = slots.front();
+          std::pop_heap(slots.begin(), slots.end(), std::greater<uint32_t>());
+          slots.pop_back();
+          slot_of[r] = slot;
+          if (device_budget == 0) {
+            plan.free_.items[released_by[slot]] = 0;
+            cancel(plan.alloc_, i, r);
+          }
+        } else {
+          open_slot(r);
+        }
+      }
+
+      const uint32_t free_begin = plan.free_.offsets.empty() ? 0 : plan.free_.offsets[i];
+      for (uint32_t k = 0; k < act.free.size(); ++k) {
+        const uint32_t id = act.free[k];
+        if (id == 0)
+          continue; // taken over in place
+        const uint32_t slot = slot_of[id];
+        std::vector<uint32_t> &slots = released[capacity_class(capacity[slot])];
+        slots.push_back(slot);
+        std::push_heap(slots.begin(), slots.end(), std::greater<uint32_t>());
+        released_by[slot] = free_begin + k;
+      }
+    }
+    dropCancelled(plan.alloc_);
+    dropCancelled(plan.free_);
+
+    // Rewrite actions and program onto slots.
+    for (ActionTable<uint32_t> *table : {&plan.evict_, &plan.spill_, &plan.discard_, &plan.alloc_, &plan.unspill_,
+                                         &plan.prefetch_, &plan.prefetch_async_, &plan.fence_, &plan.free_})
+      for (uint32_t &id : table->items)
+        id = slot_of[id];
+    for (FhnPeerCopy &copy : plan.receive_.items)
+      copy.id = slot_of[copy.id];
+    for (FhnLevelDown &down : plan.level_down_.items)
+      down.id = slot_of[down.id];
+    for (FhnPeerCopy &copy : plan.send_.items)
+      copy.id = slot_of[copy.id];
+    FhnProgram *slotted = fhn_program_alloc(n, program.num_inputs, program.num_outputs);
+    if (!slotted)
+      return std::nullopt;
+    for (uint32_t i = 0; i < n; ++i) {
+      FhnInstruction inst = program.instructions[i];
+      inst.result_id = slot_of[inst.result_id];
+      for (std::size_t j = 0; j < 4; ++j)
+        if (inst.operands[j] != 0)
+          inst.operands[j] = slot_of[inst.operands[j]];
+      slotted->instructions[i] = inst;
+    }
+    for (uint32_t k = 0; k < program.num_inputs; ++k)
+      slotted->input_ids[k] = slot_of[program.input_ids[k]];
+    for (uint32_t k = 0; k < program.num_outputs; ++k) {
+      const uint32_t id = program.output_ids[k];
+      slotted->output_ids[k] = id <= max_id ? slot_of[id] : 0;
+    }
+    plan.program_ = std::shared_ptr<const FhnProgram>(slotted, fhn_program_free);
+    plan.table_size_ = static_cast<uint32_t>(capacity.size());
+
+    plan.byte_class_.clear();
+    if (model)
+      plan.byte_class_ = capacity;
+
+    // Residency over slots: a kept buffer stays resident across its gap.
+    plan.stats_.high_water = 0;
+    plan.stats_.high_water_bytes = 0;
+    plan.stats_.alloc_count = 0;
+    std::vector<char> live(capacity.size(), 0);
+    uint32_t live_count = 0;
+    uint64_t live_bytes = 0;
+    auto enter_live = [&](uint32_t slot) {
+      if (!live[slot]) {
+        live[slot] = 1;
+        ++live_count;
+        live_bytes += capacity[slot];
+      }
+    };
+    auto leave_live = [&](uint32_t slot) {
+      if (live[slot]) {
+        live[slot] = 0;
+        --live_count;
+        live_bytes -= capacity[slot];
+      }
+    };
+    for (uint32_t i = 0; i < n; ++i) {
+      const FhnMovementActions act = plan.at(i);
+      for (uint32_t slot : act.evict)
+        leave_live(slot);
+      for (uint32_t slot : act.discard)
+        leave_live(slot);
+      for (uint32_t slot : act.alloc)
+        enter_live(slot);
+      for (uint32_t slot : act.prefetch)
+        enter_live(slot);
+      for (uint32_t k : act.recompute)
+        enter_live(slot_of[program.instructions[k].result_id]);
+      for (uint32_t slot : act.prefetch_async)
+        enter_live(slot);
+      plan.stats_.alloc_count += static_cast<uint32_t>(act.alloc.size());
+      plan.stats_.high_water = std::max(plan.stats_.high_water, live_count);
+      if (model)
+        plan.stats_.high_water_bytes = std::max(plan.stats_.high_water_bytes, live_bytes);
+      for (uint32_t slot : act.free)
+        leave_live(slot);
+    }
+  }
+
+  // Buffer pool reuse: replay allocs and frees in execution order (allocs
+  // precede the instruction, frees follow it) against per-class idle
+  // counts, once from empty and once from the first replay's leftovers.
+  // Discards release like frees; recomputations acquire like allocs. The
+  // classes are the model's byte sizes (and 0), so idle counts sit in a
+  // small array.
+  std::vector<uint64_t> classes(1, 0);
+  if (model)
+    classes.insert(classes.end(), model->bytes_by_level.begin(), model->bytes_by_level.end());
+  std::sort(classes.begin(), classes.end());
+  classes.erase(std::unique(classes.begin(), classes.end()), classes.end());
+  auto class_of = [&](uint32_t id) {
+    return static_cast<std::size_t>(std::lower_bound(classes.begin(), classes.end(), plan.byteClass(id)) -
+                                    classes.begin());
+  };
+  auto replay = [&](std::vector<uint32_t> &idle) {
+    uint32_t hits = 0;
+    auto acquire = [&](uint32_t id) {
+      uint32_t &count = idle[class_of(id)];
+      if (count > 0) {
+        --count;
+        ++hits;
+      }
+    };
+    for (uint32_t i = 0; i < n; ++i) {
+      const FhnMovementActions act = plan.at(i);
+      for (uint32_t id : act.discard)
+        ++idle[class_of(id)];
+      for (uint32_t id : act.alloc)
+        acquire(id);
+      for (uint32_t k : act.recompute)
+        acquire(plan.slotOf(program.instructions[k].result_id));
+      for (uint32_t id : act.free)
+        ++idle[class_of(id)];
+    }
+    return hits;
+  };
+  std::vector<uint32_t> idle(classes.size(), 0);
+  plan.stats_.pool_hits = replay(idle);
+  plan.stats_.pool_warm_hits = replay(idle);
+
+  // Timeline: the residency replay above, on the plan's final table (slots
+  // with assign_slots), keeping each instruction's resident set.
+  if (options.record_timeline) {
+    std::vector<char> live(plan.table_size_, 0);
+    std::vector<uint32_t> live_ids; // ascending
+    uint64_t live_bytes = 0;
+    auto enter_live = [&](uint32_t id) {
+      if (!live[id]) {
+        live[id] = 1;
+        live_ids.insert(std::lower_bound(live_ids.begin(), live_ids.end(), id), id);
+        live_bytes += plan.byteClass(id);
+      }
+    };
+    auto leave_live = [&](uint32_t id) {
+      if (live[id]) {
+        live[id] = 0;
+        live_ids.erase(std::lower_bound(live_ids.begin(), live_ids.end(), id));
+        live_bytes -= plan.byteClass(id);
+      }
+    };
+    std::size_t peak_count = 0;
+    uint64_t peak_bytes = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      const FhnMovementActions act = plan.at(i);
+      FhnTimelinePoint &point = plan.timeline_[i];
+      for (const FhnActionSpan<uint32_t> *ids : {&act.evict, &act.discard})
+        for (uint32_t id : *ids)
+          leave_live(id);
+      for (const FhnActionSpan<uint32_t> *ids : {&act.alloc, &act.prefetch, &act.prefetch_async})
+        for (uint32_t id : *ids)
+          enter_live(id);
+      for (uint32_t k : act.recompute)
+        enter_live(plan.slotOf(program.instructions[k].result_id));
+      point.resident = live_ids;
+      point.resident_bytes = live_bytes;
+      peak_count = std::max(peak_count, live_ids.size());
+      peak_bytes = std::max(peak_bytes, live_bytes);
+      for (uint32_t id : act.free)
+        leave_live(id);
+    }
+    for (FhnTimelinePoint &point : plan.timeline_)
+      point.bottleneck = model ? point.resident_bytes == peak_bytes : point.resident.size() == peak_count;
+  }
 
   return plan;
 }
 
+std::string FhnMovementPlan::timelineCsv() const {
+  std::string out = "index,resident_count,resident_bytes,transfers,transfer_bytes,bottleneck,resident\n";
+  for (std::size_t i = 0; i < timeline_.size(); ++i) {
+    const FhnTimelinePoint &point = timeline_[i];
+    out += std::to_string(i) + ',' + std::to_string(point.resident.size()) + ',' +
+           std::to_string(point.resident_bytes) + ',' + std::to_string(point.transfers) + ',' +
+           std::to_string(point.transfer_bytes) + ',' + (point.bottleneck ? '1' : '0') + ',';
+    for (std::size_t k = 0; k < point.resident.size(); ++k) {
+      if (k > 0)
+        out += ' ';
+      out += std::to_string(point.resident[k]);
+    }
+    out += '\n';
+  }
+  return out;
+}
+
+std::string FhnMovementPlan::timelineJson() const {
+  std::string out = "[";
+  for (std::size_t i = 0; i < timeline_.size(); ++i) {
+    const FhnTimelinePoint &point = timeline_[i];
+    if (i > 0)
+      out += ',';
+    out += "\n{\"index\":" + std::to_string(i) + ",\"resident_count\":" + std::to_string(point.resident.size()) +
+           ",\"resident_bytes\":" + std::to_string(point.resident_bytes) +
+           ",\"transfers\":" + std::to_string(point.transfers) +
+           ",\"transfer_bytes\":" + std::to_string(point.transfer_bytes) +
+           ",\"bottleneck\":" + (point.bottleneck ? "true" : "false") + ",\"resident\":[";
+    for (std::size_t k = 0; k < point.resident.size(); ++k) {
+      if (k > 0)
+        out += ',';
+      out += std::to_string(point.resident[k]);
+    }
+    out += "]}";
+  }
+  out += "\n]";
+  return out;
+}
+
 } // namespace fhenomenon
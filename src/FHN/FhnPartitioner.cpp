@@ -0,0 +1,292 @@
+#include "FHN/FhnPartitioner.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+namespace fhenomenon {
+
+namespace {
+
+// Distinct non-zero operands of inst.
+std::vector<uint32_t> operandIds(const FhnInstruction &inst) {
+  std::vector<uint32_t> ids;
+  for (uint32_t id : inst.operands) {
+    if (id != 0 && std::find(ids.begin(), ids.end(), id) == ids.end())
+      ids.push_back(id);
+  }
+  return ids;
+}
+
+// Sent values waiting for their receive, by (value, destination device).
+struct PeerMailbox {
+  std::mutex mutex;
+  std::condition_variable arrived;
+  std::map<std::pair<uint32_t, uint32_t>, FhnBuffer *> buffers;
+  int rc = 0; // first device failure; pending receives give up once set
+};
+
+} // namespace
+
+std::optional<FhnPartitioner::Partition> FhnPartitioner::partition(const FhnProgram &program,
+                                                                   const std::vector<uint32_t> &pinned,
+                                                                   uint32_t num_devices,
+                                                                   const FhnPartitionOptions &options) {
+  if (program.version != FHN_ABI_VERSION || num_devices == 0)
+    return std::nullopt;
+  constexpr double kAbsent = std::numeric_limits<double>::infinity();
+  const uint32_t n = program.num_instructions;
+
+  auto instructionCost = [&options](const FhnInstruction &inst) {
+    if (options.costs) {
+      for (uint32_t k = 0; k < options.costs->num_costs; ++k) {
+        if (options.costs->costs[k].opcode == inst.opcode)
+          return options.costs->costs[k].base_ns;
+      }
+    }
+    return 1.0;
+  };
+
+  std::unordered_set<uint32_t> inputs;
+  for (uint32_t k = 0; k < program.num_inputs; ++k) {
+    if (program.input_ids[k] == 0 || !inputs.insert(program.input_ids[k]).second)
+      return std::nullopt;
+  }
+
+  Partition out;
+  std::vector<std::vector<uint32_t>> imports; // ids copied to each device, in first-need order
+  // List-schedules onto the first `spread` devices; false on an invalid
+  // program.
+  auto assign = [&](uint32_t spread) {
+    out.device_of.assign(n, 0);
+    out.home.clear();
+    out.stats = Stats();
+    out.stats.load.assign(num_devices, 0.0);
+    imports.assign(num_devices, {});
+    // When each value is (estimated to be) available on each device;
+    // kAbsent where it is not. Inputs enter once their first reader homes
+    // them.
+    std::unordered_map<uint32_t, std::vector<double>> available;
+    auto readyAtHome = [&](uint32_t id) { return available.at(id)[out.home.at(id)]; };
+    std::vector<double> device_free(num_devices, 0.0);
+
+    for (uint32_t i = 0; i < n; ++i) {
+      const FhnInstruction &inst = program.instructions[i];
+      const std::vector<uint32_t> ops = operandIds(inst);
+      if (inst.result_id == 0 || inputs.count(inst.result_id) || available.count(inst.result_id))
+        return false;
+      for (uint32_t id : ops) {
+        if (!available.count(id) && !inputs.count(id))
+          return false;
+      }
+      const double cost = instructionCost(inst);
+
+      bool found = false;
+      uint32_t best = 0;
+      uint32_t best_copies = 0;
+      double best_finish = 0.0;
+      for (uint32_t d = 0; d < spread; ++d) {
+        double ready = device_free[d];
+        uint32_t copies = 0;
+        for (uint32_t id : ops) {
+          auto it = available.find(id);
+          if (it == available.end())
+            continue; // an input nobody read yet: it would live here
+          double t = it->second[d];
+          if (t == kAbsent) {
+            t = readyAtHome(id) + options.transfer_cost;
+            ++copies;
+          }
+          ready = std::max(ready, t);
+        }
+        const double finish = ready + cost;
+        if (!found || finish < best_finish ||
+            (finish == best_finish &&
+             (copies < best_copies || (copies == best_copies && out.stats.load[d] < out.stats.load[best])))) {
+          found = true;
+          best = d;
+          best_copies = copies;
+          best_finish = finish;
+        }
+      }
+
+      for (uint32_t id : ops) {
+        auto it = available.find(id);
+        if (it == available.end()) {
+          available.emplace(id, std::vector<double>(num_devices, kAbsent)).first->second[best] = 0.0;
+          out.home[id] = best;
+        } else if (it->second[best] == kAbsent) {
+          it->second[best] = readyAtHome(id) + options.transfer_cost;
+          imports[best].push_back(id);
+        }
+      }
+      available.emplace(inst.result_id, std::vector<double>(num_devices, kAbsent)).first->second[best] = best_finish;
+      out.home[inst.result_id] = best;
+      out.device_of[i] = best;
+      device_free[best] = best_finish;
+      out.stats.load[best] += cost;
+      out.stats.serial += cost;
+      out.stats.makespan = std::max(out.stats.makespan, best_finish);
+    }
+    return true;
+  };
+  if (!assign(num_devices))
+    return std::nullopt;
+  // Greedy placement cannot see the copies its early choices commit later
+  // instructions to; when they eat the whole gain, one device it is.
+  if (num_devices > 1 && out.stats.makespan >= out.stats.serial)
+    assign(1);
+  for (uint32_t id : inputs)
+    out.home.emplace(id, 0); // never read: stays with device 0
+
+  // Carve out the parts.
+  std::vector<std::vector<uint32_t>> part_inputs(num_devices);
+  std::vector<std::vector<uint32_t>> part_outputs(num_devices);
+  std::vector<std::vector<uint32_t>> part_instructions(num_devices);
+  out.parts.resize(num_devices);
+  for (uint32_t k = 0; k < program.num_inputs; ++k)
+    part_inputs[out.home.at(program.input_ids[k])].push_back(program.input_ids[k]);
+  for (uint32_t d = 0; d < num_devices; ++d) {
+    for (uint32_t id : imports[d]) {
+      part_inputs[d].push_back(id);
+      if (inputs.count(id)) {
+        out.input_copies.emplace_back(id, d);
+      } else {
+        out.parts[d].options.peer_receives[id] = out.home.at(id);
+        out.parts[out.home.at(id)].options.peer_sends[id].push_back(d);
+      }
+    }
+    out.stats.transfers += static_cast<uint32_t>(imports[d].size());
+  }
+  for (uint32_t k = 0; k < program.num_outputs; ++k) {
+    auto it = out.home.find(program.output_ids[k]);
+    if (it == out.home.end())
+      return std::nullopt;
+    part_outputs[it->second].push_back(program.output_ids[k]);
+  }
+  for (uint32_t i = 0; i < n; ++i)
+    part_instructions[out.device_of[i]].push_back(i);
+  for (uint32_t id : pinned) {
+    auto it = out.home.find(id);
+    if (it != out.home.end())
+      out.parts[it->second].pinned.push_back(id);
+  }
+
+  for (uint32_t d = 0; d < num_devices; ++d) {
+    const auto num_instructions = static_cast<uint32_t>(part_instructions[d].size());
+    FhnProgram *part = fhn_program_alloc(num_instructions, static_cast<uint32_t>(part_inputs[d].size()),
+                                         static_cast<uint32_t>(part_outputs[d].size()));
+    if (!part)
+      return std::nullopt;
+    for (uint32_t k = 0; k < num_instructions; ++k)
+      part->instructions[k] = program.instructions[part_instructions[d][k]];
+    std::copy(part_inputs[d].begin(), part_inputs[d].end(), part->input_ids);
+    std::copy(part_outputs[d].begin(), part_outputs[d].end(), part->output_ids);
+    out.parts[d].program = std::shared_ptr<const FhnProgram>(part, fhn_program_free);
+  }
+  return out;
+}
+
+int FhnPartitioner::execute(const Partition &partition, const std::vector<Device> &devices,
+                            const std::vector<FhnMovementPlan> &plans, const std::vector<FhnBuffer **> &tables) {
+  const std::size_t num_devices = partition.parts.size();
+  if (num_devices == 0 || devices.size() != num_devices || plans.size() != num_devices ||
+      tables.size() != num_devices)
+    return -1;
+  for (std::size_t d = 0; d < num_devices; ++d) {
+    const Device &device = devices[d];
+    if (!device.executor || !tables[d] || !device.hooks.buffer_alloc || !device.hooks.buffer_free ||
+        (partition.stats.transfers > 0 && !device.copy_peer))
+      return -1;
+  }
+
+  // Copies into other devices' buffers are made on the sending side, so
+  // the sender may free its buffer right after.
+  auto copyTo = [&devices](uint32_t dst, uint32_t src, const FhnBuffer *buffer) -> FhnBuffer * {
+    const FhnMovementHooks &to = devices[dst].hooks;
+    FhnBuffer *copy = to.buffer_alloc(to.ctx);
+    if (copy && devices[src].copy_peer(to.ctx, copy, devices[src].hooks.ctx, buffer) != 0) {
+      to.buffer_free(to.ctx, copy);
+      copy = nullptr;
+    }
+    return copy;
+  };
+  auto releaseInputCopies = [&]() {
+    for (const auto &[id, d] : partition.input_copies) {
+      FhnBuffer *&slot = tables[d][plans[d].slotOf(id)];
+      if (slot)
+        devices[d].hooks.buffer_free(devices[d].hooks.ctx, slot);
+      slot = nullptr;
+    }
+  };
+  for (const auto &[id, d] : partition.input_copies) {
+    const uint32_t home = partition.home.at(id);
+    FhnBuffer *copy = copyTo(d, home, tables[home][plans[home].slotOf(id)]);
+    if (!copy) {
+      releaseInputCopies();
+      return -1;
+    }
+    tables[d][plans[d].slotOf(id)] = copy;
+  }
+
+  PeerMailbox mailbox;
+  auto run = [&](uint32_t d) {
+    FhnMovementHooks hooks = devices[d].hooks;
+    hooks.send = [&, d](const FhnPeerCopy &copy, const FhnBuffer *buffer) {
+      FhnBuffer *sent = copyTo(copy.device, d, buffer);
+      if (!sent)
+        return -1;
+      {
+        std::lock_guard<std::mutex> lock(mailbox.mutex);
+        mailbox.buffers[{copy.value, copy.device}] = sent;
+      }
+      mailbox.arrived.notify_all();
+      return 0;
+    };
+    hooks.receive = [&, d](const FhnPeerCopy &copy) -> FhnBuffer * {
+      std::unique_lock<std::mutex> lock(mailbox.mutex);
+      const std::pair<uint32_t, uint32_t> key{copy.value, d};
+      mailbox.arrived.wait(lock, [&] { return mailbox.buffers.count(key) || mailbox.rc != 0; });
+      auto it = mailbox.buffers.find(key);
+      if (it == mailbox.buffers.end())
+        return nullptr;
+      FhnBuffer *received = it->second;
+      mailbox.buffers.erase(it);
+      return received;
+    };
+    const FhnProgram *program = plans[d].program() ? plans[d].program() : partition.parts[d].program.get();
+    const int rc = devices[d].executor->execute(hooks, program, tables[d], plans[d]);
+    if (rc != 0) {
+      {
+        std::lock_guard<std::mutex> lock(mailbox.mutex);
+        if (mailbox.rc == 0)
+          mailbox.rc = rc;
+      }
+      mailbox.arrived.notify_all();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_devices - 1);
+  for (uint32_t d = 1; d < num_devices; ++d)
+    threads.emplace_back(run, d);
+  run(0);
+  for (std::thread &thread : threads)
+    thread.join();
+
+  // A failed run leaves sends nobody received and input copies its plans
+  // never got to free. (A successful one consumed both: copies are
+  // unpinned inputs of the parts that read them.)
+  for (const auto &[key, buffer] : mailbox.buffers)
+    devices[key.second].hooks.buffer_free(devices[key.second].hooks.ctx, buffer);
+  if (mailbox.rc != 0)
+    releaseInputCopies();
+  return mailbox.rc;
+}
+
+} // namespace fhenomenon
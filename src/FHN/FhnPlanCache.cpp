@@ -0,0 +1,160 @@
+#include "FHN/FhnPlanCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace fhenomenon {
+
+namespace {
+
+// 64-bit FNV-1a, fed one fixed-width field at a time so padding inside
+// FhnInstruction never reaches the hash.
+struct Fnv1a {
+  uint64_t h = 14695981039346656037ull;
+
+  void add(uint64_t v) {
+    for (int b = 0; b < 8; ++b) {
+      h ^= (v >> (8 * b)) & 0xff;
+      h *= 1099511628211ull;
+    }
+  }
+  void add(double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    add(bits);
+  }
+};
+
+bool sameInstruction(const FhnInstruction &a, const FhnInstruction &b) {
+  return a.opcode == b.opcode && a.result_id == b.result_id &&
+         std::equal(a.operands, a.operands + 4, b.operands) && std::equal(a.params, a.params + 4, b.params) &&
+         std::memcmp(a.fparams, b.fparams, sizeof(a.fparams)) == 0;
+}
+
+std::vector<uint32_t> canonicalPinned(const std::vector<uint32_t> &pinned) {
+  std::vector<uint32_t> sorted(pinned);
+  std::sort(sorted.begin(), sorted.end());
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+  return sorted;
+}
+
+uint64_t hashKey(const FhnProgram &program, const std::vector<uint32_t> &sorted_pinned, uint64_t device_budget) {
+  Fnv1a fnv;
+  fnv.add(uint64_t{program.num_instructions});
+  for (uint32_t i = 0; i < program.num_instructions; ++i) {
+    const FhnInstruction &inst = program.instructions[i];
+    fnv.add(static_cast<uint64_t>(inst.opcode));
+    fnv.add(uint64_t{inst.result_id});
+    for (std::size_t j = 0; j < 4; ++j) {
+      fnv.add(uint64_t{inst.operands[j]});
+      fnv.add(static_cast<uint64_t>(inst.params[j]));
+    }
+    fnv.add(inst.fparams[0]);
+    fnv.add(inst.fparams[1]);
+  }
+  fnv.add(uint64_t{program.num_inputs});
+  for (uint32_t i = 0; i < program.num_inputs; ++i)
+    fnv.add(uint64_t{program.input_ids[i]});
+  fnv.add(uint64_t{program.num_outputs});
+  for (uint32_t i = 0; i < program.num_outputs; ++i)
+    fnv.add(uint64_t{program.output_ids[i]});
+  fnv.add(uint64_t{sorted_pinned.size()});
+  for (uint32_t id : sorted_pinned)
+    fnv.add(uint64_t{id});
+  fnv.add(device_budget);
+  return fnv.h;
+}
+
+} // namespace
+
+bool FhnPlanCache::Key::operator==(const Key &other) const {
+  return fingerprint == other.fingerprint && device_budget == other.device_budget && inputs == other.inputs &&
+         outputs == other.outputs && pinned == other.pinned && instructions.size() == other.instructions.size() &&
+         std::equal(instructions.begin(), instructions.end(), other.instructions.begin(), sameInstruction);
+}
+
+uint64_t FhnPlanCache::fingerprint(const FhnProgram &program, const std::vector<uint32_t> &pinned,
+                                   uint64_t device_budget) {
+  return hashKey(program, canonicalPinned(pinned), device_budget);
+}
+
+FhnPlanCache::Key FhnPlanCache::makeKey(const FhnProgram &program, const std::vector<uint32_t> &pinned,
+                                        uint64_t device_budget) {
+  Key key;
+  key.pinned = canonicalPinned(pinned);
+  key.device_budget = device_budget;
+  key.fingerprint = hashKey(program, key.pinned, device_budget);
+  key.instructions.assign(program.instructions, program.instructions + program.num_instructions);
+  key.inputs.assign(program.input_ids, program.input_ids + program.num_inputs);
+  key.outputs.assign(program.output_ids, program.output_ids + program.num_outputs);
+  return key;
+}
+
+std::list<FhnPlanCache::Node>::iterator FhnPlanCache::lookup(const Key &key) {
+  const auto range = by_fingerprint_.equal_range(key.fingerprint);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second->key == key)
+      return it->second;
+  }
+  return lru_.end();
+}
+
+std::shared_ptr<const FhnPlanCache::Entry> FhnPlanCache::find(const FhnProgram &program,
+                                                              const std::vector<uint32_t> &pinned,
+                                                              uint64_t device_budget) {
+  const Key key = makeKey(program, pinned, device_budget);
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto node = lookup(key);
+  if (node == lru_.end()) {
+    ++stats_.misses;
+    return nullptr;
+  }
+  lru_.splice(lru_.begin(), lru_, node); // iterators stay valid
+  ++stats_.hits;
+  return node->entry;
+}
+
+void FhnPlanCache::insert(const FhnProgram &program, const std::vector<uint32_t> &pinned, uint64_t device_budget,
+                          std::shared_ptr<const Entry> entry) {
+  if (capacity_ == 0 || !entry)
+    return;
+  Key key = makeKey(program, pinned, device_budget);
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto existing = lookup(key);
+  if (existing != lru_.end()) {
+    existing->entry = std::move(entry);
+    lru_.splice(lru_.begin(), lru_, existing);
+    return;
+  }
+  const uint64_t fp = key.fingerprint;
+  lru_.push_front(Node{std::move(key), std::move(entry)});
+  by_fingerprint_.emplace(fp, lru_.begin());
+  while (lru_.size() > capacity_) {
+    const auto oldest = std::prev(lru_.end());
+    const auto range = by_fingerprint_.equal_range(oldest->key.fingerprint);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == oldest) {
+        by_fingerprint_.erase(it);
+        break;
+      }
+    }
+    lru_.pop_back();
+    ++stats_.evictions;
+  }
+  stats_.entries = static_cast<uint32_t>(lru_.size());
+}
+
+void FhnPlanCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lru_.clear();
+  by_fingerprint_.clear();
+  stats_.entries = 0;
+}
+
+FhnPlanCache::Stats FhnPlanCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+} // namespace fhenomenon
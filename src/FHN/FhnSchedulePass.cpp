@@ -0,0 +1,200 @@
+#include "FHN/FhnSchedulePass.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fhenomenon {
+
+namespace {
+
+// Distinct non-zero operands of inst.
+std::vector<uint32_t> operandIds(const FhnInstruction &inst) {
+  std::vector<uint32_t> ids;
+  for (uint32_t id : inst.operands) {
+    if (id != 0 && std::find(ids.begin(), ids.end(), id) == ids.end())
+      ids.push_back(id);
+  }
+  return ids;
+}
+
+// Lexicographic plan score, lower is better.
+std::tuple<uint32_t, uint64_t, uint32_t> score(const FhnMovementPlan::Stats &s, uint64_t device_budget) {
+  const uint32_t transfers = device_budget > 0 ? s.prefetch_count + s.evict_count : 0;
+  return {transfers, s.high_water_bytes, s.high_water};
+}
+
+FhnProgram *copyInOrder(const FhnProgram &program, const std::vector<uint32_t> &order) {
+  FhnProgram *out = fhn_program_alloc(program.num_instructions, program.num_inputs, program.num_outputs);
+  if (!out)
+    return nullptr;
+  for (std::size_t i = 0; i < order.size(); ++i)
+    out->instructions[i] = program.instructions[order[i]];
+  std::copy(program.input_ids, program.input_ids + program.num_inputs, out->input_ids);
+  std::copy(program.output_ids, program.output_ids + program.num_outputs, out->output_ids);
+  return out;
+}
+
+} // namespace
+
+FhnProgram *FhnSchedulePass::run(const FhnProgram &program, const std::vector<uint32_t> &pinned,
+                                 uint64_t device_budget, const FhnLevelModel *model, Stats *stats) {
+  if (program.version != FHN_ABI_VERSION)
+    return nullptr;
+  const auto original = FhnMovementPlan::analyze(program, pinned, device_budget, FhnEvictionPolicy::Belady, model);
+  if (!original)
+    return nullptr;
+
+  const uint32_t n = program.num_instructions;
+  std::vector<uint32_t> identity(n);
+  for (uint32_t i = 0; i < n; ++i)
+    identity[i] = i;
+
+  // Dependence DAG: after the latest writer of every operand, the previous
+  // writer of the result and every read of the value it overwrites.
+  std::vector<std::vector<uint32_t>> succs(n);
+  std::vector<uint32_t> preds(n, 0);
+  {
+    std::unordered_map<uint32_t, uint32_t> writer;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> readers_since_write;
+    auto edge = [&](uint32_t from, uint32_t to) {
+      succs[from].push_back(to);
+      ++preds[to];
+    };
+    for (uint32_t i = 0; i < n; ++i) {
+      const FhnInstruction &inst = program.instructions[i];
+      std::unordered_set<uint32_t> after;
+      for (uint32_t id : operandIds(inst)) {
+        auto w = writer.find(id);
+        if (w != writer.end())
+          after.insert(w->second);
+      }
+      auto w = writer.find(inst.result_id);
+      if (w != writer.end())
+        after.insert(w->second);
+      for (uint32_t r : readers_since_write[inst.result_id])
+        after.insert(r);
+      after.erase(i);
+      for (uint32_t from : after)
+        edge(from, i);
+      for (uint32_t id : operandIds(inst))
+        readers_since_write[id].push_back(i);
+      writer[inst.result_id] = i;
+      readers_since_write[inst.result_id].clear();
+    }
+  }
+
+  // Live-set bookkeeping: an id is live from its def (inputs: first read)
+  // until its last read; pinned ids never die. Weights are byte classes
+  // under a model, else 1.
+  const std::unordered_set<uint32_t> pinned_set(pinned.begin(), pinned.end());
+  std::unordered_map<uint32_t, uint32_t> remaining; // unscheduled reading instructions
+  std::unordered_map<uint32_t, std::vector<uint32_t>> readers;
+  for (uint32_t i = 0; i < n; ++i) {
+    for (uint32_t id : operandIds(program.instructions[i])) {
+      ++remaining[id];
+      readers[id].push_back(i);
+    }
+  }
+  auto weight = [&](uint32_t id) -> int64_t {
+    return model ? static_cast<int64_t>(original->byteClass(id)) : 1;
+  };
+  std::unordered_set<uint32_t> live;
+  auto stays = [&](uint32_t id, uint32_t reads_left) { return pinned_set.count(id) || reads_left > 0; };
+
+  using Key = std::tuple<int64_t, int64_t, uint32_t>; // (live-set growth, peak, index)
+  auto key_of = [&](uint32_t i) -> Key {
+    const FhnInstruction &inst = program.instructions[i];
+    const uint32_t r = inst.result_id;
+    int64_t growth = 0;
+    int64_t peak = weight(r);
+    for (uint32_t id : operandIds(inst)) {
+      const uint32_t left = remaining.at(id) - 1;
+      if (!live.count(id)) {
+        peak += weight(id);
+        if (stays(id, left) && id != r)
+          growth += weight(id);
+      } else if (!stays(id, left)) {
+        growth -= weight(id);
+      }
+    }
+    const auto reads = remaining.find(r);
+    if (!live.count(r) && stays(r, reads == remaining.end() ? 0 : reads->second))
+      growth += weight(r);
+    return {growth, peak, i};
+  };
+
+  std::set<Key> ready;
+  std::vector<Key> key(n);
+  std::vector<char> is_ready(n, 0);
+  auto push = [&](uint32_t i) {
+    key[i] = key_of(i);
+    ready.insert(key[i]);
+    is_ready[i] = 1;
+  };
+  auto rekey_readers = [&](uint32_t id) {
+    for (uint32_t i : readers[id]) {
+      if (!is_ready[i])
+        continue;
+      ready.erase(key[i]);
+      push(i);
+    }
+  };
+  for (uint32_t i = 0; i < n; ++i) {
+    if (preds[i] == 0)
+      push(i);
+  }
+
+  std::vector<uint32_t> order;
+  order.reserve(n);
+  while (!ready.empty()) {
+    const uint32_t i = std::get<2>(*ready.begin());
+    ready.erase(ready.begin());
+    is_ready[i] = 0;
+    order.push_back(i);
+    const FhnInstruction &inst = program.instructions[i];
+    for (uint32_t id : operandIds(inst)) {
+      const uint32_t left = --remaining.at(id);
+      if (live.insert(id).second || left == 1)
+        rekey_readers(id); // first read opened it, or one reader is left to close it
+      if (!stays(id, left))
+        live.erase(id);
+    }
+    const auto reads = remaining.find(inst.result_id);
+    if (stays(inst.result_id, reads == remaining.end() ? 0 : reads->second) && live.insert(inst.result_id).second)
+      rekey_readers(inst.result_id);
+    for (uint32_t s : succs[i]) {
+      if (--preds[s] == 0)
+        push(s);
+    }
+  }
+  if (order.size() != n)
+    return nullptr; // unreachable: program order is a topological order
+
+  Stats local;
+  local.before = original->stats();
+  local.after = local.before;
+  FhnProgram *reordered = copyInOrder(program, order);
+  if (!reordered)
+    return nullptr;
+  const auto candidate = FhnMovementPlan::analyze(*reordered, pinned, device_budget, FhnEvictionPolicy::Belady, model);
+  if (candidate && score(candidate->stats(), device_budget) < score(local.before, device_budget)) {
+    local.reordered = true;
+    local.after = candidate->stats();
+    for (uint32_t i = 0; i < n; ++i) {
+      if (order[i] != i)
+        ++local.moved;
+    }
+  } else {
+    fhn_program_free(reordered);
+    reordered = copyInOrder(program, identity);
+  }
+  if (stats && reordered)
+    *stats = local;
+  return reordered;
+}
+
+} // namespace fhenomenon
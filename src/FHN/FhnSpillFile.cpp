@@ -0,0 +1,104 @@
+#include "FHN/FhnSpillFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <iterator>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+
+namespace fhenomenon {
+
+namespace {
+
+constexpr uint64_t kMinFileBytes = uint64_t{1} << 20;
+
+} // namespace
+
+std::unique_ptr<FhnSpillFile> FhnSpillFile::create(const std::string &path) {
+  const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0)
+    return nullptr;
+  return std::unique_ptr<FhnSpillFile>(new FhnSpillFile(fd, path));
+}
+
+FhnSpillFile::~FhnSpillFile() {
+  if (base_)
+    ::munmap(base_, stats_.file_bytes);
+  ::close(fd_);
+  std::remove(path_.c_str());
+}
+
+bool FhnSpillFile::grow(uint64_t min_bytes) {
+  const uint64_t page = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+  const uint64_t old_bytes = stats_.file_bytes;
+  uint64_t new_bytes = std::max({kMinFileBytes, 2 * old_bytes, old_bytes + min_bytes});
+  new_bytes = (new_bytes + page - 1) / page * page;
+  // On failure the old mapping stays valid; a longer file is harmless.
+  if (::ftruncate(fd_, static_cast<off_t>(new_bytes)) != 0)
+    return false;
+  void *mapped = ::mmap(nullptr, new_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (mapped == MAP_FAILED)
+    return false;
+  if (base_)
+    ::munmap(base_, old_bytes);
+  base_ = static_cast<unsigned char *>(mapped);
+  stats_.file_bytes = new_bytes;
+  stats_.grows++;
+  insertFree(old_bytes, new_bytes - old_bytes);
+  return true;
+}
+
+void FhnSpillFile::insertFree(uint64_t offset, uint64_t size) {
+  auto next = free_.lower_bound(offset);
+  if (next != free_.end() && offset + size == next->first) {
+    size += next->second;
+    next = free_.erase(next);
+  }
+  if (next != free_.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      size += prev->second;
+      free_.erase(prev);
+    }
+  }
+  free_.emplace(offset, size);
+}
+
+std::optional<FhnSpillFile::Extent> FhnSpillFile::reserve(uint64_t size) {
+  if (size == 0)
+    return std::nullopt;
+  auto it = std::find_if(free_.begin(), free_.end(), [size](const auto &entry) { return entry.second >= size; });
+  if (it == free_.end()) {
+    // The new tail coalesces with a free extent ending the file.
+    uint64_t tail = 0;
+    if (!free_.empty()) {
+      const auto last = std::prev(free_.end());
+      if (last->first + last->second == stats_.file_bytes)
+        tail = last->second;
+    }
+    if (!grow(size - tail))
+      return std::nullopt;
+    it = std::prev(free_.end());
+  }
+  const Extent extent{it->first, size};
+  const uint64_t rest = it->second - size;
+  free_.erase(it);
+  if (rest > 0)
+    free_.emplace(extent.offset + size, rest);
+  stats_.live_bytes += size;
+  stats_.high_water_bytes = std::max(stats_.high_water_bytes, stats_.live_bytes);
+  stats_.reserves++;
+  return extent;
+}
+
+void FhnSpillFile::release(const Extent &extent) {
+  if (extent.size == 0)
+    return;
+  stats_.live_bytes -= extent.size;
+  insertFree(extent.offset, extent.size);
+}
+
+} // namespace fhenomenon
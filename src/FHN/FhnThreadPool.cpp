@@ -0,0 +1,106 @@
+#include "FHN/FhnThreadPool.h"
+
+#include <algorithm>
+
+namespace fhenomenon {
+
+FhnThreadPool::FhnThreadPool(uint32_t threads) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  queues_.reserve(threads);
+  for (uint32_t i = 0; i < threads; ++i)
+    queues_.push_back(std::make_unique<Queue>());
+  workers_.reserve(threads - 1);
+  for (std::size_t i = 1; i < threads; ++i)
+    workers_.emplace_back([this, i] { workerLoop(i); });
+}
+
+FhnThreadPool::~FhnThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &worker : workers_)
+    worker.join();
+}
+
+void FhnThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)> &fn) {
+  if (count == 0)
+    return;
+  if (queues_.size() == 1 || count == 1) {
+    for (uint32_t i = 0; i < count; ++i)
+      fn(i);
+    return;
+  }
+
+  // Tasks carry their function: a worker still finishing the previous
+  // batch's steal loop may pick up a task of this one.
+  pending_.store(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    Queue &queue = *queues_[i % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(Task{&fn, i});
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+  }
+  wake_.notify_all();
+
+  drain(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return pending_.load() == 0; });
+}
+
+bool FhnThreadPool::popOrSteal(std::size_t self, Task &task) {
+  {
+    Queue &own = *queues_[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = own.tasks.back();
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (std::size_t k = 1; k < queues_.size(); ++k) {
+    Queue &victim = *queues_[(self + k) % queues_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.front();
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void FhnThreadPool::drain(std::size_t self) {
+  Task task{nullptr, 0};
+  while (popOrSteal(self, task)) {
+    (*task.fn)(task.index);
+    if (pending_.fetch_sub(1) == 1) {
+      // Lock before notifying so the waiter cannot miss the wakeup between
+      // its predicate check and its wait.
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_.notify_all();
+    }
+  }
+}
+
+void FhnThreadPool::workerLoop(std::size_t self) {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_)
+        return;
+      seen = generation_;
+    }
+    drain(self);
+  }
+}
+
+} // namespace fhenomenon
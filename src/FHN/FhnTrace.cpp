@@ -0,0 +1,222 @@
+#include "FHN/FhnTrace.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+
+namespace fhenomenon {
+
+namespace {
+
+// Indexed by FhnOpCode; keep in enum order.
+const char *const kOpcodeNames[FHN_OPCODE_COUNT] = {
+  "NOP", "ADD_CC", "ADD_CP", "ADD_CS", "SUB_CC", "SUB_CP", "SUB_SC", "NEGATE", "MULT_CC", "MULT_CP", "MULT_CS",
+  "RELINEARIZE", "RESCALE", "ROTATE", "CONJUGATE", "MULT_KEY", "MOD_DOWN", "LEVEL_DOWN", "HMULT", "HROT", "HROT_ADD",
+  "HCONJ_ADD", "MAD", "AND", "OR", "XOR", "EQ", "LT", "LE",
+};
+
+uint32_t bucketOf(uint64_t ns) {
+  uint32_t b = 0;
+  while (ns > 1 && b + 1 < FhnTrace::kBuckets) {
+    ns >>= 1;
+    ++b;
+  }
+  return b;
+}
+
+// Nearest-rank percentile of a sorted, non-empty sample.
+uint64_t percentile(const std::vector<uint64_t> &sorted, uint32_t pct) {
+  const std::size_t rank = (sorted.size() * pct + 99) / 100;
+  return sorted[std::max<std::size_t>(rank, 1) - 1];
+}
+
+// Kernel and track names are backend- or caller-supplied; keep the JSON
+// well-formed whatever they contain.
+void appendEscaped(std::string &out, const char *s) {
+  for (; *s != '\0'; ++s) {
+    const char c = *s;
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+}
+
+void appendUs(std::string &out, uint64_t ns) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%" PRIu64 ".%03" PRIu64, ns / 1000, ns % 1000);
+  out += buf;
+}
+
+std::string formatNs(uint64_t ns) {
+  char buf[32];
+  if (ns < 10000)
+    std::snprintf(buf, sizeof(buf), "%" PRIu64 "ns", ns);
+  else if (ns < 10000000)
+    std::snprintf(buf, sizeof(buf), "%.1fus", static_cast<double>(ns) / 1e3);
+  else
+    std::snprintf(buf, sizeof(buf), "%.1fms", static_cast<double>(ns) / 1e6);
+  return buf;
+}
+
+} // namespace
+
+const char *FhnTrace::opcodeName(FhnOpCode opcode) {
+  const auto index = static_cast<uint32_t>(opcode);
+  return index < FHN_OPCODE_COUNT ? kOpcodeNames[index] : "UNKNOWN";
+}
+
+uint32_t FhnTrace::beginTrack(const std::string &name) {
+  tracks_.push_back(name);
+  track_ = static_cast<uint32_t>(tracks_.size() - 1);
+  return track_;
+}
+
+void FhnTrace::clear() {
+  events_.clear();
+  tracks_.assign(1, "main");
+  track_ = 0;
+  origin_ = std::chrono::steady_clock::now();
+}
+
+std::vector<FhnTrace::OpcodeSummary> FhnTrace::summarize() const {
+  std::map<uint32_t, std::vector<uint64_t>> samples;
+  std::map<uint32_t, OpcodeSummary> by_op;
+  for (const FhnTraceEvent &e : events_) {
+    const auto op = static_cast<uint32_t>(e.opcode);
+    OpcodeSummary &s = by_op[op];
+    s.opcode = e.opcode;
+    ++s.count;
+    s.decomposed += e.decomposed ? 1u : 0u;
+    s.total_ns += e.duration_ns;
+    ++s.buckets[bucketOf(e.duration_ns)];
+    samples[op].push_back(e.duration_ns);
+  }
+
+  std::vector<OpcodeSummary> out;
+  out.reserve(by_op.size());
+  for (auto &[op, s] : by_op) {
+    std::vector<uint64_t> &d = samples[op];
+    std::sort(d.begin(), d.end());
+    s.p50_ns = percentile(d, 50);
+    s.p90_ns = percentile(d, 90);
+    s.p99_ns = percentile(d, 99);
+    s.max_ns = d.back();
+    out.push_back(s);
+  }
+  std::stable_sort(out.begin(), out.end(),
+                   [](const OpcodeSummary &a, const OpcodeSummary &b) { return a.total_ns > b.total_ns; });
+  return out;
+}
+
+std::string FhnTrace::histogramText() const {
+  const auto summary = summarize();
+  uint64_t grand_total = 0;
+  for (const OpcodeSummary &s : summary)
+    grand_total += s.total_ns;
+
+  std::string out;
+  char line[256];
+  std::snprintf(line, sizeof(line), "%-11s %8s %6s %10s %6s %10s %10s %10s %10s\n", "opcode", "count", "decomp",
+                "total", "share", "p50", "p90", "p99", "max");
+  out += line;
+  for (const OpcodeSummary &s : summary) {
+    const double share =
+      grand_total == 0 ? 0.0 : 100.0 * static_cast<double>(s.total_ns) / static_cast<double>(grand_total);
+    std::snprintf(line, sizeof(line), "%-11s %8u %6u %10s %5.1f%% %10s %10s %10s %10s\n", opcodeName(s.opcode), s.count,
+                  s.decomposed, formatNs(s.total_ns).c_str(), share, formatNs(s.p50_ns).c_str(),
+                  formatNs(s.p90_ns).c_str(), formatNs(s.p99_ns).c_str(), formatNs(s.max_ns).c_str());
+    out += line;
+    // Non-empty buckets only, labelled by their upper bound.
+    out += "            ";
+    for (uint32_t b = 0; b < kBuckets; ++b) {
+      if (s.buckets[b] == 0)
+        continue;
+      const std::string bound =
+        b + 1 < kBuckets ? "<" + formatNs(uint64_t{1} << (b + 1)) : ">=" + formatNs(uint64_t{1} << b);
+      std::snprintf(line, sizeof(line), " %s:%u", bound.c_str(), s.buckets[b]);
+      out += line;
+    }
+    out += '\n';
+  }
+  return out;
+}
+
+std::string FhnTrace::chromeJson() const {
+  std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  auto begin_event = [&]() {
+    if (!first)
+      out += ',';
+    first = false;
+    out += "\n{";
+  };
+
+  for (uint32_t t = 0; t < tracks_.size(); ++t) {
+    begin_event();
+    out += "\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(t) + ",\"args\":{\"name\":\"";
+    appendEscaped(out, tracks_[t].c_str());
+    out += "\"}}";
+  }
+
+  for (const FhnTraceEvent &e : events_) {
+    const std::string tid = std::to_string(e.track);
+    if (e.movement_ns > 0) {
+      begin_event();
+      out += "\"name\":\"movement\",\"cat\":\"movement\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid + ",\"ts\":";
+      appendUs(out, e.start_ns >= e.movement_ns ? e.start_ns - e.movement_ns : 0);
+      out += ",\"dur\":";
+      appendUs(out, e.movement_ns);
+      out += ",\"args\":{\"index\":" + std::to_string(e.index) + "}}";
+    }
+
+    begin_event();
+    out += "\"name\":\"";
+    out += opcodeName(e.opcode);
+    out += "\",\"cat\":\"";
+    out += e.decomposed ? "decomposed" : "kernel";
+    out += "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid + ",\"ts\":";
+    appendUs(out, e.start_ns);
+    out += ",\"dur\":";
+    appendUs(out, e.duration_ns);
+    out += ",\"args\":{\"index\":" + std::to_string(e.index) + ",\"kernel\":\"";
+    for (uint32_t k = 0; k < e.num_kernels; ++k) {
+      if (k > 0)
+        out += '+';
+      appendEscaped(out, e.kernels[k] != nullptr ? e.kernels[k] : "?");
+    }
+    out += "\",\"decomposed\":";
+    out += e.decomposed ? "true" : "false";
+    out += ",\"evict\":" + std::to_string(e.evict) + ",\"alloc\":" + std::to_string(e.alloc) +
+           ",\"prefetch\":" + std::to_string(e.prefetch) + ",\"free\":" + std::to_string(e.free);
+    if (e.discard != 0 || e.recompute != 0)
+      out += ",\"discard\":" + std::to_string(e.discard) + ",\"recompute\":" + std::to_string(e.recompute);
+    if (e.prefetch_async != 0 || e.fence != 0)
+      out += ",\"prefetch_async\":" + std::to_string(e.prefetch_async) + ",\"fence\":" + std::to_string(e.fence);
+    if (e.level_down != 0)
+      out += ",\"level_down\":" + std::to_string(e.level_down);
+    if (e.spill != 0 || e.unspill != 0)
+      out += ",\"spill\":" + std::to_string(e.spill) + ",\"unspill\":" + std::to_string(e.unspill);
+    out += "}}";
+  }
+  out += "\n]}\n";
+  return out;
+}
+
+int FhnTrace::writeChromeJson(const std::string &path) const {
+  std::FILE *f = std::fopen(path.c_str(), "w");
+  if (f == nullptr)
+    return -1;
+  const std::string json = chromeJson();
+  const bool ok = std::fwrite(json.data(), 1, json.size(), f) == json.size();
+  return (std::fclose(f) == 0 && ok) ? 0 : -1;
+}
+
+} // namespace fhenomenon
@@ -1,8 +1,21 @@
 #include "FHN/ToyFheKernels.h"
 #include "Crypto/ToyFHE.h"
+#include "Crypto/ToyFheRlwe.h"
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnThreadPool.h"
 
+#include <algorithm>
 #include <cmath>
+#include <condition_variable>
+#include <cstring>
 #include <cstddef>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <thread>
 #include <vector>
 
 // ---------------------------------------------------------------------------
@@ -13,19 +26,95 @@
 
 // --- Concrete types behind the opaque handles ---
 
+// Single worker thread behind the async exports, started on first submit.
+struct ToyAsyncWorker {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<FhnExecHandle *> jobs;
+  bool stop = false;
+  std::thread thread;
+};
+
+// The engine's slot loops on a ctx-owned pool: chunks of at least `grain`
+// work (slots times the loop's per-slot cost), up to four per thread so
+// work stealing can even them out. FhnThreadPool runs one batch at a time,
+// so a kernel that finds the pool busy (the wavefront or async executor
+// running kernels side by side) runs its slots inline instead of waiting.
+class ToySlotRunner final : public fhenomenon::toyfhe::SlotRunner {
+  public:
+  ToySlotRunner(uint32_t threads, std::size_t grain) : pool_(threads), grain_(std::max<std::size_t>(grain, 1)) {}
+
+  void run(std::size_t n, std::size_t cost, Chunk chunk, void *arg) override {
+    const std::size_t chunks = std::min({n * cost / grain_, n, 4 * std::size_t{pool_.threadCount()}});
+    std::unique_lock<std::mutex> lock(busy_, std::try_to_lock);
+    if (chunks <= 1 || !lock.owns_lock()) {
+      chunk(arg, 0, n);
+      return;
+    }
+    const std::size_t size = (n + chunks - 1) / chunks;
+    pool_.parallelFor(static_cast<uint32_t>((n + size - 1) / size), [&](uint32_t i) {
+      const std::size_t begin = std::size_t{i} * size;
+      chunk(arg, begin, std::min(n, begin + size));
+    });
+  }
+
+  private:
+  fhenomenon::FhnThreadPool pool_;
+  std::size_t grain_;
+  std::mutex busy_;
+};
+
 struct FhnBackendCtx {
   fhenomenon::toyfhe::Engine engine;
   fhenomenon::toyfhe::Parameters params;
+  std::mutex async_mutex; // guards lazy creation of async
+  std::unique_ptr<ToyAsyncWorker> async;
+  std::optional<uint64_t> key_seed; // config "key_seed": contexts sharing it share keys
+  // Config "packed": true — vectors encrypt into one RLWE ciphertext
+  // (config "ring_dim" slots per row pair) instead of one toy ciphertext
+  // per slot. Scalars still go through `engine`.
+  std::unique_ptr<fhenomenon::toyfhe::RlweEngine> packed;
+  // Config "lazy_rotate": false makes ROTATE copy the slots into rotated
+  // order again, as before rotations were recorded as offsets. Kept so
+  // benchmarks can compare the two.
+  bool lazy_rotate = true;
+  // Config "slot_threads": T (0 = hardware concurrency) and "slot_grain":
+  // G. With T other than 1 the engine's vector kernels and bulk encryption
+  // split their slots across this pool in chunks of at least G SIMD slot
+  // additions' worth of work (1024 ciphertext products by default); the
+  // default T = 1 keeps them on the calling thread, and allocation-free.
+  // Config "encrypt_threads": T, from when bulk encryption had threads of
+  // its own, sizes the pool when slot_threads is not given.
+  uint32_t slot_threads = 1;
+  std::size_t slot_grain = 65536;
+  std::unique_ptr<ToySlotRunner> slot_runner;
+  // Slot storage a lazy ROTATE released (its result re-pointed at the
+  // source's slots), handed to the next write into a shared buffer so that
+  // repeated runs of a program allocate none. Bounded by kToyVecPoolCap;
+  // guarded because the wavefront executor runs kernels concurrently.
+  std::mutex vec_pool_mutex;
+  std::vector<std::shared_ptr<fhenomenon::toyfhe::CiphertextVec>> vec_pool;
 };
 
-enum class BufKind { Empty, Ciphertext, IntValue, DoubleValue, CiphertextVec };
+static constexpr std::size_t kToyVecPoolCap = 64;
+
+enum class BufKind { Empty, Ciphertext, IntValue, DoubleValue, CiphertextVec, PackedCiphertext };
 
 struct FhnBuffer {
   BufKind kind = BufKind::Empty;
   fhenomenon::toyfhe::Ciphertext ct;
   // Multi-slot vector ciphertext: ToyFHE is single-slot, so slot packing is
-  // emulated with one independent toy ciphertext per slot.
-  std::vector<fhenomenon::toyfhe::Ciphertext> ct_vec;
+  // emulated with one independent toy ciphertext per slot, stored as
+  // structure-of-arrays so slot-wise kernels vectorize. Buffers share slot
+  // storage copy-on-write: ROTATE points the result at its source's slots
+  // and records the distance in ct_rot, and kernels read through that
+  // offset (toyfhe_view) inside their own slot loop. Results are written
+  // through toyfhe_vec_out, which reuses the storage only while this
+  // buffer is its sole owner and otherwise recycles storage a ROTATE let go.
+  std::shared_ptr<fhenomenon::toyfhe::CiphertextVec> ct_vec;
+  std::size_t ct_rot = 0;
+  // Packed mode: the whole vector in one RLWE ciphertext.
+  fhenomenon::toyfhe::RlweCiphertext packed_ct;
   int64_t int_val = 0;
   double double_val = 0.0;
 };
@@ -34,33 +123,102 @@ struct FhnBuffer {
 
 static bool toyfhe_is_vec(const FhnBuffer *buf) { return buf != nullptr && buf->kind == BufKind::CiphertextVec; }
 
+static std::size_t toyfhe_vec_size(const FhnBuffer *buf) { return buf->ct_vec ? buf->ct_vec->size() : 0; }
+
+// A vector buffer's slots in logical order.
+static fhenomenon::toyfhe::VecView toyfhe_view(const FhnBuffer *buf) {
+  return fhenomenon::toyfhe::VecView(*buf->ct_vec, buf->ct_rot);
+}
+
+// Slot storage to write a vector result into: the buffer's own when no
+// other buffer shares it (warm when the buffer is recycled by an
+// FhnBufferPool), else one from the ctx's pool, else a fresh one. Take
+// operand views first — this resets the buffer's rotation.
+static fhenomenon::toyfhe::CiphertextVec &toyfhe_vec_out(FhnBackendCtx *ctx, FhnBuffer *result) {
+  if (!result->ct_vec || result->ct_vec.use_count() != 1) {
+    std::unique_lock<std::mutex> lock(ctx->vec_pool_mutex);
+    if (ctx->vec_pool.empty()) {
+      lock.unlock();
+      result->ct_vec = std::make_shared<fhenomenon::toyfhe::CiphertextVec>();
+    } else {
+      result->ct_vec = std::move(ctx->vec_pool.back());
+      ctx->vec_pool.pop_back();
+    }
+  }
+  result->ct_rot = 0;
+  result->kind = BufKind::CiphertextVec;
+  return *result->ct_vec;
+}
+
+static bool toyfhe_is_packed(const FhnBuffer *buf) {
+  return buf != nullptr && buf->kind == BufKind::PackedCiphertext;
+}
+
 // Normalize a signed rotation distance into [0, n). Positive = left.
 static std::size_t toyfhe_norm_rot(int64_t d, std::size_t n) {
   const int64_t sn = static_cast<int64_t>(n);
   return static_cast<std::size_t>(((d % sn) + sn) % sn);
 }
 
-typedef fhenomenon::toyfhe::Ciphertext (fhenomenon::toyfhe::Engine::*ToyBinOp)(
-  const fhenomenon::toyfhe::Ciphertext &, const fhenomenon::toyfhe::Ciphertext &) const;
+typedef void (fhenomenon::toyfhe::Engine::*ToyVecOp)(fhenomenon::toyfhe::VecView, fhenomenon::toyfhe::VecView,
+                                                     fhenomenon::toyfhe::CiphertextVec &) const;
 
-// Slot-wise binary engine op over two CiphertextVec operands of equal size.
-// Computes into a local vector first so the result may alias either operand —
-// the executor's decomposition paths issue in-place calls per the ABI
-// contract in fhn_backend_api.h.
+// Slot-wise binary engine op over two CiphertextVec operands of equal size,
+// written straight into the result's slot arrays. The engine's vector ops
+// allow the result to alias either operand — the executor's decomposition
+// paths issue in-place calls per the ABI contract in fhn_backend_api.h.
 static int toyfhe_vec_binary(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *a, const FhnBuffer *b,
-                             ToyBinOp op) {
-  if (a->ct_vec.empty() || a->ct_vec.size() != b->ct_vec.size())
+                             ToyVecOp op) {
+  if (toyfhe_vec_size(a) == 0 || toyfhe_vec_size(a) != toyfhe_vec_size(b))
     return -1;
-  std::vector<fhenomenon::toyfhe::Ciphertext> out;
-  out.reserve(a->ct_vec.size());
-  for (std::size_t i = 0; i < a->ct_vec.size(); ++i) {
-    out.push_back((ctx->engine.*op)(a->ct_vec[i], b->ct_vec[i]));
-  }
-  result->ct_vec = std::move(out);
-  result->kind = BufKind::CiphertextVec;
+  const fhenomenon::toyfhe::VecView va = toyfhe_view(a);
+  const fhenomenon::toyfhe::VecView vb = toyfhe_view(b);
+  (ctx->engine.*op)(va, vb, toyfhe_vec_out(ctx, result));
+  return 0;
+}
+
+// Mixed scalar/vector operands are not defined: -1 when exactly one of a
+// and b is a vector, 1 when both are, 0 when neither is.
+static int toyfhe_vec_operands(const FhnBuffer *a, const FhnBuffer *b) {
+  if (toyfhe_is_vec(a) != toyfhe_is_vec(b))
+    return -1;
+  return toyfhe_is_vec(a) ? 1 : 0;
+}
+
+// --- Packed (RLWE) helpers ----------------------------------------------------
+
+typedef void (fhenomenon::toyfhe::RlweEngine::*ToyPackedOp)(const fhenomenon::toyfhe::RlweCiphertext &,
+                                                            const fhenomenon::toyfhe::RlweCiphertext &,
+                                                            fhenomenon::toyfhe::RlweCiphertext &) const;
+
+// Same contract as toyfhe_vec_operands, for packed ciphertexts: -1 when
+// exactly one of a and b is packed or their slot counts differ.
+static int toyfhe_packed_operands(const FhnBuffer *a, const FhnBuffer *b) {
+  if (toyfhe_is_packed(a) != toyfhe_is_packed(b))
+    return -1;
+  if (!toyfhe_is_packed(a))
+    return 0;
+  return a->packed_ct.slots == b->packed_ct.slots ? 1 : -1;
+}
+
+// The RLWE engine's ops also allow the result to alias either operand.
+static int toyfhe_packed_binary(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *a, const FhnBuffer *b,
+                                ToyPackedOp op) {
+  if (!ctx->packed)
+    return -1;
+  (ctx->packed.get()->*op)(a->packed_ct, b->packed_ct, result->packed_ct);
+  result->kind = BufKind::PackedCiphertext;
   return 0;
 }
 
+// A packed plaintext operand is an integer mod t; fractional scalars have
+// no encoding there.
+static std::optional<int64_t> toyfhe_packed_scalar(double value) {
+  if (!std::isfinite(value) || std::nearbyint(value) != value || std::fabs(value) > 9.0e18)
+    return std::nullopt;
+  return static_cast<int64_t>(value);
+}
+
 // --- Kernel implementations ------------------------------------------------
 
 static int toyfhe_add_cc(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands,
@@ -69,12 +227,10 @@ static int toyfhe_add_cc(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer
   const FhnBuffer *b = operands[1];
   if (a == nullptr || b == nullptr)
     return -1;
-  if (toyfhe_is_vec(a) || toyfhe_is_vec(b)) {
-    // Mixed scalar/vector operands are not defined.
-    if (!toyfhe_is_vec(a) || !toyfhe_is_vec(b))
-      return -1;
-    return toyfhe_vec_binary(ctx, result, a, b, &fhenomenon::toyfhe::Engine::add);
-  }
+  if (const int packed = toyfhe_packed_operands(a, b))
+    return packed < 0 ? -1 : toyfhe_packed_binary(ctx, result, a, b, &fhenomenon::toyfhe::RlweEngine::add);
+  if (const int vec = toyfhe_vec_operands(a, b))
+    return vec < 0 ? -1 : toyfhe_vec_binary(ctx, result, a, b, &fhenomenon::toyfhe::Engine::addVec);
   result->ct = ctx->engine.add(a->ct, b->ct);
   result->kind = BufKind::Ciphertext;
   return 0;
@@ -82,6 +238,14 @@ static int toyfhe_add_cc(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer
 
 static int toyfhe_add_cs(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands,
                          const int64_t * /*params*/, const double *fparams) {
+  if (toyfhe_is_packed(operands[0])) {
+    const std::optional<int64_t> scalar = toyfhe_packed_scalar(fparams[0]);
+    if (!ctx->packed || !scalar)
+      return -1;
+    ctx->packed->addPlain(operands[0]->packed_ct, *scalar, result->packed_ct);
+    result->kind = BufKind::PackedCiphertext;
+    return 0;
+  }
   result->ct = ctx->engine.addPlain(operands[0]->ct, fparams[0]);
   result->kind = BufKind::Ciphertext;
   return 0;
@@ -89,6 +253,14 @@ static int toyfhe_add_cs(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer
 
 static int toyfhe_sub_cc(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands,
                          const int64_t * /*params*/, const double * /*fparams*/) {
+  const FhnBuffer *a = operands[0];
+  const FhnBuffer *b = operands[1];
+  if (a == nullptr || b == nullptr)
+    return -1;
+  if (const int packed = toyfhe_packed_operands(a, b))
+    return packed < 0 ? -1 : toyfhe_packed_binary(ctx, result, a, b, &fhenomenon::toyfhe::RlweEngine::sub);
+  if (const int vec = toyfhe_vec_operands(a, b))
+    return vec < 0 ? -1 : toyfhe_vec_binary(ctx, result, a, b, &fhenomenon::toyfhe::Engine::subVec);
   // ToyFHE has no direct subtract — negate b then add.
   fhenomenon::toyfhe::Ciphertext neg_b = operands[1]->ct;
   neg_b.c0 = -neg_b.c0;
@@ -98,8 +270,20 @@ static int toyfhe_sub_cc(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer
   return 0;
 }
 
-static int toyfhe_negate(FhnBackendCtx * /*ctx*/, FhnBuffer *result, const FhnBuffer *const *operands,
+static int toyfhe_negate(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands,
                          const int64_t * /*params*/, const double * /*fparams*/) {
+  if (toyfhe_is_packed(operands[0])) {
+    if (!ctx->packed)
+      return -1;
+    ctx->packed->negate(operands[0]->packed_ct, result->packed_ct);
+    result->kind = BufKind::PackedCiphertext;
+    return 0;
+  }
+  if (toyfhe_is_vec(operands[0])) {
+    const fhenomenon::toyfhe::VecView src = toyfhe_view(operands[0]);
+    ctx->engine.negateVec(src, toyfhe_vec_out(ctx, result));
+    return 0;
+  }
   result->ct = operands[0]->ct;
   result->ct.c0 = -result->ct.c0;
   result->ct.c1 = -result->ct.c1;
@@ -113,12 +297,10 @@ static int toyfhe_mult_cc(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer
   const FhnBuffer *b = operands[1];
   if (a == nullptr || b == nullptr)
     return -1;
-  if (toyfhe_is_vec(a) || toyfhe_is_vec(b)) {
-    // Mixed scalar/vector operands are not defined.
-    if (!toyfhe_is_vec(a) || !toyfhe_is_vec(b))
-      return -1;
-    return toyfhe_vec_binary(ctx, result, a, b, &fhenomenon::toyfhe::Engine::multiply);
-  }
+  if (const int packed = toyfhe_packed_operands(a, b))
+    return packed < 0 ? -1 : toyfhe_packed_binary(ctx, result, a, b, &fhenomenon::toyfhe::RlweEngine::multiply);
+  if (const int vec = toyfhe_vec_operands(a, b))
+    return vec < 0 ? -1 : toyfhe_vec_binary(ctx, result, a, b, &fhenomenon::toyfhe::Engine::multiplyVec);
   result->ct = ctx->engine.multiply(a->ct, b->ct);
   result->kind = BufKind::Ciphertext;
   return 0;
@@ -126,11 +308,40 @@ static int toyfhe_mult_cc(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer
 
 static int toyfhe_mult_cs(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands,
                           const int64_t * /*params*/, const double *fparams) {
+  if (toyfhe_is_packed(operands[0])) {
+    const std::optional<int64_t> scalar = toyfhe_packed_scalar(fparams[0]);
+    if (!ctx->packed || !scalar)
+      return -1;
+    ctx->packed->multiplyPlain(operands[0]->packed_ct, *scalar, result->packed_ct);
+    result->kind = BufKind::PackedCiphertext;
+    return 0;
+  }
+  if (toyfhe_is_vec(operands[0])) {
+    const fhenomenon::toyfhe::VecView src = toyfhe_view(operands[0]);
+    ctx->engine.multiplyPlainVec(src, fparams[0], toyfhe_vec_out(ctx, result));
+    return 0;
+  }
   result->ct = ctx->engine.multiplyPlain(operands[0]->ct, fparams[0]);
   result->kind = BufKind::Ciphertext;
   return 0;
 }
 
+// Fused multiply-by-scalar and add: result = a * fparams[0] + b. The
+// product is formed in a local first, so result may alias a (not b, per the
+// opcode's contract).
+static int toyfhe_mad(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands,
+                      const int64_t * /*params*/, const double *fparams) {
+  const FhnBuffer *a = operands[0];
+  const FhnBuffer *b = operands[1];
+  if (a == nullptr || b == nullptr || toyfhe_is_vec(a) || toyfhe_is_vec(b) || toyfhe_is_packed(a) ||
+      toyfhe_is_packed(b))
+    return -1;
+  fhenomenon::toyfhe::Ciphertext product = ctx->engine.multiplyPlain(a->ct, fparams[0]);
+  result->ct = ctx->engine.add(product, b->ct);
+  result->kind = BufKind::Ciphertext;
+  return 0;
+}
+
 // ToyFHE multiply performs relinearization and rescale internally, so the
 // fused HMULT (mult + relin + rescale) is exactly MULT_CC.
 static int toyfhe_hmult(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *params,
@@ -140,20 +351,35 @@ static int toyfhe_hmult(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *
 
 // Cyclic rotation of a CiphertextVec. params[0] is a signed distance:
 // positive rotates left (result[i] = src[(i + d) mod n]), negative rotates
-// right. Scalar ciphertexts have no slots to rotate.
-static int toyfhe_rotate(FhnBackendCtx * /*ctx*/, FhnBuffer *result, const FhnBuffer *const *operands,
+// right. O(1): the result shares the source's slots at a further offset
+// (or copies them into rotated order when the ctx has lazy_rotate off).
+// Scalar ciphertexts have no slots to rotate. A packed ciphertext rotates
+// by Galois automorphisms, one key switch per set bit of d.
+static int toyfhe_rotate(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands,
                          const int64_t *params, const double * /*fparams*/) {
   const FhnBuffer *src = operands[0];
-  if (!toyfhe_is_vec(src) || src->ct_vec.empty())
+  if (toyfhe_is_packed(src)) {
+    if (!ctx->packed || src->packed_ct.slots == 0)
+      return -1;
+    ctx->packed->rotate(src->packed_ct, toyfhe_norm_rot(params[0], src->packed_ct.slots), result->packed_ct);
+    result->kind = BufKind::PackedCiphertext;
+    return 0;
+  }
+  if (!toyfhe_is_vec(src) || toyfhe_vec_size(src) == 0)
     return -1;
-  const std::size_t n = src->ct_vec.size();
-  const std::size_t d = toyfhe_norm_rot(params[0], n);
-  std::vector<fhenomenon::toyfhe::Ciphertext> out;
-  out.reserve(n);
-  for (std::size_t i = 0; i < n; ++i) {
-    out.push_back(src->ct_vec[(i + d) % n]);
+  const fhenomenon::toyfhe::VecView view = toyfhe_view(src);
+  const fhenomenon::toyfhe::VecView rotated = view.rotated(toyfhe_norm_rot(params[0], view.size()));
+  if (!ctx->lazy_rotate) {
+    fhenomenon::toyfhe::Engine::materializeVec(rotated, toyfhe_vec_out(ctx, result));
+    return 0;
+  }
+  if (result->ct_vec && result->ct_vec != src->ct_vec && result->ct_vec.use_count() == 1) {
+    std::lock_guard<std::mutex> lock(ctx->vec_pool_mutex);
+    if (ctx->vec_pool.size() < kToyVecPoolCap)
+      ctx->vec_pool.push_back(std::move(result->ct_vec));
   }
-  result->ct_vec = std::move(out);
+  result->ct_vec = src->ct_vec;
+  result->ct_rot = rotated.rotation;
   result->kind = BufKind::CiphertextVec;
   return 0;
 }
@@ -161,21 +387,32 @@ static int toyfhe_rotate(FhnBackendCtx * /*ctx*/, FhnBuffer *result, const FhnBu
 // Fused rotate-and-add in one pass: result[i] = a[(i + d) mod n] + b[i].
 // This is the fusion the matvec benchmark measures against the executor's
 // decomposition into ROTATE + ADD_CC (two full passes over the slots).
+// Packed, the rotation dominates and the add is one pass over 2N words;
+// the rotation goes to a local when result aliases b.
 static int toyfhe_hrot_add(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands,
                            const int64_t *params, const double * /*fparams*/) {
   const FhnBuffer *a = operands[0];
   const FhnBuffer *b = operands[1];
-  if (!toyfhe_is_vec(a) || !toyfhe_is_vec(b) || a->ct_vec.empty() || a->ct_vec.size() != b->ct_vec.size())
-    return -1;
-  const std::size_t n = a->ct_vec.size();
-  const std::size_t d = toyfhe_norm_rot(params[0], n);
-  std::vector<fhenomenon::toyfhe::Ciphertext> out;
-  out.reserve(n);
-  for (std::size_t i = 0; i < n; ++i) {
-    out.push_back(ctx->engine.add(a->ct_vec[(i + d) % n], b->ct_vec[i]));
+  if (const int packed = toyfhe_packed_operands(a, b)) {
+    if (packed < 0 || !ctx->packed || a->packed_ct.slots == 0)
+      return -1;
+    const std::size_t d = toyfhe_norm_rot(params[0], a->packed_ct.slots);
+    if (result == b) {
+      fhenomenon::toyfhe::RlweCiphertext rotated;
+      ctx->packed->rotate(a->packed_ct, d, rotated);
+      ctx->packed->add(rotated, b->packed_ct, result->packed_ct);
+    } else {
+      ctx->packed->rotate(a->packed_ct, d, result->packed_ct);
+      ctx->packed->add(result->packed_ct, b->packed_ct, result->packed_ct);
+    }
+    result->kind = BufKind::PackedCiphertext;
+    return 0;
   }
-  result->ct_vec = std::move(out);
-  result->kind = BufKind::CiphertextVec;
+  if (!toyfhe_is_vec(a) || !toyfhe_is_vec(b) || toyfhe_vec_size(a) == 0 || toyfhe_vec_size(a) != toyfhe_vec_size(b))
+    return -1;
+  const fhenomenon::toyfhe::VecView va = toyfhe_view(a);
+  const fhenomenon::toyfhe::VecView vb = toyfhe_view(b);
+  ctx->engine.rotateAddVec(va, toyfhe_norm_rot(params[0], va.size()), vb, toyfhe_vec_out(ctx, result));
   return 0;
 }
 
@@ -186,7 +423,8 @@ static int toyfhe_hrot_add(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffe
 static int toyfhe_passthrough(FhnBackendCtx * /*ctx*/, FhnBuffer *result, const FhnBuffer *const *operands,
                               const int64_t * /*params*/, const double * /*fparams*/) {
   const FhnBuffer *src = operands[0];
-  if (src == nullptr || (src->kind != BufKind::Ciphertext && src->kind != BufKind::CiphertextVec))
+  if (src == nullptr || (src->kind != BufKind::Ciphertext && src->kind != BufKind::CiphertextVec &&
+                         src->kind != BufKind::PackedCiphertext))
     return -1;
   if (result != src) {
     *result = *src;
@@ -194,6 +432,148 @@ static int toyfhe_passthrough(FhnBackendCtx * /*ctx*/, FhnBuffer *result, const
   return 0;
 }
 
+// --- Batched kernels ---------------------------------------------------------
+// One call covers every request of an executeBatch() instruction. Vector
+// requests go to the engine's batched ops: operand checks and the ctx's
+// storage pool lock happen once per batch, scale bookkeeping once, and a
+// single slot loop runs over all requests' slots (split by the slot runner
+// like any other). A batch with a scalar or packed request runs the
+// single-request kernel per request instead.
+
+static int toyfhe_batch_each(FhnBackendCtx *ctx, uint32_t count, FhnBuffer *const *results,
+                             const FhnBuffer *const *operands, const int64_t *params, const double *fparams,
+                             FhnKernelFn kernel) {
+  for (uint32_t r = 0; r < count; ++r) {
+    const int rc = kernel(ctx, results[r], operands + static_cast<std::size_t>(r) * 4, params, fparams);
+    if (rc != 0)
+      return rc;
+  }
+  return 0;
+}
+
+// Operand views and result storage of a vector batch. Per thread, so the
+// capacity carries over from call to call.
+struct ToyVecBatch {
+  std::vector<fhenomenon::toyfhe::VecView> lhs;
+  std::vector<fhenomenon::toyfhe::VecView> rhs;
+  std::vector<fhenomenon::toyfhe::CiphertextVec *> out;
+};
+
+static ToyVecBatch &toyfhe_vec_batch() {
+  thread_local ToyVecBatch batch;
+  return batch;
+}
+
+// Whether operand `which` of every request is a vector of n > 0 slots
+// (n taken from request 0).
+static bool toyfhe_batch_is_vec(uint32_t count, const FhnBuffer *const *operands, uint32_t which) {
+  const std::size_t n = toyfhe_is_vec(operands[which]) ? toyfhe_vec_size(operands[which]) : 0;
+  if (n == 0)
+    return false;
+  for (uint32_t r = 0; r < count; ++r) {
+    const FhnBuffer *buf = operands[static_cast<std::size_t>(r) * 4 + which];
+    if (!toyfhe_is_vec(buf) || toyfhe_vec_size(buf) != n)
+      return false;
+  }
+  return true;
+}
+
+// toyfhe_vec_out for every request, taking the pool lock at most once.
+static void toyfhe_vec_outs(FhnBackendCtx *ctx, uint32_t count, FhnBuffer *const *results,
+                            std::vector<fhenomenon::toyfhe::CiphertextVec *> &out) {
+  std::unique_lock<std::mutex> lock(ctx->vec_pool_mutex, std::defer_lock);
+  out.clear();
+  for (uint32_t r = 0; r < count; ++r) {
+    FhnBuffer *result = results[r];
+    if (!result->ct_vec || result->ct_vec.use_count() != 1) {
+      if (!lock.owns_lock())
+        lock.lock();
+      if (ctx->vec_pool.empty()) {
+        result->ct_vec = std::make_shared<fhenomenon::toyfhe::CiphertextVec>();
+      } else {
+        result->ct_vec = std::move(ctx->vec_pool.back());
+        ctx->vec_pool.pop_back();
+      }
+    }
+    result->ct_rot = 0;
+    result->kind = BufKind::CiphertextVec;
+    out.push_back(result->ct_vec.get());
+  }
+}
+
+typedef void (fhenomenon::toyfhe::Engine::*ToyVecBatchOp)(const fhenomenon::toyfhe::VecView *,
+                                                          const fhenomenon::toyfhe::VecView *,
+                                                          fhenomenon::toyfhe::CiphertextVec *const *,
+                                                          std::size_t) const;
+
+// A binary vector op over the whole batch, lhs rotated left by `distance`.
+// False (nothing written) when some request is not a vector pair of
+// request 0's slot count.
+static bool toyfhe_batch_vec_binary(FhnBackendCtx *ctx, uint32_t count, FhnBuffer *const *results,
+                                    const FhnBuffer *const *operands, int64_t distance, ToyVecBatchOp op) {
+  if (!toyfhe_batch_is_vec(count, operands, 0) || !toyfhe_batch_is_vec(count, operands, 1) ||
+      toyfhe_vec_size(operands[0]) != toyfhe_vec_size(operands[1]))
+    return false;
+  const std::size_t d = toyfhe_norm_rot(distance, toyfhe_vec_size(operands[0]));
+  ToyVecBatch &batch = toyfhe_vec_batch();
+  batch.lhs.clear();
+  batch.rhs.clear();
+  for (uint32_t r = 0; r < count; ++r) {
+    batch.lhs.push_back(toyfhe_view(operands[static_cast<std::size_t>(r) * 4]).rotated(d));
+    batch.rhs.push_back(toyfhe_view(operands[static_cast<std::size_t>(r) * 4 + 1]));
+  }
+  toyfhe_vec_outs(ctx, count, results, batch.out);
+  (ctx->engine.*op)(batch.lhs.data(), batch.rhs.data(), batch.out.data(), count);
+  return true;
+}
+
+static int toyfhe_batch_add_cc(FhnBackendCtx *ctx, uint32_t count, FhnBuffer *const *results,
+                               const FhnBuffer *const *operands, const int64_t *params, const double *fparams) {
+  if (toyfhe_batch_vec_binary(ctx, count, results, operands, 0, &fhenomenon::toyfhe::Engine::addVecBatch))
+    return 0;
+  return toyfhe_batch_each(ctx, count, results, operands, params, fparams, toyfhe_add_cc);
+}
+
+static int toyfhe_batch_mult_cc(FhnBackendCtx *ctx, uint32_t count, FhnBuffer *const *results,
+                                const FhnBuffer *const *operands, const int64_t *params, const double *fparams) {
+  if (toyfhe_batch_vec_binary(ctx, count, results, operands, 0, &fhenomenon::toyfhe::Engine::multiplyVecBatch))
+    return 0;
+  return toyfhe_batch_each(ctx, count, results, operands, params, fparams, toyfhe_mult_cc);
+}
+
+static int toyfhe_batch_hrot_add(FhnBackendCtx *ctx, uint32_t count, FhnBuffer *const *results,
+                                 const FhnBuffer *const *operands, const int64_t *params, const double *fparams) {
+  if (toyfhe_batch_vec_binary(ctx, count, results, operands, params[0], &fhenomenon::toyfhe::Engine::addVecBatch))
+    return 0;
+  return toyfhe_batch_each(ctx, count, results, operands, params, fparams, toyfhe_hrot_add);
+}
+
+// Lazy rotations move no slots, so batching them saves the per-request
+// checks and takes the pool lock once for the storage results release.
+static int toyfhe_batch_rotate(FhnBackendCtx *ctx, uint32_t count, FhnBuffer *const *results,
+                               const FhnBuffer *const *operands, const int64_t *params, const double *fparams) {
+  if (!ctx->lazy_rotate || !toyfhe_batch_is_vec(count, operands, 0))
+    return toyfhe_batch_each(ctx, count, results, operands, params, fparams, toyfhe_rotate);
+  const std::size_t n = toyfhe_vec_size(operands[0]);
+  const std::size_t d = toyfhe_norm_rot(params[0], n);
+  std::unique_lock<std::mutex> lock(ctx->vec_pool_mutex, std::defer_lock);
+  for (uint32_t r = 0; r < count; ++r) {
+    const FhnBuffer *src = operands[static_cast<std::size_t>(r) * 4];
+    FhnBuffer *result = results[r];
+    const std::size_t rotation = (src->ct_rot + d) % n;
+    if (result->ct_vec && result->ct_vec != src->ct_vec && result->ct_vec.use_count() == 1) {
+      if (!lock.owns_lock())
+        lock.lock();
+      if (ctx->vec_pool.size() < kToyVecPoolCap)
+        ctx->vec_pool.push_back(std::move(result->ct_vec));
+    }
+    result->ct_vec = src->ct_vec;
+    result->ct_rot = rotation;
+    result->kind = BufKind::CiphertextVec;
+  }
+  return 0;
+}
+
 // --- Kernel table ----------------------------------------------------------
 
 // Compute-only: encryption and decryption are host-side data-plane exports
@@ -210,6 +590,7 @@ static FhnKernelEntry toyfhe_kernels[] = {
   {FHN_ROTATE, toyfhe_rotate, "rotate"},
   {FHN_HMULT, toyfhe_hmult, "hmult"},
   {FHN_HROT_ADD, toyfhe_hrot_add, "hrot_add"},
+  {FHN_MAD, toyfhe_mad, "mad"},
 };
 
 static FhnKernelTable toyfhe_kernel_table = {
@@ -217,6 +598,19 @@ static FhnKernelTable toyfhe_kernel_table = {
   toyfhe_kernels,
 };
 
+static FhnBatchKernelEntry toyfhe_batch_kernels[] = {
+  {FHN_ADD_CC, toyfhe_batch_add_cc, "add_cc"},
+  {FHN_MULT_CC, toyfhe_batch_mult_cc, "mult_cc"},
+  {FHN_HMULT, toyfhe_batch_mult_cc, "hmult"},
+  {FHN_ROTATE, toyfhe_batch_rotate, "rotate"},
+  {FHN_HROT_ADD, toyfhe_batch_hrot_add, "hrot_add"},
+};
+
+static FhnBatchKernelTable toyfhe_batch_kernel_table = {
+  sizeof(toyfhe_batch_kernels) / sizeof(toyfhe_batch_kernels[0]),
+  toyfhe_batch_kernels,
+};
+
 // --- Backend exports -------------------------------------------------------
 
 uint32_t toyfhe_fhn_get_abi_version(void) { return FHN_ABI_VERSION; }
@@ -231,18 +625,71 @@ FhnBackendInfo *toyfhe_fhn_get_info(void) {
   return &info;
 }
 
-FhnBackendCtx *toyfhe_fhn_create(const char * /*config_json*/) {
+FhnBackendCtx *toyfhe_fhn_create(const char *config_json) {
   auto *ctx = new FhnBackendCtx();
+  ctx->vec_pool.reserve(kToyVecPoolCap);
   ctx->params = fhenomenon::toyfhe::Parameters{}; // defaults
   ctx->engine.initialize(ctx->params);
-  ctx->engine.generateKeys();
+  fhenomenon::toyfhe::RlweParameters packed_params;
+  bool packed = false;
+  if (config_json && *config_json) {
+    const auto config = nlohmann::json::parse(config_json, nullptr, false);
+    if (config.is_object() && config.contains("key_seed") && config["key_seed"].is_number_unsigned())
+      ctx->key_seed = config["key_seed"].get<uint64_t>();
+    if (config.is_object() && config.contains("packed") && config["packed"].is_boolean())
+      packed = config["packed"].get<bool>();
+    if (config.is_object() && config.contains("ring_dim") && config["ring_dim"].is_number_unsigned())
+      packed_params.ring_dim = config["ring_dim"].get<std::size_t>();
+    if (config.is_object() && config.contains("encrypt_threads") && config["encrypt_threads"].is_number_unsigned())
+      ctx->slot_threads = std::max(1u, config["encrypt_threads"].get<uint32_t>());
+    if (config.is_object() && config.contains("lazy_rotate") && config["lazy_rotate"].is_boolean())
+      ctx->lazy_rotate = config["lazy_rotate"].get<bool>();
+    if (config.is_object() && config.contains("slot_threads") && config["slot_threads"].is_number_unsigned())
+      ctx->slot_threads = config["slot_threads"].get<uint32_t>();
+    if (config.is_object() && config.contains("slot_grain") && config["slot_grain"].is_number_unsigned())
+      ctx->slot_grain = std::max<std::size_t>(1, config["slot_grain"].get<std::size_t>());
+  }
+  if (ctx->slot_threads != 1) {
+    ctx->slot_runner = std::make_unique<ToySlotRunner>(ctx->slot_threads, ctx->slot_grain);
+    ctx->engine.setSlotRunner(ctx->slot_runner.get());
+  }
+  if (ctx->key_seed)
+    ctx->engine.generateKeys(*ctx->key_seed);
+  else
+    ctx->engine.generateKeys();
+  if (packed) {
+    ctx->packed = std::make_unique<fhenomenon::toyfhe::RlweEngine>();
+    try {
+      ctx->packed->initialize(packed_params);
+    } catch (const std::exception &e) {
+      std::cerr << "toyfhe fhn_create error: " << e.what() << std::endl;
+      delete ctx;
+      return nullptr;
+    }
+    if (ctx->key_seed)
+      ctx->packed->generateKeys(*ctx->key_seed);
+    else
+      ctx->packed->generateKeys();
+  }
   return ctx;
 }
 
-void toyfhe_fhn_destroy(FhnBackendCtx *ctx) { delete ctx; }
+void toyfhe_fhn_destroy(FhnBackendCtx *ctx) {
+  if (ctx && ctx->async) {
+    {
+      std::lock_guard<std::mutex> lock(ctx->async->mutex);
+      ctx->async->stop = true;
+    }
+    ctx->async->cv.notify_one();
+    ctx->async->thread.join();
+  }
+  delete ctx;
+}
 
 FhnKernelTable *toyfhe_fhn_get_kernels(FhnBackendCtx * /*ctx*/) { return &toyfhe_kernel_table; }
 
+FhnBatchKernelTable *toyfhe_fhn_get_batch_kernels(FhnBackendCtx * /*ctx*/) { return &toyfhe_batch_kernel_table; }
+
 // --- Host-side data plane ---------------------------------------------------
 // These exports handle plaintexts and key material. The trusted host calls
 // them directly; they are never dispatched from an FhnProgram.
@@ -251,6 +698,181 @@ FhnBuffer *toyfhe_fhn_buffer_alloc(FhnBackendCtx * /*ctx*/) { return new FhnBuff
 
 void toyfhe_fhn_buffer_free(FhnBackendCtx * /*ctx*/, FhnBuffer *buf) { delete buf; }
 
+// A "device" is just a context, so the peer copy is a struct copy — valid
+// only between contexts holding the same key (created with one key_seed).
+int toyfhe_fhn_buffer_copy_peer(FhnBackendCtx *dst_ctx, FhnBuffer *dst, FhnBackendCtx *src_ctx,
+                                const FhnBuffer *src) {
+  if (!dst_ctx || !dst || !src_ctx || !src)
+    return -1;
+  if (dst_ctx != src_ctx && (!dst_ctx->key_seed || dst_ctx->key_seed != src_ctx->key_seed))
+    return -1;
+  *dst = *src;
+  return 0;
+}
+
+// Serialized form: the kind byte, then its payload — nothing (Empty), one
+// ciphertext record (c0, c1, scale_power, encoding), the int or double
+// value, a slot count, the shared scale_power and encoding, and the c0
+// then the c1 array, or (packed) a slot count, the ring dimension and the
+// c0 then the c1 evaluations.
+static constexpr uint64_t kToyRecordBytes = 2 * sizeof(int64_t) + 2 * sizeof(int32_t);
+static constexpr uint64_t kToyVecHeaderBytes = sizeof(uint64_t) + 2 * sizeof(int32_t);
+static constexpr uint64_t kToyPackedHeaderBytes = 2 * sizeof(uint64_t);
+
+static uint64_t toyfhe_serialized_size(const FhnBuffer &buf) {
+  switch (buf.kind) {
+  case BufKind::Empty:
+    return 1;
+  case BufKind::Ciphertext:
+    return 1 + kToyRecordBytes;
+  case BufKind::IntValue:
+    return 1 + sizeof(int64_t);
+  case BufKind::DoubleValue:
+    return 1 + sizeof(double);
+  case BufKind::CiphertextVec:
+    return 1 + kToyVecHeaderBytes + 2 * sizeof(int64_t) * toyfhe_vec_size(&buf);
+  case BufKind::PackedCiphertext:
+    return 1 + kToyPackedHeaderBytes + 2 * sizeof(uint64_t) * buf.packed_ct.c0.size();
+  }
+  return 0;
+}
+
+template <typename T> static unsigned char *toyfhe_put(unsigned char *out, T value) {
+  std::memcpy(out, &value, sizeof(T));
+  return out + sizeof(T);
+}
+
+template <typename T> static const unsigned char *toyfhe_get(const unsigned char *in, T &value) {
+  std::memcpy(&value, in, sizeof(T));
+  return in + sizeof(T);
+}
+
+static unsigned char *toyfhe_put_record(unsigned char *out, const fhenomenon::toyfhe::Ciphertext &ct) {
+  out = toyfhe_put(out, ct.c0);
+  out = toyfhe_put(out, ct.c1);
+  out = toyfhe_put(out, static_cast<int32_t>(ct.scale_power));
+  return toyfhe_put(out, static_cast<int32_t>(ct.encoding));
+}
+
+// A slot array in logical order, stored slot rot first.
+static unsigned char *toyfhe_put_slots(unsigned char *out, const std::vector<int64_t> &slots, std::size_t rot) {
+  const std::size_t tail = slots.size() - rot;
+  std::memcpy(out, slots.data() + rot, sizeof(int64_t) * tail);
+  std::memcpy(out + sizeof(int64_t) * tail, slots.data(), sizeof(int64_t) * rot);
+  return out + sizeof(int64_t) * slots.size();
+}
+
+static const unsigned char *toyfhe_get_record(const unsigned char *in, fhenomenon::toyfhe::Ciphertext &ct) {
+  int32_t scale_power = 0;
+  int32_t encoding = 0;
+  in = toyfhe_get(in, ct.c0);
+  in = toyfhe_get(in, ct.c1);
+  in = toyfhe_get(in, scale_power);
+  in = toyfhe_get(in, encoding);
+  ct.scale_power = scale_power;
+  ct.encoding = static_cast<fhenomenon::toyfhe::Encoding>(encoding);
+  return in;
+}
+
+uint64_t toyfhe_fhn_buffer_serialize(FhnBackendCtx * /*ctx*/, const FhnBuffer *buffer, void *out, uint64_t capacity) {
+  if (!buffer)
+    return 0;
+  const uint64_t size = toyfhe_serialized_size(*buffer);
+  if (!out || capacity < size)
+    return size;
+  auto *p = toyfhe_put(static_cast<unsigned char *>(out), static_cast<uint8_t>(buffer->kind));
+  switch (buffer->kind) {
+  case BufKind::Empty:
+    break;
+  case BufKind::Ciphertext:
+    toyfhe_put_record(p, buffer->ct);
+    break;
+  case BufKind::IntValue:
+    toyfhe_put(p, buffer->int_val);
+    break;
+  case BufKind::DoubleValue:
+    toyfhe_put(p, buffer->double_val);
+    break;
+  case BufKind::CiphertextVec:
+    p = toyfhe_put<uint64_t>(p, buffer->ct_vec->size());
+    p = toyfhe_put<int32_t>(p, buffer->ct_vec->scale_power);
+    p = toyfhe_put(p, static_cast<int32_t>(buffer->ct_vec->encoding));
+    p = toyfhe_put_slots(p, buffer->ct_vec->c0, buffer->ct_rot);
+    toyfhe_put_slots(p, buffer->ct_vec->c1, buffer->ct_rot);
+    break;
+  case BufKind::PackedCiphertext:
+    p = toyfhe_put<uint64_t>(p, buffer->packed_ct.slots);
+    p = toyfhe_put<uint64_t>(p, buffer->packed_ct.c0.size());
+    std::memcpy(p, buffer->packed_ct.c0.data(), sizeof(uint64_t) * buffer->packed_ct.c0.size());
+    std::memcpy(p + sizeof(uint64_t) * buffer->packed_ct.c0.size(), buffer->packed_ct.c1.data(),
+                sizeof(uint64_t) * buffer->packed_ct.c1.size());
+    break;
+  }
+  return size;
+}
+
+int toyfhe_fhn_buffer_deserialize(FhnBackendCtx * /*ctx*/, FhnBuffer *buffer, const void *in, uint64_t size) {
+  if (!buffer || !in || size < 1)
+    return -1;
+  const auto *p = static_cast<const unsigned char *>(in);
+  uint8_t kind = 0;
+  p = toyfhe_get(p, kind);
+  if (kind > static_cast<uint8_t>(BufKind::PackedCiphertext))
+    return -1;
+  FhnBuffer restored;
+  restored.kind = static_cast<BufKind>(kind);
+  uint64_t count = 0;
+  if (restored.kind == BufKind::CiphertextVec) {
+    if (size < 1 + kToyVecHeaderBytes)
+      return -1;
+    int32_t scale_power = 0;
+    int32_t encoding = 0;
+    p = toyfhe_get(p, count);
+    p = toyfhe_get(p, scale_power);
+    p = toyfhe_get(p, encoding);
+    if (count > (size - 1 - kToyVecHeaderBytes) / (2 * sizeof(int64_t)))
+      return -1;
+    restored.ct_vec = std::make_shared<fhenomenon::toyfhe::CiphertextVec>();
+    restored.ct_vec->resize(count);
+    restored.ct_vec->scale_power = scale_power;
+    restored.ct_vec->encoding = static_cast<fhenomenon::toyfhe::Encoding>(encoding);
+  } else if (restored.kind == BufKind::PackedCiphertext) {
+    if (size < 1 + kToyPackedHeaderBytes)
+      return -1;
+    p = toyfhe_get(p, restored.packed_ct.slots);
+    p = toyfhe_get(p, count);
+    if (count > (size - 1 - kToyPackedHeaderBytes) / (2 * sizeof(uint64_t)))
+      return -1;
+    restored.packed_ct.c0.resize(count);
+    restored.packed_ct.c1.resize(count);
+  }
+  if (size != toyfhe_serialized_size(restored))
+    return -1;
+  switch (restored.kind) {
+  case BufKind::Empty:
+    break;
+  case BufKind::Ciphertext:
+    toyfhe_get_record(p, restored.ct);
+    break;
+  case BufKind::IntValue:
+    toyfhe_get(p, restored.int_val);
+    break;
+  case BufKind::DoubleValue:
+    toyfhe_get(p, restored.double_val);
+    break;
+  case BufKind::CiphertextVec:
+    std::memcpy(restored.ct_vec->c0.data(), p, sizeof(int64_t) * count);
+    std::memcpy(restored.ct_vec->c1.data(), p + sizeof(int64_t) * count, sizeof(int64_t) * count);
+    break;
+  case BufKind::PackedCiphertext:
+    std::memcpy(restored.packed_ct.c0.data(), p, sizeof(uint64_t) * count);
+    std::memcpy(restored.packed_ct.c1.data(), p + sizeof(uint64_t) * count, sizeof(uint64_t) * count);
+    break;
+  }
+  *buffer = std::move(restored);
+  return 0;
+}
+
 int toyfhe_fhn_encrypt_i64(FhnBackendCtx *ctx, FhnBuffer *out, int64_t value) {
   if (!out)
     return -1;
@@ -287,25 +909,54 @@ int toyfhe_fhn_decrypt_f64(FhnBackendCtx *ctx, const FhnBuffer *in, double *valu
   return 0;
 }
 
+// count independent scalar ciphertexts in one bulk pass: the Engine draws
+// their randomness from its counter-based stream a block at a time, split
+// over the ctx's slot pool.
+int toyfhe_fhn_encrypt_batch_i64(FhnBackendCtx *ctx, FhnBuffer *const *outs, const int64_t *values, uint32_t count) {
+  if (!ctx || !outs || !values)
+    return -1;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (!outs[i])
+      return -1;
+  }
+  std::vector<int64_t> c0(count);
+  std::vector<int64_t> c1(count);
+  ctx->engine.encryptIntBulk(values, count, c0.data(), c1.data());
+  for (uint32_t i = 0; i < count; ++i) {
+    outs[i]->ct = fhenomenon::toyfhe::Ciphertext{c0[i], c1[i], 0, fhenomenon::toyfhe::Encoding::Integer};
+    outs[i]->kind = BufKind::Ciphertext;
+  }
+  return 0;
+}
+
+// In packed mode n must divide ring_dim / 2: the vector repeats along each
+// row so that rotation stays cyclic in n.
 int toyfhe_fhn_encrypt_vec_i64(FhnBackendCtx *ctx, FhnBuffer *out, const int64_t *values, uint32_t n) {
   if (!ctx || !out || !values || n == 0)
     return -1;
-  std::vector<fhenomenon::toyfhe::Ciphertext> cts;
-  cts.reserve(n);
-  for (uint32_t i = 0; i < n; ++i) {
-    cts.push_back(ctx->engine.encryptInt(values[i]));
+  if (ctx->packed) {
+    if (ctx->packed->rowSlots() % n != 0)
+      return -1;
+    out->packed_ct = ctx->packed->encrypt(values, n);
+    out->kind = BufKind::PackedCiphertext;
+    return 0;
   }
-  out->ct_vec = std::move(cts);
-  out->kind = BufKind::CiphertextVec;
+  ctx->engine.encryptIntVec(values, n, toyfhe_vec_out(ctx, out));
   return 0;
 }
 
 int toyfhe_fhn_decrypt_vec_i64(FhnBackendCtx *ctx, const FhnBuffer *in, int64_t *out, uint32_t n) {
-  if (!ctx || !in || !out || in->kind != BufKind::CiphertextVec || in->ct_vec.size() != n)
+  if (!ctx || !in || !out)
     return -1;
-  for (uint32_t i = 0; i < n; ++i) {
-    out[i] = ctx->engine.decryptInt(in->ct_vec[i]);
+  if (in->kind == BufKind::PackedCiphertext) {
+    if (!ctx->packed || in->packed_ct.slots != n || in->packed_ct.c0.size() != ctx->packed->parameters().ring_dim)
+      return -1;
+    ctx->packed->decrypt(in->packed_ct, out);
+    return 0;
   }
+  if (in->kind != BufKind::CiphertextVec || toyfhe_vec_size(in) != n)
+    return -1;
+  ctx->engine.decryptIntVec(toyfhe_view(in), out);
   return 0;
 }
 
@@ -332,14 +983,202 @@ double toyfhe_fhn_buffer_read_double(FhnBackendCtx *ctx, FhnBuffer *buf) {
 // --- Level model (data plane) -----------------------------------------------
 // ToyFHE is flat: multiply relinearizes and rescales internally, so a
 // ciphertext's size and every opcode's effect are level-independent. There
-// is exactly one valid level (0); anything else has no defined size.
+// is exactly one valid level (0); anything else has no defined size. In
+// packed mode a ciphertext is two rings of N 64-bit evaluations.
 
 int64_t toyfhe_fhn_fresh_level(FhnBackendCtx * /*ctx*/) { return 0; }
 
-uint64_t toyfhe_fhn_level_bytes(FhnBackendCtx * /*ctx*/, int64_t level) {
-  return level == 0 ? sizeof(fhenomenon::toyfhe::Ciphertext) : 0;
+uint64_t toyfhe_fhn_level_bytes(FhnBackendCtx *ctx, int64_t level) {
+  if (level != 0)
+    return 0;
+  if (ctx && ctx->packed)
+    return 2 * sizeof(uint64_t) * ctx->packed->parameters().ring_dim;
+  return sizeof(fhenomenon::toyfhe::Ciphertext);
 }
 
 FhnLevelEffect toyfhe_fhn_opcode_level_effect(FhnBackendCtx * /*ctx*/, FhnOpCode /*opcode*/) {
   return FHN_LEVEL_PRESERVE;
 }
+
+// --- Kernel capability flags --------------------------------------------------
+// The Engine serializes its RNG internally and otherwise only reads keys and
+// parameters, and every kernel writes nothing but its result buffer, so all
+// registered kernels may run concurrently.
+
+uint32_t toyfhe_fhn_kernel_flags(FhnBackendCtx * /*ctx*/, FhnOpCode opcode) {
+  for (const FhnKernelEntry &entry : toyfhe_kernels) {
+    if (entry.opcode == opcode)
+      return FHN_KERNEL_THREAD_SAFE;
+  }
+  return 0;
+}
+
+// --- Async execution (control plane) --------------------------------------------
+// A reference for accelerator backends: submit queues the program on a
+// ctx-owned worker thread and returns at once, so the host can encrypt the
+// next batch while this one runs. The worker interprets the program with the
+// host's default executor over this backend's own kernel table.
+
+struct FhnExecHandle {
+  FhnBackendCtx *ctx = nullptr;
+  std::vector<FhnInstruction> instructions; // program copy
+  std::vector<uint32_t> input_ids;
+  std::vector<uint32_t> output_ids;
+  std::vector<FhnBuffer *> inputs; // borrowed, input_ids order
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  int state = 0; // 0 running, 1 done, < 0 failed
+  std::vector<FhnBuffer *> outputs; // owned until collected
+  bool collected = false;
+};
+
+static void toyfhe_async_run(FhnExecHandle *h) {
+  FhnProgram view{};
+  view.version = FHN_ABI_VERSION;
+  view.num_instructions = static_cast<uint32_t>(h->instructions.size());
+  view.instructions = h->instructions.data();
+  view.num_inputs = static_cast<uint32_t>(h->input_ids.size());
+  view.input_ids = h->input_ids.data();
+  view.num_outputs = static_cast<uint32_t>(h->output_ids.size());
+  view.output_ids = h->output_ids.data();
+
+  uint32_t max_id = 0;
+  for (uint32_t id : h->input_ids)
+    max_id = std::max(max_id, id);
+  for (const FhnInstruction &inst : h->instructions)
+    max_id = std::max(max_id, inst.result_id);
+  for (uint32_t id : h->output_ids)
+    max_id = std::max(max_id, id);
+
+  std::vector<FhnBuffer *> bufs(max_id + 1, nullptr);
+  std::vector<char> owned(max_id + 1, 0);
+  for (std::size_t k = 0; k < h->input_ids.size(); ++k)
+    bufs[h->input_ids[k]] = h->inputs[k];
+  for (const FhnInstruction &inst : h->instructions) {
+    if (bufs[inst.result_id] == nullptr) {
+      bufs[inst.result_id] = new FhnBuffer{};
+      owned[inst.result_id] = 1;
+    }
+  }
+
+  fhenomenon::FhnDefaultExecutor executor(&toyfhe_kernel_table);
+  int state = executor.execute(h->ctx, &view, bufs.data()) == 0 ? 1 : -1;
+
+  std::vector<FhnBuffer *> outputs;
+  if (state == 1) {
+    for (uint32_t id : h->output_ids) {
+      if (bufs[id] == nullptr) {
+        state = -1; // output never defined
+        break;
+      }
+      if (owned[id]) {
+        outputs.push_back(bufs[id]);
+        owned[id] = 0; // handed over: repeated output ids get copies
+      } else {
+        outputs.push_back(new FhnBuffer(*bufs[id]));
+      }
+    }
+  }
+  if (state != 1) {
+    for (FhnBuffer *buf : outputs)
+      delete buf;
+    outputs.clear();
+  }
+  for (uint32_t id = 0; id <= max_id; ++id) {
+    if (owned[id])
+      delete bufs[id];
+  }
+
+  std::lock_guard<std::mutex> lock(h->mutex);
+  h->outputs = std::move(outputs);
+  h->state = state;
+  h->cv.notify_all();
+}
+
+static void toyfhe_async_loop(ToyAsyncWorker *worker) {
+  for (;;) {
+    FhnExecHandle *job = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(worker->mutex);
+      worker->cv.wait(lock, [&] { return worker->stop || !worker->jobs.empty(); });
+      if (worker->jobs.empty())
+        return; // stop requested and drained
+      job = worker->jobs.front();
+      worker->jobs.pop_front();
+    }
+    toyfhe_async_run(job);
+  }
+}
+
+FhnExecHandle *toyfhe_fhn_submit(FhnBackendCtx *ctx, const FhnProgram *program, FhnBuffer **inputs,
+                                 uint32_t num_inputs) {
+  if (!ctx || !program || program->version != FHN_ABI_VERSION || num_inputs != program->num_inputs ||
+      (num_inputs > 0 && !inputs))
+    return nullptr;
+  for (uint32_t k = 0; k < num_inputs; ++k) {
+    if (inputs[k] == nullptr)
+      return nullptr;
+  }
+
+  auto *h = new FhnExecHandle();
+  h->ctx = ctx;
+  h->instructions.assign(program->instructions, program->instructions + program->num_instructions);
+  h->input_ids.assign(program->input_ids, program->input_ids + program->num_inputs);
+  h->output_ids.assign(program->output_ids, program->output_ids + program->num_outputs);
+  h->inputs.assign(inputs, inputs + num_inputs);
+
+  ToyAsyncWorker *worker = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(ctx->async_mutex);
+    if (!ctx->async) {
+      ctx->async = std::make_unique<ToyAsyncWorker>();
+      ctx->async->thread = std::thread(toyfhe_async_loop, ctx->async.get());
+    }
+    worker = ctx->async.get();
+  }
+  {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->jobs.push_back(h);
+  }
+  worker->cv.notify_one();
+  return h;
+}
+
+int toyfhe_fhn_poll(FhnExecHandle *handle) {
+  if (!handle)
+    return -1;
+  std::lock_guard<std::mutex> lock(handle->mutex);
+  return handle->state;
+}
+
+int toyfhe_fhn_wait(FhnExecHandle *handle) {
+  if (!handle)
+    return -1;
+  std::unique_lock<std::mutex> lock(handle->mutex);
+  handle->cv.wait(lock, [&] { return handle->state != 0; });
+  return handle->state == 1 ? 0 : handle->state;
+}
+
+FhnBuffer **toyfhe_fhn_get_outputs(FhnExecHandle *handle, uint32_t *num_outputs) {
+  if (!handle)
+    return nullptr;
+  std::lock_guard<std::mutex> lock(handle->mutex);
+  if (handle->state != 1 || handle->collected)
+    return nullptr;
+  handle->collected = true;
+  if (num_outputs)
+    *num_outputs = static_cast<uint32_t>(handle->outputs.size());
+  return handle->outputs.data();
+}
+
+void toyfhe_fhn_exec_free(FhnExecHandle *handle) {
+  if (!handle)
+    return;
+  toyfhe_fhn_wait(handle);
+  if (!handle->collected) {
+    for (FhnBuffer *buf : handle->outputs)
+      delete buf;
+  }
+  delete handle;
+}
@@ -1,6 +1,9 @@
 #include "Session/Session.h"
 #include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnFusionPass.h"
 #include "FHN/FhnMovementPlan.h"
+#include "FHN/FhnPlanCache.h"
+#include "FHN/FhnSchedulePass.h"
 #include "FHN/fhn_program.h"
 #include "Scheduler/MatMulRecognitionPass.h"
 
@@ -17,25 +20,103 @@ using namespace fhenomenon;
 
 thread_local std::shared_ptr<Session> Session::session_ptr_ = nullptr;
 
+namespace fhenomenon {
+
+struct SessionPendingRun {
+  const Backend *backend = nullptr;
+  const FhnRuntime *runtime = nullptr;
+  FhnExecHandle *handle = nullptr;
+  // Borrowed by the backend until the handle completes.
+  std::vector<std::shared_ptr<FhnBuffer>> inputs;
+  std::unordered_map<uint32_t, std::shared_ptr<FhnBuffer>> input_by_id;
+  // The submitted program's output_ids, in order.
+  std::vector<uint32_t> output_ids;
+  // Write-back targets and the value id each must observe.
+  std::vector<std::pair<std::shared_ptr<Fhenon<int>>, uint32_t>> writes;
+};
+
+} // namespace fhenomenon
+
 namespace {
 
+// FhnPlanOptions::prefetch_lookahead on backends with async prefetch.
+constexpr uint32_t kPrefetchLookahead = 4;
+
+// Entity -> (shared handle, value id it must observe after the run).
+using LatestBindings = std::unordered_map<Fhenon<int> *, std::pair<std::shared_ptr<Fhenon<int>>, uint32_t>>;
+
+// Wrap a buffer the host now owns; the deleter shares the runtime keepalive.
+std::shared_ptr<FhnBuffer> adoptBuffer(const FhnRuntime &runtime, FhnBuffer *buffer) {
+  auto *ctx = runtime.ctx;
+  auto free_fn = runtime.buffer_free;
+  auto keepalive = runtime.keepalive;
+  return std::shared_ptr<FhnBuffer>(buffer, [ctx, free_fn, keepalive](FhnBuffer *b) { free_fn(ctx, b); });
+}
+
+// Submit `program` on the runtime's async group instead of executing it.
+// Write-backs to input ids reuse the entity-owned buffers; every other
+// write-back id becomes an output of the submitted copy.
+std::unique_ptr<SessionPendingRun> submitThroughFhnRuntime(const FhnProgram &program, const Backend &backend,
+                                                           const FhnRuntime &runtime,
+                                                           const std::vector<std::shared_ptr<FhnBuffer>> &input_hold,
+                                                           const LatestBindings &latest) {
+  auto run = std::make_unique<SessionPendingRun>();
+  run->backend = &backend;
+  run->runtime = &runtime;
+  for (uint32_t i = 0; i < program.num_inputs; ++i) {
+    const uint32_t id = program.input_ids[i];
+    run->inputs.push_back(input_hold[id]);
+    run->input_by_id[id] = input_hold[id];
+  }
+  std::unordered_set<uint32_t> seen;
+  for (const auto &[raw_entity, bound] : latest) {
+    (void)raw_entity;
+    run->writes.push_back(bound);
+    if (!run->input_by_id.count(bound.second) && seen.insert(bound.second).second) {
+      run->output_ids.push_back(bound.second);
+    }
+  }
+
+  std::unique_ptr<FhnProgram, decltype(&fhn_program_free)> submitted(
+    fhn_program_alloc(program.num_instructions, program.num_inputs, static_cast<uint32_t>(run->output_ids.size())),
+    &fhn_program_free);
+  if (!submitted) {
+    throw std::runtime_error("Session: FHN program allocation failed");
+  }
+  std::copy(program.instructions, program.instructions + program.num_instructions, submitted->instructions);
+  std::copy(program.input_ids, program.input_ids + program.num_inputs, submitted->input_ids);
+  std::copy(run->output_ids.begin(), run->output_ids.end(), submitted->output_ids);
+
+  std::vector<FhnBuffer *> inputs;
+  inputs.reserve(run->inputs.size());
+  for (const auto &buffer : run->inputs) {
+    inputs.push_back(buffer.get());
+  }
+  run->handle = runtime.submit(runtime.ctx, submitted.get(), inputs.data(), submitted->num_inputs);
+  if (!run->handle) {
+    throw std::runtime_error("Session: backend rejected the async FHN submission");
+  }
+  return run;
+}
+
 // Execute the recorded graph through the backend's FHN runtime: lower the
 // AST to an FhnProgram, provision the buffer table, dispatch through the
 // executor, and write results back into the bound entities.
 // Returns false when lowering produced nothing executable, in which case the
 // caller falls back to the legacy per-operation path.
+// With `pending` set and an async-capable runtime, the program is submitted
+// instead and the write-back deferred to Session::sync().
 bool executeThroughFhnRuntime(scheduler::Scheduler &scheduler, scheduler::Planner<int> &planner, const Backend &backend,
-                              const FhnRuntime &runtime) {
+                              const FhnRuntime &runtime, std::unique_ptr<SessionPendingRun> *pending) {
   scheduler::LowerToFhnProgram::EntityBindings<int> bindings;
-  std::unique_ptr<FhnProgram, decltype(&fhn_program_free)> program(scheduler.lowerGraph<int>(planner, &bindings),
-                                                                   &fhn_program_free);
+  const std::shared_ptr<const FhnProgram> program(scheduler.lowerGraph<int>(planner, &bindings), &fhn_program_free);
   if (!program || bindings.empty()) {
     return false;
   }
 
   // Walking the bindings forward, the last binding per entity wins — that
   // id holds the value the entity must observe after the run.
-  std::unordered_map<Fhenon<int> *, std::pair<std::shared_ptr<Fhenon<int>>, uint32_t>> latest;
+  LatestBindings latest;
   for (const auto &[id, entity] : bindings) {
     if (entity) {
       latest[entity.get()] = {entity, id};
@@ -55,10 +136,48 @@ bool executeThroughFhnRuntime(scheduler::Scheduler &scheduler, scheduler::Planne
     pinned.push_back(bound.second);
   }
 
-  const auto plan = FhnMovementPlan::analyze(*program, pinned, /*device_budget=*/0);
-  if (!plan) {
-    throw std::runtime_error("Session: FHN program failed movement analysis (operand used without a definition?)");
+  // A request shape seen before reuses its fused program and plan; the
+  // cache key is the lowered program plus the pinned set and budget.
+  std::shared_ptr<const FhnPlanCache::Entry> planned =
+    runtime.plan_cache ? runtime.plan_cache->find(*program, pinned, /*device_budget=*/0) : nullptr;
+  if (!planned) {
+    // Fold primitive sequences into the backend's fused kernels. Pinned ids
+    // are preserved so every write-back target keeps its value; on failure
+    // the unfused program runs unchanged.
+    std::shared_ptr<const FhnProgram> executable(FhnFusionPass::run(*runtime.executor, *program, pinned),
+                                                 &fhn_program_free);
+    if (!executable) {
+      executable = program;
+    }
+    // Reorder for a smaller peak live set (the pass keeps the lowered order
+    // unless the plan improves).
+    std::shared_ptr<const FhnProgram> scheduled(FhnSchedulePass::run(*executable, pinned), &fhn_program_free);
+    if (scheduled) {
+      executable = scheduled;
+    }
+
+    // Slot assignment shrinks the buffer table to the peak live set and
+    // lets results reuse dying operands' buffers; the plan hands back the
+    // slot-rewritten program to execute.
+    FhnPlanOptions plan_options;
+    plan_options.assign_slots = true;
+    // Backends with async copies get inputs' H2D transfers started a few
+    // instructions early, overlapping the compute before their first use.
+    if (runtime.prefetch_async) {
+      plan_options.prefetch_lookahead = kPrefetchLookahead;
+    }
+    const auto plan = FhnMovementPlan::analyze(*executable, pinned, /*device_budget=*/0, FhnEvictionPolicy::Belady,
+                                               /*model=*/nullptr, plan_options);
+    if (!plan) {
+      throw std::runtime_error("Session: FHN program failed movement analysis (operand used without a definition?)");
+    }
+    planned = std::make_shared<const FhnPlanCache::Entry>(FhnPlanCache::Entry{executable, *plan});
+    if (runtime.plan_cache) {
+      runtime.plan_cache->insert(*program, pinned, /*device_budget=*/0, planned);
+    }
   }
+  const FhnProgram &executable = *planned->program;
+  const FhnMovementPlan *plan = &planned->plan;
 
   uint32_t max_id = 0;
   for (uint32_t i = 0; i < program->num_instructions; ++i) {
@@ -93,27 +212,34 @@ bool executeThroughFhnRuntime(scheduler::Scheduler &scheduler, scheduler::Planne
     }
   }
 
-  std::vector<FhnBuffer *> buffers(max_id + 1, nullptr);
+  if (pending && runtime.submit) {
+    *pending = submitThroughFhnRuntime(executable, backend, runtime, input_hold, latest);
+    return true;
+  }
+
+  std::vector<FhnBuffer *> buffers(plan->tableSize(), nullptr);
   for (uint32_t id = 1; id <= max_id; ++id) {
     if (input_hold[id]) {
-      buffers[id] = input_hold[id].get();
+      buffers[plan->slotOf(id)] = input_hold[id].get();
     }
   }
 
-  const FhnMovementHooks hooks{runtime.ctx, runtime.buffer_alloc, runtime.buffer_free, runtime.prefetch, runtime.evict};
-  const int rc = runtime.executor->execute(hooks, program.get(), buffers.data(), *plan);
+  FhnMovementHooks hooks{runtime.ctx, runtime.buffer_alloc, runtime.buffer_free, runtime.prefetch, runtime.evict};
+  hooks.prefetch_async = runtime.prefetch_async;
+  hooks.fence = runtime.fence;
+  hooks.pool = runtime.pool; // intermediates stay warm across sessions
+  const FhnProgram *slotted = plan->program() ? plan->program() : &executable;
+  const int rc = runtime.executor->execute(hooks, slotted, buffers.data(), *plan);
   if (rc != 0) {
     throw std::runtime_error("Session: FHN executor failed with rc=" + std::to_string(rc));
   }
 
-  // Adopt surviving pinned buffers and write back. Adoption is deduped by
-  // id: two entities bound to the same value id must share one shared_ptr,
-  // not wrap the same raw pointer twice (double free). Input ids reuse the
+  // Adopt surviving pinned buffers (at their plan slots) and write back.
+  // Adoption is deduped by id: two entities bound to the same value id must
+  // share one shared_ptr, not wrap the same raw pointer twice (double
+  // free). Pinned ids never share a slot. Input ids reuse the
   // entity-owned shared_ptr; plan-allocated ids get a deleter sharing the
   // runtime keepalive, exactly like the old preallocation path.
-  auto *ctx = runtime.ctx;
-  auto free_fn = runtime.buffer_free;
-  auto keepalive = runtime.keepalive;
   std::unordered_map<uint32_t, std::shared_ptr<FhnBuffer>> adopted;
   auto adopt = [&](uint32_t id) -> std::shared_ptr<FhnBuffer> {
     if (input_hold[id]) {
@@ -121,8 +247,7 @@ bool executeThroughFhnRuntime(scheduler::Scheduler &scheduler, scheduler::Planne
     }
     auto &slot = adopted[id];
     if (!slot) {
-      slot =
-        std::shared_ptr<FhnBuffer>(buffers[id], [ctx, free_fn, keepalive](FhnBuffer *buffer) { free_fn(ctx, buffer); });
+      slot = adoptBuffer(runtime, buffers[plan->slotOf(id)]);
     }
     return slot;
   };
@@ -137,7 +262,52 @@ bool executeThroughFhnRuntime(scheduler::Scheduler &scheduler, scheduler::Planne
 
 } // namespace
 
-void Session::optimize() {
+Session::Session(const Backend &backend)
+  : active_(false), backend_(backend), scheduler_(std::make_unique<scheduler::Scheduler>(backend)) {}
+
+Session::~Session() {
+  // Pending results are dropped: their targets may already be gone.
+  if (pending_) {
+    pending_->runtime->exec_free(pending_->handle);
+  }
+  if (session_ptr_.get() == this)
+    session_ptr_ = nullptr;
+}
+
+void Session::sync() {
+  if (!pending_) {
+    return;
+  }
+  const std::unique_ptr<SessionPendingRun> run = std::move(pending_);
+  const FhnRuntime &runtime = *run->runtime;
+
+  if (runtime.wait(run->handle) != 0) {
+    runtime.exec_free(run->handle);
+    throw std::runtime_error("Session: async FHN execution failed");
+  }
+  uint32_t num_outputs = 0;
+  FhnBuffer **outputs = runtime.get_outputs(run->handle, &num_outputs);
+  // Adopt before validating so a short array is still released.
+  std::unordered_map<uint32_t, std::shared_ptr<FhnBuffer>> adopted = run->input_by_id;
+  for (uint32_t k = 0; outputs && k < num_outputs; ++k) {
+    if (k < run->output_ids.size()) {
+      adopted[run->output_ids[k]] = adoptBuffer(runtime, outputs[k]);
+    } else {
+      runtime.buffer_free(runtime.ctx, outputs[k]);
+    }
+  }
+  runtime.exec_free(run->handle);
+  if (!outputs || num_outputs != run->output_ids.size()) {
+    throw std::runtime_error("Session: async FHN execution returned the wrong number of outputs");
+  }
+
+  for (auto &[entity, id] : run->writes) {
+    entity->ciphertext_ = FhnCiphertext{adopted.at(id), run->backend};
+    entity->isEncrypted_ = true;
+  }
+}
+
+void Session::optimize(bool async) {
   LOG_MESSAGE("Session: optimize");
 
   // A recorded entity died before evaluation: executing the graph would read
@@ -177,7 +347,7 @@ void Session::optimize() {
   // FhnProgram through the executor; the rest use the legacy per-operation
   // evaluation. Lowering failures also fall back.
   const FhnRuntime *runtime = backend_.fhnRuntime();
-  if (runtime && executeThroughFhnRuntime(*scheduler_, planner, backend_, *runtime)) {
+  if (runtime && executeThroughFhnRuntime(*scheduler_, planner, backend_, *runtime, async ? &pending_ : nullptr)) {
     return;
   }
   scheduler_->evaluateGraph(planner);
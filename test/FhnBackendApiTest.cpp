@@ -68,6 +68,12 @@ TEST(FhnBackendApi, VTableNullOptional) {
   EXPECT_EQ(vtable.wait, nullptr);
   EXPECT_EQ(vtable.get_outputs, nullptr);
   EXPECT_EQ(vtable.exec_free, nullptr);
+  EXPECT_EQ(vtable.kernel_flags, nullptr);
+  EXPECT_EQ(vtable.get_batch_kernels, nullptr);
+  EXPECT_EQ(vtable.get_kernel_costs, nullptr);
+  EXPECT_EQ(vtable.prefetch_async, nullptr);
+  EXPECT_EQ(vtable.fence, nullptr);
+  EXPECT_EQ(vtable.copy_peer, nullptr);
 }
 
 TEST(FhnBackendApi, DeviceTypeEnum) {
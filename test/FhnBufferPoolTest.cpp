@@ -0,0 +1,205 @@
+#include "FHN/FhnBufferPool.h"
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnMovementPlan.h"
+#include "FhnTestProgramBuilder.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using fhenomenon::FhnBufferPool;
+using fhenomenon::FhnDefaultExecutor;
+using fhenomenon::FhnMovementHooks;
+using fhenomenon::FhnMovementPlan;
+using fhenomenon::testutil::ProgramBuilder;
+
+namespace {
+
+struct TestBuffer {
+  int64_t value;
+};
+
+int g_allocs = 0;
+int g_frees = 0;
+
+FhnBuffer *counting_alloc(FhnBackendCtx *) {
+  ++g_allocs;
+  return reinterpret_cast<FhnBuffer *>(new TestBuffer{0});
+}
+
+void counting_free(FhnBackendCtx *, FhnBuffer *buf) {
+  ++g_frees;
+  delete reinterpret_cast<TestBuffer *>(buf);
+}
+
+int test_add_cc(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *, const double *) {
+  reinterpret_cast<TestBuffer *>(result)->value = reinterpret_cast<const TestBuffer *>(operands[0])->value +
+                                                  reinterpret_cast<const TestBuffer *>(operands[1])->value;
+  return 0;
+}
+
+int test_fail(FhnBackendCtx *, FhnBuffer *, const FhnBuffer *const *, const int64_t *, const double *) { return -3; }
+
+FhnKernelEntry g_entries[] = {
+  {FHN_ADD_CC, test_add_cc, "add_cc"},
+  {FHN_NEGATE, test_fail, "negate"},
+};
+FhnKernelTable g_table = {2, g_entries};
+
+class FhnBufferPoolTest : public ::testing::Test {
+  protected:
+  void SetUp() override { g_allocs = g_frees = 0; }
+};
+
+} // namespace
+
+TEST_F(FhnBufferPoolTest, ReleasedBufferServesTheSameClass) {
+  FhnBufferPool pool(nullptr, counting_alloc, counting_free);
+  FhnBuffer *a = pool.acquire(64);
+  FhnBuffer *b = pool.acquire(64);
+  EXPECT_EQ(g_allocs, 2);
+  pool.release(a, 64);
+  pool.release(b, 64);
+  EXPECT_EQ(pool.stats().idle_buffers, 2u);
+  EXPECT_EQ(pool.stats().idle_bytes, 128u);
+
+  EXPECT_EQ(pool.acquire(64), b); // warmest first
+  FhnBuffer *c = pool.acquire(32); // other class: a stays idle
+  EXPECT_NE(c, a);
+  EXPECT_EQ(g_allocs, 3);
+
+  const auto stats = pool.stats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 3u);
+  EXPECT_DOUBLE_EQ(stats.hitRate(), 0.25);
+  EXPECT_EQ(stats.idle_buffers, 1u);
+  EXPECT_EQ(stats.idle_bytes, 64u);
+
+  pool.release(b, 64);
+  pool.release(c, 32);
+  EXPECT_EQ(g_frees, 0);
+}
+
+TEST_F(FhnBufferPoolTest, DestructorFreesIdleBuffers) {
+  {
+    FhnBufferPool pool(nullptr, counting_alloc, counting_free);
+    pool.release(pool.acquire(0), 0);
+    pool.release(pool.acquire(8), 8);
+  }
+  EXPECT_EQ(g_allocs, 2);
+  EXPECT_EQ(g_frees, 2);
+}
+
+TEST_F(FhnBufferPoolTest, CapsFreeTheOldestIdleBuffers) {
+  FhnBufferPool::Limits limits;
+  limits.max_idle_buffers = 2;
+  FhnBufferPool pool(nullptr, counting_alloc, counting_free, limits);
+  FhnBuffer *bufs[3] = {pool.acquire(1), pool.acquire(2), pool.acquire(1)};
+  for (FhnBuffer *buf : bufs)
+    pool.release(buf, buf == bufs[1] ? 2 : 1);
+  EXPECT_EQ(g_frees, 1); // bufs[0], the oldest
+  EXPECT_EQ(pool.stats().trimmed, 1u);
+  EXPECT_EQ(pool.acquire(1), bufs[2]);
+  EXPECT_EQ(pool.acquire(2), bufs[1]);
+  pool.release(bufs[1], 2);
+  pool.release(bufs[2], 1);
+
+  // Byte cap: a 10-byte idle budget holds the 1- and 2-byte buffers but
+  // not a 9-byte one on top; the oldest goes first.
+  FhnBufferPool::Limits bytes;
+  bytes.max_idle_bytes = 10;
+  FhnBufferPool small(nullptr, counting_alloc, counting_free, bytes);
+  FhnBuffer *x = small.acquire(2);
+  FhnBuffer *y = small.acquire(9);
+  small.release(x, 2);
+  small.release(y, 9);
+  EXPECT_EQ(small.stats().idle_buffers, 1u);
+  EXPECT_EQ(small.stats().idle_bytes, 9u);
+  EXPECT_EQ(small.acquire(9), y);
+  small.release(y, 9);
+}
+
+TEST_F(FhnBufferPoolTest, EndRunAgesOutBuffersIdleForWholeRuns) {
+  FhnBufferPool::Limits limits;
+  limits.max_idle_runs = 2;
+  FhnBufferPool pool(nullptr, counting_alloc, counting_free, limits);
+  FhnBuffer *old_buf = pool.acquire(4);
+  FhnBuffer *new_buf = pool.acquire(4);
+  pool.release(old_buf, 4);
+  pool.endRun();
+  pool.release(new_buf, 4);
+  pool.endRun();
+  EXPECT_EQ(g_frees, 1); // old_buf: idle through two runs
+  EXPECT_EQ(pool.stats().idle_buffers, 1u);
+  pool.endRun();
+  EXPECT_EQ(g_frees, 2);
+
+  pool.release(pool.acquire(4), 4);
+  pool.release(pool.acquire(8), 8);
+  pool.trim(1);
+  EXPECT_EQ(pool.stats().idle_buffers, 1u);
+  pool.trim();
+  EXPECT_EQ(pool.stats().idle_buffers, 0u);
+  EXPECT_EQ(g_frees, g_allocs);
+}
+
+// Planned execution through a pool: the second run allocates nothing from
+// the backend, and the pool's counts match the plan's prediction.
+TEST_F(FhnBufferPoolTest, PlannedExecutionRecyclesAcrossRuns) {
+  FhnDefaultExecutor executor(&g_table);
+  // t3 = a + b; t4 = t3 + t3; t5 = t4 + a; r6 = t5 + t5
+  auto prog = ProgramBuilder()
+                .input(1)
+                .input(2)
+                .inst(FHN_ADD_CC, 3, 1, 2)
+                .inst(FHN_ADD_CC, 4, 3, 3)
+                .inst(FHN_ADD_CC, 5, 4, 1)
+                .inst(FHN_ADD_CC, 6, 5, 5)
+                .output(6)
+                .build();
+  auto plan = FhnMovementPlan::analyze(*prog, {1, 2, 6});
+  ASSERT_TRUE(plan.has_value());
+
+  FhnBufferPool pool(nullptr, counting_alloc, counting_free);
+  FhnMovementHooks hooks;
+  hooks.pool = &pool;
+  TestBuffer a{2};
+  TestBuffer b{3};
+  for (int run = 0; run < 2; ++run) {
+    std::vector<FhnBuffer *> buffers(7, nullptr);
+    buffers[1] = reinterpret_cast<FhnBuffer *>(&a);
+    buffers[2] = reinterpret_cast<FhnBuffer *>(&b);
+    const int allocs_before = g_allocs;
+    const auto hits_before = pool.stats().hits;
+    ASSERT_EQ(executor.execute(hooks, prog.get(), buffers.data(), *plan), 0);
+    EXPECT_EQ(reinterpret_cast<TestBuffer *>(buffers[6])->value, 2 * (2 * (2 + 3) + 2));
+    const auto hits = pool.stats().hits - hits_before;
+    EXPECT_EQ(hits, run == 0 ? plan->stats().pool_hits : plan->stats().pool_warm_hits) << run;
+    EXPECT_EQ(static_cast<uint32_t>(g_allocs - allocs_before), plan->stats().alloc_count - hits) << run;
+    counting_free(nullptr, buffers[6]); // the caller owns the pinned output
+  }
+  EXPECT_EQ(plan->stats().pool_hits, 2u);
+  EXPECT_EQ(plan->stats().pool_warm_hits, 3u);
+  EXPECT_EQ(g_frees, 2);
+}
+
+TEST_F(FhnBufferPoolTest, FailedRunReturnsOwnedBuffersToThePool) {
+  FhnDefaultExecutor executor(&g_table);
+  auto prog = ProgramBuilder().input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).inst(FHN_NEGATE, 4, 3).output(4).build();
+  auto plan = FhnMovementPlan::analyze(*prog, {1, 2, 4});
+  ASSERT_TRUE(plan.has_value());
+
+  FhnBufferPool pool(nullptr, counting_alloc, counting_free);
+  FhnMovementHooks hooks;
+  hooks.pool = &pool;
+  TestBuffer a{1};
+  TestBuffer b{1};
+  std::vector<FhnBuffer *> buffers(5, nullptr);
+  buffers[1] = reinterpret_cast<FhnBuffer *>(&a);
+  buffers[2] = reinterpret_cast<FhnBuffer *>(&b);
+  EXPECT_EQ(executor.execute(hooks, prog.get(), buffers.data(), *plan), -3);
+  EXPECT_EQ(buffers[3], nullptr);
+  EXPECT_EQ(buffers[4], nullptr);
+  EXPECT_EQ(pool.stats().idle_buffers, 2u);
+  EXPECT_EQ(g_frees, 0);
+}
@@ -0,0 +1,254 @@
+#include "FHN/FhnCompiledProgram.h"
+#include "FHN/FhnDefaultExecutor.h"
+#include "FhnTestProgramBuilder.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using fhenomenon::FhnCompiledProgram;
+using fhenomenon::FhnDefaultExecutor;
+using fhenomenon::testutil::ProgramBuilder;
+
+namespace {
+
+struct TestBuffer {
+  int64_t value;
+};
+
+int test_add_cc(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *, const double *) {
+  auto *r = reinterpret_cast<TestBuffer *>(result);
+  auto *a = reinterpret_cast<const TestBuffer *>(operands[0]);
+  auto *b = reinterpret_cast<const TestBuffer *>(operands[1]);
+  r->value = a->value + b->value;
+  return 0;
+}
+
+int test_mult_cc(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+                 const double *) {
+  auto *r = reinterpret_cast<TestBuffer *>(result);
+  auto *a = reinterpret_cast<const TestBuffer *>(operands[0]);
+  auto *b = reinterpret_cast<const TestBuffer *>(operands[1]);
+  r->value = a->value * b->value;
+  return 0;
+}
+
+int test_mult_cs(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+                 const double *fparams) {
+  auto *r = reinterpret_cast<TestBuffer *>(result);
+  auto *a = reinterpret_cast<const TestBuffer *>(operands[0]);
+  r->value = a->value * static_cast<int64_t>(fparams[0]);
+  return 0;
+}
+
+int test_negate(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *, const double *) {
+  auto *r = reinterpret_cast<TestBuffer *>(result);
+  auto *a = reinterpret_cast<const TestBuffer *>(operands[0]);
+  r->value = -a->value;
+  return 0;
+}
+
+// "Rotation" by params[0] over scalar buffers: add the step so the rotation
+// amount is observable.
+int test_rotate(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *params,
+                const double *) {
+  auto *r = reinterpret_cast<TestBuffer *>(result);
+  auto *a = reinterpret_cast<const TestBuffer *>(operands[0]);
+  r->value = a->value + params[0];
+  return 0;
+}
+
+// Adds 1000 so the RELINEARIZE step of a decomposition shows in the result.
+int test_relin(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *, const int64_t *, const double *) {
+  reinterpret_cast<TestBuffer *>(result)->value += 1000;
+  return 0;
+}
+
+int test_fail(FhnBackendCtx *, FhnBuffer *, const FhnBuffer *const *, const int64_t *, const double *) { return -7; }
+
+struct Buffers {
+  explicit Buffers(std::size_t n) : values(n, TestBuffer{0}), ptrs(n, nullptr) {
+    for (std::size_t i = 0; i < n; ++i)
+      ptrs[i] = reinterpret_cast<FhnBuffer *>(&values[i]);
+  }
+  std::vector<TestBuffer> values;
+  std::vector<FhnBuffer *> ptrs;
+};
+
+} // namespace
+
+TEST(FhnCompiledProgram, MatchesInterpretedExecution) {
+  FhnKernelEntry entries[] = {
+    {FHN_ADD_CC, test_add_cc, "add_cc"},
+    {FHN_MULT_CC, test_mult_cc, "mult_cc"},
+    {FHN_NEGATE, test_negate, "negate"},
+  };
+  FhnKernelTable table = {3, entries};
+  FhnDefaultExecutor executor(&table);
+
+  // r3 = r1 + r2; r4 = r3 * r1; r5 = -r4
+  ProgramBuilder b;
+  b.input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).inst(FHN_MULT_CC, 4, 3, 1).inst(FHN_NEGATE, 5, 4).output(5);
+  auto prog = b.build();
+
+  auto compiled = FhnCompiledProgram::compile(executor, *prog);
+  ASSERT_TRUE(compiled.has_value());
+  EXPECT_EQ(compiled->instructionCount(), 3u);
+  EXPECT_EQ(compiled->stepCount(), 3u);
+
+  Buffers interpreted(6), fast(6);
+  interpreted.values[1].value = fast.values[1].value = 4;
+  interpreted.values[2].value = fast.values[2].value = 6;
+  ASSERT_EQ(executor.execute(nullptr, prog.get(), interpreted.ptrs.data()), 0);
+  ASSERT_EQ(compiled->execute(nullptr, fast.ptrs.data()), 0);
+  EXPECT_EQ(fast.values[5].value, -40);
+  EXPECT_EQ(fast.values[5].value, interpreted.values[5].value);
+}
+
+TEST(FhnCompiledProgram, PreExpandsDecompositions) {
+  FhnKernelEntry entries[] = {
+    {FHN_ADD_CC, test_add_cc, "add_cc"},       {FHN_MULT_CC, test_mult_cc, "mult_cc"},
+    {FHN_MULT_CS, test_mult_cs, "mult_cs"},    {FHN_ROTATE, test_rotate, "rotate"},
+    {FHN_RELINEARIZE, test_relin, "relin"},
+  };
+  FhnKernelTable table = {5, entries};
+  FhnDefaultExecutor executor(&table);
+
+  // HMULT -> MULT_CC + RELIN (no RESCALE registered), HROT_ADD -> ROTATE +
+  // ADD_CC, MAD -> MULT_CS + ADD_CC.
+  ProgramBuilder b;
+  b.input(1).input(2);
+  b.inst(FHN_HMULT, 3, 1, 2);
+  b.inst(FHN_HROT_ADD, 4, 3, 1);
+  b.insts.back().params[0] = 5;
+  b.inst(FHN_MAD, 5, 4, 2);
+  b.insts.back().fparams[0] = 3.0;
+  b.output(5);
+  auto prog = b.build();
+
+  auto compiled = FhnCompiledProgram::compile(executor, *prog);
+  ASSERT_TRUE(compiled.has_value());
+  EXPECT_EQ(compiled->instructionCount(), 3u);
+  EXPECT_EQ(compiled->stepCount(), 6u);
+
+  Buffers interpreted(6), fast(6);
+  interpreted.values[1].value = fast.values[1].value = 2;
+  interpreted.values[2].value = fast.values[2].value = 7;
+  ASSERT_EQ(executor.execute(nullptr, prog.get(), interpreted.ptrs.data()), 0);
+  ASSERT_EQ(compiled->execute(nullptr, fast.ptrs.data()), 0);
+  // r3 = 2*7 + 1000 = 1014; r4 = (1014 + 5) + 2 = 1021; r5 = 1021*3 + 7.
+  EXPECT_EQ(fast.values[5].value, 3070);
+  EXPECT_EQ(fast.values[5].value, interpreted.values[5].value);
+}
+
+TEST(FhnCompiledProgram, CompileFailsWhenUnresolvable) {
+  FhnKernelEntry entries[] = {
+    {FHN_ADD_CC, test_add_cc, "add_cc"},
+    {FHN_MULT_CS, test_mult_cs, "mult_cs"},
+  };
+  FhnKernelTable table = {2, entries};
+  FhnDefaultExecutor executor(&table);
+
+  // No kernel and no decomposition path.
+  ProgramBuilder unsupported;
+  unsupported.input(1).inst(FHN_CONJUGATE, 2, 1).output(2);
+  EXPECT_FALSE(FhnCompiledProgram::compile(executor, *unsupported.build()).has_value());
+
+  // MAD whose addend aliases the result violates the decomposition rule.
+  ProgramBuilder aliased;
+  aliased.input(1).input(2).inst(FHN_MAD, 2, 1, 2).output(2);
+  EXPECT_FALSE(FhnCompiledProgram::compile(executor, *aliased.build()).has_value());
+
+  // ABI version mismatch.
+  ProgramBuilder ok;
+  ok.input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).output(3);
+  auto prog = ok.build();
+  prog->version = FHN_ABI_VERSION + 1;
+  EXPECT_FALSE(FhnCompiledProgram::compile(executor, *prog).has_value());
+}
+
+TEST(FhnCompiledProgram, PropagatesKernelFailure) {
+  FhnKernelEntry entries[] = {
+    {FHN_ADD_CC, test_add_cc, "add_cc"},
+    {FHN_NEGATE, test_fail, "negate"},
+  };
+  FhnKernelTable table = {2, entries};
+  FhnDefaultExecutor executor(&table);
+
+  ProgramBuilder b;
+  b.input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).inst(FHN_NEGATE, 4, 3).output(4);
+  auto compiled = FhnCompiledProgram::compile(executor, *b.build());
+  ASSERT_TRUE(compiled.has_value());
+
+  Buffers bufs(5);
+  EXPECT_EQ(compiled->execute(nullptr, bufs.ptrs.data()), -7);
+}
+
+TEST(FhnCompiledProgram, RunRequiresBindAndFollowsRebind) {
+  FhnKernelEntry entries[] = {{FHN_ADD_CC, test_add_cc, "add_cc"}};
+  FhnKernelTable table = {1, entries};
+  FhnDefaultExecutor executor(&table);
+
+  ProgramBuilder b;
+  b.input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).output(3);
+  auto compiled = FhnCompiledProgram::compile(executor, *b.build());
+  ASSERT_TRUE(compiled.has_value());
+  EXPECT_EQ(compiled->run(nullptr), -1);
+
+  Buffers first(4), second(4);
+  first.values[1].value = 1;
+  first.values[2].value = 2;
+  second.values[1].value = 10;
+  second.values[2].value = 20;
+
+  compiled->bind(first.ptrs.data());
+  ASSERT_EQ(compiled->run(nullptr), 0);
+  ASSERT_EQ(compiled->run(nullptr), 0); // bound once, run repeatedly
+  EXPECT_EQ(first.values[3].value, 3);
+
+  compiled->bind(second.ptrs.data());
+  ASSERT_EQ(compiled->run(nullptr), 0);
+  EXPECT_EQ(second.values[3].value, 30);
+  EXPECT_EQ(first.values[3].value, 3);
+}
+
+TEST(FhnCompiledProgram, OutlivesSourceProgram) {
+  FhnKernelEntry entries[] = {{FHN_ROTATE, test_rotate, "rotate"}};
+  FhnKernelTable table = {1, entries};
+  FhnDefaultExecutor executor(&table);
+
+  std::optional<FhnCompiledProgram> compiled;
+  {
+    ProgramBuilder b;
+    b.input(1).inst_p0(FHN_ROTATE, 2, 1, 9).output(2);
+    compiled = FhnCompiledProgram::compile(executor, *b.build());
+  }
+  ASSERT_TRUE(compiled.has_value());
+
+  Buffers bufs(3);
+  bufs.values[1].value = 1;
+  ASSERT_EQ(compiled->execute(nullptr, bufs.ptrs.data()), 0);
+  EXPECT_EQ(bufs.values[2].value, 10);
+}
+
+TEST(FhnCompiledProgram, HRotAddPrefersRegisteredHRot) {
+  FhnKernelEntry entries[] = {
+    {FHN_ADD_CC, test_add_cc, "add_cc"},
+    {FHN_HROT, test_rotate, "hrot"},
+  };
+  FhnKernelTable table = {2, entries};
+  FhnDefaultExecutor executor(&table);
+
+  ProgramBuilder b;
+  b.input(1).input(2).inst(FHN_HROT_ADD, 3, 1, 2).output(3);
+  b.insts.back().params[0] = 4;
+  auto compiled = FhnCompiledProgram::compile(executor, *b.build());
+  ASSERT_TRUE(compiled.has_value());
+  EXPECT_EQ(compiled->stepCount(), 2u); // HROT + ADD_CC
+
+  Buffers bufs(4);
+  bufs.values[1].value = 1;
+  bufs.values[2].value = 100;
+  ASSERT_EQ(compiled->execute(nullptr, bufs.ptrs.data()), 0);
+  EXPECT_EQ(bufs.values[3].value, 105);
+}
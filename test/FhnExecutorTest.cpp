@@ -448,7 +448,9 @@ TEST(FhnExecutor, DecomposeFailsWhenPrimitiveMissing) {
   fhn_program_free(prog);
 }
 
+#include "FHN/FhnCompiledProgram.h"
 #include "FHN/FhnMovementPlan.h"
+#include "FHN/FhnThreadPool.h"
 #include "FhnTestProgramBuilder.h"
 
 #include <algorithm>
@@ -707,3 +709,437 @@ TEST(FhnExecutorMovement, BudgetedExecutionCorrectUnderLru) {
   EXPECT_NE(std::find(world.log.begin(), world.log.end(), "evict#2"), world.log.end());
   movementFree(nullptr, buffers[7]);
 }
+
+namespace {
+
+// Batched ADD_CC: records its calls so tests can tell batched dispatch from
+// the per-request fallback loop.
+int g_batch_calls = 0;
+uint32_t g_batch_count = 0;
+
+int test_batch_add_cc(FhnBackendCtx *, uint32_t count, FhnBuffer *const *results, const FhnBuffer *const *operands,
+                      const int64_t *, const double *) {
+  ++g_batch_calls;
+  g_batch_count = count;
+  for (uint32_t r = 0; r < count; ++r) {
+    auto *res = reinterpret_cast<TestBuffer *>(results[r]);
+    res->value = reinterpret_cast<const TestBuffer *>(operands[r * 4])->value +
+                 reinterpret_cast<const TestBuffer *>(operands[r * 4 + 1])->value;
+  }
+  return 0;
+}
+
+int test_batch_fail(FhnBackendCtx *, uint32_t, FhnBuffer *const *, const FhnBuffer *const *, const int64_t *,
+                    const double *) {
+  return -9;
+}
+
+// Request r's buffer table over ids 0..5, inputs r1 = r + 1 and r2 = 10.
+struct BatchTables {
+  explicit BatchTables(uint32_t n) : values(n, std::vector<TestBuffer>(6, TestBuffer{0})), ptrs(n), tables(n) {
+    for (uint32_t r = 0; r < n; ++r) {
+      values[r][1].value = r + 1;
+      values[r][2].value = 10;
+      for (auto &v : values[r])
+        ptrs[r].push_back(reinterpret_cast<FhnBuffer *>(&v));
+      tables[r] = ptrs[r].data();
+    }
+  }
+  std::vector<std::vector<TestBuffer>> values;
+  std::vector<std::vector<FhnBuffer *>> ptrs;
+  std::vector<FhnBuffer **> tables;
+};
+
+} // namespace
+
+TEST(FhnExecutorBatch, MatchesPerRequestExecution) {
+  FhnKernelEntry entries[] = {
+    {FHN_ADD_CC, test_add_cc, "add_cc"},
+    {FHN_MULT_CC, test_mult_cc, "mult_cc"},
+    {FHN_NEGATE, test_negate, "negate"},
+  };
+  FhnKernelTable table = {3, entries};
+  FhnBatchKernelEntry batch_entries[] = {
+    {FHN_ADD_CC, test_batch_add_cc, "add_cc"},
+    {FHN_ROTATE, test_batch_add_cc, "rotate"}, // no regular kernel: ignored
+  };
+  FhnBatchKernelTable batch_table = {2, batch_entries};
+  FhnDefaultExecutor executor(&table, nullptr, nullptr, &batch_table);
+  EXPECT_NE(executor.batchKernel(FHN_ADD_CC), nullptr);
+  EXPECT_EQ(executor.batchKernel(FHN_MULT_CC), nullptr);
+  EXPECT_EQ(executor.batchKernel(FHN_ROTATE), nullptr);
+
+  // r3 = HMULT(r1, r2) (decomposes to MULT_CC); r4 = r3 + r1; r5 = -r4
+  ProgramBuilder b;
+  b.input(1).input(2).inst(FHN_HMULT, 3, 1, 2).inst(FHN_ADD_CC, 4, 3, 1).inst(FHN_NEGATE, 5, 4).output(5);
+  auto prog = b.build();
+
+  const uint32_t n = 4;
+  BatchTables batched(n), single(n);
+  g_batch_calls = 0;
+  ASSERT_EQ(executor.executeBatch(nullptr, prog.get(), batched.tables.data(), n), 0);
+  EXPECT_EQ(g_batch_calls, 1);
+  EXPECT_EQ(g_batch_count, n);
+  for (uint32_t r = 0; r < n; ++r) {
+    ASSERT_EQ(executor.execute(nullptr, prog.get(), single.tables[r]), 0);
+    EXPECT_EQ(batched.values[r][5].value, -11 * static_cast<int64_t>(r + 1));
+    EXPECT_EQ(batched.values[r][5].value, single.values[r][5].value);
+  }
+
+  // Without a batched table every kernel runs per request.
+  FhnDefaultExecutor looped(&table);
+  BatchTables fallback(n);
+  g_batch_calls = 0;
+  ASSERT_EQ(looped.executeBatch(nullptr, prog.get(), fallback.tables.data(), n), 0);
+  EXPECT_EQ(g_batch_calls, 0);
+  EXPECT_EQ(fallback.values[3][5].value, -44);
+}
+
+TEST(FhnExecutorBatch, FailuresPropagate) {
+  FhnKernelEntry entries[] = {
+    {FHN_ADD_CC, test_add_cc, "add_cc"},
+    {FHN_NEGATE, test_fail, "negate"},
+  };
+  FhnKernelTable table = {2, entries};
+  FhnBatchKernelEntry batch_entries[] = {{FHN_ADD_CC, test_batch_fail, "add_cc"}};
+  FhnBatchKernelTable batch_table = {1, batch_entries};
+  FhnDefaultExecutor looped(&table);
+  FhnDefaultExecutor batched(&table, nullptr, nullptr, &batch_table);
+
+  ProgramBuilder failing;
+  failing.input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).inst(FHN_NEGATE, 4, 3).output(4);
+  auto prog = failing.build();
+  BatchTables a(2), c(2);
+  EXPECT_EQ(looped.executeBatch(nullptr, prog.get(), a.tables.data(), 2), -7);
+  EXPECT_EQ(a.values[1][3].value, 12); // the ADD_CC before the failure ran
+  EXPECT_EQ(batched.executeBatch(nullptr, prog.get(), c.tables.data(), 2), -9);
+
+  // Unresolvable opcodes are rejected before any kernel runs.
+  ProgramBuilder unsupported;
+  unsupported.input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).inst(FHN_CONJUGATE, 4, 3);
+  BatchTables untouched(2);
+  EXPECT_EQ(looped.executeBatch(nullptr, unsupported.build().get(), untouched.tables.data(), 2), -1);
+  EXPECT_EQ(untouched.values[0][3].value, 0);
+
+  // An empty batch is a no-op.
+  EXPECT_EQ(looped.executeBatch(nullptr, prog.get(), nullptr, 0), 0);
+}
+
+// --- Cost-driven fused vs decomposed selection ---
+
+namespace {
+
+int g_fused_calls = 0;
+int g_primitive_calls = 0;
+
+int cost_fused_mult(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *params,
+                    const double *fparams) {
+  ++g_fused_calls;
+  return test_mult_cc(ctx, result, operands, params, fparams);
+}
+
+int cost_primitive_mult(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands,
+                        const int64_t *params, const double *fparams) {
+  ++g_primitive_calls;
+  return test_mult_cc(ctx, result, operands, params, fparams);
+}
+
+FhnKernelEntry costEntries[] = {
+  {FHN_HMULT, cost_fused_mult, "hmult"},
+  {FHN_MULT_CC, cost_primitive_mult, "mult_cc"},
+  {FHN_RELINEARIZE, test_noop, "relin"},
+  {FHN_RESCALE, test_noop, "rescale"},
+};
+FhnKernelTable costTable{4, costEntries};
+
+} // namespace
+
+TEST(FhnExecutorCosts, CheaperDecompositionDisplacesFusedKernel) {
+  FhnDefaultExecutor executor(&costTable);
+  EXPECT_FALSE(executor.prefersDecomposition(FHN_HMULT));
+
+  FhnKernelCost costs[] = {
+    {FHN_HMULT, 100.0, 0.0},
+    {FHN_MULT_CC, 10.0, 0.0},
+    {FHN_RELINEARIZE, 10.0, 0.0},
+    {FHN_RESCALE, 10.0, 0.0},
+  };
+  FhnKernelCostTable table{4, costs};
+  executor.setKernelCosts(&table);
+  EXPECT_TRUE(executor.prefersDecomposition(FHN_HMULT));
+  EXPECT_FALSE(executor.prefersDecomposition(FHN_MULT_CC)); // nothing to decompose into
+  FhnKernelStep steps[FhnDefaultExecutor::kMaxSteps];
+  FhnInstruction inst{};
+  inst.opcode = FHN_HMULT;
+  inst.result_id = 3;
+  inst.operands[0] = 1;
+  inst.operands[1] = 2;
+  ASSERT_EQ(executor.resolve(inst, steps), 3u);
+  EXPECT_EQ(steps[0].opcode, FHN_MULT_CC);
+
+  ProgramBuilder b;
+  b.input(1).input(2).inst(FHN_HMULT, 3, 1, 2).output(3);
+  auto prog = b.build();
+  TestBuffer bufs[4] = {{0}, {7}, {6}, {0}};
+  FhnBuffer *ptrs[4];
+  for (int i = 0; i < 4; ++i)
+    ptrs[i] = reinterpret_cast<FhnBuffer *>(&bufs[i]);
+  g_fused_calls = g_primitive_calls = 0;
+  ASSERT_EQ(executor.execute(nullptr, prog.get(), ptrs), 0);
+  EXPECT_EQ(bufs[3].value, 42);
+  EXPECT_EQ(g_fused_calls, 0);
+  EXPECT_EQ(g_primitive_calls, 1);
+
+  // The fused kernel is cheaper again: it wins.
+  costs[0].base_ns = 20.0;
+  executor.setKernelCosts(&table);
+  EXPECT_FALSE(executor.prefersDecomposition(FHN_HMULT));
+
+  // No table: back to the default.
+  costs[0].base_ns = 100.0;
+  executor.setKernelCosts(&table);
+  executor.setKernelCosts(nullptr);
+  EXPECT_FALSE(executor.prefersDecomposition(FHN_HMULT));
+  g_fused_calls = g_primitive_calls = 0;
+  ASSERT_EQ(executor.execute(nullptr, prog.get(), ptrs), 0);
+  EXPECT_EQ(g_fused_calls, 1);
+  EXPECT_EQ(g_primitive_calls, 0);
+}
+
+TEST(FhnExecutorCosts, MissingEstimateKeepsFusedKernel) {
+  FhnDefaultExecutor executor(&costTable);
+  // RESCALE has no estimate: the decomposition cannot be priced.
+  FhnKernelCost costs[] = {
+    {FHN_HMULT, 100.0, 0.0},
+    {FHN_MULT_CC, 1.0, 0.0},
+    {FHN_RELINEARIZE, 1.0, 0.0},
+  };
+  FhnKernelCostTable table{3, costs};
+  executor.setKernelCosts(&table);
+  EXPECT_FALSE(executor.prefersDecomposition(FHN_HMULT));
+}
+
+TEST(FhnExecutorCosts, ChoiceFollowsInstructionLevel) {
+  // HMULT only decomposes into MULT_CC here. Fused: 10 + 30/level;
+  // decomposed: 15 + 5/level. Decomposition wins at levels 1 and 2, the
+  // fused kernel at level 0.
+  FhnKernelEntry entries[] = {
+    {FHN_HMULT, cost_fused_mult, "hmult"},
+    {FHN_MULT_CC, cost_primitive_mult, "mult_cc"},
+  };
+  FhnKernelTable kernels{2, entries};
+  FhnDefaultExecutor executor(&kernels);
+  FhnKernelCost costs[] = {
+    {FHN_HMULT, 10.0, 30.0},
+    {FHN_MULT_CC, 15.0, 5.0},
+  };
+  FhnKernelCostTable table{2, costs};
+  fhenomenon::FhnLevelModel model;
+  model.fresh_level = 2;
+  model.bytes_by_level = {1, 2, 3};
+  model.effects[FHN_HMULT] = FHN_LEVEL_CONSUME;
+  executor.setKernelCosts(&table, &model);
+  EXPECT_TRUE(executor.prefersDecomposition(FHN_HMULT)); // fresh level
+  EXPECT_TRUE(executor.prefersDecomposition(FHN_HMULT, 1));
+  EXPECT_FALSE(executor.prefersDecomposition(FHN_HMULT, 0));
+
+  // r3 = r1 * r2 (level 2); r4 = r3 * r3 (level 1); r5 = r4 * r4 (level 0)
+  ProgramBuilder b;
+  b.input(1).input(2).inst(FHN_HMULT, 3, 1, 2).inst(FHN_HMULT, 4, 3, 3).inst(FHN_HMULT, 5, 4, 4).output(5);
+  auto prog = b.build();
+  TestBuffer bufs[6] = {{0}, {2}, {1}, {0}, {0}, {0}};
+  FhnBuffer *ptrs[6];
+  for (int i = 0; i < 6; ++i)
+    ptrs[i] = reinterpret_cast<FhnBuffer *>(&bufs[i]);
+  g_fused_calls = g_primitive_calls = 0;
+  ASSERT_EQ(executor.execute(nullptr, prog.get(), ptrs), 0);
+  EXPECT_EQ(bufs[5].value, 16);
+  EXPECT_EQ(g_primitive_calls, 2);
+  EXPECT_EQ(g_fused_calls, 1);
+
+  // The parallel, batched and compiled paths resolve the same kernels.
+  // Without thread-safety flags executeParallel runs every kernel on the
+  // calling thread, so the counters need no synchronization.
+  fhenomenon::FhnThreadPool pool(2);
+  g_fused_calls = g_primitive_calls = 0;
+  bufs[5].value = 0;
+  ASSERT_EQ(executor.executeParallel(nullptr, prog.get(), ptrs, pool), 0);
+  EXPECT_EQ(bufs[5].value, 16);
+  EXPECT_EQ(g_primitive_calls, 2);
+  EXPECT_EQ(g_fused_calls, 1);
+
+  TestBuffer other[6] = {{0}, {3}, {1}, {0}, {0}, {0}};
+  FhnBuffer *other_ptrs[6];
+  for (int i = 0; i < 6; ++i)
+    other_ptrs[i] = reinterpret_cast<FhnBuffer *>(&other[i]);
+  FhnBuffer **tables[2] = {ptrs, other_ptrs};
+  g_fused_calls = g_primitive_calls = 0;
+  ASSERT_EQ(executor.executeBatch(nullptr, prog.get(), tables, 2), 0);
+  EXPECT_EQ(other[5].value, 81);
+  EXPECT_EQ(g_primitive_calls, 4);
+  EXPECT_EQ(g_fused_calls, 2);
+
+  auto compiled = fhenomenon::FhnCompiledProgram::compile(executor, *prog);
+  ASSERT_TRUE(compiled.has_value());
+  compiled->bind(ptrs);
+  g_fused_calls = g_primitive_calls = 0;
+  ASSERT_EQ(compiled->run(nullptr), 0);
+  EXPECT_EQ(g_primitive_calls, 2);
+  EXPECT_EQ(g_fused_calls, 1);
+}
+
+// The slot-rewritten program computes the same values as the id program,
+// with the inputs placed at their slots and fewer backend allocations.
+TEST(FhnExecutorMovement, SlotAssignedExecutionComputesCorrectValues) {
+  auto prog = ProgramBuilder()
+                .input(1)
+                .input(2)
+                .input(8)
+                .inst(FHN_ADD_CC, 3, 2, 2)
+                .inst(FHN_ADD_CC, 4, 3, 1)
+                .inst(FHN_ADD_CC, 5, 4, 8)
+                .inst(FHN_ADD_CC, 6, 5, 2)
+                .inst(FHN_ADD_CC, 7, 6, 1)
+                .output(7)
+                .build();
+  FhnPlanOptions options;
+  options.assign_slots = true;
+  for (uint64_t budget : {uint64_t{0}, uint64_t{4}}) {
+    MovementWorld world;
+    g_world = &world;
+    auto plan = FhnMovementPlan::analyze(*prog, {7}, budget, FhnEvictionPolicy::Belady, nullptr, options);
+    ASSERT_TRUE(plan.has_value());
+    ASSERT_NE(plan->program(), nullptr);
+    EXPECT_LT(plan->tableSize(), 9u);
+
+    std::vector<FhnBuffer *> buffers(plan->tableSize(), nullptr);
+    const long values[] = {10, 1, 100};
+    const uint32_t inputs[] = {1, 2, 8};
+    for (std::size_t k = 0; k < 3; ++k) {
+      FhnBuffer *buf = movementAlloc(nullptr);
+      world.device_vals[buf] = values[k];
+      buffers[plan->slotOf(inputs[k])] = buf;
+    }
+
+    FhnDefaultExecutor executor(&movementTable);
+    FhnMovementHooks hooks{nullptr, movementAlloc, movementFree, movementPrefetch, movementEvict};
+    ASSERT_EQ(executor.execute(hooks, plan->program(), buffers.data(), *plan), 0) << budget;
+
+    FhnBuffer *out = buffers[plan->slotOf(7)];
+    EXPECT_EQ(world.device_vals.at(out), 123) << budget;
+    EXPECT_EQ(static_cast<uint32_t>(world.allocs - 3), plan->stats().alloc_count) << budget;
+    EXPECT_EQ(world.allocs - world.frees, 1) << budget; // only the pinned output survives
+    movementFree(nullptr, out);
+  }
+}
+
+// Discarded values are recomputed from resident operands: the same values
+// come out with one round trip fewer, with and without slot assignment.
+TEST(FhnExecutorMovement, RematerializedExecutionComputesCorrectValues) {
+  auto prog = ProgramBuilder()
+                .input(1)
+                .input(2)
+                .inst(FHN_ADD_CC, 3, 1, 1)
+                .inst(FHN_ADD_CC, 4, 2, 2)
+                .inst(FHN_ADD_CC, 5, 4, 2)
+                .inst(FHN_ADD_CC, 6, 5, 5)
+                .inst(FHN_ADD_CC, 7, 6, 1)
+                .inst(FHN_ADD_CC, 8, 7, 3)
+                .output(8)
+                .build();
+  for (bool slots : {false, true}) {
+    MovementWorld world;
+    g_world = &world;
+    FhnPlanOptions options;
+    options.rematerialize = true;
+    options.assign_slots = slots;
+    auto plan = FhnMovementPlan::analyze(*prog, {1, 2, 8}, 4, FhnEvictionPolicy::Belady, nullptr, options);
+    ASSERT_TRUE(plan.has_value());
+    ASSERT_EQ(plan->stats().recompute_count, 1u);
+
+    FhnBuffer *a1 = movementAlloc(nullptr);
+    FhnBuffer *b2 = movementAlloc(nullptr);
+    world.device_vals[a1] = 10;
+    world.device_vals[b2] = 1;
+    std::vector<FhnBuffer *> buffers(plan->tableSize(), nullptr);
+    buffers[plan->slotOf(1)] = a1;
+    buffers[plan->slotOf(2)] = b2;
+
+    FhnDefaultExecutor executor(&movementTable);
+    FhnMovementHooks hooks{nullptr, movementAlloc, movementFree, movementPrefetch, movementEvict};
+    const FhnProgram *run = plan->program() ? plan->program() : prog.get();
+    ASSERT_EQ(executor.execute(hooks, run, buffers.data(), *plan), 0) << slots;
+
+    // 3=20; 4=2; 5=3; 6=6; 7=16; 8=16+20 with t3 recomputed at i5.
+    FhnBuffer *out = buffers[plan->slotOf(8)];
+    EXPECT_EQ(world.device_vals.at(out), 36) << slots;
+    EXPECT_EQ(world.kernel_calls, 7) << slots;
+    EXPECT_EQ(std::count(world.log.begin(), world.log.end(), "evict#3"), 0) << slots;
+    EXPECT_EQ(world.allocs - world.frees, 3) << slots; // a1, b2 and the output
+    for (FhnBuffer *buf : {a1, b2, out})
+      movementFree(nullptr, buf);
+  }
+}
+
+namespace {
+
+// LEVEL_DOWN keeps the fake value: a lowered value must read the same.
+int movementLevelDownKernel(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *ops, const int64_t *params,
+                            const double *) {
+  g_world->kernel_calls++;
+  g_world->device_vals.at(result) = g_world->device_vals.at(const_cast<FhnBuffer *>(ops[0]));
+  g_world->log.push_back("level_down#" + std::to_string(g_world->names[result]) + "@" + std::to_string(params[0]));
+  return 0;
+}
+
+FhnKernelEntry levelEntries[] = {{FHN_ADD_CC, movementAddKernel, "add_cc"},
+                                 {FHN_LEVEL_DOWN, movementLevelDownKernel, "level_down"}};
+FhnKernelTable levelTable{2, levelEntries};
+
+} // namespace
+
+// A value lowered before its eviction travels at the smaller size and the
+// same values come out; the level-down runs in place ahead of the evict.
+TEST(FhnExecutorMovement, LevelDownBeforeEvictComputesCorrectValues) {
+  MovementWorld world;
+  g_world = &world;
+  // Same program as FhnMovementPlan.LevelDownShrinksEvictedValues.
+  auto prog = ProgramBuilder()
+                .input(1)
+                .inst_p0(FHN_LEVEL_DOWN, 2, 1, 0)
+                .inst(FHN_ADD_CC, 3, 2, 2)
+                .inst(FHN_ADD_CC, 4, 3, 2)
+                .inst(FHN_ADD_CC, 5, 4, 1)
+                .output(5)
+                .build();
+  FhnLevelModel model;
+  model.fresh_level = 2;
+  model.bytes_by_level = {30, 60, 100};
+  model.effects[FHN_ADD_CC] = FHN_LEVEL_PRESERVE;
+  model.effects[FHN_LEVEL_DOWN] = FHN_LEVEL_SET_PARAM0;
+  FhnPlanOptions options;
+  options.level_down_before_evict = true;
+  auto plan = FhnMovementPlan::analyze(*prog, {5}, 160, FhnEvictionPolicy::Belady, &model, options);
+  ASSERT_TRUE(plan.has_value());
+  ASSERT_EQ(plan->stats().level_down_count, 1u);
+
+  FhnBuffer *a1 = movementAlloc(nullptr);
+  world.device_vals[a1] = 10;
+  std::vector<FhnBuffer *> buffers(plan->tableSize(), nullptr);
+  buffers[1] = a1;
+
+  FhnDefaultExecutor executor(&levelTable);
+  FhnMovementHooks hooks{nullptr, movementAlloc, movementFree, movementPrefetch, movementEvict};
+  ASSERT_EQ(executor.execute(hooks, prog.get(), buffers.data(), *plan), 0);
+
+  // 2=10; 3=20; 4=30; 5=30+10.
+  EXPECT_EQ(world.device_vals.at(buffers[5]), 40);
+  auto lowered = std::find(world.log.begin(), world.log.end(), "level_down#1@0");
+  auto evicted = std::find(world.log.begin(), world.log.end(), "evict#1");
+  ASSERT_NE(lowered, world.log.end());
+  ASSERT_NE(evicted, world.log.end());
+  EXPECT_LT(lowered, evicted);
+
+  EXPECT_EQ(world.allocs - world.frees, 1); // only the pinned output
+  movementFree(nullptr, buffers[5]);
+}
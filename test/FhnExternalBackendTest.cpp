@@ -1,6 +1,8 @@
 #include "Backend/External.h"
 #include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnMovementPlan.h"
 #include "FHN/fhn_program.h"
+#include "FhnTestProgramBuilder.h"
 #include "Fhenon.h"
 #include "Parameter/ParameterGen.h"
 
@@ -29,6 +31,14 @@ static std::string getPartialTestLibPath() {
 #endif
 }
 
+static std::string getLatencyTestLibPath() {
+#ifdef __APPLE__
+  return std::string(TEST_LIB_DIR) + "/liblatency_fhn.dylib";
+#else
+  return std::string(TEST_LIB_DIR) + "/liblatency_fhn.so";
+#endif
+}
+
 TEST(FhnExternalBackend, LoadAndQueryInfo) {
   ExternalBackend backend(getTestLibPath(), nullptr, "toyfhe_");
 
@@ -63,6 +73,12 @@ TEST(FhnExternalBackend, ResolvesDataPlane) {
   EXPECT_NE(vtable.encrypt_f64, nullptr);
   EXPECT_NE(vtable.decrypt_i64, nullptr);
   EXPECT_NE(vtable.decrypt_f64, nullptr);
+  EXPECT_NE(vtable.encrypt_batch_i64, nullptr);
+  // As does the peer copy its contexts exchange ciphertexts through.
+  EXPECT_NE(vtable.copy_peer, nullptr);
+  // And the serialization pair spilling goes through.
+  EXPECT_NE(vtable.serialize, nullptr);
+  EXPECT_NE(vtable.deserialize, nullptr);
 }
 
 TEST(FhnExternalBackend, EncryptAddDecryptViaDlopen) {
@@ -100,6 +116,26 @@ TEST(FhnExternalBackend, EncryptAddDecryptViaDlopen) {
   fhn_program_free(prog);
 }
 
+TEST(FhnExternalBackend, BatchEncryptViaDlopen) {
+  ExternalBackend backend(getTestLibPath(), nullptr, "toyfhe_");
+  auto &vtable = backend.getVTable();
+  auto *ctx = backend.getFhnCtx();
+  ASSERT_NE(vtable.encrypt_batch_i64, nullptr);
+
+  const int64_t values[3] = {-7, 0, 123456};
+  FhnBuffer *bufs[3];
+  for (auto &buf : bufs)
+    buf = vtable.buffer_alloc(ctx);
+  ASSERT_EQ(vtable.encrypt_batch_i64(ctx, bufs, values, 3), 0);
+  for (int i = 0; i < 3; i++) {
+    int64_t result = 0;
+    ASSERT_EQ(vtable.decrypt_i64(ctx, bufs[i], &result), 0);
+    EXPECT_EQ(result, values[i]);
+  }
+  for (auto *buf : bufs)
+    vtable.buffer_free(ctx, buf);
+}
+
 // The Backend-interface path: transform() encrypts and decrypt() decrypts
 // through the data plane instead of silently returning 0.
 TEST(FhnExternalBackend, BackendInterfaceEncryptDecrypt) {
@@ -154,6 +190,91 @@ TEST(FhnExternalBackend, MovementHooksAbsentResolveToNull) {
   ASSERT_NE(rt, nullptr);
   EXPECT_EQ(rt->prefetch, nullptr);
   EXPECT_EQ(rt->evict, nullptr);
+  EXPECT_EQ(rt->prefetch_async, nullptr);
+  EXPECT_EQ(rt->fence, nullptr);
+}
+
+// The latency fixture exports the movement pair and the async pair.
+TEST(FhnExternalBackend, AsyncPrefetchPairResolves) {
+  ExternalBackend backend(getLatencyTestLibPath(), nullptr, "lat_");
+  const FhnRuntime *rt = backend.fhnRuntime();
+  ASSERT_NE(rt, nullptr);
+  EXPECT_NE(rt->prefetch, nullptr);
+  EXPECT_NE(rt->evict, nullptr);
+  EXPECT_NE(rt->prefetch_async, nullptr);
+  EXPECT_NE(rt->fence, nullptr);
+}
+
+// On the simulated-latency backend (1 us per transfer and per kernel),
+// lookahead hides the copies of inputs c3 and d4 behind the two kernels
+// before each one's first use: 2 of the 9 us on the critical path go.
+// Without the async pair the same plan still runs, with synchronous copies.
+TEST(FhnExternalBackend, LookaheadOverlapsTransfersWithCompute) {
+  using fhenomenon::testutil::ProgramBuilder;
+  ExternalBackend backend(getLatencyTestLibPath(), R"({"transfer_ns": 1000, "kernel_ns": 1000})", "lat_");
+  const FhnRuntime *rt = backend.fhnRuntime();
+  ASSERT_NE(rt, nullptr);
+  void *lib = dlopen(getLatencyTestLibPath().c_str(), RTLD_NOW | RTLD_NOLOAD);
+  ASSERT_NE(lib, nullptr);
+  auto elapsed = reinterpret_cast<uint64_t (*)(FhnBackendCtx *)>(dlsym(lib, "lat_elapsed_ns"));
+  ASSERT_NE(elapsed, nullptr);
+
+  auto prog = ProgramBuilder()
+                .input(1)
+                .input(2)
+                .input(3)
+                .input(4)
+                .inst(FHN_ADD_CC, 5, 1, 2)
+                .inst(FHN_MULT_CC, 6, 5, 5)
+                .inst(FHN_ADD_CC, 7, 6, 3)
+                .inst(FHN_MULT_CC, 8, 7, 7)
+                .inst(FHN_ADD_CC, 9, 8, 4)
+                .output(9)
+                .build();
+  const std::vector<uint32_t> pinned{1, 2, 3, 4, 9};
+  auto eager = FhnMovementPlan::analyze(*prog, pinned);
+  FhnPlanOptions options;
+  options.prefetch_lookahead = 2;
+  auto ahead = FhnMovementPlan::analyze(*prog, pinned, 0, FhnEvictionPolicy::Belady, nullptr, options);
+  ASSERT_TRUE(eager.has_value());
+  ASSERT_TRUE(ahead.has_value());
+  ASSERT_EQ(ahead->stats().hoisted_prefetch_count, 2u);
+
+  const auto &vtable = backend.getVTable();
+  auto run = [&](const FhnMovementHooks &hooks, const FhnMovementPlan &plan, uint64_t *ns) {
+    std::vector<FhnBuffer *> bufs(10, nullptr);
+    for (uint32_t id = 1; id <= 4; ++id) {
+      bufs[id] = rt->buffer_alloc(rt->ctx);
+      vtable.encrypt_i64(rt->ctx, bufs[id], id); // host-side: each needs a prefetch
+    }
+    const uint64_t start = elapsed(rt->ctx);
+    const int rc = rt->executor->execute(hooks, prog.get(), bufs.data(), plan);
+    *ns = elapsed(rt->ctx) - start;
+    int64_t value = -1;
+    if (rc == 0)
+      vtable.decrypt_i64(rt->ctx, bufs[9], &value);
+    for (FhnBuffer *b : bufs) {
+      if (b)
+        rt->buffer_free(rt->ctx, b);
+    }
+    return rc == 0 ? value : -1;
+  };
+
+  FhnMovementHooks sync_hooks{rt->ctx, rt->buffer_alloc, rt->buffer_free, rt->prefetch, rt->evict};
+  FhnMovementHooks async_hooks = sync_hooks;
+  async_hooks.prefetch_async = rt->prefetch_async;
+  async_hooks.fence = rt->fence;
+  const int64_t expected = (1 + 2) * (1 + 2) + 3;
+  uint64_t eager_ns = 0;
+  uint64_t ahead_ns = 0;
+  uint64_t fallback_ns = 0;
+  EXPECT_EQ(run(async_hooks, *eager, &eager_ns), expected * expected + 4);
+  EXPECT_EQ(run(async_hooks, *ahead, &ahead_ns), expected * expected + 4);
+  EXPECT_EQ(run(sync_hooks, *ahead, &fallback_ns), expected * expected + 4);
+  EXPECT_EQ(eager_ns, 9000u); // 4 copies + 5 kernels, back to back
+  EXPECT_EQ(ahead_ns, 7000u);
+  EXPECT_EQ(fallback_ns, eager_ns);
+  dlclose(lib);
 }
 
 // ToyFHE declares a flat level model: the trio resolves (positive dlsym
@@ -0,0 +1,314 @@
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnFusionPass.h"
+#include "FhnTestProgramBuilder.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+using fhenomenon::FhnDefaultExecutor;
+using fhenomenon::FhnFusionPass;
+using fhenomenon::testutil::ProgramBuilder;
+
+namespace {
+
+// Scalar stand-ins: ROTATE adds its distance, so rotations stay observable
+// without slots.
+struct TestBuffer {
+  int64_t value;
+};
+
+int64_t val(const FhnBuffer *buf) { return reinterpret_cast<const TestBuffer *>(buf)->value; }
+void set(FhnBuffer *buf, int64_t v) { reinterpret_cast<TestBuffer *>(buf)->value = v; }
+
+int test_add_cc(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *, const double *) {
+  set(result, val(operands[0]) + val(operands[1]));
+  return 0;
+}
+
+int test_mult_cc(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+                 const double *) {
+  set(result, val(operands[0]) * val(operands[1]));
+  return 0;
+}
+
+int test_mult_cs(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+                 const double *fparams) {
+  set(result, val(operands[0]) * static_cast<int64_t>(fparams[0]));
+  return 0;
+}
+
+int test_passthrough(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+                     const double *) {
+  set(result, val(operands[0]));
+  return 0;
+}
+
+int test_rotate(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *params,
+                const double *) {
+  set(result, val(operands[0]) + params[0]);
+  return 0;
+}
+
+int test_hrot_add(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *params,
+                  const double *) {
+  set(result, val(operands[0]) + params[0] + val(operands[1]));
+  return 0;
+}
+
+int test_mad(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+             const double *fparams) {
+  set(result, val(operands[0]) * static_cast<int64_t>(fparams[0]) + val(operands[1]));
+  return 0;
+}
+
+int test_hmult(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *params,
+               const double *fparams) {
+  return test_mult_cc(ctx, result, operands, params, fparams);
+}
+
+FhnKernelEntry g_full[] = {
+  {FHN_ADD_CC, test_add_cc, "add_cc"},
+  {FHN_MULT_CC, test_mult_cc, "mult_cc"},
+  {FHN_MULT_CS, test_mult_cs, "mult_cs"},
+  {FHN_RELINEARIZE, test_passthrough, "relinearize"},
+  {FHN_RESCALE, test_passthrough, "rescale"},
+  {FHN_ROTATE, test_rotate, "rotate"},
+  {FHN_HROT_ADD, test_hrot_add, "hrot_add"},
+  {FHN_MAD, test_mad, "mad"},
+  {FHN_HMULT, test_hmult, "hmult"},
+};
+FhnKernelTable g_full_table = {sizeof(g_full) / sizeof(g_full[0]), g_full};
+
+// Primitives only: nothing may fuse.
+FhnKernelTable g_primitive_table = {6, g_full};
+
+using ProgramPtr = std::unique_ptr<FhnProgram, decltype(&fhn_program_free)>;
+
+ProgramPtr fuse(const FhnDefaultExecutor &executor, const FhnProgram &program,
+                const std::vector<uint32_t> &preserved = {}, FhnFusionPass::Stats *stats = nullptr) {
+  return {FhnFusionPass::run(executor, program, preserved, stats), &fhn_program_free};
+}
+
+FhnInstruction scalar_inst(FhnOpCode op, uint32_t result, uint32_t a, double s) {
+  FhnInstruction in{};
+  in.opcode = op;
+  in.result_id = result;
+  in.operands[0] = a;
+  in.fparams[0] = s;
+  return in;
+}
+
+// Runs `program` over ids 1..max_id with input i holding 10 * i.
+std::vector<int64_t> run(FhnDefaultExecutor &executor, const FhnProgram &program, uint32_t max_id) {
+  std::vector<TestBuffer> values(max_id + 1, TestBuffer{0});
+  std::vector<FhnBuffer *> ptrs(max_id + 1, nullptr);
+  for (uint32_t id = 0; id <= max_id; ++id)
+    ptrs[id] = reinterpret_cast<FhnBuffer *>(&values[id]);
+  for (uint32_t i = 0; i < program.num_inputs; ++i)
+    values[program.input_ids[i]].value = 10 * static_cast<int64_t>(program.input_ids[i]);
+  EXPECT_EQ(executor.execute(nullptr, &program, ptrs.data()), 0);
+  std::vector<int64_t> out;
+  for (uint32_t i = 0; i < program.num_outputs; ++i)
+    out.push_back(values[program.output_ids[i]].value);
+  return out;
+}
+
+} // namespace
+
+TEST(FhnFusionPass, RotateThenAddBecomesHrotAdd) {
+  FhnDefaultExecutor executor(&g_full_table);
+  ProgramBuilder b;
+  b.input(1).input(2).inst_p0(FHN_ROTATE, 3, 1, 4).inst(FHN_ADD_CC, 4, 2, 3).output(4);
+  auto prog = b.build();
+
+  FhnFusionPass::Stats stats;
+  auto fused = fuse(executor, *prog, {}, &stats);
+  ASSERT_NE(fused, nullptr);
+  EXPECT_EQ(stats.hrot_add, 1u);
+  EXPECT_EQ(stats.fused(), 1u);
+  ASSERT_EQ(fused->num_instructions, 1u);
+  const FhnInstruction &inst = fused->instructions[0];
+  EXPECT_EQ(inst.opcode, FHN_HROT_ADD);
+  EXPECT_EQ(inst.result_id, 4u);
+  EXPECT_EQ(inst.operands[0], 1u);
+  EXPECT_EQ(inst.operands[1], 2u);
+  EXPECT_EQ(inst.params[0], 4);
+  EXPECT_EQ(run(executor, *fused, 4), run(executor, *prog, 4));
+}
+
+TEST(FhnFusionPass, ScalarMultiplyThenAddBecomesMad) {
+  FhnDefaultExecutor executor(&g_full_table);
+  ProgramBuilder b;
+  b.input(1).input(2);
+  b.insts.push_back(scalar_inst(FHN_MULT_CS, 3, 1, 3.0));
+  b.inst(FHN_ADD_CC, 4, 3, 2).output(4);
+  auto prog = b.build();
+
+  FhnFusionPass::Stats stats;
+  auto fused = fuse(executor, *prog, {}, &stats);
+  ASSERT_NE(fused, nullptr);
+  EXPECT_EQ(stats.mad, 1u);
+  ASSERT_EQ(fused->num_instructions, 1u);
+  const FhnInstruction &inst = fused->instructions[0];
+  EXPECT_EQ(inst.opcode, FHN_MAD);
+  EXPECT_EQ(inst.operands[0], 1u);
+  EXPECT_EQ(inst.operands[1], 2u);
+  EXPECT_EQ(inst.fparams[0], 3.0);
+  EXPECT_EQ(run(executor, *fused, 4), (std::vector<int64_t>{10 * 3 + 20}));
+}
+
+TEST(FhnFusionPass, MultiplyRelinRescaleBecomesHmult) {
+  FhnDefaultExecutor executor(&g_full_table);
+  ProgramBuilder b;
+  b.input(1).input(2).inst(FHN_MULT_CC, 3, 1, 2).inst(FHN_RELINEARIZE, 4, 3).inst(FHN_RESCALE, 5, 4).output(5);
+  auto prog = b.build();
+
+  FhnFusionPass::Stats stats;
+  auto fused = fuse(executor, *prog, {}, &stats);
+  ASSERT_NE(fused, nullptr);
+  EXPECT_EQ(stats.hmult, 1u);
+  ASSERT_EQ(fused->num_instructions, 1u);
+  EXPECT_EQ(fused->instructions[0].opcode, FHN_HMULT);
+  EXPECT_EQ(fused->instructions[0].result_id, 5u);
+  EXPECT_EQ(run(executor, *fused, 5), (std::vector<int64_t>{200}));
+}
+
+TEST(FhnFusionPass, MultiUseIntermediateIsKept) {
+  FhnDefaultExecutor executor(&g_full_table);
+  // t = rot(x) feeds two adds.
+  ProgramBuilder b;
+  b.input(1).input(2).inst_p0(FHN_ROTATE, 3, 1, 1).inst(FHN_ADD_CC, 4, 3, 2).inst(FHN_ADD_CC, 5, 3, 4).output(5);
+  auto prog = b.build();
+
+  FhnFusionPass::Stats stats;
+  auto fused = fuse(executor, *prog, {}, &stats);
+  ASSERT_NE(fused, nullptr);
+  EXPECT_EQ(stats.fused(), 0u);
+  EXPECT_EQ(fused->num_instructions, 3u);
+}
+
+TEST(FhnFusionPass, OutputsAndPreservedIntermediatesAreKept) {
+  FhnDefaultExecutor executor(&g_full_table);
+  ProgramBuilder b;
+  b.input(1).input(2).inst_p0(FHN_ROTATE, 3, 1, 1).inst(FHN_ADD_CC, 4, 3, 2).output(4);
+  auto as_output = b;
+  as_output.output(3);
+
+  FhnFusionPass::Stats stats;
+  EXPECT_EQ(fuse(executor, *as_output.build(), {}, &stats)->num_instructions, 2u);
+  EXPECT_EQ(stats.fused(), 0u);
+  EXPECT_EQ(fuse(executor, *b.build(), {3}, &stats)->num_instructions, 2u);
+  EXPECT_EQ(stats.fused(), 0u);
+
+  // A preserved id that is overwritten later does not pin this version.
+  auto overwritten = b;
+  overwritten.inst(FHN_ADD_CC, 3, 1, 2);
+  EXPECT_EQ(fuse(executor, *overwritten.build(), {3}, &stats)->num_instructions, 2u);
+  EXPECT_EQ(stats.hrot_add, 1u);
+}
+
+TEST(FhnFusionPass, NeedsTheFusedKernel) {
+  FhnDefaultExecutor executor(&g_primitive_table);
+  ProgramBuilder b;
+  b.input(1).input(2).inst_p0(FHN_ROTATE, 3, 1, 1).inst(FHN_ADD_CC, 4, 3, 2);
+  b.insts.push_back(scalar_inst(FHN_MULT_CS, 5, 4, 2.0));
+  b.inst(FHN_ADD_CC, 6, 5, 1).output(6);
+  auto prog = b.build();
+
+  FhnFusionPass::Stats stats;
+  auto fused = fuse(executor, *prog, {}, &stats);
+  ASSERT_NE(fused, nullptr);
+  EXPECT_EQ(stats.fused(), 0u);
+  EXPECT_EQ(fused->num_instructions, prog->num_instructions);
+}
+
+TEST(FhnFusionPass, FusedKernelDisplacedByCostsIsNotTargeted) {
+  FhnDefaultExecutor executor(&g_full_table);
+  FhnKernelCost costs[] = {
+    {FHN_HMULT, 100.0, 0.0},
+    {FHN_MULT_CC, 10.0, 0.0},
+    {FHN_RELINEARIZE, 10.0, 0.0},
+    {FHN_RESCALE, 10.0, 0.0},
+  };
+  FhnKernelCostTable table = {4, costs};
+  executor.setKernelCosts(&table);
+  ProgramBuilder b;
+  b.input(1).input(2).inst(FHN_MULT_CC, 3, 1, 2).inst(FHN_RELINEARIZE, 4, 3).inst(FHN_RESCALE, 5, 4).output(5);
+  auto prog = b.build();
+
+  FhnFusionPass::Stats stats;
+  auto fused = fuse(executor, *prog, {}, &stats);
+  ASSERT_NE(fused, nullptr);
+  EXPECT_EQ(stats.hmult, 0u);
+  EXPECT_EQ(fused->num_instructions, 3u);
+}
+
+TEST(FhnFusionPass, OperandOverwrittenBeforeConsumerBlocksFusion) {
+  FhnDefaultExecutor executor(&g_full_table);
+  // t = rot(x); x = x + y; r = t + y — moving the rotate to r would read the
+  // new x.
+  ProgramBuilder b;
+  b.input(1).input(2).inst_p0(FHN_ROTATE, 3, 1, 1).inst(FHN_ADD_CC, 1, 1, 2).inst(FHN_ADD_CC, 4, 3, 2).output(4);
+  auto prog = b.build();
+
+  FhnFusionPass::Stats stats;
+  auto fused = fuse(executor, *prog, {}, &stats);
+  ASSERT_NE(fused, nullptr);
+  EXPECT_EQ(stats.fused(), 0u);
+  EXPECT_EQ(run(executor, *fused, 4), run(executor, *prog, 4));
+}
+
+TEST(FhnFusionPass, ResultAliasingTheAddendIsNotFused) {
+  FhnDefaultExecutor executor(&g_full_table);
+  // acc = acc + rot(x): the decomposition would clobber acc before reading it.
+  ProgramBuilder b;
+  b.input(1).input(2).inst_p0(FHN_ROTATE, 3, 1, 1).inst(FHN_ADD_CC, 2, 2, 3).output(2);
+  auto prog = b.build();
+
+  FhnFusionPass::Stats stats;
+  auto fused = fuse(executor, *prog, {}, &stats);
+  ASSERT_NE(fused, nullptr);
+  EXPECT_EQ(stats.fused(), 0u);
+
+  // Writing over the rotated operand itself is fine.
+  ProgramBuilder over_source;
+  over_source.input(1).input(2).inst_p0(FHN_ROTATE, 3, 1, 1).inst(FHN_ADD_CC, 1, 3, 2).output(1);
+  auto prog2 = over_source.build();
+  auto fused2 = fuse(executor, *prog2, {}, &stats);
+  EXPECT_EQ(stats.hrot_add, 1u);
+  EXPECT_EQ(run(executor, *fused2, 3), run(executor, *prog2, 3));
+}
+
+TEST(FhnFusionPass, ReductionTreeMatchesUnfused) {
+  FhnDefaultExecutor executor(&g_full_table);
+  // s = w0 * x + s chains, then a rotate-add reduction.
+  ProgramBuilder b;
+  b.input(1).input(2).input(3);
+  b.insts.push_back(scalar_inst(FHN_MULT_CS, 4, 1, 2.0));
+  b.insts.push_back(scalar_inst(FHN_MULT_CS, 5, 2, 3.0));
+  b.inst(FHN_ADD_CC, 6, 4, 5);
+  b.insts.push_back(scalar_inst(FHN_MULT_CS, 7, 3, 5.0));
+  b.inst(FHN_ADD_CC, 8, 6, 7);
+  b.inst_p0(FHN_ROTATE, 9, 8, 2).inst(FHN_ADD_CC, 10, 8, 9);
+  b.inst_p0(FHN_ROTATE, 11, 10, 1).inst(FHN_ADD_CC, 12, 10, 11).output(12);
+  auto prog = b.build();
+
+  FhnFusionPass::Stats stats;
+  auto fused = fuse(executor, *prog, {}, &stats);
+  ASSERT_NE(fused, nullptr);
+  EXPECT_EQ(stats.mad, 2u);
+  EXPECT_EQ(stats.hrot_add, 2u);
+  EXPECT_EQ(fused->num_instructions, prog->num_instructions - 4);
+  EXPECT_EQ(run(executor, *fused, 12), run(executor, *prog, 12));
+}
+
+TEST(FhnFusionPass, RejectsVersionMismatch) {
+  FhnDefaultExecutor executor(&g_full_table);
+  ProgramBuilder b;
+  b.input(1).inst(FHN_ADD_CC, 2, 1, 1).output(2);
+  auto prog = b.build();
+  prog->version = FHN_ABI_VERSION + 1;
+  EXPECT_EQ(FhnFusionPass::run(executor, *prog), nullptr);
+}
@@ -4,6 +4,8 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <memory>
+#include <string>
 #include <vector>
 
 using namespace fhenomenon;
@@ -295,6 +297,36 @@ TEST(FhnMovementPlan, SlotModeHasZeroByteHighWater) {
   EXPECT_EQ(plan->stats().high_water_bytes, 0u);
 }
 
+// Pool reuse is replayed per byte class: freed fresh-level inputs (100B)
+// cannot serve level-1 allocs (60B), freed level-1 intermediates can.
+TEST(FhnMovementPlan, PoolHitsFollowByteClasses) {
+  auto prog = ProgramBuilder()
+                .input(1)
+                .input(2)
+                .inst(FHN_MULT_CC, 3, 1, 2) // 60B, miss; frees 1, 2 (100B)
+                .inst(FHN_ADD_CC, 4, 3, 3)  // 60B, miss; frees 3
+                .inst(FHN_NEGATE, 5, 4)     // 60B, reuses 3; frees 4
+                .inst(FHN_ADD_CC, 6, 5, 5)  // 60B, reuses 4; frees 5
+                .output(6)
+                .build();
+  const FhnLevelModel model = testModel();
+  auto plan = FhnMovementPlan::analyze(*prog, {6}, 0, FhnEvictionPolicy::Belady, &model);
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->byteClass(1), 100u);
+  EXPECT_EQ(plan->byteClass(3), 60u);
+  EXPECT_EQ(plan->stats().alloc_count, 4u);
+  EXPECT_EQ(plan->stats().pool_hits, 2u);
+  // The next run starts with one idle 60B buffer (5's): only 4 misses.
+  EXPECT_EQ(plan->stats().pool_warm_hits, 3u);
+
+  // Slot mode has a single class: the freed inputs serve too.
+  auto slots = FhnMovementPlan::analyze(*prog, {6});
+  ASSERT_TRUE(slots.has_value());
+  EXPECT_EQ(slots->byteClass(3), 0u);
+  EXPECT_EQ(slots->stats().pool_hits, 3u);
+  EXPECT_EQ(slots->stats().pool_warm_hits, 4u);
+}
+
 // A CONSUME chain deeper than the parameter chain underflows -> nullopt.
 TEST(FhnMovementPlan, LevelUnderflowIsRejected) {
   auto prog = ProgramBuilder()
@@ -404,3 +436,743 @@ TEST(FhnMovementPlan, OutOfRangeEffectIsRejected) {
   model.effects[FHN_ADD_CC] = static_cast<FhnLevelEffect>(42);
   EXPECT_FALSE(FhnMovementPlan::analyze(*prog, {3}, 0, FhnEvictionPolicy::Belady, &model).has_value());
 }
+
+namespace {
+
+FhnPlanOptions slotOptions(bool in_place = true) {
+  FhnPlanOptions options;
+  options.assign_slots = true;
+  options.in_place = in_place;
+  return options;
+}
+
+} // namespace
+
+// t3 = a1 + b2; t4 = t3 + t3; t5 = t4 + a1; r6 = t5 + t5 with the inputs
+// pinned: each result lands in the buffer of the temporary dying under it,
+// so one allocation serves the whole chain.
+TEST(FhnMovementPlan, SlotsTakeOverDyingOperandsInPlace) {
+  auto prog = ProgramBuilder()
+                .input(1)
+                .input(2)
+                .inst(FHN_ADD_CC, 3, 1, 2)
+                .inst(FHN_ADD_CC, 4, 3, 3)
+                .inst(FHN_ADD_CC, 5, 4, 1)
+                .inst(FHN_ADD_CC, 6, 5, 5)
+                .output(6)
+                .build();
+  auto plan = FhnMovementPlan::analyze(*prog, {1, 2, 6}, 0, FhnEvictionPolicy::Belady, nullptr, slotOptions());
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->tableSize(), 4u);
+  for (uint32_t id : {3u, 4u, 5u, 6u})
+    EXPECT_EQ(plan->slotOf(id), 3u) << id;
+  EXPECT_EQ(plan->at(0).alloc, (std::vector<uint32_t>{3}));
+  for (uint32_t i = 1; i < 4; ++i) {
+    EXPECT_TRUE(plan->at(i).alloc.empty()) << i;
+    EXPECT_TRUE(plan->at(i).free.empty()) << i;
+  }
+  EXPECT_EQ(plan->stats().alloc_count, 1u);
+  EXPECT_EQ(plan->stats().high_water, 3u);
+
+  // The rewritten program addresses slots.
+  const FhnProgram *slotted = plan->program();
+  ASSERT_NE(slotted, nullptr);
+  EXPECT_EQ(slotted->instructions[2].result_id, 3u);
+  EXPECT_EQ(slotted->instructions[2].operands[0], 3u);
+  EXPECT_EQ(slotted->instructions[2].operands[1], 1u);
+  EXPECT_EQ(slotted->output_ids[0], 3u);
+
+  // Without slots the plan is the identity over ids.
+  auto ids = FhnMovementPlan::analyze(*prog, {1, 2, 6});
+  ASSERT_TRUE(ids.has_value());
+  EXPECT_EQ(ids->program(), nullptr);
+  EXPECT_EQ(ids->slotOf(5), 5u);
+  EXPECT_EQ(ids->tableSize(), 7u);
+  EXPECT_EQ(ids->stats().alloc_count, 4u);
+}
+
+// Without in-place aliasing a released slot still serves a later def, and
+// unbudgeted its buffer is kept: the free and the alloc both disappear.
+TEST(FhnMovementPlan, ReleasedSlotsKeepTheirBuffersForLaterDefs) {
+  auto prog = ProgramBuilder()
+                .input(1)
+                .input(2)
+                .inst(FHN_ADD_CC, 3, 1, 2)
+                .inst(FHN_ADD_CC, 4, 3, 3)
+                .inst(FHN_ADD_CC, 5, 4, 1)
+                .inst(FHN_ADD_CC, 6, 5, 5)
+                .output(6)
+                .build();
+  auto plan =
+    FhnMovementPlan::analyze(*prog, {1, 2, 6}, 0, FhnEvictionPolicy::Belady, nullptr, slotOptions(/*in_place=*/false));
+  ASSERT_TRUE(plan.has_value());
+  // 3 -> s3, 4 -> s4, 5 reuses s3 (3 died at i1), 6 reuses s4.
+  EXPECT_EQ(plan->slotOf(5), plan->slotOf(3));
+  EXPECT_EQ(plan->slotOf(6), plan->slotOf(4));
+  EXPECT_EQ(plan->tableSize(), 5u);
+  EXPECT_EQ(plan->stats().alloc_count, 2u);
+  for (uint32_t i = 0; i < 3; ++i)
+    EXPECT_TRUE(plan->at(i).free.empty()) << i;
+  EXPECT_EQ(plan->at(3).free, (std::vector<uint32_t>{3})); // t5's slot has no later def
+  EXPECT_EQ(plan->stats().high_water, 4u);
+
+  // Under a budget the slot is still reused, but through a fresh
+  // free/alloc pair so residency matches the budgeted schedule.
+  auto budgeted =
+    FhnMovementPlan::analyze(*prog, {1, 2, 6}, 4, FhnEvictionPolicy::Belady, nullptr, slotOptions(/*in_place=*/false));
+  ASSERT_TRUE(budgeted.has_value());
+  EXPECT_EQ(budgeted->tableSize(), 5u);
+  EXPECT_EQ(budgeted->at(1).free, (std::vector<uint32_t>{3}));
+  EXPECT_EQ(budgeted->at(2).alloc, (std::vector<uint32_t>{3}));
+  EXPECT_EQ(budgeted->stats().alloc_count, 4u);
+}
+
+// MAD, HROT_ADD and HCONJ_ADD decompositions write the result before
+// reading the addend: a result may take operand 0's slot, never the
+// addend's — not even when operand 0 is the addend.
+TEST(FhnMovementPlan, AddendSlotIsNeverTakenInPlace) {
+  auto mad = ProgramBuilder().input(1).input(2).inst(FHN_MAD, 3, 1, 2).output(3).build();
+  auto plan = FhnMovementPlan::analyze(*mad, {3}, 0, FhnEvictionPolicy::Belady, nullptr, slotOptions());
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->slotOf(3), plan->slotOf(1));
+
+  auto hrot_add = ProgramBuilder().input(1).input(2).inst(FHN_HROT_ADD, 3, 1, 2).output(3).build();
+  plan = FhnMovementPlan::analyze(*hrot_add, {1, 3}, 0, FhnEvictionPolicy::Belady, nullptr, slotOptions());
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->slotOf(3), 3u); // 2 dies here but is the addend
+
+  auto squared = ProgramBuilder().input(1).inst(FHN_HCONJ_ADD, 3, 1, 1).output(3).build();
+  plan = FhnMovementPlan::analyze(*squared, {3}, 0, FhnEvictionPolicy::Belady, nullptr, slotOptions());
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->slotOf(3), 2u);
+
+  auto add = ProgramBuilder().input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).output(3).build();
+  plan = FhnMovementPlan::analyze(*add, {1, 3}, 0, FhnEvictionPolicy::Belady, nullptr, slotOptions());
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->slotOf(3), plan->slotOf(2)); // plain ops alias any operand
+}
+
+// Byte mode: a slot's capacity is its first occupant's bytes. Unbudgeted
+// a smaller result fits a larger dying buffer; under a byte budget only an
+// exact fit is taken, so residency stays what the budget admitted.
+TEST(FhnMovementPlan, SlotCapacityFollowsByteModel) {
+  // 3 = 1 * 1 (60B) with 1 (100B) dying; 4 = 3 + 3 (60B) with 3 dying.
+  auto prog = ProgramBuilder().input(1).inst(FHN_MULT_CC, 3, 1, 1).inst(FHN_ADD_CC, 4, 3, 3).output(4).build();
+  const FhnLevelModel model = testModel();
+
+  auto plan = FhnMovementPlan::analyze(*prog, {4}, 0, FhnEvictionPolicy::Belady, &model, slotOptions());
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->tableSize(), 2u);
+  EXPECT_EQ(plan->byteClass(1), 100u);
+  EXPECT_EQ(plan->stats().alloc_count, 0u);
+  EXPECT_EQ(plan->stats().high_water_bytes, 100u);
+
+  auto budgeted = FhnMovementPlan::analyze(*prog, {4}, 160, FhnEvictionPolicy::Belady, &model, slotOptions());
+  ASSERT_TRUE(budgeted.has_value());
+  EXPECT_EQ(budgeted->tableSize(), 3u);
+  EXPECT_EQ(budgeted->slotOf(4), budgeted->slotOf(3));
+  EXPECT_EQ(budgeted->byteClass(2), 60u);
+  EXPECT_EQ(budgeted->stats().alloc_count, 1u);
+  EXPECT_EQ(budgeted->stats().high_water_bytes, 160u);
+}
+
+namespace {
+
+// Budget 4, pinned {1, 2, 8}: at i2 the farthest-next-use victim is t3
+// (next read at i5), a NEGATE of the pinned input a1.
+std::unique_ptr<FhnProgram, decltype(&fhn_program_free)> rematProgram(FhnOpCode t3_op) {
+  return ProgramBuilder()
+    .input(1)
+    .input(2)
+    .inst(t3_op, 3, 1)         // i0
+    .inst(FHN_ADD_CC, 4, 2, 2) // i1
+    .inst(FHN_ADD_CC, 5, 4, 2) // i2: needs room for t5 -> t3 leaves
+    .inst(FHN_ADD_CC, 6, 5, 5) // i3
+    .inst(FHN_ADD_CC, 7, 6, 1) // i4
+    .inst(FHN_ADD_CC, 8, 7, 3) // i5: t3 is back
+    .output(8)
+    .build();
+}
+
+FhnPlanOptions rematOptions() {
+  FhnPlanOptions options;
+  options.rematerialize = true;
+  return options;
+}
+
+} // namespace
+
+// A cheap victim whose operand stays alive is discarded and recomputed at
+// its next use instead of taking a round trip through the host.
+TEST(FhnMovementPlan, RematerializationReplacesARoundTrip) {
+  auto prog = rematProgram(FHN_NEGATE);
+  auto belady = FhnMovementPlan::analyze(*prog, {1, 2, 8}, 4);
+  ASSERT_TRUE(belady.has_value());
+  EXPECT_EQ(belady->at(2).evict, (std::vector<uint32_t>{3}));
+  EXPECT_EQ(belady->at(5).prefetch, (std::vector<uint32_t>{3}));
+
+  auto remat = FhnMovementPlan::analyze(*prog, {1, 2, 8}, 4, FhnEvictionPolicy::Belady, nullptr, rematOptions());
+  ASSERT_TRUE(remat.has_value());
+  EXPECT_TRUE(remat->at(2).evict.empty());
+  EXPECT_EQ(remat->at(2).discard, (std::vector<uint32_t>{3}));
+  EXPECT_TRUE(remat->at(5).prefetch.empty());
+  EXPECT_EQ(remat->at(5).recompute, (std::vector<uint32_t>{0}));
+  // The recompute's operand a1 joins i5's working set, pushing out b2.
+  EXPECT_EQ(remat->at(5).evict, (std::vector<uint32_t>{2}));
+  EXPECT_EQ(remat->stats().recompute_count, 1u);
+  // Two transfers (t3 out and back) fewer.
+  EXPECT_EQ(remat->stats().evict_count + remat->stats().prefetch_count + 2,
+            belady->stats().evict_count + belady->stats().prefetch_count);
+  EXPECT_LE(remat->stats().high_water, 4u);
+}
+
+// Without a cost table only the cheap linear ops qualify; with one the
+// estimate is weighed against the round trip.
+TEST(FhnMovementPlan, RematerializationFollowsCosts) {
+  auto expensive = rematProgram(FHN_RELINEARIZE);
+  auto plan = FhnMovementPlan::analyze(*expensive, {1, 2, 8}, 4, FhnEvictionPolicy::Belady, nullptr, rematOptions());
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->at(2).evict, (std::vector<uint32_t>{3}));
+  EXPECT_EQ(plan->stats().recompute_count, 0u);
+
+  FhnKernelCost costs[] = {{FHN_NEGATE, 100.0, 0.0}};
+  FhnKernelCostTable table{1, costs};
+  FhnPlanOptions options = rematOptions();
+  options.remat_costs = &table;
+  auto prog = rematProgram(FHN_NEGATE);
+  options.transfer_ns_per_unit = 10.0; // round trip 20 ns < 100 ns
+  plan = FhnMovementPlan::analyze(*prog, {1, 2, 8}, 4, FhnEvictionPolicy::Belady, nullptr, options);
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->stats().recompute_count, 0u);
+  options.transfer_ns_per_unit = 100.0; // round trip 200 ns > 100 ns
+  plan = FhnMovementPlan::analyze(*prog, {1, 2, 8}, 4, FhnEvictionPolicy::Belady, nullptr, options);
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->stats().recompute_count, 1u);
+}
+
+// A value is only discarded while its operands live until the reuse: an
+// unpinned a1 dies at i4, before t3 would be recomputed at i5.
+TEST(FhnMovementPlan, RematerializationNeedsLiveOperands) {
+  auto prog = rematProgram(FHN_NEGATE);
+  auto plan = FhnMovementPlan::analyze(*prog, {2, 8}, 4, FhnEvictionPolicy::Belady, nullptr, rematOptions());
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->stats().recompute_count, 0u);
+  EXPECT_NE(plan->stats().evict_count, 0u);
+}
+
+namespace {
+
+// Inputs c3 and d4 are first read two instructions after the previous
+// input: a lookahead of 2 can start each copy at the preceding input use.
+std::unique_ptr<FhnProgram, decltype(&fhn_program_free)> staggeredInputsProgram() {
+  return ProgramBuilder()
+    .input(1)
+    .input(2)
+    .input(3)
+    .input(4)
+    .inst(FHN_ADD_CC, 5, 1, 2)  // i0
+    .inst(FHN_MULT_CC, 6, 5, 5) // i1
+    .inst(FHN_ADD_CC, 7, 6, 3)  // i2
+    .inst(FHN_MULT_CC, 8, 7, 7) // i3
+    .inst(FHN_ADD_CC, 9, 8, 4)  // i4
+    .output(9)
+    .build();
+}
+
+FhnPlanOptions lookaheadOptions(uint32_t k) {
+  FhnPlanOptions options;
+  options.prefetch_lookahead = k;
+  return options;
+}
+
+} // namespace
+
+TEST(FhnMovementPlan, LookaheadIssuesPrefetchesAsyncAheadOfUse) {
+  auto prog = staggeredInputsProgram();
+  auto plan = FhnMovementPlan::analyze(*prog, {9}, 0, FhnEvictionPolicy::Belady, nullptr, lookaheadOptions(2));
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->at(0).prefetch, (std::vector<uint32_t>{1, 2})); // nothing earlier to hide them behind
+  EXPECT_EQ(plan->at(0).prefetch_async, (std::vector<uint32_t>{3}));
+  EXPECT_TRUE(plan->at(2).prefetch.empty());
+  EXPECT_EQ(plan->at(2).fence, (std::vector<uint32_t>{3}));
+  EXPECT_EQ(plan->at(2).prefetch_async, (std::vector<uint32_t>{4}));
+  EXPECT_EQ(plan->at(4).fence, (std::vector<uint32_t>{4}));
+  EXPECT_EQ(plan->stats().prefetch_count, 4u);
+  EXPECT_EQ(plan->stats().hoisted_prefetch_count, 2u);
+  EXPECT_EQ(plan->stats().hoist_distance, 4u);
+  // An in-flight copy occupies its buffer: one more resident at i0 and i2.
+  auto eager = FhnMovementPlan::analyze(*prog, {9});
+  ASSERT_TRUE(eager.has_value());
+  EXPECT_EQ(eager->stats().high_water, 3u);
+  EXPECT_EQ(plan->stats().high_water, 4u);
+  EXPECT_EQ(eager->stats().hoisted_prefetch_count, 0u);
+}
+
+// Under a budget a prefetch only moves up across instructions that still
+// fit with it in flight.
+TEST(FhnMovementPlan, LookaheadStaysWithinBudget) {
+  auto prog = staggeredInputsProgram();
+  auto plan = FhnMovementPlan::analyze(*prog, {9}, 3, FhnEvictionPolicy::Belady, nullptr, lookaheadOptions(2));
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->stats().evict_count, 0u);
+  EXPECT_EQ(plan->at(1).prefetch_async, (std::vector<uint32_t>{3})); // i0 is full
+  EXPECT_EQ(plan->at(3).prefetch_async, (std::vector<uint32_t>{4})); // so is i2
+  EXPECT_EQ(plan->stats().hoist_distance, 2u);
+  EXPECT_EQ(plan->stats().high_water, 3u);
+
+  // b2 leaves at i1 and is read again at i5: its copy back starts once
+  // the residency drops, after the eviction.
+  auto evicting = ProgramBuilder()
+                    .input(1)
+                    .input(2)
+                    .inst(FHN_ADD_CC, 3, 1, 2) // i0
+                    .inst(FHN_NEGATE, 4, 3)    // i1: evicts b2
+                    .inst(FHN_ADD_CC, 5, 4, 1) // i2
+                    .inst(FHN_NEGATE, 6, 5)    // i3
+                    .inst(FHN_NEGATE, 7, 6)    // i4
+                    .inst(FHN_ADD_CC, 8, 7, 2) // i5
+                    .output(8)
+                    .build();
+  plan = FhnMovementPlan::analyze(*evicting, {2, 8}, 3, FhnEvictionPolicy::Belady, nullptr, lookaheadOptions(8));
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->at(1).evict, (std::vector<uint32_t>{2}));
+  EXPECT_EQ(plan->at(3).prefetch_async, (std::vector<uint32_t>{2}));
+  EXPECT_EQ(plan->at(5).fence, (std::vector<uint32_t>{2}));
+  EXPECT_LE(plan->stats().high_water, 3u);
+}
+
+// Slot assignment rewrites the async actions onto slots with the rest.
+TEST(FhnMovementPlan, LookaheadActionsFollowSlots) {
+  auto prog = staggeredInputsProgram();
+  FhnPlanOptions options = lookaheadOptions(2);
+  options.assign_slots = true;
+  auto plan = FhnMovementPlan::analyze(*prog, {9}, 0, FhnEvictionPolicy::Belady, nullptr, options);
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->at(0).prefetch_async, (std::vector<uint32_t>{plan->slotOf(3)}));
+  EXPECT_EQ(plan->at(2).fence, (std::vector<uint32_t>{plan->program()->instructions[2].operands[1]}));
+  EXPECT_EQ(plan->at(4).fence, (std::vector<uint32_t>{plan->slotOf(4)}));
+}
+
+// Peer copies: a send follows the def, a receive precedes the first action
+// touching the input — its use, since lookahead leaves a received input's
+// first prefetch in place.
+TEST(FhnMovementPlan, PeerCopiesBracketDefsAndFirstTouches) {
+  auto prog = staggeredInputsProgram();
+  FhnPlanOptions options;
+  options.peer_sends[7] = {1, 2};
+  options.peer_receives[3] = 1;
+  auto plan = FhnMovementPlan::analyze(*prog, {9}, 0, FhnEvictionPolicy::Belady, nullptr, options);
+  ASSERT_TRUE(plan.has_value());
+  ASSERT_EQ(plan->at(2).send.size(), 2u);
+  EXPECT_EQ(plan->at(2).send[0].id, 7u);
+  EXPECT_EQ(plan->at(2).send[1].device, 2u);
+  ASSERT_EQ(plan->at(2).receive.size(), 1u);
+  EXPECT_EQ(plan->at(2).receive[0].value, 3u);
+  EXPECT_EQ(plan->at(2).receive[0].device, 1u);
+  EXPECT_EQ(plan->stats().send_count, 2u);
+  EXPECT_EQ(plan->stats().receive_count, 1u);
+
+  options.prefetch_lookahead = 2;
+  plan = FhnMovementPlan::analyze(*prog, {9}, 0, FhnEvictionPolicy::Belady, nullptr, options);
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_TRUE(plan->at(0).prefetch_async.empty());
+  EXPECT_TRUE(plan->at(0).receive.empty());
+  ASSERT_EQ(plan->at(2).receive.size(), 1u);
+  EXPECT_EQ(plan->at(2).prefetch, (std::vector<uint32_t>{3}));
+  EXPECT_EQ(plan->at(2).prefetch_async, (std::vector<uint32_t>{4})); // inputs not received still hoist
+  EXPECT_EQ(plan->at(4).fence, (std::vector<uint32_t>{4}));
+
+  options.assign_slots = true;
+  plan = FhnMovementPlan::analyze(*prog, {9}, 0, FhnEvictionPolicy::Belady, nullptr, options);
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->at(2).receive[0].id, plan->slotOf(3));
+  EXPECT_EQ(plan->at(2).receive[0].value, 3u);
+  EXPECT_EQ(plan->at(2).send[0].id, plan->program()->instructions[2].result_id);
+}
+
+// A hoisted receive would wait on the peer before this device sends what
+// the peer needs to answer: a = x + x goes out at i0, v comes back for
+// c = a + v at i1, so the receive must stay at i1 under any lookahead.
+TEST(FhnMovementPlan, LookaheadKeepsReceivesAfterEarlierSends) {
+  auto prog = ProgramBuilder().input(1).input(2).inst(FHN_ADD_CC, 3, 1, 1).inst(FHN_ADD_CC, 4, 3, 2).output(4).build();
+  for (uint32_t lookahead : {0u, 1u, 4u}) {
+    FhnPlanOptions options = lookaheadOptions(lookahead);
+    options.peer_sends[3] = {1};
+    options.peer_receives[2] = 1;
+    auto plan = FhnMovementPlan::analyze(*prog, {1, 2, 4}, 0, FhnEvictionPolicy::Belady, nullptr, options);
+    ASSERT_TRUE(plan.has_value()) << lookahead;
+    EXPECT_EQ(plan->at(0).send.size(), 1u) << lookahead;
+    EXPECT_TRUE(plan->at(0).receive.empty()) << lookahead;
+    ASSERT_EQ(plan->at(1).receive.size(), 1u) << lookahead;
+    EXPECT_EQ(plan->at(1).receive[0].value, 2u) << lookahead;
+    EXPECT_EQ(plan->at(1).prefetch, (std::vector<uint32_t>{2})) << lookahead;
+  }
+}
+
+TEST(FhnMovementPlan, RejectsPeerCopiesOfTheWrongIds) {
+  auto prog = staggeredInputsProgram();
+  FhnPlanOptions sends_input;
+  sends_input.peer_sends[1] = {1};
+  EXPECT_FALSE(FhnMovementPlan::analyze(*prog, {9}, 0, FhnEvictionPolicy::Belady, nullptr, sends_input));
+  FhnPlanOptions receives_result;
+  receives_result.peer_receives[5] = 1;
+  EXPECT_FALSE(FhnMovementPlan::analyze(*prog, {9}, 0, FhnEvictionPolicy::Belady, nullptr, receives_result));
+}
+
+// Ids index flat arrays sized by the largest def: an operand beyond it is
+// undefined, and pinning an id the program never defines is harmless.
+TEST(FhnMovementPlan, IdsBeyondTheLargestDefAreHandled) {
+  auto bad = ProgramBuilder().input(1).inst(FHN_ADD_CC, 2, 1, 1000).output(2).build();
+  EXPECT_FALSE(FhnMovementPlan::analyze(*bad, {2}).has_value());
+
+  auto prog = ProgramBuilder().input(1).inst(FHN_NEGATE, 2, 1).output(2).build();
+  auto plan = FhnMovementPlan::analyze(*prog, {2, 1000}, 2);
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->tableSize(), 3u);
+  EXPECT_EQ(plan->at(0).free, (std::vector<uint32_t>{1}));
+  EXPECT_EQ(plan->byteClass(1000), 0u);
+}
+
+// A long sliding-window program under a tight budget: every instruction
+// reads the previous result and the one eight back, so Belady evicts and
+// prefetches throughout. Replaying the plan keeps residency within budget
+// and every operand resident at its use.
+TEST(FhnMovementPlan, LongProgramsStayWithinBudget) {
+  constexpr uint32_t kInstructions = 100000;
+  constexpr uint32_t kWindow = 8;
+  ProgramBuilder builder;
+  for (uint32_t k = 1; k <= kWindow; ++k)
+    builder.input(k);
+  for (uint32_t i = 0; i < kInstructions; ++i) {
+    const uint32_t r = kWindow + 1 + i;
+    builder.inst(FHN_ADD_CC, r, r - 1, r - kWindow);
+  }
+  const uint32_t last = kWindow + kInstructions;
+  auto prog = builder.output(last).build();
+
+  constexpr uint64_t kBudget = 4;
+  auto plan = FhnMovementPlan::analyze(*prog, {last}, kBudget);
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_GT(plan->stats().evict_count, kInstructions / 2);
+  EXPECT_LE(plan->stats().high_water, kBudget);
+
+  std::vector<char> resident(last + 1, 0);
+  uint64_t count = 0;
+  for (uint32_t i = 0; i < kInstructions; ++i) {
+    const FhnMovementActions &act = plan->at(i);
+    for (uint32_t id : act.evict) {
+      ASSERT_TRUE(resident[id]);
+      resident[id] = 0;
+      --count;
+    }
+    for (const FhnActionSpan<uint32_t> *ids : {&act.alloc, &act.prefetch}) {
+      for (uint32_t id : *ids) {
+        ASSERT_FALSE(resident[id]);
+        resident[id] = 1;
+        ++count;
+      }
+    }
+    ASSERT_LE(count, kBudget);
+    const FhnInstruction &inst = prog->instructions[i];
+    ASSERT_TRUE(resident[inst.operands[0]] && resident[inst.operands[1]]) << i;
+    for (uint32_t id : act.free) {
+      ASSERT_TRUE(resident[id]);
+      resident[id] = 0;
+      --count;
+    }
+  }
+}
+
+namespace {
+
+// a1 (fresh, 100 bytes) is read at i0 and again at i3 against a level-0
+// value; at i2 the 160-byte budget pushes it out.
+std::unique_ptr<FhnProgram, decltype(&fhn_program_free)> levelDownProgram() {
+  return ProgramBuilder()
+    .input(1)
+    .inst_p0(FHN_LEVEL_DOWN, 2, 1, 0) // i0: 30 bytes
+    .inst(FHN_ADD_CC, 3, 2, 2)        // i1
+    .inst(FHN_ADD_CC, 4, 3, 2)        // i2: evicts a1
+    .inst(FHN_ADD_CC, 5, 4, 1)        // i3: reads a1 at level 0
+    .output(5)
+    .build();
+}
+
+FhnPlanOptions levelDownOptions() {
+  FhnPlanOptions options;
+  options.level_down_before_evict = true;
+  return options;
+}
+
+} // namespace
+
+// An evicted value no remaining use needs at its level is lowered first:
+// it leaves and returns at the level-0 size.
+TEST(FhnMovementPlan, LevelDownShrinksEvictedValues) {
+  auto prog = levelDownProgram();
+  const FhnLevelModel model = testModel();
+  auto plain = FhnMovementPlan::analyze(*prog, {5}, 160, FhnEvictionPolicy::Belady, &model);
+  ASSERT_TRUE(plain.has_value());
+  EXPECT_EQ(plain->at(2).evict, (std::vector<uint32_t>{1}));
+  EXPECT_TRUE(plain->at(2).level_down.empty());
+  EXPECT_EQ(plain->stats().transfer_bytes, 300u); // a1 in, out and back
+  EXPECT_EQ(plain->stats().level_down_saved_bytes, 0u);
+
+  auto lowered = FhnMovementPlan::analyze(*prog, {5}, 160, FhnEvictionPolicy::Belady, &model, levelDownOptions());
+  ASSERT_TRUE(lowered.has_value());
+  ASSERT_EQ(lowered->at(2).level_down.size(), 1u);
+  EXPECT_EQ(lowered->at(2).level_down[0].id, 1u);
+  EXPECT_EQ(lowered->at(2).level_down[0].level, 0);
+  // Residency is still budgeted at the def level: same evictions.
+  EXPECT_EQ(lowered->at(2).evict, (std::vector<uint32_t>{1}));
+  EXPECT_EQ(lowered->at(3).prefetch, (std::vector<uint32_t>{1}));
+  EXPECT_EQ(lowered->stats().level_down_count, 1u);
+  EXPECT_EQ(lowered->stats().transfer_bytes, 160u);
+  EXPECT_EQ(lowered->stats().level_down_saved_bytes, 140u);
+  EXPECT_EQ(lowered->stats().high_water_bytes, plain->stats().high_water_bytes);
+}
+
+// Pinned values keep their level, as do values a later use reads fresh.
+TEST(FhnMovementPlan, LevelDownKeepsLevelsStillNeeded) {
+  auto prog = levelDownProgram();
+  const FhnLevelModel model = testModel();
+  auto pinned = FhnMovementPlan::analyze(*prog, {1, 5}, 160, FhnEvictionPolicy::Belady, &model, levelDownOptions());
+  ASSERT_TRUE(pinned.has_value());
+  EXPECT_EQ(pinned->at(2).evict, (std::vector<uint32_t>{1}));
+  EXPECT_EQ(pinned->stats().level_down_count, 0u);
+
+  auto fresh_reuse = ProgramBuilder()
+                       .input(1)
+                       .inst_p0(FHN_LEVEL_DOWN, 2, 1, 0)
+                       .inst(FHN_ADD_CC, 3, 2, 2)
+                       .inst(FHN_ADD_CC, 4, 3, 2)  // i2: evicts a1
+                       .inst(FHN_ADD_CC, 5, 4, 1)  // i3: level 0 would do
+                       .inst(FHN_MULT_CC, 6, 1, 1) // i4: but this reads level 2
+                       .output(6)
+                       .build();
+  auto plan = FhnMovementPlan::analyze(*fresh_reuse, {6}, 160, FhnEvictionPolicy::Belady, &model, levelDownOptions());
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->at(2).evict, (std::vector<uint32_t>{1}));
+  EXPECT_EQ(plan->stats().level_down_count, 0u);
+}
+
+TEST(FhnMovementPlan, LevelDownActionsFollowSlots) {
+  auto prog = levelDownProgram();
+  const FhnLevelModel model = testModel();
+  FhnPlanOptions options = levelDownOptions();
+  options.assign_slots = true;
+  auto plan = FhnMovementPlan::analyze(*prog, {5}, 160, FhnEvictionPolicy::Belady, &model, options);
+  ASSERT_TRUE(plan.has_value());
+  ASSERT_EQ(plan->at(2).level_down.size(), 1u);
+  EXPECT_EQ(plan->at(2).level_down[0].id, plan->slotOf(1));
+  EXPECT_EQ(plan->at(2).evict, (std::vector<uint32_t>{plan->slotOf(1)}));
+}
+
+namespace {
+
+// a1 and b2 are evicted together at i1 and read again at i6 and i5: with
+// room for one value on the host, a1 (back last) goes to disk.
+std::unique_ptr<FhnProgram, decltype(&fhn_program_free)> hostTierProgram() {
+  return ProgramBuilder()
+    .input(1)
+    .input(2)
+    .input(3)
+    .inst(FHN_ADD_CC, 4, 1, 2)  // i0
+    .inst(FHN_ADD_CC, 5, 4, 3)  // i1: evicts a1 and b2
+    .inst(FHN_NEGATE, 6, 5)     // i2
+    .inst(FHN_NEGATE, 7, 6)     // i3
+    .inst(FHN_ADD_CC, 8, 7, 3)  // i4
+    .inst(FHN_ADD_CC, 9, 8, 2)  // i5: b2 is back
+    .inst(FHN_ADD_CC, 10, 9, 1) // i6: a1 is back
+    .output(10)
+    .build();
+}
+
+FhnPlanOptions hostTierOptions(uint64_t host_budget) {
+  FhnPlanOptions options;
+  options.host_budget = host_budget;
+  return options;
+}
+
+} // namespace
+
+TEST(FhnMovementPlan, HostBudgetSpillsTheFarthestReturn) {
+  auto prog = hostTierProgram();
+  auto two_tier = FhnMovementPlan::analyze(*prog, {10}, 3);
+  ASSERT_TRUE(two_tier.has_value());
+  EXPECT_EQ(two_tier->at(1).evict, (std::vector<uint32_t>{1, 2}));
+  EXPECT_EQ(two_tier->stats().spill_count, 0u);
+
+  FhnPlanOptions options = hostTierOptions(1);
+  options.transfer_ns_per_unit = 10.0;
+  options.spill_ns_per_unit = 100.0;
+  auto plan = FhnMovementPlan::analyze(*prog, {10}, 3, FhnEvictionPolicy::Belady, nullptr, options);
+  ASSERT_TRUE(plan.has_value());
+  // The device schedule is the two-tier one.
+  EXPECT_EQ(plan->at(1).evict, (std::vector<uint32_t>{1, 2}));
+  EXPECT_EQ(plan->at(5).prefetch, (std::vector<uint32_t>{2}));
+  EXPECT_EQ(plan->at(6).prefetch, (std::vector<uint32_t>{1}));
+  EXPECT_EQ(plan->at(1).spill, (std::vector<uint32_t>{1}));
+  EXPECT_TRUE(plan->at(5).unspill.empty());
+  EXPECT_EQ(plan->at(6).unspill, (std::vector<uint32_t>{1}));
+  EXPECT_EQ(plan->stats().spill_count, 1u);
+  EXPECT_EQ(plan->stats().host_high_water, 1u);
+  // Seven link transfers (five prefetches, two evictions), two disk ones.
+  EXPECT_DOUBLE_EQ(plan->stats().movement_ns, 7 * 10.0 + 2 * 100.0);
+
+  auto roomy = FhnMovementPlan::analyze(*prog, {10}, 3, FhnEvictionPolicy::Belady, nullptr, hostTierOptions(2));
+  ASSERT_TRUE(roomy.has_value());
+  EXPECT_EQ(roomy->stats().spill_count, 0u);
+  EXPECT_EQ(roomy->stats().host_high_water, 2u);
+}
+
+// Pinned values stay on the host: they alone must fit its budget.
+TEST(FhnMovementPlan, HostBudgetNeverSpillsPinnedIds) {
+  auto prog = hostTierProgram();
+  EXPECT_FALSE(FhnMovementPlan::analyze(*prog, {1, 2, 10}, 3, FhnEvictionPolicy::Belady, nullptr,
+                                        hostTierOptions(1)));
+  auto plan = FhnMovementPlan::analyze(*prog, {1, 10}, 3, FhnEvictionPolicy::Belady, nullptr, hostTierOptions(1));
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->at(1).spill, (std::vector<uint32_t>{2}));
+  EXPECT_EQ(plan->at(5).unspill, (std::vector<uint32_t>{2}));
+}
+
+// A restore precedes the prefetch that brings the value back, hoisted or
+// not, and follows slot assignment.
+TEST(FhnMovementPlan, UnspillsPrecedeHoistedPrefetchesAndFollowSlots) {
+  auto prog = ProgramBuilder()
+                .input(1)
+                .input(2)
+                .input(3)
+                .inst(FHN_ADD_CC, 4, 1, 2)  // i0
+                .inst(FHN_ADD_CC, 5, 4, 3)  // i1: evicts a1 and b2
+                .inst(FHN_NEGATE, 6, 5)     // i2
+                .inst(FHN_NEGATE, 7, 6)     // i3
+                .inst(FHN_ADD_CC, 8, 7, 2)  // i4: b2 is back
+                .inst(FHN_NEGATE, 9, 8)     // i5
+                .inst(FHN_ADD_CC, 10, 9, 1) // i6: a1 is back
+                .output(10)
+                .build();
+  FhnPlanOptions options = hostTierOptions(1);
+  options.prefetch_lookahead = 8;
+  auto plan = FhnMovementPlan::analyze(*prog, {10}, 3, FhnEvictionPolicy::Belady, nullptr, options);
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->at(2).prefetch_async, (std::vector<uint32_t>{2}));
+  EXPECT_EQ(plan->at(5).prefetch_async, (std::vector<uint32_t>{1}));
+  EXPECT_EQ(plan->at(1).spill, (std::vector<uint32_t>{1}));
+  EXPECT_EQ(plan->at(5).unspill, (std::vector<uint32_t>{1}));
+  EXPECT_TRUE(plan->at(6).unspill.empty());
+
+  options.prefetch_lookahead = 0;
+  options.assign_slots = true;
+  plan = FhnMovementPlan::analyze(*prog, {10}, 3, FhnEvictionPolicy::Belady, nullptr, options);
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->at(1).spill, (std::vector<uint32_t>{plan->slotOf(1)}));
+  EXPECT_EQ(plan->at(6).unspill, (std::vector<uint32_t>{plan->slotOf(1)}));
+}
+
+namespace {
+
+FhnPlanOptions timelineOptions() {
+  FhnPlanOptions options;
+  options.record_timeline = true;
+  return options;
+}
+
+// The timeline agrees with the plan's stats: its peak is the high water,
+// and its transfers sum to the evictions and prefetches.
+void expectTimelineMatchesStats(const FhnMovementPlan &plan) {
+  ASSERT_EQ(plan.timeline().size(), plan.instructionCount());
+  std::size_t peak = 0;
+  uint64_t peak_bytes = 0;
+  uint32_t transfers = 0;
+  uint64_t transfer_bytes = 0;
+  for (const FhnTimelinePoint &point : plan.timeline()) {
+    peak = std::max(peak, point.resident.size());
+    peak_bytes = std::max(peak_bytes, point.resident_bytes);
+    transfers += point.transfers;
+    transfer_bytes += point.transfer_bytes;
+  }
+  EXPECT_EQ(peak, plan.stats().high_water);
+  EXPECT_EQ(peak_bytes, plan.stats().high_water_bytes);
+  EXPECT_EQ(transfers, plan.stats().evict_count + plan.stats().prefetch_count);
+  EXPECT_EQ(transfer_bytes, plan.stats().transfer_bytes);
+}
+
+} // namespace
+
+// The Belady example above at budget 4: residency per instruction, with
+// i1 and i2 at the high water.
+TEST(FhnMovementPlan, TimelineRecordsResidencyAndFlagsThePeak) {
+  auto prog = ProgramBuilder()
+                .input(1)
+                .input(2)
+                .input(8)
+                .inst(FHN_ADD_CC, 3, 2, 2) // i0
+                .inst(FHN_ADD_CC, 4, 3, 1) // i1
+                .inst(FHN_ADD_CC, 5, 4, 8) // i2: evicts a1
+                .inst(FHN_ADD_CC, 6, 5, 2) // i3
+                .inst(FHN_ADD_CC, 7, 6, 1) // i4: a1 is back
+                .output(7)
+                .build();
+  auto plain = FhnMovementPlan::analyze(*prog, {7}, 4);
+  ASSERT_TRUE(plain.has_value());
+  EXPECT_TRUE(plain->timeline().empty());
+
+  auto plan = FhnMovementPlan::analyze(*prog, {7}, 4, FhnEvictionPolicy::Belady, nullptr, timelineOptions());
+  ASSERT_TRUE(plan.has_value());
+  const std::vector<FhnTimelinePoint> &timeline = plan->timeline();
+  ASSERT_EQ(timeline.size(), 5u);
+  EXPECT_EQ(timeline[0].resident, (std::vector<uint32_t>{2, 3}));
+  EXPECT_EQ(timeline[1].resident, (std::vector<uint32_t>{1, 2, 3, 4}));
+  EXPECT_EQ(timeline[2].resident, (std::vector<uint32_t>{2, 4, 5, 8}));
+  EXPECT_EQ(timeline[3].resident, (std::vector<uint32_t>{2, 5, 6}));
+  EXPECT_EQ(timeline[4].resident, (std::vector<uint32_t>{1, 6, 7}));
+  const uint32_t transfers[] = {1, 1, 2, 0, 1};
+  const bool bottleneck[] = {false, true, true, false, false};
+  for (std::size_t i = 0; i < timeline.size(); ++i) {
+    EXPECT_EQ(timeline[i].transfers, transfers[i]) << "i" << i;
+    EXPECT_EQ(timeline[i].bottleneck, bottleneck[i]) << "i" << i;
+    EXPECT_EQ(timeline[i].resident_bytes, 0u);
+  }
+  expectTimelineMatchesStats(*plan);
+
+  const std::string csv = plan->timelineCsv();
+  EXPECT_EQ(csv.substr(0, csv.find('\n', csv.find('\n') + 1) + 1),
+            "index,resident_count,resident_bytes,transfers,transfer_bytes,bottleneck,resident\n"
+            "0,2,0,1,0,0,2 3\n");
+  EXPECT_EQ(std::count(csv.begin(), csv.end(), '\n'), 6);
+  const std::string json = plan->timelineJson();
+  EXPECT_NE(json.find("{\"index\":1,\"resident_count\":4,\"resident_bytes\":0,\"transfers\":1,\"transfer_bytes\":0,"
+                      "\"bottleneck\":true,\"resident\":[1,2,3,4]}"),
+            std::string::npos);
+}
+
+// Byte mode with level reductions, lookahead and slot assignment: the
+// timeline follows each plan's own accounting.
+TEST(FhnMovementPlan, TimelineMatchesStatsAcrossOptions) {
+  const FhnLevelModel model = testModel();
+  FhnPlanOptions options = levelDownOptions();
+  options.record_timeline = true;
+  auto lowered = FhnMovementPlan::analyze(*levelDownProgram(), {5}, 160, FhnEvictionPolicy::Belady, &model, options);
+  ASSERT_TRUE(lowered.has_value());
+  expectTimelineMatchesStats(*lowered);
+  EXPECT_EQ(lowered->timeline()[2].transfer_bytes, 30u); // a1 leaves at level 0
+  EXPECT_EQ(lowered->timeline()[0].resident_bytes, 130u);
+
+  auto prog = staggeredInputsProgram();
+  options = lookaheadOptions(2);
+  options.record_timeline = true;
+  auto ahead = FhnMovementPlan::analyze(*prog, {9}, 0, FhnEvictionPolicy::Belady, nullptr, options);
+  ASSERT_TRUE(ahead.has_value());
+  expectTimelineMatchesStats(*ahead);
+  EXPECT_EQ(ahead->timeline()[0].resident, (std::vector<uint32_t>{1, 2, 3, 5})); // c3 in flight
+
+  options.assign_slots = true;
+  auto slotted = FhnMovementPlan::analyze(*prog, {9}, 0, FhnEvictionPolicy::Belady, &model, options);
+  ASSERT_TRUE(slotted.has_value());
+  expectTimelineMatchesStats(*slotted);
+  for (const FhnTimelinePoint &point : slotted->timeline())
+    for (uint32_t slot : point.resident)
+      EXPECT_LT(slot, slotted->tableSize());
+}
@@ -0,0 +1,207 @@
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnThreadPool.h"
+#include "FhnTestProgramBuilder.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using fhenomenon::FhnDefaultExecutor;
+using fhenomenon::FhnThreadPool;
+using fhenomenon::testutil::ProgramBuilder;
+
+namespace {
+
+struct TestBuffer {
+  int64_t value;
+};
+
+// Concurrency observers shared by every kernel below.
+std::atomic<int> g_in_flight{0};
+std::atomic<int> g_max_in_flight{0};
+std::atomic<bool> g_serial_overlap{false};
+
+void reset_observers() {
+  g_in_flight = 0;
+  g_max_in_flight = 0;
+  g_serial_overlap = false;
+}
+
+struct InFlight {
+  InFlight() {
+    const int now = ++g_in_flight;
+    int prev = g_max_in_flight.load();
+    while (now > prev && !g_max_in_flight.compare_exchange_weak(prev, now)) {
+    }
+    // Long enough that independent kernels overlap even on one core.
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  ~InFlight() { --g_in_flight; }
+};
+
+int test_add_cc(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *, const double *) {
+  InFlight guard;
+  auto *r = reinterpret_cast<TestBuffer *>(result);
+  r->value = reinterpret_cast<const TestBuffer *>(operands[0])->value +
+             reinterpret_cast<const TestBuffer *>(operands[1])->value;
+  return 0;
+}
+
+// Registered without FHN_KERNEL_THREAD_SAFE: must run alone.
+int test_mult_cc(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+                 const double *) {
+  InFlight guard;
+  if (g_in_flight.load() != 1)
+    g_serial_overlap = true;
+  auto *r = reinterpret_cast<TestBuffer *>(result);
+  r->value = reinterpret_cast<const TestBuffer *>(operands[0])->value *
+             reinterpret_cast<const TestBuffer *>(operands[1])->value;
+  return 0;
+}
+
+int test_fail(FhnBackendCtx *, FhnBuffer *, const FhnBuffer *const *, const int64_t *, const double *) { return -7; }
+
+uint32_t test_flags(FhnBackendCtx *, FhnOpCode opcode) {
+  return opcode == FHN_MULT_CC ? 0u : static_cast<uint32_t>(FHN_KERNEL_THREAD_SAFE);
+}
+
+struct Buffers {
+  explicit Buffers(std::size_t n) : values(n, TestBuffer{0}), ptrs(n, nullptr) {
+    for (std::size_t i = 0; i < n; ++i)
+      ptrs[i] = reinterpret_cast<FhnBuffer *>(&values[i]);
+  }
+  std::vector<TestBuffer> values;
+  std::vector<FhnBuffer *> ptrs;
+};
+
+// `chains` independent chains over inputs 1 and 2:
+//   x = in1 + in2; y = x * in1; z = y + x
+ProgramBuilder wide_program(uint32_t chains) {
+  ProgramBuilder b;
+  b.input(1).input(2);
+  uint32_t next = 3;
+  for (uint32_t c = 0; c < chains; ++c) {
+    const uint32_t x = next++, y = next++, z = next++;
+    b.inst(FHN_ADD_CC, x, 1, 2).inst(FHN_MULT_CC, y, x, 1).inst(FHN_ADD_CC, z, y, x).output(z);
+  }
+  return b;
+}
+
+} // namespace
+
+TEST(FhnThreadPool, RunsEveryIndexOnceAcrossBatches) {
+  FhnThreadPool pool(4);
+  EXPECT_EQ(pool.threadCount(), 4u);
+  std::vector<std::atomic<int>> hits(257);
+  for (int batch = 0; batch < 50; ++batch) {
+    pool.parallelFor(static_cast<uint32_t>(hits.size()), [&](uint32_t i) { ++hits[i]; });
+  }
+  for (const auto &h : hits)
+    EXPECT_EQ(h.load(), 50);
+}
+
+TEST(FhnThreadPool, SingleThreadRunsInline) {
+  FhnThreadPool pool(1);
+  const std::thread::id caller = std::this_thread::get_id();
+  bool all_inline = true;
+  pool.parallelFor(16, [&](uint32_t) { all_inline = all_inline && std::this_thread::get_id() == caller; });
+  EXPECT_TRUE(all_inline);
+}
+
+TEST(FhnExecutorParallel, WavefrontsLevelIndependentChains) {
+  auto prog = wide_program(3).build();
+  const auto waves = FhnDefaultExecutor::wavefronts(*prog);
+  ASSERT_EQ(waves.size(), 3u);
+  EXPECT_EQ(waves[0], (std::vector<uint32_t>{0, 3, 6}));
+  EXPECT_EQ(waves[1], (std::vector<uint32_t>{1, 4, 7}));
+  EXPECT_EQ(waves[2], (std::vector<uint32_t>{2, 5, 8}));
+}
+
+TEST(FhnExecutorParallel, WavefrontsRespectOverwrites) {
+  // r3 = r1 + r2; r4 = r3 + r1; r3 = r1 + r1 (overwrite after a read);
+  // r5 = r1 + r2 (independent).
+  ProgramBuilder b;
+  b.input(1).input(2);
+  b.inst(FHN_ADD_CC, 3, 1, 2).inst(FHN_ADD_CC, 4, 3, 1).inst(FHN_ADD_CC, 3, 1, 1).inst(FHN_ADD_CC, 5, 1, 2);
+  const auto waves = FhnDefaultExecutor::wavefronts(*b.build());
+  ASSERT_EQ(waves.size(), 3u);
+  EXPECT_EQ(waves[0], (std::vector<uint32_t>{0, 3}));
+  EXPECT_EQ(waves[1], (std::vector<uint32_t>{1}));
+  EXPECT_EQ(waves[2], (std::vector<uint32_t>{2}));
+}
+
+TEST(FhnExecutorParallel, MatchesSerialAndOverlapsOnlySafeKernels) {
+  FhnKernelEntry entries[] = {
+    {FHN_ADD_CC, test_add_cc, "add_cc"},
+    {FHN_MULT_CC, test_mult_cc, "mult_cc"},
+  };
+  FhnKernelTable table = {2, entries};
+  FhnDefaultExecutor executor(&table, test_flags, nullptr);
+  EXPECT_EQ(executor.kernelFlags(FHN_ADD_CC), static_cast<uint32_t>(FHN_KERNEL_THREAD_SAFE));
+  EXPECT_EQ(executor.kernelFlags(FHN_MULT_CC), 0u);
+  EXPECT_EQ(executor.kernelFlags(FHN_ROTATE), 0u); // unregistered: never queried
+
+  const uint32_t chains = 8;
+  auto prog = wide_program(chains).build();
+  Buffers serial(3 + 3 * chains), parallel(3 + 3 * chains);
+  serial.values[1].value = parallel.values[1].value = 3;
+  serial.values[2].value = parallel.values[2].value = 4;
+
+  ASSERT_EQ(executor.execute(nullptr, prog.get(), serial.ptrs.data()), 0);
+
+  reset_observers();
+  FhnThreadPool pool(4);
+  ASSERT_EQ(executor.executeParallel(nullptr, prog.get(), parallel.ptrs.data(), pool), 0);
+  for (std::size_t i = 0; i < serial.values.size(); ++i)
+    EXPECT_EQ(parallel.values[i].value, serial.values[i].value) << "id " << i;
+  EXPECT_EQ(parallel.values[5].value, 7 * 3 + 7);
+  EXPECT_GT(g_max_in_flight.load(), 1);
+  EXPECT_FALSE(g_serial_overlap.load());
+}
+
+TEST(FhnExecutorParallel, WithoutFlagsEverythingIsSerial) {
+  FhnKernelEntry entries[] = {
+    {FHN_ADD_CC, test_add_cc, "add_cc"},
+    {FHN_MULT_CC, test_mult_cc, "mult_cc"},
+  };
+  FhnKernelTable table = {2, entries};
+  FhnDefaultExecutor executor(&table);
+
+  auto prog = wide_program(4).build();
+  Buffers bufs(3 + 3 * 4);
+  bufs.values[1].value = 2;
+  bufs.values[2].value = 5;
+
+  reset_observers();
+  FhnThreadPool pool(4);
+  ASSERT_EQ(executor.executeParallel(nullptr, prog.get(), bufs.ptrs.data(), pool), 0);
+  EXPECT_EQ(bufs.values[5].value, 7 * 2 + 7);
+  EXPECT_EQ(g_max_in_flight.load(), 1);
+}
+
+TEST(FhnExecutorParallel, FailuresPropagate) {
+  FhnKernelEntry entries[] = {
+    {FHN_ADD_CC, test_add_cc, "add_cc"},
+    {FHN_NEGATE, test_fail, "negate"},
+  };
+  FhnKernelTable table = {2, entries};
+  FhnDefaultExecutor executor(&table, test_flags, nullptr);
+  FhnThreadPool pool(2);
+
+  ProgramBuilder failing;
+  failing.input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).inst(FHN_NEGATE, 4, 1).inst(FHN_ADD_CC, 5, 4, 3);
+  Buffers bufs(6);
+  EXPECT_EQ(executor.executeParallel(nullptr, failing.build().get(), bufs.ptrs.data(), pool), -7);
+
+  // Unresolvable opcodes are rejected before any kernel runs.
+  ProgramBuilder unsupported;
+  unsupported.input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).inst(FHN_CONJUGATE, 4, 3);
+  Buffers untouched(5);
+  untouched.values[1].value = 1;
+  untouched.values[2].value = 1;
+  EXPECT_EQ(executor.executeParallel(nullptr, unsupported.build().get(), untouched.ptrs.data(), pool), -1);
+  EXPECT_EQ(untouched.values[3].value, 0);
+}
@@ -0,0 +1,302 @@
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnMovementPlan.h"
+#include "FHN/FhnPartitioner.h"
+#include "FHN/ToyFheKernels.h"
+#include "FhnTestProgramBuilder.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+using fhenomenon::FhnDefaultExecutor;
+using fhenomenon::FhnMovementPlan;
+using fhenomenon::FhnPartitionOptions;
+using fhenomenon::FhnPartitioner;
+using fhenomenon::FhnPlanOptions;
+using fhenomenon::testutil::ProgramBuilder;
+
+namespace {
+
+using ProgramPtr = std::unique_ptr<FhnProgram, decltype(&fhn_program_free)>;
+
+// Four products a*c + d over inputs 1..12, then a pairwise reduction.
+ProgramPtr wideFront() {
+  ProgramBuilder b;
+  for (uint32_t id = 1; id <= 12; ++id)
+    b.input(id);
+  for (uint32_t k = 0; k < 4; ++k)
+    b.inst(FHN_MULT_CC, 13 + k, 1 + 3 * k, 2 + 3 * k);
+  for (uint32_t k = 0; k < 4; ++k)
+    b.inst(FHN_ADD_CC, 17 + k, 13 + k, 3 + 3 * k);
+  b.inst(FHN_ADD_CC, 21, 17, 18).inst(FHN_ADD_CC, 22, 19, 20).inst(FHN_ADD_CC, 23, 21, 22);
+  return b.output(23).build();
+}
+
+// Σ (3k+1)(3k+2) + (3k+3) for k = 0..3, the inputs holding their ids.
+constexpr int64_t kWideFrontValue = 2 + 3 + 20 + 6 + 56 + 9 + 110 + 12;
+
+std::vector<uint32_t> inputsAndOutputs(const FhnProgram &program) {
+  std::vector<uint32_t> ids(program.input_ids, program.input_ids + program.num_inputs);
+  ids.insert(ids.end(), program.output_ids, program.output_ids + program.num_outputs);
+  return ids;
+}
+
+// N ToyFHE contexts standing in for devices; the same key_seed lets them
+// exchange ciphertexts.
+struct ToyDevices {
+  explicit ToyDevices(uint32_t n, const std::vector<const char *> &configs = {}) {
+    for (uint32_t d = 0; d < n; ++d) {
+      ctxs.push_back(toyfhe_fhn_create(configs.empty() ? R"({"key_seed": 7})" : configs[d]));
+      executors.push_back(std::make_unique<FhnDefaultExecutor>(toyfhe_fhn_get_kernels(ctxs.back())));
+      FhnPartitioner::Device device;
+      device.executor = executors.back().get();
+      device.hooks.ctx = ctxs.back();
+      device.hooks.buffer_alloc = toyfhe_fhn_buffer_alloc;
+      device.hooks.buffer_free = toyfhe_fhn_buffer_free;
+      device.copy_peer = toyfhe_fhn_buffer_copy_peer;
+      devices.push_back(device);
+    }
+  }
+  ~ToyDevices() {
+    for (FhnBackendCtx *ctx : ctxs)
+      toyfhe_fhn_destroy(ctx);
+  }
+
+  // Partition, plan and run program with every input id holding its id;
+  // returns the first output's value (or -1 on failure, *rc the status).
+  int64_t run(const FhnProgram &program, const FhnPlanOptions &base = FhnPlanOptions(), int *rc = nullptr) {
+    const uint32_t n = static_cast<uint32_t>(ctxs.size());
+    const std::vector<uint32_t> pinned = inputsAndOutputs(program);
+    const auto partition = FhnPartitioner::partition(program, pinned, n);
+    EXPECT_TRUE(partition.has_value());
+    if (!partition)
+      return -1;
+    std::vector<FhnMovementPlan> plans;
+    for (const FhnPartitioner::Part &part : partition->parts) {
+      FhnPlanOptions options = base;
+      options.peer_sends = part.options.peer_sends;
+      options.peer_receives = part.options.peer_receives;
+      auto plan = FhnMovementPlan::analyze(*part.program, part.pinned, 0, fhenomenon::FhnEvictionPolicy::Belady,
+                                           nullptr, options);
+      EXPECT_TRUE(plan.has_value());
+      if (!plan)
+        return -1;
+      plans.push_back(*plan);
+    }
+    std::vector<std::vector<FhnBuffer *>> storage;
+    std::vector<FhnBuffer **> tables;
+    for (uint32_t d = 0; d < n; ++d)
+      storage.emplace_back(plans[d].tableSize(), nullptr);
+    for (auto &table : storage)
+      tables.push_back(table.data());
+    for (uint32_t k = 0; k < program.num_inputs; ++k) {
+      const uint32_t id = program.input_ids[k];
+      const uint32_t home = partition->home.at(id);
+      FhnBuffer *buffer = toyfhe_fhn_buffer_alloc(ctxs[home]);
+      toyfhe_fhn_encrypt_i64(ctxs[home], buffer, id);
+      storage[home][plans[home].slotOf(id)] = buffer;
+    }
+
+    const int status = FhnPartitioner::execute(*partition, devices, plans, tables);
+    if (rc)
+      *rc = status;
+    int64_t value = -1;
+    for (uint32_t id : pinned) {
+      const uint32_t home = partition->home.at(id);
+      FhnBuffer *&buffer = storage[home][plans[home].slotOf(id)];
+      if (status == 0 && id == program.output_ids[0])
+        toyfhe_fhn_decrypt_i64(ctxs[home], buffer, &value);
+      if (buffer)
+        toyfhe_fhn_buffer_free(ctxs[home], buffer);
+      buffer = nullptr;
+    }
+    return value;
+  }
+
+  std::vector<FhnBackendCtx *> ctxs;
+  std::vector<std::unique_ptr<FhnDefaultExecutor>> executors;
+  std::vector<FhnPartitioner::Device> devices;
+};
+
+} // namespace
+
+// A chain has nothing to overlap: moving it would only add copies.
+TEST(FhnPartitioner, KeepsAChainOnOneDevice) {
+  auto chain = ProgramBuilder()
+                 .input(1)
+                 .input(2)
+                 .inst(FHN_ADD_CC, 3, 1, 2)
+                 .inst(FHN_MULT_CC, 4, 3, 3)
+                 .inst(FHN_ADD_CC, 5, 4, 1)
+                 .output(5)
+                 .build();
+  const auto partition = FhnPartitioner::partition(*chain, {5}, 3);
+  ASSERT_TRUE(partition.has_value());
+  EXPECT_EQ(partition->device_of, (std::vector<uint32_t>{0, 0, 0}));
+  EXPECT_EQ(partition->stats.transfers, 0u);
+  EXPECT_EQ(partition->stats.makespan, partition->stats.serial);
+  EXPECT_EQ(partition->parts[1].program->num_instructions, 0u);
+  EXPECT_EQ(partition->parts[0].pinned, (std::vector<uint32_t>{5}));
+}
+
+// Independent products spread out; the reduction pays a few copies.
+TEST(FhnPartitioner, SpreadsIndependentSubtrees) {
+  auto prog = wideFront();
+  const auto partition = FhnPartitioner::partition(*prog, {23}, 2);
+  ASSERT_TRUE(partition.has_value());
+  EXPECT_EQ(partition->stats.serial, 11.0);
+  EXPECT_LT(partition->stats.makespan, partition->stats.serial);
+  EXPECT_GT(partition->stats.load[0], 0.0);
+  EXPECT_GT(partition->stats.load[1], 0.0);
+  EXPECT_LE(std::max(partition->stats.load[0], partition->stats.load[1]), 7.0);
+  EXPECT_GT(partition->stats.transfers, 0u);
+  EXPECT_TRUE(partition->input_copies.empty()); // every input has one reader
+
+  // Each part holds its own instructions, in source order.
+  uint32_t total = 0;
+  for (const FhnPartitioner::Part &part : partition->parts) {
+    for (uint32_t k = 0; k + 1 < part.program->num_instructions; ++k)
+      EXPECT_LT(part.program->instructions[k].result_id, part.program->instructions[k + 1].result_id);
+    total += part.program->num_instructions;
+  }
+  EXPECT_EQ(total, prog->num_instructions);
+  EXPECT_EQ(partition->parts[partition->home.at(23)].program->num_outputs, 1u);
+}
+
+// An expensive transfer keeps everything together; the cost table weighs
+// instructions.
+TEST(FhnPartitioner, WeighsTransfersAgainstCompute) {
+  auto prog = wideFront();
+  FhnPartitionOptions options;
+  options.transfer_cost = 100.0;
+  const auto together = FhnPartitioner::partition(*prog, {23}, 2, options);
+  ASSERT_TRUE(together.has_value());
+  EXPECT_EQ(together->stats.transfers, 0u);
+  EXPECT_EQ(together->stats.makespan, together->stats.serial);
+  EXPECT_EQ(together->stats.load[1], 0.0);
+
+  FhnKernelCost costs[] = {{FHN_MULT_CC, 10.0, 0.0}, {FHN_ADD_CC, 1.0, 0.0}};
+  FhnKernelCostTable table{2, costs};
+  options.costs = &table;
+  options.transfer_cost = 2.0;
+  const auto weighted = FhnPartitioner::partition(*prog, {23}, 4, options);
+  ASSERT_TRUE(weighted.has_value());
+  EXPECT_EQ(weighted->stats.serial, 47.0);
+  for (uint32_t d = 0; d < 4; ++d)
+    EXPECT_GE(weighted->stats.load[d], 10.0) << d; // one product each
+}
+
+// Each cut edge is one send on the defining device and one receive on the
+// reading device, placed at the def and before the first touch.
+TEST(FhnPartitioner, PlansPairSendsWithReceives) {
+  auto prog = wideFront();
+  const auto partition = FhnPartitioner::partition(*prog, {23}, 2);
+  ASSERT_TRUE(partition.has_value());
+  uint32_t sends = 0;
+  uint32_t receives = 0;
+  for (uint32_t d = 0; d < 2; ++d) {
+    const FhnPartitioner::Part &part = partition->parts[d];
+    auto plan = FhnMovementPlan::analyze(*part.program, part.pinned, 0, fhenomenon::FhnEvictionPolicy::Belady,
+                                         nullptr, part.options);
+    ASSERT_TRUE(plan.has_value());
+    sends += plan->stats().send_count;
+    receives += plan->stats().receive_count;
+    for (uint32_t i = 0; i < part.program->num_instructions; ++i) {
+      for (const fhenomenon::FhnPeerCopy &copy : plan->at(i).send) {
+        EXPECT_EQ(copy.id, part.program->instructions[i].result_id);
+        EXPECT_NE(copy.device, d);
+      }
+      for (const fhenomenon::FhnPeerCopy &copy : plan->at(i).receive)
+        EXPECT_EQ(copy.device, partition->home.at(copy.value));
+    }
+  }
+  EXPECT_EQ(sends, partition->stats.transfers);
+  EXPECT_EQ(receives, partition->stats.transfers);
+}
+
+// N ToyFHE contexts as stand-in devices compute what one context does.
+TEST(FhnPartitioner, ToyFheContextsComputeTheSameResult) {
+  auto prog = wideFront();
+  for (uint32_t n = 1; n <= 4; ++n) {
+    ToyDevices devices(n);
+    EXPECT_EQ(devices.run(*prog), kWideFrontValue) << n;
+  }
+}
+
+// With two devices wideFront's parts trade values both ways: each sends a
+// result the other reads before it receives one back. Lookahead must not
+// pull a receive ahead of those sends, or each device waits on the other.
+TEST(FhnPartitioner, LookaheadKeepsCrossDeviceRoundTripsLive) {
+  auto prog = wideFront();
+  FhnPlanOptions lookahead;
+  lookahead.prefetch_lookahead = 4;
+  for (uint32_t n = 2; n <= 4; ++n) {
+    // Checked on the plans first, so a regression fails instead of hanging
+    // in execute(): every receive sits at an instruction reading the value.
+    const auto partition = FhnPartitioner::partition(*prog, inputsAndOutputs(*prog), n);
+    ASSERT_TRUE(partition.has_value());
+    for (const FhnPartitioner::Part &part : partition->parts) {
+      FhnPlanOptions options = lookahead;
+      options.peer_sends = part.options.peer_sends;
+      options.peer_receives = part.options.peer_receives;
+      auto plan = FhnMovementPlan::analyze(*part.program, part.pinned, 0, fhenomenon::FhnEvictionPolicy::Belady,
+                                           nullptr, options);
+      ASSERT_TRUE(plan.has_value());
+      for (uint32_t i = 0; i < part.program->num_instructions; ++i) {
+        const FhnInstruction &inst = part.program->instructions[i];
+        for (const fhenomenon::FhnPeerCopy &copy : plan->at(i).receive)
+          ASSERT_NE(std::find(std::begin(inst.operands), std::end(inst.operands), copy.value),
+                    std::end(inst.operands))
+            << "device part receives " << copy.value << " ahead of its use at " << i;
+      }
+    }
+    ToyDevices devices(n);
+    EXPECT_EQ(devices.run(*prog, lookahead), kWideFrontValue) << n;
+  }
+}
+
+// Slots index each device's table; inputs read on two devices are copied
+// before the run.
+TEST(FhnPartitioner, CopiesSharedInputsAndFollowsSlots) {
+  auto prog = ProgramBuilder()
+                .input(1)
+                .input(2)
+                .input(3)
+                .inst(FHN_MULT_CC, 4, 1, 2)
+                .inst(FHN_MULT_CC, 5, 1, 3)
+                .inst(FHN_MULT_CC, 6, 2, 3)
+                .inst(FHN_ADD_CC, 7, 4, 5)
+                .inst(FHN_ADD_CC, 8, 7, 6)
+                .output(8)
+                .build();
+  const auto partition = FhnPartitioner::partition(*prog, {8}, 2);
+  ASSERT_TRUE(partition.has_value());
+  EXPECT_FALSE(partition->input_copies.empty());
+
+  FhnPlanOptions slots;
+  slots.assign_slots = true;
+  ToyDevices devices(2);
+  EXPECT_EQ(devices.run(*prog), 2 + 3 + 6);
+  EXPECT_EQ(devices.run(*prog, slots), 2 + 3 + 6);
+}
+
+// Contexts with different keys cannot exchange ciphertexts: the copy
+// fails, the waiting peer gives up instead of hanging.
+TEST(FhnPartitioner, FailsCleanlyWhenContextsCannotCopy) {
+  auto prog = wideFront();
+  ToyDevices devices(2, {R"({"key_seed": 1})", R"({"key_seed": 2})"});
+  int rc = 0;
+  EXPECT_EQ(devices.run(*prog, FhnPlanOptions(), &rc), -1);
+  EXPECT_NE(rc, 0);
+}
+
+TEST(FhnPartitioner, RejectsInvalidPrograms) {
+  auto undefined = ProgramBuilder().input(1).inst(FHN_ADD_CC, 3, 1, 2).output(3).build();
+  EXPECT_FALSE(FhnPartitioner::partition(*undefined, {3}, 2).has_value());
+  auto prog = wideFront();
+  EXPECT_FALSE(FhnPartitioner::partition(*prog, {23}, 0).has_value());
+}
+
@@ -0,0 +1,105 @@
+#include "FHN/FhnPlanCache.h"
+#include "FhnTestProgramBuilder.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using fhenomenon::FhnMovementPlan;
+using fhenomenon::FhnPlanCache;
+using fhenomenon::testutil::ProgramBuilder;
+
+namespace {
+
+std::shared_ptr<const FhnPlanCache::Entry> planFor(const FhnProgram &program, const std::vector<uint32_t> &pinned) {
+  auto plan = FhnMovementPlan::analyze(program, pinned);
+  if (!plan)
+    return nullptr;
+  // The entry must own its program; a shape rebuilt by ProgramBuilder is
+  // freed with it.
+  auto *copy = fhn_program_alloc(program.num_instructions, program.num_inputs, program.num_outputs);
+  std::copy(program.instructions, program.instructions + program.num_instructions, copy->instructions);
+  std::copy(program.input_ids, program.input_ids + program.num_inputs, copy->input_ids);
+  std::copy(program.output_ids, program.output_ids + program.num_outputs, copy->output_ids);
+  return std::make_shared<const FhnPlanCache::Entry>(
+    FhnPlanCache::Entry{std::shared_ptr<const FhnProgram>(copy, &fhn_program_free), *plan});
+}
+
+} // namespace
+
+TEST(FhnPlanCache, SameStructureHits) {
+  FhnPlanCache cache;
+  auto first = ProgramBuilder().input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).output(3).build();
+  EXPECT_EQ(cache.find(*first, {1, 2, 3}, 0), nullptr);
+  auto entry = planFor(*first, {1, 2, 3});
+  ASSERT_NE(entry, nullptr);
+  cache.insert(*first, {1, 2, 3}, 0, entry);
+
+  // A separately built program of the same structure; pinned order and
+  // duplicates do not matter.
+  auto again = ProgramBuilder().input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).output(3).build();
+  EXPECT_EQ(FhnPlanCache::fingerprint(*first, {1, 2, 3}, 0), FhnPlanCache::fingerprint(*again, {3, 2, 1, 3}, 0));
+  EXPECT_EQ(cache.find(*again, {3, 2, 1, 3}, 0), entry);
+
+  const auto stats = cache.stats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.entries, 1u);
+  EXPECT_DOUBLE_EQ(stats.hitRate(), 0.5);
+}
+
+TEST(FhnPlanCache, KeyCoversStructurePinnedSetAndBudget) {
+  FhnPlanCache cache;
+  auto prog = ProgramBuilder().input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).output(3).build();
+  cache.insert(*prog, {1, 2, 3}, 0, planFor(*prog, {1, 2, 3}));
+
+  auto other_op = ProgramBuilder().input(1).input(2).inst(FHN_MULT_CC, 3, 1, 2).output(3).build();
+  auto other_param = ProgramBuilder().input(1).input(2).inst_p0(FHN_ROTATE, 3, 1, 5).output(3).build();
+  auto other_param2 = ProgramBuilder().input(1).input(2).inst_p0(FHN_ROTATE, 3, 1, 6).output(3).build();
+  EXPECT_EQ(cache.find(*other_op, {1, 2, 3}, 0), nullptr);
+  EXPECT_EQ(cache.find(*prog, {3}, 0), nullptr);
+  EXPECT_EQ(cache.find(*prog, {1, 2, 3}, 4), nullptr);
+  EXPECT_NE(FhnPlanCache::fingerprint(*other_param, {3}, 0), FhnPlanCache::fingerprint(*other_param2, {3}, 0));
+
+  auto scaled = ProgramBuilder().input(1).input(2).inst(FHN_MULT_CS, 3, 1).output(3).build();
+  auto rescaled = ProgramBuilder().input(1).input(2).inst(FHN_MULT_CS, 3, 1).output(3).build();
+  scaled->instructions[0].fparams[0] = 0.5;
+  rescaled->instructions[0].fparams[0] = 0.25;
+  cache.insert(*scaled, {3}, 0, planFor(*scaled, {3}));
+  EXPECT_EQ(cache.find(*rescaled, {3}, 0), nullptr);
+  EXPECT_NE(cache.find(*scaled, {3}, 0), nullptr);
+
+  EXPECT_EQ(cache.stats().misses, 4u);
+  EXPECT_EQ(cache.stats().hits, 1u);
+}
+
+TEST(FhnPlanCache, EvictsLeastRecentlyUsed) {
+  FhnPlanCache cache(2);
+  auto a = ProgramBuilder().input(1).inst(FHN_NEGATE, 2, 1).output(2).build();
+  auto b = ProgramBuilder().input(1).inst(FHN_CONJUGATE, 2, 1).output(2).build();
+  auto c = ProgramBuilder().input(1).inst(FHN_RESCALE, 2, 1).output(2).build();
+  cache.insert(*a, {2}, 0, planFor(*a, {2}));
+  cache.insert(*b, {2}, 0, planFor(*b, {2}));
+  ASSERT_NE(cache.find(*a, {2}, 0), nullptr); // a is now the most recent
+  cache.insert(*c, {2}, 0, planFor(*c, {2}));
+
+  EXPECT_EQ(cache.find(*b, {2}, 0), nullptr);
+  EXPECT_NE(cache.find(*a, {2}, 0), nullptr);
+  EXPECT_NE(cache.find(*c, {2}, 0), nullptr);
+  EXPECT_EQ(cache.stats().evictions, 1u);
+  EXPECT_EQ(cache.stats().entries, 2u);
+
+  // An entry handed out stays valid after it leaves the cache.
+  auto held = cache.find(*a, {2}, 0);
+  cache.clear();
+  EXPECT_EQ(cache.stats().entries, 0u);
+  ASSERT_NE(held, nullptr);
+  EXPECT_EQ(held->program->instructions[0].opcode, FHN_NEGATE);
+  EXPECT_EQ(held->plan.instructionCount(), 1u);
+
+  FhnPlanCache disabled(0);
+  disabled.insert(*a, {2}, 0, planFor(*a, {2}));
+  EXPECT_EQ(disabled.find(*a, {2}, 0), nullptr);
+}
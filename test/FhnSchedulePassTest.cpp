@@ -0,0 +1,142 @@
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnMovementPlan.h"
+#include "FHN/FhnSchedulePass.h"
+#include "FhnTestProgramBuilder.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+using fhenomenon::FhnDefaultExecutor;
+using fhenomenon::FhnEvictionPolicy;
+using fhenomenon::FhnLevelModel;
+using fhenomenon::FhnMovementPlan;
+using fhenomenon::FhnSchedulePass;
+using fhenomenon::testutil::ProgramBuilder;
+
+namespace {
+
+using ProgramPtr = std::unique_ptr<FhnProgram, decltype(&fhn_program_free)>;
+
+struct TestBuffer {
+  int64_t value;
+};
+
+int test_add_cc(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *, const double *) {
+  reinterpret_cast<TestBuffer *>(result)->value = reinterpret_cast<const TestBuffer *>(operands[0])->value +
+                                                  reinterpret_cast<const TestBuffer *>(operands[1])->value;
+  return 0;
+}
+
+int test_mult_cc(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+                 const double *) {
+  reinterpret_cast<TestBuffer *>(result)->value = reinterpret_cast<const TestBuffer *>(operands[0])->value *
+                                                  reinterpret_cast<const TestBuffer *>(operands[1])->value;
+  return 0;
+}
+
+FhnKernelEntry g_entries[] = {
+  {FHN_ADD_CC, test_add_cc, "add_cc"},
+  {FHN_MULT_CC, test_mult_cc, "mult_cc"},
+};
+FhnKernelTable g_table = {2, g_entries};
+
+// A miniature wide-front: four products a*c + d, all opened before the
+// pairwise reduction closes any of them (the lowering's order).
+ProgramPtr wideFront() {
+  ProgramBuilder b;
+  for (uint32_t id = 1; id <= 12; ++id)
+    b.input(id);
+  for (uint32_t k = 0; k < 4; ++k)
+    b.inst(FHN_MULT_CC, 13 + k, 1 + 3 * k, 2 + 3 * k); // p = a * c
+  for (uint32_t k = 0; k < 4; ++k)
+    b.inst(FHN_ADD_CC, 17 + k, 13 + k, 3 + 3 * k); // q = p + d
+  b.inst(FHN_ADD_CC, 21, 17, 18).inst(FHN_ADD_CC, 22, 19, 20).inst(FHN_ADD_CC, 23, 21, 22);
+  return b.output(23).build();
+}
+
+int64_t execute(const FhnProgram &program) {
+  FhnDefaultExecutor executor(&g_table);
+  std::vector<TestBuffer> values(24, TestBuffer{0});
+  std::vector<FhnBuffer *> buffers(24, nullptr);
+  for (uint32_t id = 1; id < 24; ++id) {
+    values[id].value = id <= 12 ? static_cast<int64_t>(id) : 0;
+    buffers[id] = reinterpret_cast<FhnBuffer *>(&values[id]);
+  }
+  EXPECT_EQ(executor.execute(nullptr, &program, buffers.data()), 0);
+  return values[23].value;
+}
+
+} // namespace
+
+TEST(FhnSchedulePass, ClosesSubtreesBeforeOpeningNewOnes) {
+  auto prog = wideFront();
+  FhnSchedulePass::Stats stats;
+  ProgramPtr scheduled(FhnSchedulePass::run(*prog, {23}, 0, nullptr, &stats), &fhn_program_free);
+  ASSERT_NE(scheduled, nullptr);
+  EXPECT_TRUE(stats.reordered);
+  EXPECT_GT(stats.moved, 0u);
+  EXPECT_LT(stats.after.high_water, stats.before.high_water);
+
+  // The reported stats are the plan of the returned program, which
+  // computes the same value.
+  auto plan = FhnMovementPlan::analyze(*scheduled, {23});
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->stats().high_water, stats.after.high_water);
+  EXPECT_EQ(execute(*scheduled), execute(*prog));
+  EXPECT_EQ(scheduled->num_instructions, prog->num_instructions);
+  EXPECT_EQ(scheduled->output_ids[0], 23u);
+}
+
+// Under a budget the score is transfers: fewer open subtrees means fewer
+// evictions of partial results.
+TEST(FhnSchedulePass, ReducesTransfersUnderABudget) {
+  auto prog = wideFront();
+  FhnSchedulePass::Stats stats;
+  ProgramPtr scheduled(FhnSchedulePass::run(*prog, {23}, 4, nullptr, &stats), &fhn_program_free);
+  ASSERT_NE(scheduled, nullptr);
+  ASSERT_TRUE(stats.reordered);
+  EXPECT_LT(stats.after.prefetch_count + stats.after.evict_count,
+            stats.before.prefetch_count + stats.before.evict_count);
+  EXPECT_EQ(execute(*scheduled), execute(*prog));
+}
+
+// A program the greedy order cannot improve comes back in its own order.
+TEST(FhnSchedulePass, KeepsAnOrderItCannotImprove) {
+  auto chain = ProgramBuilder()
+                 .input(1)
+                 .input(2)
+                 .inst(FHN_ADD_CC, 3, 1, 2)
+                 .inst(FHN_MULT_CC, 4, 3, 3)
+                 .inst(FHN_ADD_CC, 5, 4, 1)
+                 .output(5)
+                 .build();
+  FhnSchedulePass::Stats stats;
+  ProgramPtr scheduled(FhnSchedulePass::run(*chain, {5}, 0, nullptr, &stats), &fhn_program_free);
+  ASSERT_NE(scheduled, nullptr);
+  EXPECT_FALSE(stats.reordered);
+  EXPECT_EQ(stats.moved, 0u);
+  for (uint32_t i = 0; i < chain->num_instructions; ++i)
+    EXPECT_EQ(scheduled->instructions[i].result_id, chain->instructions[i].result_id) << i;
+}
+
+// Byte weights: with a model the live set is scored in bytes.
+TEST(FhnSchedulePass, ScoresBytesUnderALevelModel) {
+  FhnLevelModel model;
+  model.fresh_level = 0;
+  model.bytes_by_level = {64};
+  model.effects[FHN_ADD_CC] = FHN_LEVEL_PRESERVE;
+  model.effects[FHN_MULT_CC] = FHN_LEVEL_PRESERVE;
+  auto prog = wideFront();
+  FhnSchedulePass::Stats stats;
+  ProgramPtr scheduled(FhnSchedulePass::run(*prog, {23}, 0, &model, &stats), &fhn_program_free);
+  ASSERT_NE(scheduled, nullptr);
+  EXPECT_TRUE(stats.reordered);
+  EXPECT_LT(stats.after.high_water_bytes, stats.before.high_water_bytes);
+}
+
+TEST(FhnSchedulePass, RejectsInvalidPrograms) {
+  auto undefined = ProgramBuilder().input(1).inst(FHN_ADD_CC, 3, 1, 2).output(3).build();
+  EXPECT_EQ(FhnSchedulePass::run(*undefined, {3}), nullptr);
+}
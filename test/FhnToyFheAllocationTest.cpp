@@ -0,0 +1,206 @@
+#include "FHN/FhnCompiledProgram.h"
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/ToyFheKernels.h"
+#include "FhnTestProgramBuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <new>
+#include <vector>
+
+// Counting global allocator: every form of operator new in this binary —
+// scalar and array, aligned, nothrow — bumps g_allocations, so a test can
+// assert that a stretch of code allocated nothing. Each replaced new has
+// its matching deletes replaced alongside it.
+static std::atomic<std::size_t> g_allocations{0};
+
+static void *countedAlloc(std::size_t size) noexcept {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+static void *countedAlloc(std::size_t size, std::align_val_t align) noexcept {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  const std::size_t alignment = static_cast<std::size_t>(align);
+  // aligned_alloc wants a size that is a multiple of the alignment.
+  return std::aligned_alloc(alignment, (std::max<std::size_t>(size, 1) + alignment - 1) / alignment * alignment);
+}
+
+static void *countedOrThrow(void *p) {
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void *operator new(std::size_t size) { return countedOrThrow(countedAlloc(size)); }
+void *operator new[](std::size_t size) { return countedOrThrow(countedAlloc(size)); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size); }
+void *operator new(std::size_t size, std::align_val_t align) { return countedOrThrow(countedAlloc(size, align)); }
+void *operator new[](std::size_t size, std::align_val_t align) { return countedOrThrow(countedAlloc(size, align)); }
+void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+  return countedAlloc(size, align);
+}
+void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+  return countedAlloc(size, align);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept { std::free(p); }
+
+using fhenomenon::FhnCompiledProgram;
+using fhenomenon::FhnDefaultExecutor;
+using fhenomenon::testutil::ProgramBuilder;
+
+namespace {
+
+constexpr uint32_t kSlots = 1024; // several SIMD stack blocks per run
+
+int64_t at(const std::vector<int64_t> &v, uint32_t i) { return v[i % v.size()]; }
+
+// A program touching every vector kernel path that could allocate: lazy
+// rotations whose source is rewritten on the next run (storage recycled
+// through the ctx's pool), an add that lifts an operand to a higher scale,
+// in-place HROT_ADD, and an add writing over its own rotated view.
+//   3 = ROTATE(x, 3)        4 = ADD(3, y)          5 = HROT_ADD(4, 4) d=5
+//   6 = MULT_CS(x, 0.5)     7 = ADD(6, y)          8 = ROTATE(7, 1)
+//   9 = SUB(8, 7)          10 = NEGATE(9)         11 = MULT_CC(x, y)
+//  12 = MULT_CS(11, 3)     13 = HROT_ADD(12, 11) d=2
+//  14 = ADD(y, x)          14 = ROTATE(14, 2)     14 = ADD(14, x)
+std::unique_ptr<FhnProgram, decltype(&fhn_program_free)> kernel_mix_program() {
+  ProgramBuilder b;
+  b.input(1).input(2);
+  b.inst_p0(FHN_ROTATE, 3, 1, 3).inst(FHN_ADD_CC, 4, 3, 2).inst(FHN_HROT_ADD, 5, 4, 4);
+  b.insts.back().params[0] = 5;
+  b.inst(FHN_MULT_CS, 6, 1);
+  b.insts.back().fparams[0] = 0.5;
+  b.inst(FHN_ADD_CC, 7, 6, 2).inst_p0(FHN_ROTATE, 8, 7, 1).inst(FHN_SUB_CC, 9, 8, 7).inst(FHN_NEGATE, 10, 9);
+  b.inst(FHN_MULT_CC, 11, 1, 2).inst(FHN_MULT_CS, 12, 11);
+  b.insts.back().fparams[0] = 3.0;
+  b.inst(FHN_HROT_ADD, 13, 12, 11);
+  b.insts.back().params[0] = 2;
+  b.inst(FHN_ADD_CC, 14, 2, 1).inst_p0(FHN_ROTATE, 14, 14, 2).inst(FHN_ADD_CC, 14, 14, 1);
+  b.output(5).output(10).output(13).output(14);
+  return b.build();
+}
+
+// Runs the kernel-mix program compiled against `table` on a context made
+// from `config`: after two warm-up runs (the first sizes every buffer, the
+// second fills the ctx's storage pool) further runs must not allocate, and
+// the integer outputs must still decrypt to the plaintext results.
+void expect_steady_state_allocation_free(const char *config, FhnKernelTable *table) {
+  FhnBackendCtx *ctx = toyfhe_fhn_create(config);
+  ASSERT_NE(ctx, nullptr);
+  FhnDefaultExecutor executor(table);
+  auto prog = kernel_mix_program();
+  auto compiled = FhnCompiledProgram::compile(executor, *prog);
+  ASSERT_TRUE(compiled.has_value());
+
+  std::vector<FhnBuffer *> bufs(15, nullptr);
+  for (FhnBuffer *&buf : bufs)
+    buf = toyfhe_fhn_buffer_alloc(ctx);
+  std::vector<int64_t> x(kSlots), y(kSlots);
+  for (uint32_t i = 0; i < kSlots; ++i) {
+    x[i] = static_cast<int64_t>(i % 7) + 1;
+    y[i] = 3 * static_cast<int64_t>(i % 5) - 4;
+  }
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx, bufs[1], x.data(), kSlots), 0);
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx, bufs[2], y.data(), kSlots), 0);
+  compiled->bind(bufs.data());
+  ASSERT_EQ(compiled->run(ctx), 0);
+  ASSERT_EQ(compiled->run(ctx), 0);
+
+  const std::size_t before = g_allocations.load();
+  int rc = 0;
+  for (int run = 0; run < 5; ++run)
+    rc |= compiled->run(ctx);
+  // Re-encrypting an input overwrites its slots in place as well.
+  rc |= toyfhe_fhn_encrypt_vec_i64(ctx, bufs[1], x.data(), kSlots);
+  rc |= compiled->run(ctx);
+  const std::size_t allocations = g_allocations.load() - before;
+  ASSERT_EQ(rc, 0);
+  EXPECT_EQ(allocations, 0u);
+
+  std::vector<int64_t> out5(kSlots), out13(kSlots), out14(kSlots);
+  ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx, bufs[5], out5.data(), kSlots), 0);
+  ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx, bufs[13], out13.data(), kSlots), 0);
+  ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx, bufs[14], out14.data(), kSlots), 0);
+  for (uint32_t i = 0; i < kSlots; ++i) {
+    const int64_t o4_shifted = at(x, i + 5 + 3) + at(y, i + 5);
+    const int64_t o4 = at(x, i + 3) + y[i];
+    ASSERT_EQ(out5[i], o4_shifted + o4) << "slot " << i;
+    ASSERT_EQ(out13[i], 3 * at(x, i + 2) * at(y, i + 2) + x[i] * y[i]) << "slot " << i;
+    ASSERT_EQ(out14[i], at(x, i + 2) + at(y, i + 2) + x[i]) << "slot " << i;
+  }
+
+  for (FhnBuffer *buf : bufs)
+    toyfhe_fhn_buffer_free(ctx, buf);
+  toyfhe_fhn_destroy(ctx);
+}
+
+// The ToyFHE table without the fused opcodes, so HROT_ADD runs as the
+// executor's in-place ROTATE + ADD_CC decomposition.
+std::vector<FhnKernelEntry> primitive_entries(const FhnKernelTable *table) {
+  std::vector<FhnKernelEntry> primitives;
+  for (uint32_t i = 0; i < table->num_kernels; ++i) {
+    if (table->kernels[i].opcode != FHN_HMULT && table->kernels[i].opcode != FHN_HROT_ADD)
+      primitives.push_back(table->kernels[i]);
+  }
+  return primitives;
+}
+
+} // namespace
+
+// The counter itself: every form of operator new counts once, and the
+// aligned forms honour their alignment.
+TEST(FhnToyFheAllocation, CounterSeesEveryFormOfOperatorNew) {
+  constexpr std::align_val_t kAlign{64};
+  const std::size_t before = g_allocations.load();
+  void *p[8] = {::operator new(8),
+                ::operator new[](8),
+                ::operator new(8, std::nothrow),
+                ::operator new[](8, std::nothrow),
+                ::operator new(8, kAlign),
+                ::operator new[](8, kAlign),
+                ::operator new(8, kAlign, std::nothrow),
+                ::operator new[](8, kAlign, std::nothrow)};
+  const std::size_t allocations = g_allocations.load() - before;
+  EXPECT_EQ(allocations, 8u);
+  for (std::size_t k = 4; k < 8; ++k)
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p[k]) % 64, 0u) << k;
+  ::operator delete(p[0]);
+  ::operator delete[](p[1]);
+  ::operator delete(p[2], std::nothrow);
+  ::operator delete[](p[3], std::nothrow);
+  ::operator delete(p[4], kAlign);
+  ::operator delete[](p[5], kAlign);
+  ::operator delete(p[6], kAlign, std::nothrow);
+  ::operator delete[](p[7], kAlign, std::nothrow);
+}
+
+TEST(FhnToyFheAllocation, FusedKernelsAllocateNothingInSteadyState) {
+  expect_steady_state_allocation_free(nullptr, toyfhe_fhn_get_kernels(nullptr));
+}
+
+TEST(FhnToyFheAllocation, DecomposedKernelsAllocateNothingInSteadyState) {
+  std::vector<FhnKernelEntry> primitives = primitive_entries(toyfhe_fhn_get_kernels(nullptr));
+  FhnKernelTable table = {static_cast<uint32_t>(primitives.size()), primitives.data()};
+  expect_steady_state_allocation_free(nullptr, &table);
+}
+
+TEST(FhnToyFheAllocation, EagerRotationAllocatesNothingInSteadyState) {
+  expect_steady_state_allocation_free("{\"lazy_rotate\": false}", toyfhe_fhn_get_kernels(nullptr));
+}
@@ -1,10 +1,12 @@
 #include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnThreadPool.h"
 #include "FHN/ToyFheKernels.h"
 #include "FHN/fhn_program.h"
 
 #include <cstring>
 #include <gtest/gtest.h>
 #include <memory>
+#include <utility>
 #include <vector>
 
 class FhnToyFheTest : public ::testing::Test {
@@ -67,6 +69,38 @@ TEST_F(FhnToyFheTest, DataPlaneRoundTrip) {
   toyfhe_fhn_buffer_free(ctx_, buf);
 }
 
+// Serialization round-trips scalar and vector ciphertexts into fresh
+// buffers and rejects truncated strings.
+TEST_F(FhnToyFheTest, SerializeRoundTrip) {
+  FhnBuffer *scalar = toyfhe_fhn_buffer_alloc(ctx_);
+  FhnBuffer *vec = toyfhe_fhn_buffer_alloc(ctx_);
+  ASSERT_EQ(toyfhe_fhn_encrypt_f64(ctx_, scalar, -1.25), 0);
+  const int64_t values[] = {7, -8, 9};
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx_, vec, values, 3), 0);
+
+  for (FhnBuffer *buf : {scalar, vec}) {
+    const uint64_t size = toyfhe_fhn_buffer_serialize(ctx_, buf, nullptr, 0);
+    ASSERT_GT(size, 0u);
+    std::vector<unsigned char> bytes(size);
+    EXPECT_EQ(toyfhe_fhn_buffer_serialize(ctx_, buf, bytes.data(), size), size);
+    FhnBuffer *restored = toyfhe_fhn_buffer_alloc(ctx_);
+    EXPECT_NE(toyfhe_fhn_buffer_deserialize(ctx_, restored, bytes.data(), size - 1), 0);
+    ASSERT_EQ(toyfhe_fhn_buffer_deserialize(ctx_, restored, bytes.data(), size), 0);
+    if (buf == scalar) {
+      double value = 0.0;
+      ASSERT_EQ(toyfhe_fhn_decrypt_f64(ctx_, restored, &value), 0);
+      EXPECT_NEAR(value, -1.25, 1e-3);
+    } else {
+      int64_t out[3] = {0, 0, 0};
+      ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx_, restored, out, 3), 0);
+      EXPECT_EQ(std::vector<int64_t>(out, out + 3), std::vector<int64_t>(values, values + 3));
+    }
+    toyfhe_fhn_buffer_free(ctx_, restored);
+  }
+  toyfhe_fhn_buffer_free(ctx_, vec);
+  toyfhe_fhn_buffer_free(ctx_, scalar);
+}
+
 TEST_F(FhnToyFheTest, AddProgram) {
   // Program: buf[3] = buf[1] + buf[2] (inputs encrypted host-side)
   FhnProgram *prog = fhn_program_alloc(1, 2, 1);
@@ -241,6 +275,46 @@ TEST_F(FhnToyFheTest, VecDataPlaneRoundTrip) {
   toyfhe_fhn_buffer_free(ctx_, buf);
 }
 
+TEST_F(FhnToyFheTest, BatchEncryptMatchesPerValueEncrypt) {
+  FhnBackendCtx *threaded = toyfhe_fhn_create("{\"encrypt_threads\": 3}");
+  ASSERT_NE(threaded, nullptr);
+  for (FhnBackendCtx *ctx : {ctx_, threaded}) {
+    const uint32_t count = 10000;
+    std::vector<int64_t> values(count);
+    std::vector<FhnBuffer *> bufs(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      values[i] = static_cast<int64_t>(i) * 37 - 150000;
+      bufs[i] = toyfhe_fhn_buffer_alloc(ctx);
+    }
+    ASSERT_EQ(toyfhe_fhn_encrypt_batch_i64(ctx, bufs.data(), values.data(), count), 0);
+    for (uint32_t i = 0; i < count; ++i) {
+      int64_t value = 0;
+      ASSERT_EQ(toyfhe_fhn_decrypt_i64(ctx, bufs[i], &value), 0);
+      ASSERT_EQ(value, values[i]) << "value " << i;
+    }
+    // A null buffer anywhere rejects the whole batch.
+    FhnBuffer *missing[2] = {bufs[0], nullptr};
+    EXPECT_NE(toyfhe_fhn_encrypt_batch_i64(ctx, missing, values.data(), 2), 0);
+    for (FhnBuffer *buf : bufs) {
+      toyfhe_fhn_buffer_free(ctx, buf);
+    }
+  }
+
+  // Vectors go through the same bulk path, threads included.
+  FhnBuffer *vec = toyfhe_fhn_buffer_alloc(threaded);
+  std::vector<int64_t> values(20000);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<int64_t>(i % 1000) - 500;
+  }
+  const uint32_t n = static_cast<uint32_t>(values.size());
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(threaded, vec, values.data(), n), 0);
+  std::vector<int64_t> decrypted(values.size());
+  ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(threaded, vec, decrypted.data(), n), 0);
+  EXPECT_EQ(decrypted, values);
+  toyfhe_fhn_buffer_free(threaded, vec);
+  toyfhe_fhn_destroy(threaded);
+}
+
 TEST_F(FhnToyFheTest, VecAddAndHmultPrograms) {
   // Program: buf[3] = ADD_CC(buf[1], buf[2]); buf[4] = HMULT(buf[1], buf[2])
   FhnProgram *prog = fhn_program_alloc(2, 2, 2);
@@ -295,6 +369,67 @@ TEST_F(FhnToyFheTest, VecAddAndHmultPrograms) {
   fhn_program_free(prog);
 }
 
+TEST_F(FhnToyFheTest, VecSubNegateAndScalarMultiplyPrograms) {
+  // Program: buf[3] = SUB_CC(buf[1], buf[2]); buf[4] = NEGATE(buf[3]); buf[5] = MULT_CS(buf[4], -3.0)
+  FhnProgram *prog = fhn_program_alloc(3, 2, 3);
+  ASSERT_NE(prog, nullptr);
+
+  prog->input_ids[0] = 1;
+  prog->input_ids[1] = 2;
+  prog->output_ids[0] = 3;
+  prog->output_ids[1] = 4;
+  prog->output_ids[2] = 5;
+
+  auto &sub = prog->instructions[0];
+  std::memset(&sub, 0, sizeof(sub));
+  sub.opcode = FHN_SUB_CC;
+  sub.result_id = 3;
+  sub.operands[0] = 1;
+  sub.operands[1] = 2;
+
+  auto &negate = prog->instructions[1];
+  std::memset(&negate, 0, sizeof(negate));
+  negate.opcode = FHN_NEGATE;
+  negate.result_id = 4;
+  negate.operands[0] = 3;
+
+  auto &mult = prog->instructions[2];
+  std::memset(&mult, 0, sizeof(mult));
+  mult.opcode = FHN_MULT_CS;
+  mult.result_id = 5;
+  mult.operands[0] = 4;
+  mult.fparams[0] = -3.0;
+
+  FhnBuffer *bufs[6];
+  for (int i = 0; i < 6; ++i) {
+    bufs[i] = toyfhe_fhn_buffer_alloc(ctx_);
+  }
+  // Nine slots: one full AVX-512 lane, one AVX2 tail.
+  const int64_t a[9] = {1, 2, 3, 4, 5, -6, 7, 0, 900};
+  const int64_t b[9] = {10, 20, 3, -40, 0, 6, 70, 0, 1};
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx_, bufs[1], a, 9), 0);
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx_, bufs[2], b, 9), 0);
+
+  ASSERT_EQ(executor_->execute(ctx_, prog, bufs), 0);
+
+  int64_t diff[9] = {0};
+  int64_t negated[9] = {0};
+  int64_t scaled[9] = {0};
+  ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx_, bufs[3], diff, 9), 0);
+  ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx_, bufs[4], negated, 9), 0);
+  ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx_, bufs[5], scaled, 9), 0);
+  for (int i = 0; i < 9; ++i) {
+    EXPECT_EQ(diff[i], a[i] - b[i]);
+    EXPECT_EQ(negated[i], b[i] - a[i]);
+    EXPECT_EQ(scaled[i], 3 * (a[i] - b[i]));
+  }
+
+  for (int i = 0; i < 6; ++i) {
+    toyfhe_fhn_buffer_free(ctx_, bufs[i]);
+  }
+  fhn_program_free(prog);
+}
+
 TEST_F(FhnToyFheTest, VecRotateProgram) {
   // ROTATE is cyclic-left for positive distances: result[i] = src[(i+d) % n].
   // Program: buf[2] = ROTATE(buf[1], +2); buf[3] = ROTATE(buf[1], -1)
@@ -345,6 +480,65 @@ TEST_F(FhnToyFheTest, VecRotateProgram) {
   fhn_program_free(prog);
 }
 
+TEST_F(FhnToyFheTest, LazyRotationSharesSlotsCopyOnWrite) {
+  // ROTATE records an offset over its source's slots; writing either buffer
+  // afterwards must leave the other intact, and serialization must store
+  // the rotated order. The same kernel sequence runs on a ctx that
+  // materializes every rotation.
+  FhnBackendCtx *eager = toyfhe_fhn_create("{\"lazy_rotate\": false}");
+  ASSERT_NE(eager, nullptr);
+  const int64_t x[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  for (FhnBackendCtx *ctx : {ctx_, eager}) {
+    FhnKernelTable *table = toyfhe_fhn_get_kernels(ctx);
+    auto kernel = [&](FhnOpCode opcode) {
+      for (uint32_t i = 0; i < table->num_kernels; ++i) {
+        if (table->kernels[i].opcode == opcode)
+          return table->kernels[i].fn;
+      }
+      return FhnKernelFn{nullptr};
+    };
+    auto decrypt = [&](const FhnBuffer *buf) {
+      std::vector<int64_t> slots(8);
+      EXPECT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx, buf, slots.data(), 8), 0);
+      return slots;
+    };
+    FhnBuffer *src = toyfhe_fhn_buffer_alloc(ctx);
+    FhnBuffer *r3 = toyfhe_fhn_buffer_alloc(ctx);
+    FhnBuffer *r2 = toyfhe_fhn_buffer_alloc(ctx);
+    FhnBuffer *restored = toyfhe_fhn_buffer_alloc(ctx);
+    ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx, src, x, 8), 0);
+
+    const int64_t left3[4] = {3, 0, 0, 0};
+    const int64_t right1[4] = {-1, 0, 0, 0};
+    const FhnBuffer *ops[4] = {src, nullptr, nullptr, nullptr};
+    ASSERT_EQ(kernel(FHN_ROTATE)(ctx, r3, ops, left3, nullptr), 0);
+    ops[0] = r3;
+    ASSERT_EQ(kernel(FHN_ROTATE)(ctx, r2, ops, right1, nullptr), 0);
+    EXPECT_EQ(decrypt(r3), (std::vector<int64_t>{4, 5, 6, 7, 8, 1, 2, 3}));
+    EXPECT_EQ(decrypt(r2), (std::vector<int64_t>{3, 4, 5, 6, 7, 8, 1, 2}));
+
+    // src = src + src in place, then r3 = r3 + src in place.
+    ops[0] = src;
+    ops[1] = src;
+    ASSERT_EQ(kernel(FHN_ADD_CC)(ctx, src, ops, nullptr, nullptr), 0);
+    ops[0] = r3;
+    ASSERT_EQ(kernel(FHN_ADD_CC)(ctx, r3, ops, nullptr, nullptr), 0);
+    EXPECT_EQ(decrypt(src), (std::vector<int64_t>{2, 4, 6, 8, 10, 12, 14, 16}));
+    EXPECT_EQ(decrypt(r3), (std::vector<int64_t>{6, 9, 12, 15, 18, 13, 16, 19}));
+    EXPECT_EQ(decrypt(r2), (std::vector<int64_t>{3, 4, 5, 6, 7, 8, 1, 2}));
+
+    const uint64_t size = toyfhe_fhn_buffer_serialize(ctx, r2, nullptr, 0);
+    std::vector<unsigned char> bytes(size);
+    ASSERT_EQ(toyfhe_fhn_buffer_serialize(ctx, r2, bytes.data(), size), size);
+    ASSERT_EQ(toyfhe_fhn_buffer_deserialize(ctx, restored, bytes.data(), size), 0);
+    EXPECT_EQ(decrypt(restored), (std::vector<int64_t>{3, 4, 5, 6, 7, 8, 1, 2}));
+
+    for (FhnBuffer *buf : {src, r3, r2, restored})
+      toyfhe_fhn_buffer_free(ctx, buf);
+  }
+  toyfhe_fhn_destroy(eager);
+}
+
 TEST_F(FhnToyFheTest, VecHrotAddProgram) {
   // Fused rotate-and-add: result[i] = a[(i+d) % n] + b[i] with d = 1.
   // Program: buf[3] = HROT_ADD(buf[1], buf[2])
@@ -467,3 +661,555 @@ TEST_F(FhnToyFheTest, ReductionFusedMatchesDecomposed) {
   }
   fhn_program_free(prog);
 }
+
+TEST_F(FhnToyFheTest, KernelFlagsMarkEveryKernelThreadSafe) {
+  fhenomenon::FhnDefaultExecutor flagged(table_, toyfhe_fhn_kernel_flags, ctx_);
+  EXPECT_EQ(flagged.kernelFlags(FHN_ADD_CC), static_cast<uint32_t>(FHN_KERNEL_THREAD_SAFE));
+  EXPECT_EQ(flagged.kernelFlags(FHN_HROT_ADD), static_cast<uint32_t>(FHN_KERNEL_THREAD_SAFE));
+  // Re-encrypting kernels draw from the Engine RNG, which locks internally.
+  EXPECT_EQ(flagged.kernelFlags(FHN_MULT_CC), static_cast<uint32_t>(FHN_KERNEL_THREAD_SAFE));
+  EXPECT_EQ(flagged.kernelFlags(FHN_HMULT), static_cast<uint32_t>(FHN_KERNEL_THREAD_SAFE));
+  EXPECT_EQ(flagged.kernelFlags(FHN_CONJUGATE), 0u); // unregistered
+}
+
+TEST_F(FhnToyFheTest, ParallelReduceTreesMatchSerial) {
+  // Four independent dot products (HMULT then two HROT_ADD levels) over the
+  // same inputs: the wavefront executor runs each level of all four trees
+  // concurrently.
+  const uint32_t trees = 4;
+  FhnProgram *prog = fhn_program_alloc(3 * trees, 2, trees);
+  ASSERT_NE(prog, nullptr);
+  prog->input_ids[0] = 1;
+  prog->input_ids[1] = 2;
+  uint32_t next = 3;
+  for (uint32_t t = 0; t < trees; ++t) {
+    FhnInstruction *inst = &prog->instructions[3 * t];
+    const uint32_t p = next++, r1 = next++, r2 = next++;
+    inst[0].opcode = FHN_HMULT;
+    inst[0].result_id = p;
+    inst[0].operands[0] = 1;
+    inst[0].operands[1] = 2;
+    inst[1].opcode = FHN_HROT_ADD;
+    inst[1].result_id = r1;
+    inst[1].operands[0] = p;
+    inst[1].operands[1] = p;
+    inst[1].params[0] = 2;
+    inst[2].opcode = FHN_HROT_ADD;
+    inst[2].result_id = r2;
+    inst[2].operands[0] = r1;
+    inst[2].operands[1] = r1;
+    inst[2].params[0] = 1;
+    prog->output_ids[t] = r2;
+  }
+
+  std::vector<FhnBuffer *> bufs(next);
+  for (auto &buf : bufs) {
+    buf = toyfhe_fhn_buffer_alloc(ctx_);
+  }
+  const int64_t a[4] = {3, 1, 4, 1};
+  const int64_t b[4] = {2, 7, 1, 8};
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx_, bufs[1], a, 4), 0);
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx_, bufs[2], b, 4), 0);
+
+  fhenomenon::FhnDefaultExecutor flagged(table_, toyfhe_fhn_kernel_flags, ctx_);
+  fhenomenon::FhnThreadPool pool(4);
+  ASSERT_EQ(flagged.executeParallel(ctx_, prog, bufs.data(), pool), 0);
+  for (uint32_t t = 0; t < trees; ++t) {
+    int64_t out[4] = {0};
+    ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx_, bufs[prog->output_ids[t]], out, 4), 0);
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_EQ(out[i], 25);
+    }
+  }
+
+  for (auto *buf : bufs) {
+    toyfhe_fhn_buffer_free(ctx_, buf);
+  }
+  fhn_program_free(prog);
+}
+
+TEST_F(FhnToyFheTest, SlotThreadsSplitVectorKernels) {
+  // Dot products of 256-slot vectors (HMULT, then eight HROT_ADD levels) on
+  // a ctx whose kernels split their slots into chunks of 16 across three
+  // threads: serially, where every kernel gets the slot pool, and on the
+  // wavefront executor, where kernels running side by side fall back to
+  // their own thread when another holds the pool.
+  FhnBackendCtx *ctx = toyfhe_fhn_create("{\"slot_threads\": 3, \"slot_grain\": 16}");
+  ASSERT_NE(ctx, nullptr);
+  const uint32_t n = 256, trees = 3, levels = 8;
+  FhnProgram *prog = fhn_program_alloc(trees * (1 + levels), 2, trees);
+  ASSERT_NE(prog, nullptr);
+  prog->input_ids[0] = 1;
+  prog->input_ids[1] = 2;
+  uint32_t next = 3;
+  FhnInstruction *inst = prog->instructions;
+  for (uint32_t t = 0; t < trees; ++t) {
+    inst->opcode = FHN_HMULT;
+    inst->result_id = next++;
+    inst->operands[0] = 1;
+    inst->operands[1] = 2;
+    for (int64_t d = n / 2; d >= 1; d /= 2) {
+      const uint32_t src = inst->result_id;
+      ++inst;
+      inst->opcode = FHN_HROT_ADD;
+      inst->result_id = next++;
+      inst->operands[0] = src;
+      inst->operands[1] = src;
+      inst->params[0] = d;
+    }
+    prog->output_ids[t] = inst->result_id;
+    ++inst;
+  }
+
+  std::vector<FhnBuffer *> bufs(next);
+  for (auto &buf : bufs) {
+    buf = toyfhe_fhn_buffer_alloc(ctx);
+  }
+  std::vector<int64_t> a(n), b(n);
+  int64_t dot = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    a[i] = i % 10;
+    b[i] = (3 * i + 1) % 10;
+    dot += a[i] * b[i];
+  }
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx, bufs[1], a.data(), n), 0);
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx, bufs[2], b.data(), n), 0);
+  std::vector<int64_t> decrypted(n);
+  ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx, bufs[1], decrypted.data(), n), 0);
+  EXPECT_EQ(decrypted, a);
+
+  fhenomenon::FhnDefaultExecutor flagged(table_, toyfhe_fhn_kernel_flags, ctx);
+  fhenomenon::FhnThreadPool pool(4);
+  for (bool parallel : {false, true}) {
+    const int rc =
+      parallel ? flagged.executeParallel(ctx, prog, bufs.data(), pool) : flagged.execute(ctx, prog, bufs.data());
+    ASSERT_EQ(rc, 0);
+    for (uint32_t t = 0; t < trees; ++t) {
+      ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx, bufs[prog->output_ids[t]], decrypted.data(), n), 0);
+      EXPECT_EQ(decrypted, std::vector<int64_t>(n, dot)) << "tree " << t << (parallel ? ", wavefront" : ", serial");
+    }
+  }
+
+  for (auto *buf : bufs) {
+    toyfhe_fhn_buffer_free(ctx, buf);
+  }
+  fhn_program_free(prog);
+  toyfhe_fhn_destroy(ctx);
+}
+
+// out = (in1 + in2) * 3.0; also lists input 1 as a second output.
+static FhnProgram *async_test_program() {
+  FhnProgram *prog = fhn_program_alloc(2, 2, 2);
+  prog->input_ids[0] = 1;
+  prog->input_ids[1] = 2;
+  prog->instructions[0].opcode = FHN_ADD_CC;
+  prog->instructions[0].result_id = 3;
+  prog->instructions[0].operands[0] = 1;
+  prog->instructions[0].operands[1] = 2;
+  prog->instructions[1].opcode = FHN_MULT_CS;
+  prog->instructions[1].result_id = 4;
+  prog->instructions[1].operands[0] = 3;
+  prog->instructions[1].fparams[0] = 3.0;
+  prog->output_ids[0] = 4;
+  prog->output_ids[1] = 1;
+  return prog;
+}
+
+TEST_F(FhnToyFheTest, AsyncSubmitWaitCollect) {
+  FhnProgram *prog = async_test_program();
+  ASSERT_NE(prog, nullptr);
+  FhnBuffer *inputs[2] = {toyfhe_fhn_buffer_alloc(ctx_), toyfhe_fhn_buffer_alloc(ctx_)};
+  ASSERT_EQ(toyfhe_fhn_encrypt_i64(ctx_, inputs[0], 5), 0);
+  ASSERT_EQ(toyfhe_fhn_encrypt_i64(ctx_, inputs[1], 9), 0);
+
+  FhnExecHandle *handle = toyfhe_fhn_submit(ctx_, prog, inputs, 2);
+  ASSERT_NE(handle, nullptr);
+  fhn_program_free(prog); // the backend copied it
+
+  // Host-side encryption on the same ctx overlaps the run.
+  FhnBuffer *next = toyfhe_fhn_buffer_alloc(ctx_);
+  ASSERT_EQ(toyfhe_fhn_encrypt_i64(ctx_, next, 77), 0);
+
+  ASSERT_EQ(toyfhe_fhn_wait(handle), 0);
+  EXPECT_EQ(toyfhe_fhn_poll(handle), 1);
+  uint32_t num_outputs = 0;
+  FhnBuffer **outputs = toyfhe_fhn_get_outputs(handle, &num_outputs);
+  ASSERT_NE(outputs, nullptr);
+  ASSERT_EQ(num_outputs, 2u);
+  EXPECT_EQ(toyfhe_fhn_get_outputs(handle, &num_outputs), nullptr); // collected once
+
+  int64_t value = 0;
+  ASSERT_EQ(toyfhe_fhn_decrypt_i64(ctx_, outputs[0], &value), 0);
+  EXPECT_EQ(value, 42);
+  // An output naming an input id is a distinct copy the host owns.
+  EXPECT_NE(outputs[1], inputs[0]);
+  ASSERT_EQ(toyfhe_fhn_decrypt_i64(ctx_, outputs[1], &value), 0);
+  EXPECT_EQ(value, 5);
+
+  toyfhe_fhn_buffer_free(ctx_, outputs[0]);
+  toyfhe_fhn_buffer_free(ctx_, outputs[1]);
+  toyfhe_fhn_exec_free(handle);
+  toyfhe_fhn_buffer_free(ctx_, next);
+  toyfhe_fhn_buffer_free(ctx_, inputs[0]);
+  toyfhe_fhn_buffer_free(ctx_, inputs[1]);
+}
+
+TEST_F(FhnToyFheTest, AsyncFailureAndRejection) {
+  FhnBuffer *input = toyfhe_fhn_buffer_alloc(ctx_);
+  ASSERT_EQ(toyfhe_fhn_encrypt_i64(ctx_, input, 1), 0);
+
+  // CONJUGATE has no kernel: accepted, then fails on the worker.
+  FhnProgram *prog = fhn_program_alloc(1, 1, 1);
+  prog->input_ids[0] = 1;
+  prog->instructions[0].opcode = FHN_CONJUGATE;
+  prog->instructions[0].result_id = 2;
+  prog->instructions[0].operands[0] = 1;
+  prog->output_ids[0] = 2;
+  FhnExecHandle *handle = toyfhe_fhn_submit(ctx_, prog, &input, 1);
+  ASSERT_NE(handle, nullptr);
+  EXPECT_NE(toyfhe_fhn_wait(handle), 0);
+  EXPECT_LT(toyfhe_fhn_poll(handle), 0);
+  uint32_t num_outputs = 7;
+  EXPECT_EQ(toyfhe_fhn_get_outputs(handle, &num_outputs), nullptr);
+  toyfhe_fhn_exec_free(handle);
+
+  // Input count mismatch and ABI mismatch are rejected up front.
+  EXPECT_EQ(toyfhe_fhn_submit(ctx_, prog, &input, 0), nullptr);
+  prog->version = FHN_ABI_VERSION + 1;
+  EXPECT_EQ(toyfhe_fhn_submit(ctx_, prog, &input, 1), nullptr);
+
+  fhn_program_free(prog);
+  toyfhe_fhn_buffer_free(ctx_, input);
+}
+
+TEST_F(FhnToyFheTest, AsyncExecFreeReleasesUncollectedOutputs) {
+  FhnProgram *prog = async_test_program();
+  FhnBuffer *inputs[2] = {toyfhe_fhn_buffer_alloc(ctx_), toyfhe_fhn_buffer_alloc(ctx_)};
+  ASSERT_EQ(toyfhe_fhn_encrypt_i64(ctx_, inputs[0], 1), 0);
+  ASSERT_EQ(toyfhe_fhn_encrypt_i64(ctx_, inputs[1], 2), 0);
+  // Several in flight at once; freed without waiting or collecting.
+  FhnExecHandle *handles[3];
+  for (auto &h : handles) {
+    h = toyfhe_fhn_submit(ctx_, prog, inputs, 2);
+    ASSERT_NE(h, nullptr);
+  }
+  for (auto *h : handles) {
+    toyfhe_fhn_exec_free(h);
+  }
+  fhn_program_free(prog);
+  toyfhe_fhn_buffer_free(ctx_, inputs[0]);
+  toyfhe_fhn_buffer_free(ctx_, inputs[1]);
+}
+
+TEST_F(FhnToyFheTest, PipelinedBatchesOverlapPrepareWithExecution) {
+  FhnProgram *prog = async_test_program();
+  ASSERT_NE(prog, nullptr);
+  fhenomenon::FhnAsyncHooks hooks{ctx_,
+                                  toyfhe_fhn_submit,
+                                  toyfhe_fhn_poll,
+                                  toyfhe_fhn_wait,
+                                  toyfhe_fhn_get_outputs,
+                                  toyfhe_fhn_exec_free,
+                                  toyfhe_fhn_buffer_free};
+  ASSERT_TRUE(hooks.available());
+
+  // Event log: ('p', b) when batch b is prepared, ('c', b) when consumed.
+  std::vector<std::pair<char, uint32_t>> events;
+  std::vector<int64_t> results;
+  const uint32_t batches = 5;
+  auto prepare = [&](uint32_t b, FhnBuffer **inputs) {
+    events.emplace_back('p', b);
+    inputs[0] = toyfhe_fhn_buffer_alloc(ctx_);
+    inputs[1] = toyfhe_fhn_buffer_alloc(ctx_);
+    return toyfhe_fhn_encrypt_i64(ctx_, inputs[0], b) | toyfhe_fhn_encrypt_i64(ctx_, inputs[1], 10);
+  };
+  auto consume = [&](uint32_t b, FhnBuffer **inputs, FhnBuffer **outputs) {
+    events.emplace_back('c', b);
+    int64_t value = -1;
+    if (outputs && toyfhe_fhn_decrypt_i64(ctx_, outputs[0], &value) == 0)
+      results.push_back(value);
+    for (uint32_t k = 0; outputs && k < 2; ++k)
+      toyfhe_fhn_buffer_free(ctx_, outputs[k]);
+    toyfhe_fhn_buffer_free(ctx_, inputs[0]);
+    toyfhe_fhn_buffer_free(ctx_, inputs[1]);
+  };
+  ASSERT_EQ(fhenomenon::FhnDefaultExecutor::executePipelined(hooks, prog, batches, prepare, consume), 0);
+
+  ASSERT_EQ(results.size(), batches);
+  for (uint32_t b = 0; b < batches; ++b) {
+    EXPECT_EQ(results[b], 3 * (static_cast<int64_t>(b) + 10));
+  }
+  // Batch b + 1 is prepared before batch b is consumed.
+  const std::vector<std::pair<char, uint32_t>> expected = {{'p', 0}, {'p', 1}, {'c', 0}, {'p', 2}, {'c', 1},
+                                                            {'p', 3}, {'c', 2}, {'p', 4}, {'c', 3}, {'c', 4}};
+  EXPECT_EQ(events, expected);
+
+  // A failing prepare stops the pipeline; prepared batches still drain.
+  events.clear();
+  results.clear();
+  auto failing_prepare = [&](uint32_t b, FhnBuffer **inputs) { return b == 2 ? -3 : prepare(b, inputs); };
+  EXPECT_EQ(fhenomenon::FhnDefaultExecutor::executePipelined(hooks, prog, batches, failing_prepare, consume), -3);
+  EXPECT_EQ(results.size(), 2u);
+
+  fhn_program_free(prog);
+}
+
+TEST_F(FhnToyFheTest, BatchedVectorKernelsMatchPerRequest) {
+  FhnBatchKernelTable *batch_table = toyfhe_fhn_get_batch_kernels(ctx_);
+  ASSERT_NE(batch_table, nullptr);
+  fhenomenon::FhnDefaultExecutor batched(table_, nullptr, nullptr, batch_table);
+  EXPECT_NE(batched.batchKernel(FHN_HROT_ADD), nullptr);
+  EXPECT_EQ(batched.batchKernel(FHN_MULT_CS), nullptr); // scalar-only kernel
+
+  // r3 = HMULT(r1, r2); r4 = ROTATE(r3, 1); r4 = r4 + r3 (in place);
+  // r5 = HROT_ADD(r4, r1, 2); r5 = ROTATE(r5, -1) (in place)
+  FhnProgram *prog = fhn_program_alloc(5, 2, 1);
+  ASSERT_NE(prog, nullptr);
+  prog->input_ids[0] = 1;
+  prog->input_ids[1] = 2;
+  prog->output_ids[0] = 5;
+  const struct {
+    FhnOpCode op;
+    uint32_t result, a, b;
+    int64_t p0;
+  } insts[] = {{FHN_HMULT, 3, 1, 2, 0},
+               {FHN_ROTATE, 4, 3, 0, 1},
+               {FHN_ADD_CC, 4, 4, 3, 0},
+               {FHN_HROT_ADD, 5, 4, 1, 2},
+               {FHN_ROTATE, 5, 5, 0, -1}};
+  for (uint32_t i = 0; i < 5; ++i) {
+    prog->instructions[i].opcode = insts[i].op;
+    prog->instructions[i].result_id = insts[i].result;
+    prog->instructions[i].operands[0] = insts[i].a;
+    prog->instructions[i].operands[1] = insts[i].b;
+    prog->instructions[i].params[0] = insts[i].p0;
+  }
+
+  const uint32_t requests = 3;
+  std::vector<std::vector<FhnBuffer *>> bufs(requests, std::vector<FhnBuffer *>(6, nullptr));
+  std::vector<FhnBuffer **> tables;
+  for (uint32_t r = 0; r < requests; ++r) {
+    for (auto &buf : bufs[r]) {
+      buf = toyfhe_fhn_buffer_alloc(ctx_);
+    }
+    const int64_t a[4] = {1 + r, 2, 3, 4};
+    const int64_t b[4] = {5, 6 + r, 7, 8};
+    ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx_, bufs[r][1], a, 4), 0);
+    ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx_, bufs[r][2], b, 4), 0);
+    tables.push_back(bufs[r].data());
+  }
+  // Run twice: the second run writes into the first run's result storage.
+  for (int run = 0; run < 2; ++run) {
+    ASSERT_EQ(batched.executeBatch(ctx_, prog, tables.data(), requests), 0);
+  }
+
+  for (uint32_t r = 0; r < requests; ++r) {
+    std::vector<FhnBuffer *> single(6, nullptr);
+    single[1] = bufs[r][1];
+    single[2] = bufs[r][2];
+    for (uint32_t id = 3; id < 6; ++id) {
+      single[id] = toyfhe_fhn_buffer_alloc(ctx_);
+    }
+    ASSERT_EQ(executor_->execute(ctx_, prog, single.data()), 0);
+    int64_t want[4] = {0}, got[4] = {0};
+    ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx_, single[5], want, 4), 0);
+    ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx_, bufs[r][5], got, 4), 0);
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_EQ(got[i], want[i]) << "request " << r << " slot " << i;
+    }
+    for (uint32_t id = 3; id < 6; ++id) {
+      toyfhe_fhn_buffer_free(ctx_, single[id]);
+    }
+  }
+
+  for (auto &row : bufs) {
+    for (auto *buf : row) {
+      toyfhe_fhn_buffer_free(ctx_, buf);
+    }
+  }
+  fhn_program_free(prog);
+}
+
+// Packed mode: one RLWE ciphertext per vector, same kernel contracts.
+class FhnToyFhePackedTest : public ::testing::Test {
+  protected:
+  void SetUp() override {
+    ctx_ = toyfhe_fhn_create("{\"packed\": true, \"ring_dim\": 64, \"key_seed\": 5}");
+    ASSERT_NE(ctx_, nullptr);
+    table_ = toyfhe_fhn_get_kernels(ctx_);
+    executor_ = std::make_unique<fhenomenon::FhnDefaultExecutor>(table_);
+  }
+  void TearDown() override { toyfhe_fhn_destroy(ctx_); }
+  FhnBackendCtx *ctx_ = nullptr;
+  FhnKernelTable *table_ = nullptr;
+  std::unique_ptr<fhenomenon::FhnDefaultExecutor> executor_;
+};
+
+TEST_F(FhnToyFhePackedTest, DataPlaneSerializeAndLevelBytes) {
+  EXPECT_EQ(toyfhe_fhn_create("{\"packed\": true, \"ring_dim\": 48}"), nullptr);
+  EXPECT_EQ(toyfhe_fhn_level_bytes(ctx_, 0), 2u * sizeof(uint64_t) * 64u);
+
+  FhnBuffer *buf = toyfhe_fhn_buffer_alloc(ctx_);
+  const int64_t values[4] = {5, -3, 0, 12345};
+  EXPECT_NE(toyfhe_fhn_encrypt_vec_i64(ctx_, buf, values, 3), 0); // 3 does not divide N / 2 = 32
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx_, buf, values, 4), 0);
+  int64_t out[4] = {0, 0, 0, 0};
+  EXPECT_NE(toyfhe_fhn_decrypt_vec_i64(ctx_, buf, out, 2), 0);
+  ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx_, buf, out, 4), 0);
+  EXPECT_EQ(std::vector<int64_t>(out, out + 4), std::vector<int64_t>(values, values + 4));
+
+  const uint64_t size = toyfhe_fhn_buffer_serialize(ctx_, buf, nullptr, 0);
+  EXPECT_EQ(size, 1u + 2u * sizeof(uint64_t) + 2u * sizeof(uint64_t) * 64u);
+  std::vector<unsigned char> bytes(size);
+  EXPECT_EQ(toyfhe_fhn_buffer_serialize(ctx_, buf, bytes.data(), size), size);
+  FhnBuffer *restored = toyfhe_fhn_buffer_alloc(ctx_);
+  EXPECT_NE(toyfhe_fhn_buffer_deserialize(ctx_, restored, bytes.data(), size - 1), 0);
+  ASSERT_EQ(toyfhe_fhn_buffer_deserialize(ctx_, restored, bytes.data(), size), 0);
+  int64_t again[4] = {0, 0, 0, 0};
+  ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx_, restored, again, 4), 0);
+  EXPECT_EQ(std::vector<int64_t>(again, again + 4), std::vector<int64_t>(values, values + 4));
+
+  // A peer context with the same seed and ring holds the same key.
+  FhnBackendCtx *peer = toyfhe_fhn_create("{\"packed\": true, \"ring_dim\": 64, \"key_seed\": 5}");
+  ASSERT_NE(peer, nullptr);
+  FhnBuffer *copy = toyfhe_fhn_buffer_alloc(peer);
+  ASSERT_EQ(toyfhe_fhn_buffer_copy_peer(peer, copy, ctx_, buf), 0);
+  ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(peer, copy, again, 4), 0);
+  EXPECT_EQ(std::vector<int64_t>(again, again + 4), std::vector<int64_t>(values, values + 4));
+  toyfhe_fhn_buffer_free(peer, copy);
+  toyfhe_fhn_destroy(peer);
+
+  toyfhe_fhn_buffer_free(ctx_, restored);
+  toyfhe_fhn_buffer_free(ctx_, buf);
+}
+
+TEST_F(FhnToyFhePackedTest, SlotWiseAndRotateKernels) {
+  // r3 = ADD_CC(r1, r2); r4 = SUB_CC(r1, r2); r5 = NEGATE(r1);
+  // r6 = MULT_CS(r1, 3); r7 = ADD_CS(r1, -2); r8 = ROTATE(r1, 3);
+  // r9 = ROTATE(r1, -1); r10 = HROT_ADD(r1, r2, 1)
+  FhnProgram *prog = fhn_program_alloc(8, 2, 8);
+  ASSERT_NE(prog, nullptr);
+  prog->input_ids[0] = 1;
+  prog->input_ids[1] = 2;
+  const struct {
+    FhnOpCode op;
+    uint32_t result, a, b;
+    int64_t p0;
+    double f0;
+  } insts[] = {{FHN_ADD_CC, 3, 1, 2, 0, 0.0},  {FHN_SUB_CC, 4, 1, 2, 0, 0.0}, {FHN_NEGATE, 5, 1, 0, 0, 0.0},
+               {FHN_MULT_CS, 6, 1, 0, 0, 3.0}, {FHN_ADD_CS, 7, 1, 0, 0, -2.0}, {FHN_ROTATE, 8, 1, 0, 3, 0.0},
+               {FHN_ROTATE, 9, 1, 0, -1, 0.0}, {FHN_HROT_ADD, 10, 1, 2, 1, 0.0}};
+  for (uint32_t i = 0; i < 8; ++i) {
+    prog->instructions[i].opcode = insts[i].op;
+    prog->instructions[i].result_id = insts[i].result;
+    prog->instructions[i].operands[0] = insts[i].a;
+    prog->instructions[i].operands[1] = insts[i].b;
+    prog->instructions[i].params[0] = insts[i].p0;
+    prog->instructions[i].fparams[0] = insts[i].f0;
+    prog->output_ids[i] = insts[i].result;
+  }
+
+  FhnBuffer *bufs[11];
+  for (auto &buf : bufs) {
+    buf = toyfhe_fhn_buffer_alloc(ctx_);
+  }
+  const int64_t a[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  const int64_t b[8] = {10, -20, 30, -40, 50, -60, 70, -80};
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx_, bufs[1], a, 8), 0);
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx_, bufs[2], b, 8), 0);
+  ASSERT_EQ(executor_->execute(ctx_, prog, bufs), 0);
+
+  int64_t got[8] = {0};
+  const auto expect_slots = [&](uint32_t id, auto expected) {
+    ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx_, bufs[id], got, 8), 0);
+    for (int i = 0; i < 8; ++i) {
+      EXPECT_EQ(got[i], expected(i)) << "buffer " << id << " slot " << i;
+    }
+  };
+  expect_slots(3, [&](int i) { return a[i] + b[i]; });
+  expect_slots(4, [&](int i) { return a[i] - b[i]; });
+  expect_slots(5, [&](int i) { return -a[i]; });
+  expect_slots(6, [&](int i) { return 3 * a[i]; });
+  expect_slots(7, [&](int i) { return a[i] - 2; });
+  expect_slots(8, [&](int i) { return a[(i + 3) % 8]; });
+  expect_slots(9, [&](int i) { return a[(i + 7) % 8]; });
+  expect_slots(10, [&](int i) { return a[(i + 1) % 8] + b[i]; });
+
+  // Fractional plaintext scalars have no packed encoding; mixing packed
+  // and per-slot vectors or slot counts is an error.
+  prog->instructions[3].fparams[0] = 0.5;
+  EXPECT_NE(executor_->execute(ctx_, prog, bufs), 0);
+  prog->instructions[3].fparams[0] = 3.0;
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx_, bufs[2], b, 4), 0);
+  EXPECT_NE(executor_->execute(ctx_, prog, bufs), 0);
+
+  for (auto *buf : bufs) {
+    toyfhe_fhn_buffer_free(ctx_, buf);
+  }
+  fhn_program_free(prog);
+}
+
+TEST_F(FhnToyFhePackedTest, ReductionFusedMatchesDecomposed) {
+  // buf[3] = HMULT(buf[1], buf[2]); then log2(n) HROT_ADD halvings, after
+  // which every slot holds dot(a, b) — fused, and decomposed by the
+  // executor into MULT_CC + RELINEARIZE + RESCALE and ROTATE + ADD_CC.
+  const uint32_t n = 16;
+  FhnProgram *prog = fhn_program_alloc(5, 2, 1);
+  ASSERT_NE(prog, nullptr);
+  prog->input_ids[0] = 1;
+  prog->input_ids[1] = 2;
+  prog->output_ids[0] = 7;
+  prog->instructions[0].opcode = FHN_HMULT;
+  prog->instructions[0].result_id = 3;
+  prog->instructions[0].operands[0] = 1;
+  prog->instructions[0].operands[1] = 2;
+  uint32_t id = 3;
+  for (uint32_t i = 1, d = n / 2; d >= 1; ++i, d /= 2, ++id) {
+    prog->instructions[i].opcode = FHN_HROT_ADD;
+    prog->instructions[i].result_id = id + 1;
+    prog->instructions[i].operands[0] = id;
+    prog->instructions[i].operands[1] = id;
+    prog->instructions[i].params[0] = d;
+  }
+
+  FhnBuffer *bufs[8];
+  for (auto &buf : bufs) {
+    buf = toyfhe_fhn_buffer_alloc(ctx_);
+  }
+  int64_t a[n];
+  int64_t b[n];
+  int64_t dot = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    a[i] = static_cast<int64_t>(i % 7) - 3;
+    b[i] = static_cast<int64_t>((5 * i) % 9);
+    dot += a[i] * b[i];
+  }
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx_, bufs[1], a, n), 0);
+  ASSERT_EQ(toyfhe_fhn_encrypt_vec_i64(ctx_, bufs[2], b, n), 0);
+
+  ASSERT_EQ(executor_->execute(ctx_, prog, bufs), 0);
+  int64_t fused[n] = {0};
+  ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx_, bufs[7], fused, n), 0);
+
+  std::vector<FhnKernelEntry> primitives;
+  for (uint32_t i = 0; i < table_->num_kernels; ++i) {
+    if (table_->kernels[i].opcode != FHN_HMULT && table_->kernels[i].opcode != FHN_HROT_ADD) {
+      primitives.push_back(table_->kernels[i]);
+    }
+  }
+  FhnKernelTable primitives_table = {static_cast<uint32_t>(primitives.size()), primitives.data()};
+  fhenomenon::FhnDefaultExecutor decomposed_executor(&primitives_table);
+  ASSERT_EQ(decomposed_executor.execute(ctx_, prog, bufs), 0);
+  int64_t decomposed[n] = {0};
+  ASSERT_EQ(toyfhe_fhn_decrypt_vec_i64(ctx_, bufs[7], decomposed, n), 0);
+
+  for (uint32_t i = 0; i < n; ++i) {
+    EXPECT_EQ(fused[i], dot);
+    EXPECT_EQ(decomposed[i], dot);
+  }
+
+  for (auto *buf : bufs) {
+    toyfhe_fhn_buffer_free(ctx_, buf);
+  }
+  fhn_program_free(prog);
+}
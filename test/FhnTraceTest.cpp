@@ -0,0 +1,205 @@
+#include "FHN/FhnDefaultExecutor.h"
+#include "FHN/FhnMovementPlan.h"
+#include "FHN/FhnTrace.h"
+#include "FhnTestProgramBuilder.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using fhenomenon::FhnDefaultExecutor;
+using fhenomenon::FhnMovementHooks;
+using fhenomenon::FhnMovementPlan;
+using fhenomenon::FhnTrace;
+using fhenomenon::testutil::ProgramBuilder;
+
+namespace {
+
+struct TestBuffer {
+  int64_t value;
+};
+
+int test_add_cc(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *, const double *) {
+  reinterpret_cast<TestBuffer *>(result)->value = reinterpret_cast<const TestBuffer *>(operands[0])->value +
+                                                  reinterpret_cast<const TestBuffer *>(operands[1])->value;
+  return 0;
+}
+
+int test_mult_cc(FhnBackendCtx *, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+                 const double *) {
+  reinterpret_cast<TestBuffer *>(result)->value = reinterpret_cast<const TestBuffer *>(operands[0])->value *
+                                                  reinterpret_cast<const TestBuffer *>(operands[1])->value;
+  return 0;
+}
+
+int test_rescale(FhnBackendCtx *, FhnBuffer *, const FhnBuffer *const *, const int64_t *, const double *) { return 0; }
+
+FhnKernelEntry g_entries[] = {
+  {FHN_ADD_CC, test_add_cc, "add_cc"},
+  {FHN_MULT_CC, test_mult_cc, "mult_cc"},
+  {FHN_RESCALE, test_rescale, "rescale"},
+};
+FhnKernelTable g_table = {3, g_entries};
+
+FhnBuffer *test_alloc(FhnBackendCtx *) { return reinterpret_cast<FhnBuffer *>(new TestBuffer{0}); }
+void test_free(FhnBackendCtx *, FhnBuffer *buf) { delete reinterpret_cast<TestBuffer *>(buf); }
+
+// x = a + b; y = HMULT(x, a) (decomposed: mult_cc + rescale); z = y + x
+ProgramBuilder traced_program() {
+  ProgramBuilder b;
+  b.input(1).input(2).inst(FHN_ADD_CC, 3, 1, 2).inst(FHN_HMULT, 4, 3, 1).inst(FHN_ADD_CC, 5, 4, 3).output(5);
+  return b;
+}
+
+} // namespace
+
+TEST(FhnTrace, ExecuteRecordsOneEventPerInstruction) {
+  FhnDefaultExecutor executor(&g_table);
+  FhnTrace trace;
+  executor.setTraceSink(&trace);
+  EXPECT_EQ(executor.traceSink(), &trace);
+
+  auto prog = traced_program().build();
+  std::vector<TestBuffer> values(6, TestBuffer{0});
+  values[1].value = 2;
+  values[2].value = 3;
+  std::vector<FhnBuffer *> ptrs(6);
+  for (std::size_t i = 0; i < ptrs.size(); ++i)
+    ptrs[i] = reinterpret_cast<FhnBuffer *>(&values[i]);
+  ASSERT_EQ(executor.execute(nullptr, prog.get(), ptrs.data()), 0);
+  EXPECT_EQ(values[5].value, 5 * 2 + 5);
+
+  const auto &events = trace.events();
+  ASSERT_EQ(events.size(), 3u);
+  for (uint32_t i = 0; i < events.size(); ++i) {
+    EXPECT_EQ(events[i].index, i);
+    EXPECT_EQ(events[i].movement_ns, 0u);
+    EXPECT_EQ(events[i].alloc, 0u);
+    if (i > 0) {
+      EXPECT_GE(events[i].start_ns, events[i - 1].start_ns + events[i - 1].duration_ns);
+    }
+  }
+  EXPECT_EQ(events[0].opcode, FHN_ADD_CC);
+  EXPECT_FALSE(events[0].decomposed);
+  ASSERT_EQ(events[0].num_kernels, 1u);
+  EXPECT_STREQ(events[0].kernels[0], "add_cc");
+
+  EXPECT_EQ(events[1].opcode, FHN_HMULT);
+  EXPECT_TRUE(events[1].decomposed);
+  ASSERT_EQ(events[1].num_kernels, 2u);
+  EXPECT_STREQ(events[1].kernels[0], "mult_cc");
+  EXPECT_STREQ(events[1].kernels[1], "rescale");
+
+  // Detached: nothing more is recorded.
+  executor.setTraceSink(nullptr);
+  ASSERT_EQ(executor.execute(nullptr, prog.get(), ptrs.data()), 0);
+  EXPECT_EQ(trace.events().size(), 3u);
+}
+
+TEST(FhnTrace, PlannedExecuteRecordsMovementActions) {
+  FhnDefaultExecutor executor(&g_table);
+  FhnTrace trace;
+  executor.setTraceSink(&trace);
+
+  auto prog = traced_program().build();
+  auto plan = FhnMovementPlan::analyze(*prog, {1, 2, 5});
+  ASSERT_TRUE(plan.has_value());
+  std::vector<FhnBuffer *> buffers(6, nullptr);
+  buffers[1] = test_alloc(nullptr);
+  buffers[2] = test_alloc(nullptr);
+  const FhnMovementHooks hooks{nullptr, test_alloc, test_free, nullptr, nullptr};
+  ASSERT_EQ(executor.execute(hooks, prog.get(), buffers.data(), *plan), 0);
+
+  const auto &events = trace.events();
+  ASSERT_EQ(events.size(), 3u);
+  for (uint32_t i = 0; i < events.size(); ++i) {
+    const auto &act = plan->at(i);
+    EXPECT_EQ(events[i].alloc, act.alloc.size()) << i;
+    EXPECT_EQ(events[i].free, act.free.size()) << i;
+    EXPECT_EQ(events[i].evict, act.evict.size()) << i;
+    EXPECT_EQ(events[i].prefetch, act.prefetch.size()) << i;
+  }
+  EXPECT_EQ(events[0].alloc, 1u); // id 3
+
+  for (uint32_t id : {1u, 2u, 5u})
+    test_free(nullptr, buffers[id]);
+}
+
+TEST(FhnTrace, SummaryAndHistogram) {
+  FhnTrace trace;
+  for (uint64_t d : {100u, 200u, 300u, 400u, 5000u}) {
+    fhenomenon::FhnTraceEvent e;
+    e.opcode = FHN_ADD_CC;
+    e.duration_ns = d;
+    trace.record(e);
+  }
+  fhenomenon::FhnTraceEvent big;
+  big.opcode = FHN_HMULT;
+  big.decomposed = true;
+  big.duration_ns = 100000;
+  trace.record(big);
+
+  const auto summary = trace.summarize();
+  ASSERT_EQ(summary.size(), 2u);
+  EXPECT_EQ(summary[0].opcode, FHN_HMULT); // heaviest first
+  EXPECT_EQ(summary[0].decomposed, 1u);
+  const auto &add = summary[1];
+  EXPECT_EQ(add.count, 5u);
+  EXPECT_EQ(add.total_ns, 6000u);
+  EXPECT_EQ(add.p50_ns, 300u);
+  EXPECT_EQ(add.p90_ns, 5000u);
+  EXPECT_EQ(add.max_ns, 5000u);
+  uint32_t bucketed = 0;
+  for (uint32_t c : add.buckets)
+    bucketed += c;
+  EXPECT_EQ(bucketed, 5u);
+  EXPECT_EQ(add.buckets[6], 1u); // 100 ns in [64, 128)
+  EXPECT_EQ(add.buckets[12], 1u); // 5000 ns in [4096, 8192)
+
+  const std::string text = trace.histogramText();
+  EXPECT_NE(text.find("HMULT"), std::string::npos);
+  EXPECT_NE(text.find("ADD_CC"), std::string::npos);
+  EXPECT_LT(text.find("HMULT"), text.find("ADD_CC"));
+}
+
+TEST(FhnTrace, ChromeJsonCarriesTracksAndEscapesNames) {
+  FhnTrace trace;
+  trace.beginTrack("shape \"a\"");
+  fhenomenon::FhnTraceEvent e;
+  e.opcode = FHN_ROTATE;
+  e.start_ns = 2500;
+  e.duration_ns = 1500;
+  e.movement_ns = 500;
+  e.num_kernels = 1;
+  e.kernels[0] = "rot\\ate";
+  e.alloc = 2;
+  trace.record(e);
+  EXPECT_EQ(trace.events()[0].track, 1u);
+
+  const std::string json = trace.chromeJson();
+  EXPECT_NE(json.find("\"traceEvents\""), std::string::npos);
+  EXPECT_NE(json.find("\"name\":\"shape \\\"a\\\"\""), std::string::npos);
+  const std::string rotate_event = "\"name\":\"ROTATE\",\"cat\":\"kernel\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+                                   "\"ts\":2.500,\"dur\":1.500";
+  EXPECT_NE(json.find(rotate_event), std::string::npos);
+  EXPECT_NE(json.find("\"name\":\"movement\""), std::string::npos);
+  EXPECT_NE(json.find("\"ts\":2.000,\"dur\":0.500"), std::string::npos);
+  EXPECT_NE(json.find("\"kernel\":\"rot\\\\ate\""), std::string::npos);
+  EXPECT_NE(json.find("\"alloc\":2"), std::string::npos);
+
+  const std::string path = testing::TempDir() + "fhn_trace_test.json";
+  ASSERT_EQ(trace.writeChromeJson(path), 0);
+  std::ifstream in(path);
+  std::stringstream read;
+  read << in.rdbuf();
+  EXPECT_EQ(read.str(), json);
+  std::remove(path.c_str());
+
+  trace.clear();
+  EXPECT_TRUE(trace.events().empty());
+  EXPECT_EQ(trace.chromeJson().find("shape"), std::string::npos);
+}
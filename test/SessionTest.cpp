@@ -1,3 +1,4 @@
+#include "FHN/FhnPlanCache.h"
 #include "Fhenomenon.h"
 #include "Parameter/ParameterGen.h"
 #include "Profile.h"
@@ -249,3 +250,83 @@ TEST(SessionTest, AliasedWriteBackTargetsShareOneBuffer) {
   EXPECT_EQ(a.decrypt(), 7);
   EXPECT_EQ(b.decrypt(), 7);
 }
+
+// A second run recording the same shape over different values skips
+// fusion and planning: the backend's plan cache serves it.
+TEST(SessionTest, RepeatedShapeHitsThePlanCache) {
+  const FhnRuntime *runtime = Backend::getInstance().fhnRuntime();
+  if (!runtime || !runtime->plan_cache) {
+    GTEST_SKIP() << "backend has no FHN plan cache";
+  }
+  auto profile = makeProfile();
+  auto session = Session::create(Backend::getInstance());
+  const auto before = runtime->plan_cache->stats();
+
+  const int expected[] = {80, 380};
+  for (int round = 0; round < 2; ++round) {
+    Fhenon<int> a = 3 + 6 * round;
+    Fhenon<int> b = 5 * (round + 1);
+    a.belong(profile);
+    b.belong(profile);
+    session->run([&]() {
+      a = a + b;
+      a = a + a;
+      a = a * b;
+    });
+    EXPECT_EQ(a.decrypt(), expected[round]) << round;
+  }
+
+  const auto after = runtime->plan_cache->stats();
+  EXPECT_EQ(after.hits - before.hits, 1u);
+  EXPECT_EQ(after.misses - before.misses, 1u);
+}
+
+// runAsync() submits and returns; results land at sync(). Encrypting the
+// next input in between must not disturb the in-flight run.
+TEST(SessionTest, RunAsyncWritesBackAtSync) {
+  auto profile = makeProfile();
+  auto session = Session::create(Backend::getInstance());
+
+  Fhenon<int> a = 4;
+  Fhenon<int> b = 5;
+  Fhenon<int> c = 0;
+  a.belong(profile);
+  b.belong(profile);
+  c.belong(profile);
+
+  session->runAsync([&]() {
+    c = a * b;
+    c = c + a; // 24
+    b = a;     // write-back to an input's value
+  });
+  EXPECT_TRUE(session->hasPendingRun());
+
+  Fhenon<int> d = 100;
+  d.belong(profile);
+
+  session->sync();
+  EXPECT_FALSE(session->hasPendingRun());
+  EXPECT_EQ(c.decrypt(), 24);
+  EXPECT_EQ(b.decrypt(), 4);
+  EXPECT_EQ(a.decrypt(), 4);
+
+  session->sync(); // nothing pending: no-op
+  EXPECT_EQ(c.decrypt(), 24);
+  EXPECT_EQ(d.decrypt(), 100);
+}
+
+// A new recording completes the pending one first, so it reads the
+// written-back values.
+TEST(SessionTest, RunAfterRunAsyncSeesItsResults) {
+  auto profile = makeProfile();
+  auto session = Session::create(Backend::getInstance());
+
+  Fhenon<int> a = 1;
+  a.belong(profile);
+
+  session->runAsync([&]() { a = a + 2; });
+  session->runAsync([&]() { a = a * 5; });
+  session->run([&]() { a = a + 1; });
+  EXPECT_FALSE(session->hasPendingRun());
+  EXPECT_EQ(a.decrypt(), 16);
+}
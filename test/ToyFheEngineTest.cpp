@@ -1,7 +1,11 @@
 #include "Crypto/ToyFHE.h"
 
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
 
 using namespace fhenomenon::toyfhe;
 
@@ -92,3 +96,434 @@ TEST_F(ToyFheEngineTest, MultiplyPlainFractionalScalarRescales) {
   }
   EXPECT_NEAR(engine_.decryptDouble(ct), 4.0, 1e-3);
 }
+
+TEST_F(ToyFheEngineTest, SeededEnginesShareKeys) {
+  Engine a;
+  Engine b;
+  a.initialize(Parameters{});
+  b.initialize(Parameters{});
+  a.generateKeys(42);
+  b.generateKeys(42);
+  EXPECT_EQ(b.decryptInt(a.add(a.encryptInt(1200), b.encryptInt(34))), 1234);
+}
+
+TEST_F(ToyFheEngineTest, VectorOpsMatchSingleSlotOps) {
+  const int64_t xs[] = {7, -3, 0, 120, 999, -999, 42, 5, 11};
+  const int64_t ys[] = {2, 3, -8, 1, 1, 999, -42, 6, 0};
+  const std::size_t n = 9;
+  const auto x = engine_.encryptIntVec(xs, n);
+  const auto y = engine_.encryptIntVec(ys, n);
+  ASSERT_EQ(x.size(), n);
+
+  CiphertextVec sum, diff, neg, product, scaled;
+  engine_.addVec(x, y, sum);
+  engine_.subVec(x, y, diff);
+  engine_.negateVec(x, neg);
+  engine_.multiplyVec(x, y, product);
+  engine_.multiplyPlainVec(x, -3.0, scaled);
+  for (std::size_t i = 0; i < n; ++i) {
+    EXPECT_EQ(engine_.decryptInt(sum.slot(i)), xs[i] + ys[i]);
+    EXPECT_EQ(engine_.decryptInt(diff.slot(i)), xs[i] - ys[i]);
+    EXPECT_EQ(engine_.decryptInt(neg.slot(i)), -xs[i]);
+    EXPECT_EQ(engine_.decryptInt(product.slot(i)), xs[i] * ys[i]);
+    EXPECT_EQ(engine_.decryptInt(scaled.slot(i)), -3 * xs[i]);
+  }
+
+  std::vector<int64_t> decrypted(n);
+  engine_.decryptIntVec(sum, decrypted.data());
+  EXPECT_EQ(decrypted[3], 121);
+}
+
+TEST_F(ToyFheEngineTest, VectorOpsAgreeAcrossIsas) {
+  std::vector<int64_t> values(37);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<int64_t>(i * i) - 300;
+  }
+  const auto x = engine_.encryptIntVec(values.data(), values.size());
+  const auto y = engine_.encryptIntVec(values.data(), values.size());
+
+  ASSERT_TRUE(engine_.setSimdIsa(simd::Isa::Scalar));
+  CiphertextVec expected;
+  engine_.subVec(x, y, expected);
+  engine_.rotateAddVec(expected, 5, x, expected);
+  engine_.multiplyPlainVec(expected, 7.0, expected);
+  for (simd::Isa isa : {simd::Isa::Avx2, simd::Isa::Avx512}) {
+    if (!engine_.setSimdIsa(isa)) {
+      continue;
+    }
+    CiphertextVec got;
+    engine_.subVec(x, y, got);
+    engine_.rotateAddVec(got, 5, x, got);
+    engine_.multiplyPlainVec(got, 7.0, got);
+    EXPECT_EQ(got.c0, expected.c0) << simd::name(isa);
+    EXPECT_EQ(got.c1, expected.c1) << simd::name(isa);
+  }
+}
+
+TEST_F(ToyFheEngineTest, VectorAddAlignsScalesAndRejectsMismatchedSizes) {
+  CiphertextVec fixed;
+  fixed.resize(3);
+  for (std::size_t i = 0; i < 3; ++i) {
+    const auto slot = engine_.encryptDouble(0.5 + static_cast<double>(i));
+    fixed.c0[i] = slot.c0;
+    fixed.c1[i] = slot.c1;
+    fixed.scale_power = slot.scale_power;
+    fixed.encoding = slot.encoding;
+  }
+  const int64_t ints[] = {1, 2, 3};
+  const auto integers = engine_.encryptIntVec(ints, 3);
+
+  CiphertextVec sum;
+  engine_.addVec(integers, fixed, sum);
+  EXPECT_EQ(sum.scale_power, fixed.scale_power);
+  EXPECT_EQ(sum.encoding, Encoding::FixedPoint);
+  EXPECT_NEAR(engine_.decryptDouble(sum.slot(2)), 5.5, 1e-3);
+
+  EXPECT_THROW(engine_.addVec(integers, engine_.encryptIntVec(ints, 2), sum), std::runtime_error);
+}
+
+// Raising an operand's scale runs block by block inside the add: check
+// past several blocks, with a rotated operand and in place.
+TEST_F(ToyFheEngineTest, VectorAddLiftsScalesBlockwise) {
+  constexpr std::size_t n = 700;
+  std::vector<int64_t> ints(n);
+  std::vector<double> doubles(n);
+  CiphertextVec fixed;
+  fixed.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    ints[i] = static_cast<int64_t>(i % 9) - 4;
+    doubles[i] = 0.25 * static_cast<double>(i % 8);
+    const auto slot = engine_.encryptDouble(doubles[i]);
+    fixed.c0[i] = slot.c0;
+    fixed.c1[i] = slot.c1;
+    fixed.scale_power = slot.scale_power;
+    fixed.encoding = slot.encoding;
+  }
+  const auto integers = engine_.encryptIntVec(ints.data(), n);
+
+  CiphertextVec sum;
+  engine_.rotateAddVec(integers, 5, fixed, sum);
+  CiphertextVec difference = integers;
+  engine_.subVec(difference, fixed, difference);
+  EXPECT_EQ(sum.scale_power, fixed.scale_power);
+  EXPECT_EQ(difference.scale_power, fixed.scale_power);
+  for (std::size_t i = 0; i < n; ++i) {
+    EXPECT_NEAR(engine_.decryptDouble(sum.slot(i)), static_cast<double>(ints[(i + 5) % n]) + doubles[i], 1e-3);
+    EXPECT_NEAR(engine_.decryptDouble(difference.slot(i)), static_cast<double>(ints[i]) - doubles[i], 1e-3);
+  }
+}
+
+TEST_F(ToyFheEngineTest, RotateAddVecRotatesLeftAndMayWriteInPlace) {
+  const int64_t xs[] = {10, 20, 30, 40, 50};
+  const int64_t ones[] = {1, 1, 1, 1, 1};
+  auto x = engine_.encryptIntVec(xs, 5);
+  const auto y = engine_.encryptIntVec(ones, 5);
+
+  engine_.rotateAddVec(x, 7, y, x); // 7 mod 5 = 2
+  std::vector<int64_t> got(5);
+  engine_.decryptIntVec(x, got.data());
+  EXPECT_EQ(got, (std::vector<int64_t>{31, 41, 51, 11, 21}));
+}
+
+TEST_F(ToyFheEngineTest, VectorOpsReadRotatedViews) {
+  const std::size_t n = 11;
+  std::vector<int64_t> xs(n);
+  std::vector<int64_t> ys(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    xs[i] = static_cast<int64_t>(i * 7) - 30;
+    ys[i] = static_cast<int64_t>(i % 4) - 1;
+  }
+  const auto x = engine_.encryptIntVec(xs.data(), n);
+  const auto y = engine_.encryptIntVec(ys.data(), n);
+  auto rot = [&](const std::vector<int64_t> &v, std::size_t d, std::size_t i) { return v[(i + d) % n]; };
+
+  // Every pair of rotations, including ones whose runs split at different
+  // slots, against the materialized rotation.
+  for (std::size_t dx : {std::size_t{0}, std::size_t{3}, std::size_t{10}}) {
+    for (std::size_t dy : {std::size_t{0}, std::size_t{1}, std::size_t{6}}) {
+      const VecView vx(x, dx);
+      const VecView vy(y, dy);
+      CiphertextVec sum, diff, neg, product, scaled, plain;
+      engine_.addVec(vx, vy, sum);
+      engine_.subVec(vx, vy, diff);
+      engine_.negateVec(vx, neg);
+      engine_.multiplyVec(vx, vy, product);
+      engine_.multiplyPlainVec(vx, 3.0, scaled);
+      Engine::materializeVec(vx, plain);
+      std::vector<int64_t> got(n);
+      engine_.decryptIntVec(vy, got.data());
+      for (std::size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(engine_.decryptInt(sum.slot(i)), rot(xs, dx, i) + rot(ys, dy, i)) << dx << "/" << dy << " @" << i;
+        ASSERT_EQ(engine_.decryptInt(diff.slot(i)), rot(xs, dx, i) - rot(ys, dy, i));
+        ASSERT_EQ(engine_.decryptInt(neg.slot(i)), -rot(xs, dx, i));
+        ASSERT_EQ(engine_.decryptInt(product.slot(i)), rot(xs, dx, i) * rot(ys, dy, i));
+        ASSERT_EQ(engine_.decryptInt(scaled.slot(i)), 3 * rot(xs, dx, i));
+        ASSERT_EQ(engine_.decryptInt(plain.slot(i)), rot(xs, dx, i));
+        ASSERT_EQ(got[i], rot(ys, dy, i));
+      }
+    }
+  }
+}
+
+TEST_F(ToyFheEngineTest, VectorOpsWriteOverTheirOwnRotatedView) {
+  const int64_t xs[] = {1, 2, 3, 4, 5, 6, 7};
+  const int64_t ys[] = {10, 20, 30, 40, 50, 60, 70};
+  const auto x = engine_.encryptIntVec(xs, 7);
+  const auto y = engine_.encryptIntVec(ys, 7);
+  std::vector<int64_t> got(7);
+
+  auto acc = x;
+  engine_.addVec(VecView(acc, 2), y, acc);
+  engine_.decryptIntVec(acc, got.data());
+  EXPECT_EQ(got, (std::vector<int64_t>{13, 24, 35, 46, 57, 61, 72}));
+
+  acc = x;
+  engine_.subVec(y, VecView(acc, 5), acc);
+  engine_.decryptIntVec(acc, got.data());
+  EXPECT_EQ(got, (std::vector<int64_t>{4, 13, 29, 38, 47, 56, 65}));
+
+  acc = x;
+  engine_.multiplyVec(VecView(acc, 1), VecView(acc, 6), acc);
+  engine_.decryptIntVec(acc, got.data());
+  EXPECT_EQ(got, (std::vector<int64_t>{14, 3, 8, 15, 24, 35, 6}));
+
+  acc = x;
+  engine_.negateVec(VecView(acc, 3), acc);
+  engine_.decryptIntVec(acc, got.data());
+  EXPECT_EQ(got, (std::vector<int64_t>{-4, -5, -6, -7, -1, -2, -3}));
+
+  acc = x;
+  Engine::materializeVec(VecView(acc, 4), acc);
+  engine_.decryptIntVec(acc, got.data());
+  EXPECT_EQ(got, (std::vector<int64_t>{5, 6, 7, 1, 2, 3, 4}));
+}
+
+TEST_F(ToyFheEngineTest, RejectsUnsupportedSimdIsa) {
+  EXPECT_EQ(engine_.simdIsa(), simd::best());
+  EXPECT_TRUE(engine_.setSimdIsa(simd::Isa::Scalar));
+  EXPECT_EQ(engine_.simdIsa(), simd::Isa::Scalar);
+  if (!simd::supported(simd::Isa::Avx512)) {
+    EXPECT_FALSE(engine_.setSimdIsa(simd::Isa::Avx512));
+    EXPECT_EQ(engine_.simdIsa(), simd::Isa::Scalar);
+  }
+}
+
+TEST_F(ToyFheEngineTest, SelectsModReductionFromParameters) {
+  EXPECT_EQ(engine_.modReduction(), ModReduction::PowerOfTwo);
+
+  Parameters even;
+  even.q = (static_cast<int64_t>(1) << 58) + (static_cast<int64_t>(1) << 32);
+  Engine evenEngine;
+  evenEngine.initialize(even);
+  EXPECT_EQ(evenEngine.modReduction(), ModReduction::Barrett);
+
+  Parameters odd;
+  odd.t = 3486784401; // 3^20
+  odd.q = odd.t * ((static_cast<int64_t>(1) << 26) + 1);
+  Engine oddEngine;
+  oddEngine.initialize(odd);
+  EXPECT_EQ(oddEngine.modReduction(), ModReduction::Montgomery);
+
+  Parameters forced;
+  forced.reduction = ModReduction::Barrett;
+  Engine forcedEngine;
+  forcedEngine.initialize(forced);
+  EXPECT_EQ(forcedEngine.modReduction(), ModReduction::Barrett);
+}
+
+TEST_F(ToyFheEngineTest, RejectsReductionTheModulusCannotTake) {
+  Parameters even;
+  even.q = (static_cast<int64_t>(1) << 58) + (static_cast<int64_t>(1) << 32);
+  even.reduction = ModReduction::PowerOfTwo;
+  Engine engine;
+  EXPECT_THROW(engine.initialize(even), std::runtime_error);
+
+  Parameters montgomery;
+  montgomery.reduction = ModReduction::Montgomery;
+  EXPECT_THROW(engine.initialize(montgomery), std::runtime_error);
+}
+
+TEST_F(ToyFheEngineTest, EveryReductionComputesTheSameResults) {
+  Parameters odd;
+  odd.t = 3486784401; // 3^20
+  odd.q = odd.t * ((static_cast<int64_t>(1) << 26) + 1);
+  for (const Parameters &base : {Parameters{}, odd}) {
+    for (ModReduction reduction :
+         {ModReduction::Auto, ModReduction::PowerOfTwo, ModReduction::Barrett, ModReduction::Montgomery}) {
+      Parameters params = base;
+      params.reduction = reduction;
+      Engine engine;
+      try {
+        engine.initialize(params);
+      } catch (const std::runtime_error &) {
+        continue; // policy does not fit this q
+      }
+      engine.generateKeys(11);
+      SCOPED_TRACE(modReductionName(engine.modReduction()));
+      auto ct = engine.multiplyPlain(engine.add(engine.encryptInt(-321), engine.encryptInt(21)), -4.0);
+      EXPECT_EQ(engine.decryptInt(ct), 1200);
+      EXPECT_EQ(engine.decryptInt(engine.multiply(ct, engine.encryptInt(-3))), -3600);
+      EXPECT_NEAR(engine.decryptDouble(engine.addPlain(engine.encryptDouble(1.25), 2.5)), 3.75, 1e-3);
+    }
+  }
+}
+
+// Runs every slot range as chunks of 100, each on its own thread.
+class ThreadPerChunkRunner : public SlotRunner {
+  public:
+  void run(std::size_t n, std::size_t, Chunk chunk, void *arg) override {
+    std::vector<std::thread> threads;
+    for (std::size_t begin = 0; begin < n; begin += 100)
+      threads.emplace_back(chunk, arg, begin, std::min(n, begin + 100));
+    for (std::thread &thread : threads)
+      thread.join();
+    ++calls;
+  }
+  int calls = 0;
+};
+
+TEST_F(ToyFheEngineTest, BulkEncryptionIsThreadCountInvariant) {
+  const std::size_t n = 3 * 4096 + 17;
+  std::vector<int64_t> values(n);
+  for (std::size_t i = 0; i < n; ++i)
+    values[i] = static_cast<int64_t>(i * 7919 % 200001) - 100000;
+
+  std::vector<int64_t> c0(n), c1(n), c0_threaded(n), c1_threaded(n);
+  engine_.seedBulkEncryption(5);
+  engine_.encryptIntBulk(values.data(), n, c0.data(), c1.data());
+  ThreadPerChunkRunner runner;
+  engine_.setSlotRunner(&runner);
+  engine_.seedBulkEncryption(5);
+  engine_.encryptIntBulk(values.data(), n, c0_threaded.data(), c1_threaded.data());
+  EXPECT_EQ(runner.calls, 1); // the range split through the runner, not threads of its own
+  EXPECT_EQ(c0, c0_threaded);
+  EXPECT_EQ(c1, c1_threaded);
+  for (std::size_t i = 0; i < n; ++i)
+    ASSERT_EQ(engine_.decryptInt(Ciphertext{c0[i], c1[i], 0, Encoding::Integer}), values[i]) << "slot " << i;
+
+  // The next call continues the stream: fresh randomness for equal inputs.
+  engine_.encryptIntBulk(values.data(), n, c0_threaded.data(), c1_threaded.data());
+  engine_.setSlotRunner(nullptr);
+  EXPECT_NE(c1, c1_threaded);
+}
+
+TEST_F(ToyFheEngineTest, VectorOpsAreSplitInvariantUnderASlotRunner) {
+  const std::size_t n = 1234;
+  std::vector<int64_t> values(n);
+  for (std::size_t i = 0; i < n; ++i)
+    values[i] = static_cast<int64_t>(i % 19) - 9;
+  // Seeded, so the multiplies draw the same fresh masks on every pass.
+  auto evaluate = [&] {
+    engine_.seedBulkEncryption(9);
+    std::vector<CiphertextVec> r(6);
+    r[0] = engine_.encryptIntVec(values.data(), n);
+    engine_.multiplyVec(r[0], VecView(r[0], 7), r[1]);
+    engine_.multiplyPlainVec(r[1], 0.5, r[2]);
+    engine_.rotateAddVec(r[0], 3, r[2], r[3]);
+    engine_.subVec(r[3], r[0], r[4]);
+    engine_.negateVec(VecView(r[4], 11), r[5]);
+    engine_.multiplyPlainVec(r[5], 3.0, r[5]);
+    return r;
+  };
+  const std::vector<CiphertextVec> serial = evaluate();
+  ThreadPerChunkRunner runner;
+  engine_.setSlotRunner(&runner);
+  const std::vector<CiphertextVec> split = evaluate();
+  std::vector<int64_t> products(n);
+  engine_.decryptIntVec(split[1], products.data());
+  engine_.setSlotRunner(nullptr);
+
+  EXPECT_EQ(runner.calls, 8); // one per operation above, decryption included
+  for (std::size_t k = 0; k < serial.size(); ++k) {
+    EXPECT_EQ(split[k].c0, serial[k].c0) << "result " << k;
+    EXPECT_EQ(split[k].c1, serial[k].c1) << "result " << k;
+    EXPECT_EQ(split[k].scale_power, serial[k].scale_power) << "result " << k;
+  }
+  for (std::size_t i = 0; i < n; ++i)
+    ASSERT_EQ(products[i], values[i] * values[(i + 7) % n]) << "slot " << i;
+}
+
+TEST_F(ToyFheEngineTest, BatchedVectorOpsMatchSingleCalls) {
+  const std::size_t n = 300; // requests straddle the runner's chunks
+  std::vector<int64_t> values(n + 2);
+  for (std::size_t i = 0; i < values.size(); ++i)
+    values[i] = static_cast<int64_t>(i % 13) - 6;
+  engine_.seedBulkEncryption(4);
+  std::vector<CiphertextVec> in(3);
+  for (std::size_t r = 0; r < in.size(); ++r)
+    in[r] = engine_.encryptIntVec(values.data() + r, n);
+  CiphertextVec lifted;
+  engine_.multiplyPlainVec(in[2], 0.5, lifted);
+
+  // Request r multiplies, then adds, in[r] rotated by r and in[(r + 1) % 3];
+  // request 0 writes over its lhs. With `lift`, request 1's rhs sits at a
+  // higher scale, so the batch runs request by request.
+  auto evaluate = [&](bool batched, bool lift) {
+    engine_.seedBulkEncryption(5);
+    std::vector<CiphertextVec> products(3), sums(3);
+    products[0] = in[0];
+    std::vector<VecView> lhs, rhs;
+    std::vector<CiphertextVec *> productOut, sumOut;
+    for (std::size_t r = 0; r < 3; ++r) {
+      lhs.push_back(r == 0 ? VecView(products[0]) : VecView(in[r], r));
+      rhs.push_back(lift && r == 1 ? VecView(lifted) : VecView(in[(r + 1) % 3]));
+      productOut.push_back(&products[r]);
+      sumOut.push_back(&sums[r]);
+    }
+    if (batched) {
+      engine_.multiplyVecBatch(lhs.data(), rhs.data(), productOut.data(), 3);
+      engine_.addVecBatch(lhs.data(), rhs.data(), sumOut.data(), 3);
+    } else {
+      for (std::size_t r = 0; r < 3; ++r)
+        engine_.multiplyVec(lhs[r], rhs[r], products[r]);
+      for (std::size_t r = 0; r < 3; ++r)
+        engine_.addVec(lhs[r], rhs[r], sums[r]);
+    }
+    return std::make_pair(products, sums);
+  };
+  ThreadPerChunkRunner runner;
+  engine_.setSlotRunner(&runner);
+  for (bool lift : {false, true}) {
+    const auto single = evaluate(false, lift);
+    runner.calls = 0;
+    const auto batch = evaluate(true, lift);
+    EXPECT_EQ(runner.calls, lift ? 6 : 2);
+    for (std::size_t r = 0; r < 3; ++r) {
+      EXPECT_EQ(batch.first[r].c0, single.first[r].c0) << "product " << r;
+      EXPECT_EQ(batch.first[r].c1, single.first[r].c1) << "product " << r;
+      EXPECT_EQ(batch.first[r].scale_power, single.first[r].scale_power) << "product " << r;
+      EXPECT_EQ(batch.second[r].c0, single.second[r].c0) << "sum " << r;
+      EXPECT_EQ(batch.second[r].scale_power, single.second[r].scale_power) << "sum " << r;
+    }
+  }
+  engine_.setSlotRunner(nullptr);
+
+  const auto batch = evaluate(true, false);
+  std::vector<int64_t> got(n);
+  engine_.decryptIntVec(batch.first[1], got.data());
+  for (std::size_t i = 0; i < n; ++i)
+    ASSERT_EQ(got[i], values[1 + (i + 1) % n] * values[2 + i]) << "slot " << i;
+}
+
+TEST_F(ToyFheEngineTest, BulkEncryptionFeedsVectorsOnEveryReduction) {
+  Parameters odd;
+  odd.t = 3486784401; // 3^20
+  odd.q = odd.t * ((static_cast<int64_t>(1) << 26) + 1);
+  const int64_t xs[] = {7, -3, 0, 120, 999, -999, 42, 5, 11};
+  for (const Parameters &params : {Parameters{}, odd}) {
+    Engine engine;
+    engine.initialize(params);
+    engine.generateKeys(3);
+    const CiphertextVec x = engine.encryptIntVec(xs, 9);
+    CiphertextVec product;
+    engine.multiplyVec(x, x, product);
+    for (std::size_t i = 0; i < 9; ++i) {
+      EXPECT_EQ(engine.decryptInt(x.slot(i)), xs[i]);
+      EXPECT_EQ(engine.decryptInt(product.slot(i)), xs[i] * xs[i]);
+    }
+  }
+  Engine keyless;
+  keyless.initialize(Parameters{});
+  int64_t c0 = 0, c1 = 0;
+  EXPECT_THROW(keyless.encryptIntBulk(xs, 1, &c0, &c1), std::runtime_error);
+}
@@ -0,0 +1,86 @@
+#include "Crypto/ToyFheModArith.h"
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+using namespace fhenomenon::toyfhe;
+
+namespace {
+
+const int64_t kOne = 1;
+
+// Schoolbook a * b mod q by doubling, independent of every policy.
+int64_t referenceMul(int64_t a, int64_t b, int64_t q) {
+  const uint64_t uq = static_cast<uint64_t>(q);
+  uint64_t x = static_cast<uint64_t>(((a % q) + q) % q);
+  uint64_t y = static_cast<uint64_t>(((b % q) + q) % q);
+  uint64_t r = 0;
+  while (y > 0) {
+    if (y & 1) {
+      r += x;
+      if (r >= uq)
+        r -= uq;
+    }
+    x += x;
+    if (x >= uq)
+      x -= uq;
+    y >>= 1;
+  }
+  return static_cast<int64_t>(r);
+}
+
+int64_t referenceReduce(int64_t value, int64_t q) {
+  const int64_t r = value % q;
+  return r < 0 ? r + q : r;
+}
+
+// Edge residues and their negations, plus random ones.
+std::vector<int64_t> operands(int64_t q) {
+  std::vector<int64_t> values = {0, 1, 2, q - 1, q - 2, q / 2, -1, -(q - 1), q, q + 1, 2 * q - 1};
+  std::mt19937_64 rng(static_cast<uint64_t>(q));
+  std::uniform_int_distribution<int64_t> dist(0, q - 1);
+  for (int i = 0; i < 64; ++i)
+    values.push_back(dist(rng));
+  return values;
+}
+
+template <typename Modulus> void expectMatchesReference(const Modulus &m) {
+  const int64_t q = m.modulus();
+  for (int64_t a : operands(q)) {
+    EXPECT_EQ(m.reduce(a), referenceReduce(a, q)) << "reduce(" << a << ") mod " << q;
+    for (int64_t b : operands(q)) {
+      ASSERT_EQ(m.mul(a, b), referenceMul(a, b, q)) << a << " * " << b << " mod " << q;
+    }
+  }
+}
+
+} // namespace
+
+TEST(ToyFheModArithTest, PowerOfTwoMatchesReference) {
+  for (int k : {1, 16, 32, 58, 62}) {
+    expectMatchesReference(PowerOfTwoModulus(kOne << k));
+  }
+}
+
+TEST(ToyFheModArithTest, BarrettMatchesReference) {
+  // Power-of-two q included: mu is at its widest there (q = 2^62).
+  for (int64_t q : {int64_t{2}, int64_t{3}, int64_t{1000003}, (kOne << 58) + (kOne << 32), (kOne << 61) - 1,
+                    (kOne << 62) - 57, kOne << 62, kOne << 58}) {
+    expectMatchesReference(BarrettModulus(q));
+  }
+}
+
+TEST(ToyFheModArithTest, MontgomeryMatchesReference) {
+  for (int64_t q : {int64_t{3}, int64_t{1000003}, int64_t{3486784401} * ((kOne << 26) + 1), (kOne << 61) - 1,
+                    (kOne << 62) - 57}) {
+    expectMatchesReference(MontgomeryModulus(q));
+  }
+}
+
+TEST(ToyFheModArithTest, NamesEveryPolicy) {
+  EXPECT_STREQ(modReductionName(ModReduction::Auto), "auto");
+  EXPECT_STREQ(modReductionName(ModReduction::PowerOfTwo), "power-of-two");
+  EXPECT_STREQ(modReductionName(ModReduction::Barrett), "barrett");
+  EXPECT_STREQ(modReductionName(ModReduction::Montgomery), "montgomery");
+}
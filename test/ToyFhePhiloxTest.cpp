@@ -0,0 +1,53 @@
+#include "Crypto/ToyFhePhilox.h"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace fhenomenon::toyfhe;
+
+namespace {
+
+// Key (k0, k1) and counter (c0..c3) as the 32-bit words of Philox4x32's
+// reference; the class packs them as key = k1:k0, index = c1:c0,
+// stream = c3:c2.
+std::array<uint32_t, 4> reference(uint32_t k0, uint32_t k1, uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3) {
+  const Philox4x32 philox((static_cast<uint64_t>(k1) << 32) | k0);
+  return philox.block((static_cast<uint64_t>(c1) << 32) | c0, (static_cast<uint64_t>(c3) << 32) | c2);
+}
+
+} // namespace
+
+// Known-answer vectors of the Random123 distribution (philox4x32_10).
+TEST(ToyFhePhiloxTest, MatchesKnownAnswers) {
+  EXPECT_EQ(reference(0, 0, 0, 0, 0, 0), (std::array<uint32_t, 4>{0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u}));
+  EXPECT_EQ(reference(0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu),
+            (std::array<uint32_t, 4>{0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu}));
+  EXPECT_EQ(reference(0xa4093822u, 0x299f31d0u, 0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u),
+            (std::array<uint32_t, 4>{0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u}));
+}
+
+// Every Isa, any offset and any length (lane blocks plus a tail) produce
+// exactly the blocks one at a time.
+TEST(ToyFhePhiloxTest, FillMatchesBlockOnEveryIsa) {
+  const Philox4x32 philox(0x0123456789abcdefULL);
+  for (simd::Isa isa : {simd::Isa::Scalar, simd::Isa::Avx2, simd::Isa::Avx512}) {
+    for (std::size_t count : {std::size_t{1}, std::size_t{15}, std::size_t{16}, std::size_t{77}}) {
+      const uint64_t first = 0xfffffffaULL; // crosses into the counter's high word
+      std::vector<uint64_t> lo(count);
+      std::vector<uint64_t> hi(count);
+      philox.fill(first, count, 9, lo.data(), hi.data(), isa);
+      for (std::size_t i = 0; i < count; ++i) {
+        const std::array<uint32_t, 4> block = philox.block(first + i, 9);
+        ASSERT_EQ(lo[i], block[0] | (static_cast<uint64_t>(block[1]) << 32)) << simd::name(isa) << " block " << i;
+        ASSERT_EQ(hi[i], block[2] | (static_cast<uint64_t>(block[3]) << 32)) << simd::name(isa) << " block " << i;
+      }
+    }
+  }
+}
+
+TEST(ToyFhePhiloxTest, StreamsAndKeysDiffer) {
+  const Philox4x32 philox(1);
+  EXPECT_NE(philox.block(0, 0), philox.block(0, 1));
+  EXPECT_NE(philox.block(0, 0), philox.block(1, 0));
+  EXPECT_NE(philox.block(0, 0), Philox4x32(2).block(0, 0));
+}
@@ -0,0 +1,274 @@
+#include "Crypto/ToyFheRlwe.h"
+
+#include <gtest/gtest.h>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace fhenomenon::toyfhe;
+
+namespace {
+
+const RlweParameters kDefaults{};
+
+// Schoolbook a * b mod (X^n + 1, q).
+std::vector<uint64_t> negacyclicProduct(const std::vector<uint64_t> &a, const std::vector<uint64_t> &b, int64_t q) {
+  const BarrettModulus m(q);
+  const std::size_t n = a.size();
+  std::vector<int64_t> acc(n, 0);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      const int64_t term = m.mul(static_cast<int64_t>(a[i]), static_cast<int64_t>(b[j]));
+      const std::size_t k = (i + j) % n;
+      acc[k] = m.reduce(i + j < n ? acc[k] + term : acc[k] - term);
+    }
+  }
+  return std::vector<uint64_t>(acc.begin(), acc.end());
+}
+
+std::vector<uint64_t> randomPoly(std::size_t n, int64_t q, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::uniform_int_distribution<uint64_t> dist(0, static_cast<uint64_t>(q) - 1);
+  std::vector<uint64_t> poly(n);
+  for (uint64_t &c : poly)
+    c = dist(rng);
+  return poly;
+}
+
+class RlweEngineTest : public ::testing::Test {
+  protected:
+  void SetUp() override {
+    RlweParameters params;
+    params.ring_dim = 64;
+    engine_.initialize(params);
+    engine_.generateKeys(11);
+  }
+
+  std::vector<int64_t> roundTrip(const RlweCiphertext &cipher) const {
+    std::vector<int64_t> out(cipher.slots);
+    engine_.decrypt(cipher, out.data());
+    return out;
+  }
+
+  RlweEngine engine_;
+};
+
+} // namespace
+
+TEST(ToyFheRlweNttTest, InverseUndoesForward) {
+  for (std::size_t n : {std::size_t{16}, std::size_t{1024}}) {
+    const RlweNtt ntt(n, kDefaults.q);
+    const std::vector<uint64_t> poly = randomPoly(n, kDefaults.q, n);
+    std::vector<uint64_t> work = poly;
+    ntt.forward(work.data());
+    EXPECT_NE(work, poly);
+    ntt.inverse(work.data());
+    EXPECT_EQ(work, poly);
+  }
+}
+
+TEST(ToyFheRlweNttTest, PointwiseProductIsNegacyclicConvolution) {
+  for (int64_t q : {kDefaults.q, kDefaults.t}) {
+    const std::size_t n = 32;
+    const RlweNtt ntt(n, q);
+    const std::vector<uint64_t> a = randomPoly(n, q, 1);
+    const std::vector<uint64_t> b = randomPoly(n, q, 2);
+    std::vector<uint64_t> fa = a;
+    std::vector<uint64_t> fb = b;
+    ntt.forward(fa.data());
+    ntt.forward(fb.data());
+    const BarrettModulus m(q);
+    for (std::size_t i = 0; i < n; ++i)
+      fa[i] = static_cast<uint64_t>(m.mul(static_cast<int64_t>(fa[i]), static_cast<int64_t>(fb[i])));
+    ntt.inverse(fa.data());
+    EXPECT_EQ(fa, negacyclicProduct(a, b, q)) << "q = " << q;
+  }
+}
+
+TEST(ToyFheRlweNttTest, ExponentsAreTheOddResidues) {
+  const RlweNtt ntt(16, kDefaults.q);
+  std::vector<bool> seen(32, false);
+  for (std::size_t i = 0; i < 16; ++i) {
+    const std::size_t e = ntt.exponent(i);
+    ASSERT_EQ(e % 2, 1u);
+    ASSERT_LT(e, 32u);
+    EXPECT_FALSE(seen[e]);
+    seen[e] = true;
+  }
+}
+
+TEST(ToyFheRlweNttTest, RejectsModulusWithoutRoot) {
+  EXPECT_THROW(RlweNtt(16, 65537 * 2 + 1), std::runtime_error); // 131075 - 1 is not a multiple of 32
+  EXPECT_THROW(RlweNtt(12, kDefaults.q), std::runtime_error);
+}
+
+TEST_F(RlweEngineTest, EncryptDecryptEveryDivisorLength) {
+  for (std::size_t n : {std::size_t{1}, std::size_t{4}, std::size_t{32}}) {
+    std::vector<int64_t> values(n);
+    for (std::size_t i = 0; i < n; ++i)
+      values[i] = static_cast<int64_t>(i * 977) - 5000;
+    const RlweCiphertext cipher = engine_.encrypt(values.data(), n);
+    EXPECT_EQ(cipher.slots, n);
+    EXPECT_EQ(cipher.c0.size(), 64u);
+    EXPECT_EQ(roundTrip(cipher), values);
+    EXPECT_GT(engine_.noiseBudgetBits(cipher), 30);
+  }
+}
+
+TEST_F(RlweEngineTest, RejectsLengthsThatDoNotDivideTheRow) {
+  const std::vector<int64_t> values(64, 1);
+  EXPECT_THROW(engine_.encrypt(values.data(), 3), std::runtime_error);
+  EXPECT_THROW(engine_.encrypt(values.data(), 64), std::runtime_error);
+  EXPECT_THROW(engine_.encrypt(values.data(), 0), std::runtime_error);
+}
+
+TEST_F(RlweEngineTest, AdditiveOpsAreSlotWise) {
+  const std::vector<int64_t> a = {1, -2, 3, 40000, 5, 6, -7, 8};
+  const std::vector<int64_t> b = {10, 20, -30, 40, 50, 60, 70, 80};
+  const RlweCiphertext ca = engine_.encrypt(a.data(), a.size());
+  const RlweCiphertext cb = engine_.encrypt(b.data(), b.size());
+  RlweCiphertext out;
+
+  engine_.add(ca, cb, out);
+  std::vector<int64_t> got = roundTrip(out);
+  for (std::size_t i = 0; i < a.size(); ++i)
+    EXPECT_EQ(got[i], a[i] + b[i]);
+
+  engine_.sub(ca, cb, out);
+  got = roundTrip(out);
+  for (std::size_t i = 0; i < a.size(); ++i)
+    EXPECT_EQ(got[i], a[i] - b[i]);
+
+  engine_.negate(ca, out);
+  got = roundTrip(out);
+  for (std::size_t i = 0; i < a.size(); ++i)
+    EXPECT_EQ(got[i], -a[i]);
+
+  engine_.addPlain(ca, -9, out);
+  got = roundTrip(out);
+  for (std::size_t i = 0; i < a.size(); ++i)
+    EXPECT_EQ(got[i], a[i] - 9);
+
+  engine_.multiplyPlain(ca, 3, out);
+  got = roundTrip(out);
+  for (std::size_t i = 0; i < a.size(); ++i)
+    EXPECT_EQ(got[i], 3 * a[i]);
+
+  // In place.
+  RlweCiphertext acc = ca;
+  engine_.add(acc, cb, acc);
+  got = roundTrip(acc);
+  for (std::size_t i = 0; i < a.size(); ++i)
+    EXPECT_EQ(got[i], a[i] + b[i]);
+
+  const std::vector<int64_t> shorter = {1, 2, 3, 4};
+  EXPECT_THROW(engine_.add(ca, engine_.encrypt(shorter.data(), shorter.size()), out), std::runtime_error);
+}
+
+TEST_F(RlweEngineTest, MultiplyRelinearizesSlotWise) {
+  const std::vector<int64_t> a = {3, -1, 4, 1, -5, 9, 2, -6};
+  const std::vector<int64_t> b = {2, 7, -1, 8, 2, -8, 1, 8};
+  const RlweCiphertext ca = engine_.encrypt(a.data(), a.size());
+  const RlweCiphertext cb = engine_.encrypt(b.data(), b.size());
+  RlweCiphertext product;
+  engine_.multiply(ca, cb, product);
+  EXPECT_EQ(product.c0.size(), 64u);
+  EXPECT_EQ(product.c1.size(), 64u);
+  const std::vector<int64_t> got = roundTrip(product);
+  for (std::size_t i = 0; i < a.size(); ++i)
+    EXPECT_EQ(got[i], a[i] * b[i]);
+  EXPECT_GT(engine_.noiseBudgetBits(product), 0);
+  EXPECT_LT(engine_.noiseBudgetBits(product), engine_.noiseBudgetBits(ca));
+
+  // Squaring in place.
+  RlweCiphertext square = ca;
+  engine_.multiply(square, square, square);
+  const std::vector<int64_t> squared = roundTrip(square);
+  for (std::size_t i = 0; i < a.size(); ++i)
+    EXPECT_EQ(squared[i], a[i] * a[i]);
+}
+
+TEST_F(RlweEngineTest, RotateIsCyclicInTheVectorLength) {
+  for (std::size_t n : {std::size_t{8}, std::size_t{32}}) {
+    std::vector<int64_t> values(n);
+    for (std::size_t i = 0; i < n; ++i)
+      values[i] = static_cast<int64_t>(i + 1);
+    const RlweCiphertext cipher = engine_.encrypt(values.data(), n);
+    for (std::size_t d : {std::size_t{0}, std::size_t{1}, std::size_t{3}, n - 1, n, n + 5}) {
+      RlweCiphertext rotated;
+      engine_.rotate(cipher, d, rotated);
+      const std::vector<int64_t> got = roundTrip(rotated);
+      for (std::size_t i = 0; i < n; ++i)
+        ASSERT_EQ(got[i], values[(i + d) % n]) << "n = " << n << ", d = " << d << ", slot " << i;
+    }
+    RlweCiphertext inPlace = cipher;
+    engine_.rotate(inPlace, 5, inPlace);
+    const std::vector<int64_t> got = roundTrip(inPlace);
+    for (std::size_t i = 0; i < n; ++i)
+      EXPECT_EQ(got[i], values[(i + 5) % n]);
+  }
+}
+
+TEST_F(RlweEngineTest, DotProductByRotateAndAdd) {
+  const std::size_t n = 32;
+  std::vector<int64_t> a(n);
+  std::vector<int64_t> b(n);
+  int64_t dot = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    a[i] = static_cast<int64_t>(i % 10);
+    b[i] = static_cast<int64_t>((3 * i) % 10);
+    dot += a[i] * b[i];
+  }
+  RlweCiphertext acc;
+  engine_.multiply(engine_.encrypt(a.data(), n), engine_.encrypt(b.data(), n), acc);
+  for (std::size_t d = n / 2; d >= 1; d /= 2) {
+    RlweCiphertext rotated;
+    engine_.rotate(acc, d, rotated);
+    engine_.add(rotated, acc, acc);
+  }
+  EXPECT_GT(engine_.noiseBudgetBits(acc), 0);
+  for (int64_t slot : roundTrip(acc))
+    EXPECT_EQ(slot, dot);
+}
+
+TEST_F(RlweEngineTest, KeysFollowTheSeed) {
+  const std::vector<int64_t> values = {1, 2, 3, 4};
+  const RlweCiphertext cipher = engine_.encrypt(values.data(), values.size());
+
+  RlweEngine same;
+  same.initialize(engine_.parameters());
+  same.generateKeys(11);
+  std::vector<int64_t> out(values.size());
+  same.decrypt(cipher, out.data());
+  EXPECT_EQ(out, values);
+
+  RlweEngine other;
+  other.initialize(engine_.parameters());
+  other.generateKeys(12);
+  other.decrypt(cipher, out.data());
+  EXPECT_NE(out, values);
+}
+
+TEST(ToyFheRlweEngineTest, RejectsBadParametersAndMissingKeys) {
+  RlweEngine engine;
+  RlweParameters params;
+  params.ring_dim = 48;
+  EXPECT_THROW(engine.initialize(params), std::runtime_error);
+  params.ring_dim = 8;
+  EXPECT_THROW(engine.initialize(params), std::runtime_error);
+  params = RlweParameters{};
+  params.t = 65537 * 4 + 1; // not 1 mod 2N for N = 1024
+  EXPECT_THROW(engine.initialize(params), std::runtime_error);
+  params = RlweParameters{};
+  params.digit_bits = 0;
+  EXPECT_THROW(engine.initialize(params), std::runtime_error);
+  EXPECT_FALSE(engine.isInitialized());
+  EXPECT_THROW(engine.generateKeys(), std::runtime_error);
+
+  engine.initialize(RlweParameters{});
+  EXPECT_TRUE(engine.isInitialized());
+  EXPECT_FALSE(engine.areKeysGenerated());
+  const int64_t value = 1;
+  EXPECT_THROW(engine.encrypt(&value, 1), std::runtime_error);
+  EXPECT_EQ(engine.rowSlots(), 512u);
+}
@@ -0,0 +1,123 @@
+#include "Crypto/ToyFheSimd.h"
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+using namespace fhenomenon::toyfhe::simd;
+
+namespace {
+
+const int64_t kPowerOfTwoQ = static_cast<int64_t>(1) << 58;
+const int64_t kLargestQ = static_cast<int64_t>(1) << 62;
+const int64_t kOddQ = (static_cast<int64_t>(1) << 61) - 1;
+
+// Residues in [0, q) with the edges (0, 1, q - 1) spread through.
+std::vector<int64_t> residues(std::size_t n, int64_t q, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::uniform_int_distribution<int64_t> dist(0, q - 1);
+  std::vector<int64_t> values(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    switch (i % 7) {
+    case 0:
+      values[i] = 0;
+      break;
+    case 3:
+      values[i] = q - 1;
+      break;
+    case 5:
+      values[i] = 1;
+      break;
+    default:
+      values[i] = dist(rng);
+    }
+  }
+  return values;
+}
+
+std::vector<Isa> supportedIsas() {
+  std::vector<Isa> isas;
+  for (Isa isa : {Isa::Scalar, Isa::Avx2, Isa::Avx512}) {
+    if (supported(isa))
+      isas.push_back(isa);
+  }
+  return isas;
+}
+
+} // namespace
+
+TEST(ToyFheSimdTest, ScalarPathIsAlwaysSupported) {
+  EXPECT_TRUE(supported(Isa::Scalar));
+  EXPECT_TRUE(supported(best()));
+  EXPECT_STREQ(name(Isa::Scalar), "scalar");
+}
+
+TEST(ToyFheSimdTest, EveryIsaMatchesTheScalarPath) {
+  // Lengths around the 4- and 8-lane widths exercise the scalar tails.
+  for (int64_t q : {kPowerOfTwoQ, kLargestQ, kOddQ}) {
+    for (std::size_t n : {std::size_t{0}, std::size_t{1}, std::size_t{7}, std::size_t{8}, std::size_t{13},
+                          std::size_t{64}, std::size_t{515}}) {
+      const auto a = residues(n, q, 1);
+      const auto b = residues(n, q, 2);
+      std::vector<int64_t> expected(n);
+      std::vector<int64_t> got(n);
+      for (Isa isa : supportedIsas()) {
+        SCOPED_TRACE(name(isa));
+        addMod(Isa::Scalar, a.data(), b.data(), expected.data(), n, q);
+        addMod(isa, a.data(), b.data(), got.data(), n, q);
+        EXPECT_EQ(got, expected);
+        subMod(Isa::Scalar, a.data(), b.data(), expected.data(), n, q);
+        subMod(isa, a.data(), b.data(), got.data(), n, q);
+        EXPECT_EQ(got, expected);
+        negateMod(Isa::Scalar, a.data(), expected.data(), n, q);
+        negateMod(isa, a.data(), got.data(), n, q);
+        EXPECT_EQ(got, expected);
+        for (int64_t scalar : {int64_t{0}, int64_t{3}, int64_t{-5}, q - 1, (static_cast<int64_t>(1) << 40) + 7}) {
+          mulScalarMod(Isa::Scalar, a.data(), scalar, expected.data(), n, q);
+          mulScalarMod(isa, a.data(), scalar, got.data(), n, q);
+          EXPECT_EQ(got, expected);
+        }
+      }
+    }
+  }
+}
+
+TEST(ToyFheSimdTest, ScalarPathComputesResiduesModQ) {
+  const int64_t q = kOddQ;
+  const int64_t a[] = {0, 1, q - 1, q - 2};
+  const int64_t b[] = {0, q - 1, q - 1, 5};
+  int64_t out[4];
+  addMod(Isa::Scalar, a, b, out, 4, q);
+  EXPECT_EQ(out[0], 0);
+  EXPECT_EQ(out[1], 0);
+  EXPECT_EQ(out[2], q - 2);
+  EXPECT_EQ(out[3], 3);
+  subMod(Isa::Scalar, a, b, out, 4, q);
+  EXPECT_EQ(out[1], 2);
+  EXPECT_EQ(out[2], 0);
+  EXPECT_EQ(out[3], q - 7);
+  negateMod(Isa::Scalar, a, out, 4, q);
+  EXPECT_EQ(out[0], 0);
+  EXPECT_EQ(out[1], q - 1);
+  EXPECT_EQ(out[2], 1);
+  mulScalarMod(Isa::Scalar, a, -1, out, 4, q);
+  EXPECT_EQ(out[2], 1);
+  EXPECT_EQ(out[3], 2);
+}
+
+TEST(ToyFheSimdTest, OutputMayAliasAnInput) {
+  const std::size_t n = 37;
+  const auto a = residues(n, kPowerOfTwoQ, 3);
+  const auto b = residues(n, kPowerOfTwoQ, 4);
+  for (Isa isa : supportedIsas()) {
+    SCOPED_TRACE(name(isa));
+    std::vector<int64_t> expected(n);
+    addMod(Isa::Scalar, a.data(), b.data(), expected.data(), n, kPowerOfTwoQ);
+    mulScalarMod(Isa::Scalar, expected.data(), 9, expected.data(), n, kPowerOfTwoQ);
+
+    std::vector<int64_t> in_place = a;
+    addMod(isa, in_place.data(), b.data(), in_place.data(), n, kPowerOfTwoQ);
+    mulScalarMod(isa, in_place.data(), 9, in_place.data(), n, kPowerOfTwoQ);
+    EXPECT_EQ(in_place, expected);
+  }
+}
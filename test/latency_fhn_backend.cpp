@@ -0,0 +1,149 @@
+#include "FHN/fhn_backend_api.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// A CPU backend that SIMULATES a separate compute memory space: plaintext
+// int64 "ciphertexts", a virtual clock, and per-buffer residency. Kernels
+// cost kernel_ns and fail on operands that are not compute-resident (or
+// are mid-copy without a fence); synchronous prefetch/evict cost
+// transfer_ns on the compute timeline, while fhn_buffer_prefetch_async
+// queues the copy on a separate copy-engine timeline that
+// fhn_buffer_fence joins. lat_elapsed_ns() reads the clock, so tests can
+// compare schedules without real sleeps.
+//
+// config_json: {"transfer_ns": T, "kernel_ns": K} (defaults 1000 each).
+namespace {
+
+struct LatCtx {
+  uint64_t transfer_ns = 1000;
+  uint64_t kernel_ns = 1000;
+  uint64_t clock = 0;       // compute timeline
+  uint64_t copy_free = 0;   // copy engine busy until
+  uint32_t async_count = 0; // fhn_buffer_prefetch_async calls that started a copy
+};
+
+struct LatBuffer {
+  int64_t value = 0;
+  bool resident = true; // fresh device allocations are compute-resident
+  bool in_flight = false;
+  uint64_t ready_at = 0;
+};
+
+LatCtx *lat(FhnBackendCtx *ctx) { return reinterpret_cast<LatCtx *>(ctx); }
+LatBuffer *buf(FhnBuffer *b) { return reinterpret_cast<LatBuffer *>(b); }
+const LatBuffer *buf(const FhnBuffer *b) { return reinterpret_cast<const LatBuffer *>(b); }
+
+uint64_t configValue(const char *json, const char *key, uint64_t fallback) {
+  if (json == nullptr)
+    return fallback;
+  const char *at = std::strstr(json, key);
+  unsigned long long value = 0;
+  if (at == nullptr || std::sscanf(at + std::strlen(key), "\"%*[ :]%llu", &value) != 1)
+    return fallback;
+  return value;
+}
+
+// Runs one kernel: every operand must be resident and fenced.
+template <typename Op> int run(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands, Op op) {
+  for (int j = 0; j < 2; ++j) {
+    if (operands[j] == nullptr || !buf(operands[j])->resident || buf(operands[j])->in_flight)
+      return -2;
+  }
+  if (!buf(result)->resident)
+    return -2;
+  buf(result)->value = op(buf(operands[0])->value, buf(operands[1])->value);
+  lat(ctx)->clock += lat(ctx)->kernel_ns;
+  return 0;
+}
+
+int lat_add_cc(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+               const double *) {
+  return run(ctx, result, operands, [](int64_t a, int64_t b) { return a + b; });
+}
+
+int lat_mult_cc(FhnBackendCtx *ctx, FhnBuffer *result, const FhnBuffer *const *operands, const int64_t *,
+                const double *) {
+  return run(ctx, result, operands, [](int64_t a, int64_t b) { return a * b; });
+}
+
+FhnKernelEntry g_entries[] = {
+  {FHN_ADD_CC, lat_add_cc, "add_cc"},
+  {FHN_MULT_CC, lat_mult_cc, "mult_cc"},
+};
+FhnKernelTable g_table{2, g_entries};
+
+} // namespace
+
+extern "C" uint32_t lat_fhn_get_abi_version(void) { return FHN_ABI_VERSION; }
+extern "C" FhnBackendInfo *lat_fhn_get_info(void) {
+  static FhnBackendInfo info{"latency-fixture", "0", FHN_DEVICE_CPU, 0};
+  return &info;
+}
+extern "C" FhnBackendCtx *lat_fhn_create(const char *config_json) {
+  auto *ctx = new LatCtx;
+  ctx->transfer_ns = configValue(config_json, "\"transfer_ns", ctx->transfer_ns);
+  ctx->kernel_ns = configValue(config_json, "\"kernel_ns", ctx->kernel_ns);
+  return reinterpret_cast<FhnBackendCtx *>(ctx);
+}
+extern "C" void lat_fhn_destroy(FhnBackendCtx *ctx) { delete lat(ctx); }
+extern "C" FhnKernelTable *lat_fhn_get_kernels(FhnBackendCtx *) { return &g_table; }
+extern "C" FhnBuffer *lat_fhn_buffer_alloc(FhnBackendCtx *) { return reinterpret_cast<FhnBuffer *>(new LatBuffer); }
+extern "C" void lat_fhn_buffer_free(FhnBackendCtx *, FhnBuffer *buffer) { delete buf(buffer); }
+
+// Encryption writes host memory: the buffer needs a prefetch before use.
+extern "C" int lat_fhn_encrypt_i64(FhnBackendCtx *, FhnBuffer *out, int64_t value) {
+  buf(out)->value = value;
+  buf(out)->resident = false;
+  return 0;
+}
+extern "C" int lat_fhn_decrypt_i64(FhnBackendCtx *, const FhnBuffer *in, int64_t *value_out) {
+  *value_out = buf(in)->value;
+  return 0;
+}
+
+extern "C" int lat_fhn_buffer_fence(FhnBackendCtx *ctx, FhnBuffer *buffer) {
+  LatBuffer *b = buf(buffer);
+  if (b->in_flight) {
+    lat(ctx)->clock = std::max(lat(ctx)->clock, b->ready_at);
+    b->in_flight = false;
+    b->resident = true;
+  }
+  return 0;
+}
+extern "C" int lat_fhn_buffer_prefetch(FhnBackendCtx *ctx, FhnBuffer *buffer) {
+  LatBuffer *b = buf(buffer);
+  lat_fhn_buffer_fence(ctx, buffer);
+  if (!b->resident) {
+    lat(ctx)->clock += lat(ctx)->transfer_ns;
+    b->resident = true;
+  }
+  return 0;
+}
+extern "C" int lat_fhn_buffer_prefetch_async(FhnBackendCtx *ctx, FhnBuffer *buffer) {
+  LatBuffer *b = buf(buffer);
+  if (b->resident || b->in_flight)
+    return 0;
+  LatCtx *c = lat(ctx);
+  b->ready_at = std::max(c->clock, c->copy_free) + c->transfer_ns;
+  c->copy_free = b->ready_at;
+  b->in_flight = true;
+  ++c->async_count;
+  return 0;
+}
+extern "C" int lat_fhn_buffer_evict(FhnBackendCtx *ctx, FhnBuffer *buffer) {
+  LatBuffer *b = buf(buffer);
+  if (b->in_flight)
+    return -2; // the host must fence before evicting
+  if (b->resident) {
+    lat(ctx)->clock += lat(ctx)->transfer_ns;
+    b->resident = false;
+  }
+  return 0;
+}
+
+// Test-only introspection (not part of the ABI).
+extern "C" uint64_t lat_elapsed_ns(FhnBackendCtx *ctx) { return lat(ctx)->clock; }
+extern "C" uint32_t lat_async_count(FhnBackendCtx *ctx) { return lat(ctx)->async_count; }